@@ -39,6 +39,8 @@ let package = Package(
                 .linkedFramework("SwiftUI"),
                 .linkedFramework("CoreLocation"),
                 .linkedFramework("AVFoundation"),
+                .linkedFramework("Accelerate"),
+                .linkedFramework("ScreenCaptureKit"),
             ]
         ),
         .testTarget(
@@ -98,17 +98,24 @@ static void cfx_release_bytes(void *refcon, const void *base) {
   free((void *)base);
 }
 
-static void cfx_cg_release_data(void *info, const void *data, size_t size) {
-  (void)info; (void)size;
-  free((void *)data);
+static void cfx_release_planar(void *refcon, const void *data, size_t size,
+                               size_t count, const void *planes[]) {
+  (void)data; (void)size; (void)count; (void)planes;
+  free(refcon);
 }
 
-static CMSampleBufferRef cfx_build_cmsb(void) {
-  if (!cfx_shm_open()) return NULL;
+#define CFX_FMT_420V 0x34323076u  // '420v', Y plane then CbCr, same stride
+
+// Copy the shm frame out into a CVPixelBuffer of the published format
+// (vphoned may publish BGRA or 420v). Caller releases.
+static CVPixelBufferRef cfx_copy_pixel_buffer_from_shm(void) CF_RETURNS_RETAINED;
+static CVPixelBufferRef cfx_copy_pixel_buffer_from_shm(void) {
   const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
   uint32_t w = hdr->width, h = hdr->height, bpr = hdr->bytes_per_row;
+  uint32_t fmt = hdr->pixel_format;
   if (!w || !h || !bpr) { cfxlog(@"shm header zeros"); return NULL; }
-  size_t len = (size_t)bpr * h;
+  size_t luma = (size_t)bpr * h;
+  size_t len = fmt == CFX_FMT_420V ? luma + (size_t)bpr * ((h + 1) / 2) : luma;
   if ((size_t)CFX_SHM_HEADER_SIZE + len > cfx_shm_size) {
     cfxlog(@"shm: pixel range exceeds mapping"); return NULL;
   }
@@ -117,10 +124,60 @@ static CMSampleBufferRef cfx_build_cmsb(void) {
   memcpy(pixels, cfx_shm_base + CFX_SHM_HEADER_SIZE, len);
 
   CVPixelBufferRef pb = NULL;
-  CVReturn cvr = CVPixelBufferCreateWithBytes(
-      kCFAllocatorDefault, w, h, kCVPixelFormatType_32BGRA,
-      pixels, bpr, cfx_release_bytes, NULL, NULL, &pb);
+  CVReturn cvr;
+  if (fmt == CFX_FMT_420V) {
+    void *planes[2] = {pixels, (uint8_t *)pixels + luma};
+    size_t widths[2] = {w, (w + 1) / 2};
+    size_t heights[2] = {h, (h + 1) / 2};
+    size_t rows[2] = {bpr, bpr};
+    cvr = CVPixelBufferCreateWithPlanarBytes(
+        kCFAllocatorDefault, w, h, kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange,
+        NULL, 0, 2, planes, widths, heights, rows,
+        cfx_release_planar, pixels, NULL, &pb);
+  } else {
+    cvr = CVPixelBufferCreateWithBytes(
+        kCFAllocatorDefault, w, h, kCVPixelFormatType_32BGRA,
+        pixels, bpr, cfx_release_bytes, NULL, NULL, &pb);
+  }
   if (cvr != kCVReturnSuccess || !pb) { free(pixels); return NULL; }
+  return pb;
+}
+
+// 420v frames are not directly CGImage- or BGRA-representable; Core Image
+// converts them. One context is shared by every conversion.
+static CIContext *cfx_ci_context(void) {
+  static CIContext *ctx = nil;
+  static dispatch_once_t once;
+  dispatch_once(&once, ^{ ctx = [CIContext contextWithOptions:nil]; });
+  return ctx;
+}
+
+// Current 420v shm frame as a CIImage (which retains the copied buffer).
+static CIImage *cfx_ciimage_from_420v_shm(void) {
+  CVPixelBufferRef pb = cfx_copy_pixel_buffer_from_shm();
+  if (!pb) return nil;
+  CIImage *ci = [CIImage imageWithCVPixelBuffer:pb];
+  CVPixelBufferRelease(pb);
+  return ci;
+}
+
+static CGImageRef cfx_cgimage_from_420v_shm(void) CF_RETURNS_RETAINED;
+static CGImageRef cfx_cgimage_from_420v_shm(void) {
+  CIImage *ci = cfx_ciimage_from_420v_shm();
+  if (!ci) return NULL;
+  return [cfx_ci_context() createCGImage:ci fromRect:ci.extent];
+}
+
+static void cfx_cg_release_data(void *info, const void *data, size_t size) {
+  (void)info; (void)size;
+  free((void *)data);
+}
+
+static CMSampleBufferRef cfx_build_cmsb(void) {
+  if (!cfx_shm_open()) return NULL;
+  const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
+  CVPixelBufferRef pb = cfx_copy_pixel_buffer_from_shm();
+  if (!pb) return NULL;
   CMVideoFormatDescriptionRef desc = NULL;
   OSStatus s = CMVideoFormatDescriptionCreateForImageBuffer(
       kCFAllocatorDefault, pb, &desc);
@@ -324,6 +381,7 @@ static CGImageRef cfx_make_cgimage_from_shm(void) {
   const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
   uint32_t w = hdr->width, h = hdr->height, bpr = hdr->bytes_per_row;
   if (!w || !h || !bpr) return NULL;
+  if (hdr->pixel_format == CFX_FMT_420V) return cfx_cgimage_from_420v_shm();
   size_t len = (size_t)bpr * h;
   if ((size_t)CFX_SHM_HEADER_SIZE + len > cfx_shm_size) return NULL;
   CFDataRef data = CFDataCreate(kCFAllocatorDefault,
@@ -684,26 +742,9 @@ static void cfx_deliver_photo_to_delegate(id output, id delegate) {
 typedef struct { int32_t width, height; } cfx_video_dims_t;
 
 static NSData *cfx_build_jpeg_from_shm(uint32_t *outW, uint32_t *outH) {
-  if (!cfx_shm_open()) return nil;
-  const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
-  uint32_t w = hdr->width, h = hdr->height, bpr = hdr->bytes_per_row;
-  if (!w || !h || !bpr) return nil;
-  size_t len = (size_t)bpr * h;
-  if ((size_t)CFX_SHM_HEADER_SIZE + len > cfx_shm_size) return nil;
-
-  void *copy = malloc(len);
-  if (!copy) return nil;
-  memcpy(copy, cfx_shm_base + CFX_SHM_HEADER_SIZE, len);
-
-  CGColorSpaceRef cs = CGColorSpaceCreateDeviceRGB();
-  CGDataProviderRef dp = CGDataProviderCreateWithData(
-      NULL, copy, len, cfx_cg_release_data);
-  CGImageRef img = CGImageCreate(
-      w, h, 8, 32, bpr, cs,
-      (CGBitmapInfo)(kCGBitmapByteOrder32Little | kCGImageAlphaPremultipliedFirst),
-      dp, NULL, false, kCGRenderingIntentDefault);
-  CGDataProviderRelease(dp);
-  CGColorSpaceRelease(cs);
+  // Handles both transports; 420v goes through Core Image.
+  uint32_t w = 0, h = 0;
+  CGImageRef img = cfx_build_cgimage_from_shm(&w, &h);
   if (!img) return nil;
 
   NSMutableData *data = [NSMutableData data];
@@ -725,6 +766,12 @@ static CGImageRef cfx_build_cgimage_from_shm(uint32_t *outW, uint32_t *outH) CF_
   const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
   uint32_t w = hdr->width, h = hdr->height, bpr = hdr->bytes_per_row;
   if (!w || !h || !bpr) return NULL;
+  if (hdr->pixel_format == CFX_FMT_420V) {
+    CGImageRef img = cfx_cgimage_from_420v_shm();
+    if (img && outW) *outW = w;
+    if (img && outH) *outH = h;
+    return img;
+  }
   size_t len = (size_t)bpr * h;
   if ((size_t)CFX_SHM_HEADER_SIZE + len > cfx_shm_size) return NULL;
   void *copy = malloc(len);
@@ -749,6 +796,24 @@ static IOSurfaceRef cfx_build_iosurface_from_shm(uint32_t *outW, uint32_t *outH)
   const cfx_shm_header_t *hdr = (const cfx_shm_header_t *)cfx_shm_base;
   uint32_t w = hdr->width, h = hdr->height, bpr = hdr->bytes_per_row;
   if (!w || !h || !bpr) return NULL;
+  if (hdr->pixel_format == CFX_FMT_420V) {
+    // Render into an IOSurface-backed BGRA buffer so callers get the same
+    // surface format as the BGRA transport.
+    CIImage *ci = cfx_ciimage_from_420v_shm();
+    if (!ci) return NULL;
+    NSDictionary *attrs = @{(NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{}};
+    CVPixelBufferRef out = NULL;
+    if (CVPixelBufferCreate(kCFAllocatorDefault, w, h, kCVPixelFormatType_32BGRA,
+                            (__bridge CFDictionaryRef)attrs, &out) != kCVReturnSuccess || !out)
+      return NULL;
+    [cfx_ci_context() render:ci toCVPixelBuffer:out];
+    IOSurfaceRef surf = CVPixelBufferGetIOSurface(out);
+    if (surf) CFRetain(surf);
+    CVPixelBufferRelease(out);
+    if (surf && outW) *outW = w;
+    if (surf && outH) *outH = h;
+    return surf;
+  }
   size_t len = (size_t)bpr * h;
   if ((size_t)CFX_SHM_HEADER_SIZE + len > cfx_shm_size) return NULL;
   NSDictionary *props = @{
@@ -196,6 +196,7 @@ build_tweakloader() {
         -dynamiclib \
         -fobjc-arc -O3 \
         -framework Foundation \
+        -framework CoreFoundation \
         -o "$out" \
         "$src"
 
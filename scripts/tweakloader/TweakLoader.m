@@ -1,50 +1,122 @@
+#import <CoreFoundation/CoreFoundation.h>
 #import <Foundation/Foundation.h>
+#import <crt_externs.h>
 #import <dlfcn.h>
+#import <errno.h>
 #import <fcntl.h>
 #import <mach-o/dyld.h>
 #import <mach-o/loader.h>
+#import <os/lock.h>
+#import <pthread.h>
 #import <stdarg.h>
+#import <stdatomic.h>
+#import <stdio.h>
+#import <stdlib.h>
 #import <string.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <time.h>
 #import <unistd.h>
 
-static NSString *const kTweakDir = @"/var/jb/Library/MobileSubstrate/DynamicLibraries";
-static NSString *const kLogDir = @"/var/jb/var/mobile/Library/TweakLoader";
-static NSString *const kLogPath = @"/var/jb/var/mobile/Library/TweakLoader/tweakloader.log";
+static const char kTweakDir[] = "/var/jb/Library/MobileSubstrate/DynamicLibraries";
+static const char kLogDir[] = "/var/jb/var/mobile/Library/TweakLoader";
+static const char kLogPath[] = "/var/jb/var/mobile/Library/TweakLoader/tweakloader.log";
+static const char kIndexPath[] = "/var/jb/var/mobile/Library/TweakLoader/filters.idx";
+
+// MARK: - Logging
+
+// Lines are formatted on the stack and collected in a small buffer that is
+// flushed to a once-opened, append-only fd at the end of the load pass, after
+// each deferred dlopen and at exit. Processes that never log never open it.
+static os_unfair_lock gTLLogLock = OS_UNFAIR_LOCK_INIT;
+static pthread_once_t gTLLogOnce = PTHREAD_ONCE_INIT;
+static int gTLLogFd = -1;
+static char gTLLogBuf[4096];
+static size_t gTLLogLen = 0;
+
+// mkdir -p for a short absolute path.
+static void TLMakeDirs(const char *path) {
+    char buf[256];
+    size_t len = strlcpy(buf, path, sizeof(buf));
+    if (len >= sizeof(buf)) return;
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        (void)mkdir(buf, 0755);
+        *p = '/';
+    }
+    (void)mkdir(buf, 0755);
+}
+
+static void TLLogFlushLocked(void) {
+    if (gTLLogLen && gTLLogFd >= 0) (void)write(gTLLogFd, gTLLogBuf, gTLLogLen);
+    gTLLogLen = 0;
+}
+
+static void TLLogFlush(void) {
+    os_unfair_lock_lock(&gTLLogLock);
+    TLLogFlushLocked();
+    os_unfair_lock_unlock(&gTLLogLock);
+}
+
+static void TLLogOpen(void) {
+    TLMakeDirs(kLogDir);
+    gTLLogFd = open(kLogPath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (gTLLogFd >= 0) atexit(TLLogFlush);
+}
+
+static void TLLog(const char *format, ...) __printflike(1, 2);
+static void TLLog(const char *format, ...) {
+    pthread_once(&gTLLogOnce, TLLogOpen);
+    if (gTLLogFd < 0) return;
+
+    char line[1024];
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    size_t n = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S +0000 [TweakLoader] ", &tm);
 
-static void TLLog(NSString *format, ...) {
     va_list args;
     va_start(args, format);
-    NSString *message = [[NSString alloc] initWithFormat:format arguments:args];
+    int m = vsnprintf(line + n, sizeof(line) - n - 1, format, args);
     va_end(args);
+    if (m <= 0) return;
+    n += (size_t)m < sizeof(line) - n - 1 ? (size_t)m : sizeof(line) - n - 2;
+    line[n++] = '\n';
+
+    os_unfair_lock_lock(&gTLLogLock);
+    if (gTLLogLen + n > sizeof(gTLLogBuf)) TLLogFlushLocked();
+    memcpy(gTLLogBuf + gTLLogLen, line, n);
+    gTLLogLen += n;
+    os_unfair_lock_unlock(&gTLLogLock);
+}
 
-    if (!message.length) return;
-
-    [[NSFileManager defaultManager] createDirectoryAtPath:kLogDir
-                              withIntermediateDirectories:YES
-                                               attributes:nil
-                                                    error:nil];
-
-    NSString *line = [NSString stringWithFormat:@"%@ [TweakLoader] %@\n",
-                      [NSDate.date description],
-                      message];
-    NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
-    if (!data.length) return;
+// MARK: - Process Identity
 
-    int fd = open(kLogPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND, 0644);
-    if (fd < 0) return;
-    (void)write(fd, data.bytes, data.length);
-    close(fd);
+static const char *TLExecutablePath(void) {
+    char **argv = *_NSGetArgv();
+    return argv && argv[0] ? argv[0] : "";
 }
 
-static NSString *TLExecutableName(void) {
-    NSString *argv0 = NSProcessInfo.processInfo.arguments.firstObject;
-    if (argv0.length) return argv0.lastPathComponent;
-    return NSProcessInfo.processInfo.processName ?: @"unknown";
+static const char *TLExecutableName(void) {
+    const char *path = TLExecutablePath();
+    if (!*path) return getprogname() ?: "unknown";
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
 }
 
-static NSString *TLExecutablePath(void) {
-    NSString *argv0 = NSProcessInfo.processInfo.arguments.firstObject;
-    return argv0 ?: @"";
+// Main bundle identifier, or "" when there is none. Resolved on first use:
+// most processes are decided without it.
+static const char *TLBundleIdentifier(void) {
+    static char identifier[256];
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        CFBundleRef bundle = CFBundleGetMainBundle();
+        CFStringRef value = bundle ? CFBundleGetIdentifier(bundle) : NULL;
+        if (!value || !CFStringGetCString(value, identifier, sizeof(identifier), kCFStringEncodingUTF8))
+            identifier[0] = '\0';
+    });
+    return identifier;
 }
 
 // Daemons the loader is explicitly allowed to load tweaks into, even though
@@ -55,245 +127,513 @@ static NSString *TLExecutablePath(void) {
 // This list ONLY applies to tweaks WITHOUT Filter.Frameworks. Framework-
 // filtered tweaks engage in every process and self-limit based on which
 // frameworks are actually loaded — they don't need per-daemon entries here.
-static NSString *const kVPhoneAllowedDaemonPaths[] = {
-    @"/usr/libexec/cameracaptured",  // libvcamcaptured (Filter.Executables match)
+static const char *const kVPhoneAllowedDaemonPaths[] = {
+    "/usr/libexec/cameracaptured",  // libvcamcaptured (Filter.Executables match)
 };
 
 static BOOL TLShouldRunInCurrentProcess(void) {
-    NSString *execPath = TLExecutablePath();
-    if (!execPath.length) return NO;
+    const char *execPath = TLExecutablePath();
+    if (!*execPath) return NO;
 
     // vphone's hook runtime injects broadly, including launch-critical daemons
     // like xpcproxy, logd, notifyd, sshd, shells, and helper tools. Restrict the
     // user tweak loader to app binaries only — plus an allowlist of daemons
     // that explicitly opt in (see `kVPhoneAllowedDaemonPaths`).
-    if ([execPath containsString:@".app/"]) return YES;
+    if (strstr(execPath, ".app/")) return YES;
 
     for (size_t i = 0;
          i < sizeof(kVPhoneAllowedDaemonPaths) /
                  sizeof(kVPhoneAllowedDaemonPaths[0]);
          i++) {
-        if ([execPath isEqualToString:kVPhoneAllowedDaemonPaths[i]]) return YES;
+        if (strcmp(execPath, kVPhoneAllowedDaemonPaths[i]) == 0) return YES;
     }
 
     return NO;
 }
 
-static BOOL TLArrayContainsString(id obj, NSString *value) {
-    if (![obj isKindOfClass:[NSArray class]] || !value.length) return NO;
-    for (id item in (NSArray *)obj) {
-        if ([item isKindOfClass:[NSString class]] &&
-            [(NSString *)item isEqualToString:value]) {
-            return YES;
-        }
+// MARK: - Filter Index
+//
+// The tweak plists are compiled into one file so launch-time decisions are
+// hash probes into a read-only mapping. The index records the tweak
+// directory's mtime and inode, which any add, remove or rename changes, and
+// each plist's size and mtime, which catch a plist rewritten in place (the
+// installer's `cp -R` does that). Either mismatch makes the next process to
+// start rebuild it; checking costs one stat per plist.
+//
+// File layout (native endian):
+//   tl_index_header_t
+//   tl_index_tweak_t[tweak_count]   in directory listing order
+//   tl_index_key_t[key_count]       per tweak and kind, sorted by hash
+//   tl_index_source_t[source_count] every plist read by the build
+//   NUL-terminated strings          dylib paths, key values, plist paths
+
+#define TL_INDEX_MAGIC 0x49464C54u  // 'TLFI'
+#define TL_INDEX_VERSION 2u
+
+enum { TL_KEY_BUNDLE = 0, TL_KEY_EXECUTABLE = 1, TL_KEY_FRAMEWORK = 2, TL_KEY_KINDS = 3 };
+
+enum {
+    TL_TWEAK_BUNDLES = 1u << TL_KEY_BUNDLE,          // Filter.Bundles present
+    TL_TWEAK_EXECUTABLES = 1u << TL_KEY_EXECUTABLE,  // Filter.Executables present
+    TL_TWEAK_FRAMEWORKS = 1u << TL_KEY_FRAMEWORK,    // non-empty Filter.Frameworks
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t dir_mtime_sec;
+    int64_t dir_mtime_nsec;
+    uint64_t dir_ino;
+    uint32_t tweak_count;
+    uint32_t key_count;
+    uint32_t size;
+    uint32_t source_count;
+} tl_index_header_t;
+
+typedef struct {
+    uint32_t dylib;  // string offset
+    uint32_t flags;
+    uint32_t first[TL_KEY_KINDS];
+    uint32_t count[TL_KEY_KINDS];
+} tl_index_tweak_t;
+
+typedef struct {
+    uint64_t hash;
+    uint32_t string;  // offset of the value, checked on a hash hit
+    uint32_t reserved;
+} tl_index_key_t;
+
+typedef struct {
+    uint32_t path;  // string offset
+    uint32_t reserved;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} tl_index_source_t;
+
+typedef struct {
+    const uint8_t *base;
+    const tl_index_header_t *header;
+    const tl_index_tweak_t *tweaks;
+    const tl_index_key_t *keys;
+    const tl_index_source_t *sources;
+} tl_index_t;
+
+// FNV-1a.
+static uint64_t TLHash(const char *s, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 0x100000001b3ull;
     }
-    return NO;
+    return h;
 }
 
-static BOOL TLFilterMatches(NSDictionary *plist, NSString *bundleID, NSString *executableName) {
-    NSDictionary *filter = [plist isKindOfClass:[NSDictionary class]] ? plist[@"Filter"] : nil;
-    if (![filter isKindOfClass:[NSDictionary class]]) {
-        return YES;
+static BOOL TLIndexAttach(tl_index_t *ix, const void *base, size_t size, const struct stat *dirSt) {
+    const tl_index_header_t *h = base;
+    if (size < sizeof(*h) || h->magic != TL_INDEX_MAGIC || h->version != TL_INDEX_VERSION ||
+        h->size != size || h->dir_mtime_sec != dirSt->st_mtimespec.tv_sec ||
+        h->dir_mtime_nsec != dirSt->st_mtimespec.tv_nsec || h->dir_ino != dirSt->st_ino)
+        return NO;
+
+    size_t stringsStart = sizeof(*h) + (size_t)h->tweak_count * sizeof(tl_index_tweak_t) +
+                          (size_t)h->key_count * sizeof(tl_index_key_t) +
+                          (size_t)h->source_count * sizeof(tl_index_source_t);
+    const uint8_t *bytes = base;
+    if (stringsStart > size || bytes[size - 1] != '\0') return NO;
+
+    ix->base = bytes;
+    ix->header = h;
+    ix->tweaks = (const tl_index_tweak_t *)(bytes + sizeof(*h));
+    ix->keys = (const tl_index_key_t *)(ix->tweaks + h->tweak_count);
+    ix->sources = (const tl_index_source_t *)(ix->keys + h->key_count);
+
+    for (uint32_t i = 0; i < h->tweak_count; i++) {
+        const tl_index_tweak_t *t = &ix->tweaks[i];
+        if (t->dylib < stringsStart || t->dylib >= size) return NO;
+        for (int k = 0; k < TL_KEY_KINDS; k++) {
+            if (t->first[k] > h->key_count || t->count[k] > h->key_count - t->first[k]) return NO;
+        }
+    }
+    for (uint32_t i = 0; i < h->key_count; i++) {
+        if (ix->keys[i].string < stringsStart || ix->keys[i].string >= size) return NO;
+    }
+    for (uint32_t i = 0; i < h->source_count; i++) {
+        if (ix->sources[i].path < stringsStart || ix->sources[i].path >= size) return NO;
     }
+    return YES;
+}
 
-    id bundles = filter[@"Bundles"];
-    if ([bundles isKindOfClass:[NSArray class]]) {
-        if (!bundleID.length || !TLArrayContainsString(bundles, bundleID)) {
+// Whether every plist the index was built from still has its recorded size
+// and mtime. A plist added or removed changes the directory instead.
+static BOOL TLIndexSourcesCurrent(const tl_index_t *ix) {
+    for (uint32_t i = 0; i < ix->header->source_count; i++) {
+        const tl_index_source_t *src = &ix->sources[i];
+        struct stat st;
+        if (stat((const char *)ix->base + src->path, &st) != 0 || st.st_size != src->size ||
+            st.st_mtimespec.tv_sec != src->mtime_sec || st.st_mtimespec.tv_nsec != src->mtime_nsec)
             return NO;
-        }
     }
+    return YES;
+}
 
-    id executables = filter[@"Executables"];
-    if ([executables isKindOfClass:[NSArray class]]) {
-        if (!executableName.length || !TLArrayContainsString(executables, executableName)) {
-            return NO;
-        }
+// Map the on-disk index if it is current for `dirSt`. The mapping is kept
+// for the life of the process; a rebuild renames a new file over it.
+static BOOL TLIndexMap(tl_index_t *ix, const struct stat *dirSt) {
+    int fd = open(kIndexPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NO;
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NO;
+    if (TLIndexAttach(ix, base, (size_t)st.st_size, dirSt) && TLIndexSourcesCurrent(ix)) return YES;
+    munmap(base, (size_t)st.st_size);
+    return NO;
+}
+
+static const char *TLIndexString(const tl_index_t *ix, uint32_t offset) {
+    return (const char *)ix->base + offset;
+}
+
+// Whether `tweak`'s `kind` keys contain the `len` bytes at `value`.
+static BOOL TLIndexContains(const tl_index_t *ix, const tl_index_tweak_t *tweak, int kind,
+                            const char *value, size_t len) {
+    if (!len) return NO;
+    uint64_t hash = TLHash(value, len);
+    const tl_index_key_t *keys = ix->keys + tweak->first[kind];
+    uint32_t lo = 0, hi = tweak->count[kind];
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (keys[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < tweak->count[kind] && keys[lo].hash == hash; lo++) {
+        const char *s = TLIndexString(ix, keys[lo].string);
+        if (strncmp(s, value, len) == 0 && s[len] == '\0') return YES;
     }
+    return NO;
+}
 
+static BOOL TLFilterMatches(const tl_index_t *ix, const tl_index_tweak_t *tweak, const char *executableName) {
+    if (tweak->flags & TL_TWEAK_BUNDLES) {
+        const char *bundleID = TLBundleIdentifier();
+        if (!TLIndexContains(ix, tweak, TL_KEY_BUNDLE, bundleID, strlen(bundleID))) return NO;
+    }
+    if (tweak->flags & TL_TWEAK_EXECUTABLES) {
+        if (!TLIndexContains(ix, tweak, TL_KEY_EXECUTABLE, executableName, strlen(executableName))) return NO;
+    }
     return YES;
 }
 
-// Match a loaded dylib path against a "framework name" filter entry.
+// Match a loaded image path against a tweak's framework names.
 // "AVFoundation" matches any path containing "/AVFoundation.framework/" —
 // catches both /System/Library/Frameworks/... and PrivateFrameworks/....
-static BOOL TLPathMatchesFramework(const char *path, NSString *frameworkName) {
-    if (!path || !frameworkName.length) return NO;
-    NSString *needle = [NSString stringWithFormat:@"/%@.framework/", frameworkName];
-    return strstr(path, needle.UTF8String) != NULL;
+static BOOL TLPathMatchesFramework(const tl_index_t *ix, const tl_index_tweak_t *tweak, const char *path) {
+    static const char kSuffix[] = ".framework/";
+    if (!path) return NO;
+    for (const char *hit = strstr(path, kSuffix); hit; hit = strstr(hit + 1, kSuffix)) {
+        const char *name = hit;
+        while (name > path && name[-1] != '/') name--;
+        if (name == path) continue;  // needs the leading '/'
+        if (TLIndexContains(ix, tweak, TL_KEY_FRAMEWORK, name, (size_t)(hit - name))) return YES;
+    }
+    return NO;
 }
 
-// Pending framework-filtered tweaks: each entry is @{"dylib": path, "frameworks": @[name,...]}.
-static NSMutableArray<NSDictionary *> *gTLPendingFrameworkTweaks = nil;
-static NSLock *gTLPendingLock = nil;
-static dispatch_once_t gTLAddImageOnce;
+// MARK: - Index Build
 
-// dyld invokes add-image callbacks SYNCHRONOUSLY inside its loader lock.
-// Calling dlopen from here would recurse and can deadlock or crash early
-// daemons. Hand the actual dlopen off to a background queue so it runs
-// outside the loader lock — by the time it executes, the framework that
-// triggered it is fully loaded.
-static void TLOnImageAdded(const struct mach_header *mh, intptr_t slide) {
-    (void)slide;
-    Dl_info info; if (!dladdr((const void *)mh, &info)) return;
-    const char *cpath = info.dli_fname; if (!cpath) return;
-    NSString *imagePath = [NSString stringWithUTF8String:cpath];
-    if (!imagePath.length) return;
-
-    NSArray<NSDictionary *> *snapshot;
-    [gTLPendingLock lock];
-    snapshot = [gTLPendingFrameworkTweaks copy];
-    [gTLPendingLock unlock];
-    if (!snapshot.count) return;
-
-    NSMutableArray<NSString *> *toLoad = [NSMutableArray array];
-    for (NSDictionary *pending in snapshot) {
-        NSArray *frameworks = pending[@"frameworks"];
-        for (NSString *fw in frameworks) {
-            if (TLPathMatchesFramework(imagePath.UTF8String, fw)) {
-                [toLoad addObject:pending[@"dylib"]];
-                break;
-            }
-        }
+static void TLAppendString(NSMutableData *strings, NSString *value) {
+    const char *utf8 = value.UTF8String ?: "";
+    [strings appendBytes:utf8 length:strlen(utf8) + 1];
+}
+
+static NSArray<NSString *> *TLStringsIn(id obj) {
+    if (![obj isKindOfClass:[NSArray class]]) return @[];
+    NSMutableArray<NSString *> *out = [NSMutableArray array];
+    for (id item in (NSArray *)obj) {
+        if ([item isKindOfClass:[NSString class]] && [(NSString *)item length]) [out addObject:item];
     }
-    if (!toLoad.count) return;
+    return out;
+}
 
-    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
-        for (NSString *dylibPath in toLoad) {
-            void *h = dlopen(dylibPath.fileSystemRepresentation, RTLD_NOW | RTLD_GLOBAL);
-            if (h) TLLog(@"framework-deferred-load %@ -> %p (triggered by %@)",
-                         dylibPath, h, imagePath);
-            else   TLLog(@"framework-deferred-load failed for %@: %s",
-                         dylibPath, dlerror() ?: "unknown");
+// Compile the tweak directory, as of `dirSt`, into index bytes. This is the
+// only path that parses plists; filter semantics match the old per-launch
+// evaluation.
+static NSData *TLIndexBuild(const struct stat *dirSt) {
+    NSFileManager *fm = NSFileManager.defaultManager;
+    NSString *tweakDir = @(kTweakDir);
+    NSArray<NSString *> *files = [fm contentsOfDirectoryAtPath:tweakDir error:nil];
+
+    NSMutableArray<NSDictionary *> *tweaks = [NSMutableArray array];
+    NSMutableData *sourceTable = [NSMutableData data];
+    NSMutableArray<NSString *> *sourcePaths = [NSMutableArray array];
+    for (NSString *filename in files) {
+        if (![filename.pathExtension isEqualToString:@"plist"]) continue;
+        NSString *plistPath = [tweakDir stringByAppendingPathComponent:filename];
+        // Stat before reading, so a rewrite racing the build is seen as
+        // stale next time. Unusable plists are recorded too.
+        struct stat plistSt;
+        if (stat(plistPath.fileSystemRepresentation, &plistSt) == 0) {
+            tl_index_source_t src = {
+                .size = plistSt.st_size,
+                .mtime_sec = plistSt.st_mtimespec.tv_sec,
+                .mtime_nsec = plistSt.st_mtimespec.tv_nsec,
+            };
+            [sourceTable appendBytes:&src length:sizeof(src)];
+            [sourcePaths addObject:plistPath];
         }
-    });
-}
+        @try {
+            NSDictionary *plist = [NSDictionary dictionaryWithContentsOfFile:plistPath];
+            if (![plist isKindOfClass:[NSDictionary class]]) continue;
 
-// Schedule a tweak whose Filter.Frameworks needs at least one framework loaded.
-// If a matching framework is already in the process, dlopen via dispatch_async
-// (the constructor is still inside dyld's image loading sequence). Otherwise
-// queue it; the dyld add-image callback (also async-deferred) handles future.
-static void TLScheduleFrameworkTweak(NSString *dylibPath, NSArray *frameworks) {
-    // Already-loaded fast path: schedule dlopen on a background queue so it
-    // runs after the TweakLoader constructor returns and dyld is idle.
-    uint32_t n = _dyld_image_count();
-    for (uint32_t i = 0; i < n; i++) {
-        const char *p = _dyld_get_image_name(i);
-        for (NSString *fw in frameworks) {
-            if (TLPathMatchesFramework(p, fw)) {
-                TLLog(@"queueing %@ for async load (framework %@ already loaded as %s)",
-                      dylibPath, fw, p);
-                dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
-                    void *h = dlopen(dylibPath.fileSystemRepresentation, RTLD_NOW | RTLD_GLOBAL);
-                    if (h) TLLog(@"framework-load %@ -> %p", dylibPath, h);
-                    else   TLLog(@"framework-load failed for %@: %s",
-                                 dylibPath, dlerror() ?: "unknown");
-                });
-                return;
+            NSString *dylibPath = [[tweakDir stringByAppendingPathComponent:filename.stringByDeletingPathExtension]
+                stringByAppendingPathExtension:@"dylib"];
+            if (![fm isExecutableFileAtPath:dylibPath]) continue;
+
+            NSDictionary *filter = [plist[@"Filter"] isKindOfClass:[NSDictionary class]] ? plist[@"Filter"] : nil;
+            uint32_t flags = 0;
+            NSArray *keys[TL_KEY_KINDS] = {@[], @[], TLStringsIn(filter[@"Frameworks"])};
+            if ([keys[TL_KEY_FRAMEWORK] count]) {
+                flags |= TL_TWEAK_FRAMEWORKS;
+            } else {
+                if ([filter[@"Bundles"] isKindOfClass:[NSArray class]]) {
+                    flags |= TL_TWEAK_BUNDLES;
+                    keys[TL_KEY_BUNDLE] = TLStringsIn(filter[@"Bundles"]);
+                }
+                if ([filter[@"Executables"] isKindOfClass:[NSArray class]]) {
+                    flags |= TL_TWEAK_EXECUTABLES;
+                    keys[TL_KEY_EXECUTABLE] = TLStringsIn(filter[@"Executables"]);
+                }
             }
+            [tweaks addObject:@{
+                @"dylib": dylibPath,
+                @"flags": @(flags),
+                @"keys": @[keys[0], keys[1], keys[2]],
+            }];
+        } @catch (NSException *e) {
+            TLLog("Exception indexing %s: %s", filename.UTF8String, e.reason.UTF8String ?: "?");
         }
     }
 
-    // Queue for later; register the add-image callback once.
-    [gTLPendingLock lock];
-    if (!gTLPendingFrameworkTweaks) gTLPendingFrameworkTweaks = [NSMutableArray array];
-    [gTLPendingFrameworkTweaks addObject:@{@"dylib": dylibPath, @"frameworks": frameworks}];
-    [gTLPendingLock unlock];
+    uint32_t keyCount = 0;
+    for (NSDictionary *tweak in tweaks) {
+        for (NSArray *list in tweak[@"keys"]) keyCount += (uint32_t)list.count;
+    }
+    uint32_t stringsStart = (uint32_t)(sizeof(tl_index_header_t) + tweaks.count * sizeof(tl_index_tweak_t) +
+                                       keyCount * sizeof(tl_index_key_t) + sourceTable.length);
+
+    NSMutableData *tweakTable = [NSMutableData data];
+    NSMutableData *keyTable = [NSMutableData data];
+    NSMutableData *strings = [NSMutableData data];
+    uint32_t nextKey = 0;
+    for (NSDictionary *tweak in tweaks) {
+        tl_index_tweak_t t = {0};
+        t.dylib = stringsStart + (uint32_t)strings.length;
+        t.flags = [tweak[@"flags"] unsignedIntValue];
+        TLAppendString(strings, tweak[@"dylib"]);
+
+        NSArray<NSArray<NSString *> *> *lists = tweak[@"keys"];
+        for (int k = 0; k < TL_KEY_KINDS; k++) {
+            NSUInteger n = lists[k].count;
+            tl_index_key_t *sorted = calloc(n ? n : 1, sizeof(tl_index_key_t));
+            for (NSUInteger i = 0; i < n; i++) {
+                const char *utf8 = lists[k][i].UTF8String ?: "";
+                sorted[i].hash = TLHash(utf8, strlen(utf8));
+                sorted[i].string = stringsStart + (uint32_t)strings.length;
+                TLAppendString(strings, lists[k][i]);
+            }
+            qsort_b(sorted, n, sizeof(*sorted), ^int(const void *a, const void *b) {
+                uint64_t ha = ((const tl_index_key_t *)a)->hash, hb = ((const tl_index_key_t *)b)->hash;
+                return ha < hb ? -1 : ha > hb;
+            });
+            [keyTable appendBytes:sorted length:n * sizeof(*sorted)];
+            free(sorted);
+            t.first[k] = nextKey;
+            t.count[k] = (uint32_t)n;
+            nextKey += (uint32_t)n;
+        }
+        [tweakTable appendBytes:&t length:sizeof(t)];
+    }
+    tl_index_source_t *sources = sourceTable.mutableBytes;
+    for (NSUInteger i = 0; i < sourcePaths.count; i++) {
+        sources[i].path = stringsStart + (uint32_t)strings.length;
+        TLAppendString(strings, sourcePaths[i]);
+    }
+
+    tl_index_header_t h = {
+        .magic = TL_INDEX_MAGIC,
+        .version = TL_INDEX_VERSION,
+        .dir_mtime_sec = dirSt->st_mtimespec.tv_sec,
+        .dir_mtime_nsec = dirSt->st_mtimespec.tv_nsec,
+        .dir_ino = dirSt->st_ino,
+        .tweak_count = (uint32_t)tweaks.count,
+        .key_count = keyCount,
+        .source_count = (uint32_t)sourcePaths.count,
+    };
+    if (!strings.length) [strings appendBytes:"" length:1];
+    h.size = stringsStart + (uint32_t)strings.length;
+
+    NSMutableData *out = [NSMutableData dataWithBytes:&h length:sizeof(h)];
+    [out appendData:tweakTable];
+    [out appendData:keyTable];
+    [out appendData:sourceTable];
+    [out appendData:strings];
+    return out;
+}
+
+// Publish `data` as the index. Sandboxed processes usually cannot write
+// here; they use their in-memory copy and leave the rebuild to the next
+// process that can.
+static void TLIndexStore(NSData *data) {
+    TLMakeDirs(kLogDir);
+    char tmp[sizeof(kIndexPath) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", kIndexPath);
+    int fd = mkstemp(tmp);
+    if (fd < 0) return;
+    BOOL ok = write(fd, data.bytes, data.length) == (ssize_t)data.length;
+    fchmod(fd, 0644);
+    close(fd);
+    if (!ok || rename(tmp, kIndexPath) != 0) unlink(tmp);
+    else TLLog("rebuilt filter index (%u bytes)", (unsigned)data.length);
+}
 
-    dispatch_once(&gTLAddImageOnce, ^{
-        _dyld_register_func_for_add_image(TLOnImageAdded);
+// MARK: - Framework-Filtered Tweaks
+
+// Framework-filtered tweaks still waiting for a matching image. Filled once
+// before the add-image callback is registered and read-only afterwards.
+static tl_index_t gTLIndex;
+static uint32_t *gTLPendingTweaks = NULL;
+static _Atomic bool *gTLPendingScheduled = NULL;
+static uint32_t gTLPendingCount = 0;
+
+static void TLLoadDeferred(const char *dylibPath, const char *trigger) {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        void *h = dlopen(dylibPath, RTLD_NOW | RTLD_GLOBAL);
+        if (h) TLLog("framework-deferred-load %s -> %p (triggered by %s)", dylibPath, h, trigger);
+        else   TLLog("framework-deferred-load failed for %s: %s", dylibPath, dlerror() ?: "unknown");
+        TLLogFlush();
     });
 }
 
+// dyld invokes add-image callbacks SYNCHRONOUSLY inside its loader lock, and
+// once for every image already loaded at registration. Calling dlopen from
+// here would recurse and can deadlock or crash early daemons. Hand the actual
+// dlopen off to a background queue so it runs outside the loader lock — by
+// the time it executes, the framework that triggered it is fully loaded.
+static void TLOnImageAdded(const struct mach_header *mh, intptr_t slide) {
+    (void)slide;
+    Dl_info info; if (!dladdr((const void *)mh, &info)) return;
+    const char *path = info.dli_fname; if (!path) return;
+
+    for (uint32_t i = 0; i < gTLPendingCount; i++) {
+        if (atomic_load_explicit(&gTLPendingScheduled[i], memory_order_relaxed)) continue;
+        const tl_index_tweak_t *tweak = &gTLIndex.tweaks[gTLPendingTweaks[i]];
+        if (!TLPathMatchesFramework(&gTLIndex, tweak, path)) continue;
+        if (atomic_exchange(&gTLPendingScheduled[i], true)) continue;
+        // dli_fname points into dyld's image list and outlives the block.
+        TLLoadDeferred(TLIndexString(&gTLIndex, tweak->dylib), path);
+    }
+}
+
+// MARK: - Loading
+
 static void TLLoadTweaks(void) {
     // Two engagement tiers:
     //
-    //   1. Framework-filtered tweaks (Filter.Frameworks in plist): scanned
-    //      and scheduled in EVERY process. The schedule is a no-op unless
-    //      the named framework actually loads in this process — the dyld
-    //      add-image callback (dispatch_async'd dlopen) is what eventually
-    //      pulls the tweak in. Cost in non-AVF processes: one dir scan,
-    //      a few plist parses, one callback registration. Safe because
-    //      no dlopen happens until the framework appears.
+    //   1. Framework-filtered tweaks (Filter.Frameworks in plist): scheduled
+    //      in EVERY process. The schedule is a no-op unless the named
+    //      framework actually loads in this process — the dyld add-image
+    //      callback (dispatch_async'd dlopen) is what eventually pulls the
+    //      tweak in. Cost in non-AVF processes: one index probe per image,
+    //      one callback registration. Safe because no dlopen happens until
+    //      the framework appears.
     //
     //   2. Non-framework tweaks (Bundles/Executables filter or none):
     //      only run in .app/ processes and the explicit daemon allowlist
     //      (TLShouldRunInCurrentProcess). Keeping this gate avoids dropping
     //      arbitrary tweaks into launch-critical daemons by accident.
     //
-    // Everything below is wrapped in @try/@catch so a bad plist or
-    // Foundation quirk in an early-boot daemon can't crash the whole
-    // process and trigger a launchd respawn loop.
-    NSFileManager *fm = nil;
-    NSArray<NSString *> *files = nil;
-    @try {
-        fm = NSFileManager.defaultManager;
-        files = [fm contentsOfDirectoryAtPath:kTweakDir error:nil];
-    } @catch (NSException *e) {
-        return;
+    // Plist parsing only happens when the index is rebuilt, and is wrapped in
+    // @try/@catch so a bad plist or Foundation quirk in an early-boot daemon
+    // can't crash the whole process and trigger a launchd respawn loop.
+    struct stat dirSt;
+    if (stat(kTweakDir, &dirSt) != 0) return;
+
+    tl_index_t ix;
+    if (!TLIndexMap(&ix, &dirSt)) {
+        NSData *built = nil;
+        @autoreleasepool {
+            @try {
+                built = TLIndexBuild(&dirSt);
+            } @catch (NSException *e) {
+                return;
+            }
+            if (!built) return;
+            TLIndexStore(built);
+            // Kept for the life of the process, like the mapping.
+            void *copy = malloc(built.length);
+            if (!copy) return;
+            memcpy(copy, built.bytes, built.length);
+            if (!TLIndexAttach(&ix, copy, built.length, &dirSt)) {
+                free(copy);
+                return;
+            }
+        }
     }
-    if (!files.count) return;
+    uint32_t tweakCount = ix.header->tweak_count;
+    if (!tweakCount) return;
 
-    NSString *execPath = TLExecutablePath();
-    NSString *bundleID = NSBundle.mainBundle.bundleIdentifier ?: @"";
-    NSString *executableName = TLExecutableName();
+    const char *executableName = TLExecutableName();
     BOOL processAllowed = TLShouldRunInCurrentProcess();
-
-    if (gTLPendingLock == nil) gTLPendingLock = [[NSLock alloc] init];
-
-    for (NSString *filename in files) {
-        if (![filename.pathExtension isEqualToString:@"plist"]) continue;
-
-        NSDictionary *plist = nil;
-        NSString *dylibPath = nil;
-        @try {
-            NSString *plistPath = [kTweakDir stringByAppendingPathComponent:filename];
-            plist = [NSDictionary dictionaryWithContentsOfFile:plistPath];
-            if (![plist isKindOfClass:[NSDictionary class]]) continue;
-
-            NSString *baseName = filename.stringByDeletingPathExtension;
-            dylibPath = [[kTweakDir stringByAppendingPathComponent:baseName]
-                stringByAppendingPathExtension:@"dylib"];
-            if (![fm isExecutableFileAtPath:dylibPath]) continue;
-        } @catch (NSException *e) {
+    uint32_t pendingCount = 0;
+    uint32_t *pending = NULL;
+
+    for (uint32_t i = 0; i < tweakCount; i++) {
+        const tl_index_tweak_t *tweak = &ix.tweaks[i];
+        const char *dylibPath = TLIndexString(&ix, tweak->dylib);
+
+        if (tweak->flags & TL_TWEAK_FRAMEWORKS) {
+            // Universal: schedule in every process. No-op in processes
+            // where the named framework never loads.
+            if (!pending) pending = calloc(tweakCount, sizeof(*pending));
+            if (pending) pending[pendingCount++] = i;
             continue;
         }
 
-        @try {
-            NSDictionary *filter = plist[@"Filter"];
-            id frameworksRaw = [filter isKindOfClass:[NSDictionary class]] ? filter[@"Frameworks"] : nil;
-
-            if ([frameworksRaw isKindOfClass:[NSArray class]] &&
-                [(NSArray *)frameworksRaw count] > 0) {
-                // Universal: schedule in every process. No-op in processes
-                // where the named framework never loads.
-                TLScheduleFrameworkTweak(dylibPath, (NSArray *)frameworksRaw);
-                continue;
-            }
+        // Non-framework-filtered: keep the .app/+allowlist gate.
+        if (!processAllowed) continue;
+        if (!TLFilterMatches(&ix, tweak, executableName)) continue;
 
-            // Non-framework-filtered: keep the .app/+allowlist gate.
-            if (!processAllowed) continue;
-            if (!TLFilterMatches(plist, bundleID, executableName)) continue;
+        void *handle = dlopen(dylibPath, RTLD_NOW | RTLD_GLOBAL);
+        if (handle) {
+            TLLog("Loaded %s (exec=%s bundle=%s)", dylibPath, executableName, TLBundleIdentifier());
+        } else {
+            const char *err = dlerror();
+            TLLog("Failed to load %s: %s", dylibPath, err ?: "unknown error");
+        }
+    }
 
-            void *handle = dlopen(dylibPath.fileSystemRepresentation, RTLD_NOW | RTLD_GLOBAL);
-            if (handle) {
-                TLLog(@"Loaded %@ (exec=%@ bundle=%@)", dylibPath, executableName, bundleID);
-            } else {
-                const char *err = dlerror();
-                TLLog(@"Failed to load %@: %s", dylibPath, err ?: "unknown error");
-            }
-        } @catch (NSException *e) {
-            TLLog(@"Exception loading %@: %@", dylibPath, e);
+    if (pendingCount) {
+        gTLIndex = ix;
+        gTLPendingTweaks = pending;
+        gTLPendingScheduled = calloc(pendingCount, sizeof(*gTLPendingScheduled));
+        if (gTLPendingScheduled) {
+            gTLPendingCount = pendingCount;
+            // Also called back for every image already loaded.
+            _dyld_register_func_for_add_image(TLOnImageAdded);
         }
+    } else {
+        free(pending);
     }
-    (void)execPath;
+    TLLogFlush();
 }
 
 __attribute__((constructor))
 static void TweakLoaderInit(void) {
-    @autoreleasepool {
-        static dispatch_once_t onceToken;
-        dispatch_once(&onceToken, ^{
-            TLLoadTweaks();
-        });
-    }
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        TLLoadTweaks();
+    });
 }
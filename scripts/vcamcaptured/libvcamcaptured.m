@@ -92,6 +92,43 @@ typedef struct __attribute__((packed)) {
   uint32_t _pad;
 } vcc_shm_header_t;
 
+// Frame ring (vphoned_vcam_ring_t). Older vphoned builds only write the
+// single-slot header above; vcc_shm_map() falls back to that when the
+// file is too small or the magic is missing.
+#define VCC_RING_MAGIC 0x47524356u  // 'VCRG'
+#define VCC_RING_SLOTS 3
+#define VCC_RING_OFFSET                                                        \
+  ((VCC_SHM_TOTAL_SIZE + 0x3fff) & ~(size_t)0x3fff)
+#define VCC_RING_CTRL_SIZE 4096
+#define VCC_SHM_MAP_SIZE                                                       \
+  (VCC_RING_OFFSET + VCC_RING_CTRL_SIZE +                                      \
+   (size_t)(VCC_RING_SLOTS - 1) * VCC_SHM_MAX_PIXELS)
+#define VCC_RING_READ_RETRIES 3
+
+typedef struct __attribute__((packed)) {
+  uint64_t seq;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row;
+  uint32_t pixel_format;
+  uint64_t timestamp_ns;
+  uint64_t frame_index;
+  uint32_t pixels_length;
+  uint32_t _pad;
+  uint64_t pixels_offset;
+  uint64_t _reserved;
+} vcc_ring_slot_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_capacity;
+  uint64_t head;
+  uint8_t  _reserved[40];
+  vcc_ring_slot_t slots[VCC_RING_SLOTS];
+} vcc_ring_t;
+
 // MARK: - sentinel logging
 
 static NSString *const kSentinelPath =
@@ -2185,6 +2222,36 @@ static void vcc_cv_release_bytes(void *refcon, const void *baseAddress) {
   free((void *)baseAddress);
 }
 
+// Planar variant: refcon is the single malloc'd block backing both planes.
+static void vcc_cv_release_planar(void *refcon, const void *dataPtr,
+                                  size_t dataSize, size_t planeCount,
+                                  const void *planes[]) {
+  (void)dataPtr; (void)dataSize; (void)planeCount; (void)planes;
+  free(refcon);
+}
+
+#define VCC_FMT_420V 0x34323076u  // '420v', Y plane then CbCr, same stride
+
+// Wrap a malloc'd frame (ownership passes to the pixel buffer on success)
+// in a CVPixelBuffer of the published format.
+static CVReturn vcc_cv_create_from_frame(uint32_t w, uint32_t h, uint32_t bpr,
+                                         uint32_t fmt, void *pixels,
+                                         CVPixelBufferRef *out) {
+  if (fmt == VCC_FMT_420V) {
+    void *planes[2] = {pixels, (uint8_t *)pixels + (size_t)bpr * h};
+    size_t widths[2] = {w, (w + 1) / 2};
+    size_t heights[2] = {h, (h + 1) / 2};
+    size_t rows[2] = {bpr, bpr};
+    return CVPixelBufferCreateWithPlanarBytes(
+        kCFAllocatorDefault, w, h, kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange,
+        NULL, 0, 2, planes, widths, heights, rows,
+        vcc_cv_release_planar, pixels, NULL, out);
+  }
+  return CVPixelBufferCreateWithBytes(
+      kCFAllocatorDefault, w, h, kCVPixelFormatType_32BGRA,
+      pixels, bpr, vcc_cv_release_bytes, NULL, NULL, out);
+}
+
 static IMP vcc_vfs_init_orig = NULL;
 static IMP vcc_vfs_open_orig = NULL;
 static IMP vcc_vfs_close_orig = NULL;
@@ -2239,6 +2306,7 @@ static CMSampleBufferRef vcc_build_cmsb_from_shm(void) {
   uint32_t w = vcc_latest_frame.width;
   uint32_t h = vcc_latest_frame.height;
   uint32_t bpr = vcc_latest_frame.bytes_per_row;
+  uint32_t fmt = vcc_latest_frame.pixel_format;
   size_t len = vcc_latest_frame.pixels_length;
   if (!len || !w || !h || !bpr) {
     pthread_mutex_unlock(&vcc_latest_frame.lock);
@@ -2253,9 +2321,7 @@ static CMSampleBufferRef vcc_build_cmsb_from_shm(void) {
   pthread_mutex_unlock(&vcc_latest_frame.lock);
 
   CVPixelBufferRef pb = NULL;
-  CVReturn cvr = CVPixelBufferCreateWithBytes(
-      kCFAllocatorDefault, w, h, kCVPixelFormatType_32BGRA,
-      pixels, bpr, vcc_cv_release_bytes, NULL, NULL, &pb);
+  CVReturn cvr = vcc_cv_create_from_frame(w, h, bpr, fmt, pixels, &pb);
   if (cvr != kCVReturnSuccess || !pb) {
     free(pixels);
     return NULL;
@@ -3086,8 +3152,12 @@ vcc_latest_frame_t vcc_latest_frame = {
 };
 
 static const uint8_t *vcc_shm_base = NULL;
+static size_t vcc_shm_size = 0;
+static const vcc_ring_t *vcc_ring = NULL;
 static uint64_t vcc_last_seq_seen = 0;
+static uint64_t vcc_ring_cursor = 0;
 static uint64_t vcc_frames_received = 0;
+static uint64_t vcc_frames_skipped = 0;
 
 static int vcc_shm_map(void) {
   int fd = open(VCC_SHM_PATH, O_RDONLY);
@@ -3101,15 +3171,126 @@ static int vcc_shm_map(void) {
     close(fd);
     return -1;
   }
-  void *base = mmap(NULL, VCC_SHM_TOTAL_SIZE, PROT_READ,
-                    MAP_SHARED, fd, 0);
+  size_t map_size = st.st_size >= (off_t)VCC_SHM_MAP_SIZE
+                        ? VCC_SHM_MAP_SIZE
+                        : VCC_SHM_TOTAL_SIZE;
+  void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
   close(fd);
   if (base == MAP_FAILED) {
     vcc_log(@"  shm mmap failed: %s", strerror(errno));
     return -1;
   }
   vcc_shm_base = (const uint8_t *)base;
-  vcc_log(@"  shm mapped %s -> %p", VCC_SHM_PATH, vcc_shm_base);
+  vcc_shm_size = map_size;
+  if (map_size == VCC_SHM_MAP_SIZE) {
+    const vcc_ring_t *ring =
+        (const vcc_ring_t *)(vcc_shm_base + VCC_RING_OFFSET);
+    uint32_t magic = atomic_load_explicit(
+        (const _Atomic uint32_t *)&ring->magic, memory_order_acquire);
+    if (magic == VCC_RING_MAGIC && ring->slot_count == VCC_RING_SLOTS) {
+      vcc_ring = ring;
+    }
+  }
+  vcc_log(@"  shm mapped %s -> %p (%s)", VCC_SHM_PATH, vcc_shm_base,
+          vcc_ring ? "ring" : "single-slot");
+  return 0;
+}
+
+// Frames are copied out of the shm here first and only swapped into
+// vcc_latest_frame once the seqlock confirms the copy was not torn.
+// Reader queue only; the swap hands the previous latest buffer back as the
+// next scratch, so steady state allocates nothing.
+static uint8_t *vcc_scratch = NULL;
+static size_t vcc_scratch_capacity = 0;
+
+static const uint8_t *vcc_copy_to_scratch(const uint8_t *pixels,
+                                          uint32_t pix_len) {
+  if (vcc_scratch_capacity < pix_len) {
+    free(vcc_scratch);
+    vcc_scratch = (uint8_t *)malloc(pix_len);
+    vcc_scratch_capacity = vcc_scratch ? pix_len : 0;
+  }
+  if (!vcc_scratch) return NULL;
+  memcpy(vcc_scratch, pixels, pix_len);
+  return vcc_scratch;
+}
+
+// Publishes the validated scratch copy as vcc_latest_frame.
+static void vcc_publish_scratch(uint32_t pix_len, uint32_t w, uint32_t h,
+                                uint32_t bpr, uint32_t fmt, uint64_t ts,
+                                uint64_t idx) {
+  pthread_mutex_lock(&vcc_latest_frame.lock);
+  uint8_t *old = vcc_latest_frame.pixels;
+  size_t old_capacity = vcc_latest_frame.pixels_capacity;
+  vcc_latest_frame.pixels = vcc_scratch;
+  vcc_latest_frame.pixels_capacity = vcc_scratch_capacity;
+  vcc_latest_frame.pixels_length = pix_len;
+  vcc_latest_frame.width = w;
+  vcc_latest_frame.height = h;
+  vcc_latest_frame.bytes_per_row = bpr;
+  vcc_latest_frame.pixel_format = fmt;
+  vcc_latest_frame.timestamp_ns = ts;
+  vcc_latest_frame.frame_index = idx;
+  pthread_mutex_unlock(&vcc_latest_frame.lock);
+  vcc_scratch = old;
+  vcc_scratch_capacity = old ? old_capacity : 0;
+}
+
+static void vcc_log_frame(uint64_t idx, uint32_t w, uint32_t h,
+                          uint32_t bpr, uint32_t fmt) {
+  vcc_frames_received++;
+  if ((vcc_frames_received & 29) == 1) {
+    vcc_log(@"  shm frame #%llu (idx=%llu skipped=%llu) w=%u h=%u bpr=%u fmt=0x%08x",
+            (unsigned long long)vcc_frames_received,
+            (unsigned long long)idx,
+            (unsigned long long)vcc_frames_skipped, w, h, bpr, fmt);
+  }
+}
+
+// Ring path: always copy the newest published slot. The writer only ever
+// fills the slot after head, so a torn read means we were lapped by N-1
+// frames; reload head and try the newer slot.
+static int vcc_ring_read_latest(void) {
+  for (int attempt = 0; attempt < VCC_RING_READ_RETRIES; attempt++) {
+    uint64_t head = atomic_load_explicit(
+        (const _Atomic uint64_t *)&vcc_ring->head, memory_order_acquire);
+    if (head == 0 || head == vcc_ring_cursor) return 0;
+
+    const vcc_ring_slot_t *rs = &vcc_ring->slots[head % VCC_RING_SLOTS];
+    uint64_t seq_a = atomic_load_explicit(
+        (const _Atomic uint64_t *)&rs->seq, memory_order_acquire);
+    if (seq_a & 1ull) continue;
+
+    uint32_t w   = rs->width;
+    uint32_t h   = rs->height;
+    uint32_t bpr = rs->bytes_per_row;
+    uint32_t fmt = rs->pixel_format;
+    uint64_t ts  = rs->timestamp_ns;
+    uint64_t idx = rs->frame_index;
+    uint32_t pix_len = rs->pixels_length;
+    uint64_t off = rs->pixels_offset;
+
+    if (idx != head) continue;
+    if (pix_len == 0 || pix_len > VCC_SHM_MAX_PIXELS) return 0;
+    if (off < VCC_SHM_HEADER_SIZE || off + pix_len > vcc_shm_size) return 0;
+    if (w == 0 || h == 0 || bpr == 0 || pix_len < (size_t)bpr * h) return 0;
+
+    if (!vcc_copy_to_scratch(vcc_shm_base + off, pix_len)) return 0;
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t seq_b = atomic_load_explicit(
+        (const _Atomic uint64_t *)&rs->seq, memory_order_relaxed);
+    if (seq_b != seq_a) continue;
+
+    vcc_publish_scratch(pix_len, w, h, bpr, fmt, ts, idx);
+
+    if (vcc_ring_cursor && idx > vcc_ring_cursor + 1) {
+      vcc_frames_skipped += idx - vcc_ring_cursor - 1;
+    }
+    vcc_ring_cursor = idx;
+    vcc_log_frame(idx, w, h, bpr, fmt);
+    return 1;
+  }
   return 0;
 }
 
@@ -3117,6 +3298,7 @@ static int vcc_shm_map(void) {
 // fresh frame, 0 if seq hasn't advanced since last call or a read tore.
 static int vcc_shm_read_latest(void) {
   if (!vcc_shm_base) return 0;
+  if (vcc_ring) return vcc_ring_read_latest();
   const vcc_shm_header_t *hdr = (const vcc_shm_header_t *)vcc_shm_base;
 
   uint64_t seq_a = atomic_load_explicit(
@@ -3135,40 +3317,21 @@ static int vcc_shm_read_latest(void) {
   if (pix_len == 0 || pix_len > VCC_SHM_MAX_PIXELS) return 0;
   if (w == 0 || h == 0 || bpr == 0 || pix_len < (size_t)bpr * h) return 0;
 
-  pthread_mutex_lock(&vcc_latest_frame.lock);
-  if (vcc_latest_frame.pixels_capacity < pix_len) {
-    free(vcc_latest_frame.pixels);
-    vcc_latest_frame.pixels = (uint8_t *)malloc(pix_len);
-    vcc_latest_frame.pixels_capacity =
-        vcc_latest_frame.pixels ? pix_len : 0;
-  }
-  if (vcc_latest_frame.pixels) {
-    memcpy(vcc_latest_frame.pixels,
-           vcc_shm_base + VCC_SHM_HEADER_SIZE, pix_len);
-    vcc_latest_frame.pixels_length = pix_len;
-    vcc_latest_frame.width = w;
-    vcc_latest_frame.height = h;
-    vcc_latest_frame.bytes_per_row = bpr;
-    vcc_latest_frame.pixel_format = fmt;
-    vcc_latest_frame.timestamp_ns = ts;
-    vcc_latest_frame.frame_index = idx;
-  }
-  pthread_mutex_unlock(&vcc_latest_frame.lock);
+  if (!vcc_copy_to_scratch(vcc_shm_base + VCC_SHM_HEADER_SIZE, pix_len))
+    return 0;
 
   // Re-check seq after copy. If it advanced past our snapshot+1 we may
   // have torn — but the writer always sets even seq AFTER pixel write,
   // so seeing the same even seq means our copy was clean.
+  atomic_thread_fence(memory_order_acquire);
   uint64_t seq_b = atomic_load_explicit(
-      (const _Atomic uint64_t *)&hdr->seq, memory_order_acquire);
+      (const _Atomic uint64_t *)&hdr->seq, memory_order_relaxed);
   if (seq_b != seq_a) return 0;
 
+  vcc_publish_scratch(pix_len, w, h, bpr, fmt, ts, idx);
+
   vcc_last_seq_seen = seq_a;
-  vcc_frames_received++;
-  if ((vcc_frames_received & 29) == 1) {
-    vcc_log(@"  shm frame #%llu (idx=%llu) w=%u h=%u bpr=%u fmt=0x%08x",
-            (unsigned long long)vcc_frames_received,
-            (unsigned long long)idx, w, h, bpr, fmt);
-  }
+  vcc_log_frame(idx, w, h, bpr, fmt);
   return 1;
 }
 
@@ -3178,9 +3341,12 @@ static void vcc_start_frame_receiver(void) {
     return;
   }
   // Subscribe to vphoned's notification. Each fire = one frame ready.
+  // Serial, since the reader's scratch buffer and cursors are unlocked.
   int token = -1;
-  dispatch_queue_t q =
-      dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+  dispatch_queue_t q = dispatch_queue_create(
+      "com.vphone.vcamcaptured.frames",
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL,
+                                              QOS_CLASS_USER_INITIATED, 0));
   uint32_t status = notify_register_dispatch(
       VCC_NOTIFY_NAME, &token, q,
       ^(__unused int t) {
@@ -1,12 +1,15 @@
 #!/bin/zsh
 # vm_backup.sh — Save the current VM as a named backup.
 #
-# Backups are stored under vm.backups/<name>/.
+# Backups are stored under vm.backups/<name>/. With SNAPSHOT_STORE set they
+# go into that deduplicated block store instead (see vm_snapshot.py), which
+# may live on another disk or a mounted NAS share.
 # The active VM remembers its name in vm/.vm_name for use by vm_switch.
 #
 # Usage:
 #   make vm_backup NAME=ios17
 #   make vm_backup NAME=ios18-jb BACKUP_INCLUDE_IPSW=1
+#   make vm_backup NAME=ios17 SNAPSHOT_STORE=/Volumes/nas/vphone-snapshots
 set -euo pipefail
 
 # Try cp -c for APFS clone/COW first; fall back to cp -a where -c is unsupported.
@@ -16,16 +19,29 @@ _vphone_cp() {
 
 VM_DIR="${VM_DIR:-vm}"
 BACKUPS_DIR="${BACKUPS_DIR:-vm.backups}"
+SNAPSHOT_STORE="${SNAPSHOT_STORE:-}"
 NAME="${NAME:-}"
 BACKUP_INCLUDE_IPSW="${BACKUP_INCLUDE_IPSW:-0}"
+SCRIPT_DIR="${0:a:h}"
+
+# Prefer the project venv's python3 for vm_snapshot.py.
+_resolve_python3() {
+    local venv_py="${SCRIPT_DIR:h}/.venv/bin/python3"
+    if [[ -x "$venv_py" ]]; then
+        echo "$venv_py"
+    else
+        command -v python3 || true
+    fi
+}
 
 # --- Parse args ---
 while [[ $# -gt 0 ]]; do
     case "$1" in
         --name)          NAME="$2"; shift 2 ;;
         --include-ipsw)  BACKUP_INCLUDE_IPSW=1; shift ;;
+        --store)         SNAPSHOT_STORE="$2"; shift 2 ;;
         -h|--help)
-            echo "Usage: $0 --name <name> [--include-ipsw]"
+            echo "Usage: $0 --name <name> [--include-ipsw] [--store <snapshot store>]"
             exit 0
             ;;
         *) echo "Unknown option: $1"; exit 1 ;;
@@ -64,6 +80,29 @@ if pgrep -f "vphone-cli.*--config.*${VM_DIR}" >/dev/null 2>&1; then
     [[ "${answer}" =~ ^[Yy]$ ]] || exit 1
 fi
 
+# --- Snapshot store ---
+if [[ -n "${SNAPSHOT_STORE}" ]]; then
+    PYTHON3="$(_resolve_python3)"
+    [[ -x "${PYTHON3}" ]] || { echo "ERROR: python3 not found. Run: make setup_venv"; exit 1; }
+
+    echo "=== vphone vm_backup (snapshot) ==="
+    echo "Name   : ${NAME}"
+    echo "Source : ${VM_DIR}/"
+    echo "Store  : ${SNAPSHOT_STORE}/"
+    echo ""
+
+    snapshot_args=(save --store "${SNAPSHOT_STORE}" --vm-dir "${VM_DIR}" --name "${NAME}")
+    [[ "${BACKUP_INCLUDE_IPSW}" == "1" ]] && snapshot_args+=(--include-ipsw)
+    echo "${NAME}" > "${VM_DIR}/.vm_name"
+    "${PYTHON3}" "${SCRIPT_DIR}/vm_snapshot.py" "${snapshot_args[@]}"
+
+    echo ""
+    echo "=== Saved as '${NAME}' ==="
+    echo "To restore : make vm_restore NAME=${NAME} SNAPSHOT_STORE=${SNAPSHOT_STORE}"
+    echo "Reclaim    : make vm_snapshot_gc SNAPSHOT_STORE=${SNAPSHOT_STORE}"
+    exit 0
+fi
+
 DEST="${BACKUPS_DIR}/${NAME}"
 
 echo "=== vphone vm_backup ==="
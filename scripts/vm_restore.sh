@@ -4,6 +4,7 @@
 # Usage:
 #   make vm_restore NAME=ios17
 #   make vm_restore NAME=ios17 FORCE=1
+#   make vm_restore NAME=ios17 SNAPSHOT_STORE=/Volumes/nas/vphone-snapshots
 
 set -euo pipefail
 
@@ -14,8 +15,20 @@ _vphone_cp() {
 
 VM_DIR="${VM_DIR:-vm}"
 BACKUPS_DIR="${BACKUPS_DIR:-vm.backups}"
+SNAPSHOT_STORE="${SNAPSHOT_STORE:-}"
 NAME="${NAME:-}"
 FORCE="${FORCE:-0}"
+SCRIPT_DIR="${0:a:h}"
+
+# Prefer the project venv's python3 for vm_snapshot.py.
+_resolve_python3() {
+    local venv_py="${SCRIPT_DIR:h}/.venv/bin/python3"
+    if [[ -x "$venv_py" ]]; then
+        echo "$venv_py"
+    else
+        command -v python3 || true
+    fi
+}
 
 validate_backup_name() {
     local name="$1"
@@ -33,6 +46,10 @@ validate_backup_name() {
 }
 
 list_backups() {
+    if [[ -n "${SNAPSHOT_STORE}" ]]; then
+        "$(_resolve_python3)" "${SCRIPT_DIR}/vm_snapshot.py" list --store "${SNAPSHOT_STORE}"
+        return
+    fi
     if [[ ! -d "${BACKUPS_DIR}" ]]; then
         echo "  (none)"
         return
@@ -69,8 +86,9 @@ while [[ $# -gt 0 ]]; do
     case "$1" in
         --name)  NAME="$2"; shift 2 ;;
         --force) FORCE=1; shift ;;
+        --store) SNAPSHOT_STORE="$2"; shift 2 ;;
         -h|--help)
-            echo "Usage: $0 --name <name> [--force]"
+            echo "Usage: $0 --name <name> [--force] [--store <snapshot store>]"
             exit 0
             ;;
         *) echo "Unknown option: $1"; exit 1 ;;
@@ -91,15 +109,24 @@ validate_backup_name "${NAME}"
 SRC="${BACKUPS_DIR}/${NAME}"
 
 # --- Validate backup ---
-if [[ ! -d "${SRC}" ]]; then
+if [[ -n "${SNAPSHOT_STORE}" ]]; then
+    PYTHON3="$(_resolve_python3)"
+    [[ -x "${PYTHON3}" ]] || { echo "ERROR: python3 not found. Run: make setup_venv"; exit 1; }
+    if ! "${PYTHON3}" "${SCRIPT_DIR}/vm_snapshot.py" exists --store "${SNAPSHOT_STORE}" --name "${NAME}"; then
+        echo "ERROR: Snapshot '${NAME}' not found in ${SNAPSHOT_STORE}/"
+        echo ""
+        echo "Available snapshots:"
+        list_backups
+        exit 1
+    fi
+    SRC="${SNAPSHOT_STORE}"
+elif [[ ! -d "${SRC}" ]]; then
     echo "ERROR: Backup '${NAME}' not found at ${SRC}/"
     echo ""
     echo "Available backups:"
     list_backups
     exit 1
-fi
-
-if [[ ! -f "${SRC}/config.plist" ]]; then
+elif [[ ! -f "${SRC}/config.plist" ]]; then
     echo "ERROR: ${SRC}/config.plist not found — backup appears invalid."
     exit 1
 fi
@@ -128,11 +155,30 @@ echo "=== vphone vm_restore ==="
 echo "Name   : ${NAME}"
 echo "Source : ${SRC}/"
 echo "Dest   : ${VM_DIR}/"
-backup_size="$(du -sh "${SRC}" 2>/dev/null | cut -f1)"
-echo "Size   : ${backup_size} (on disk)"
+if [[ -z "${SNAPSHOT_STORE}" ]]; then
+    backup_size="$(du -sh "${SRC}" 2>/dev/null | cut -f1)"
+    echo "Size   : ${backup_size} (on disk)"
+fi
 echo ""
 
 # --- Restore ---
+if [[ -n "${SNAPSHOT_STORE}" ]]; then
+    # Rebuild next to the VM, cloning files the current VM already has,
+    # then swap it in.
+    TMP_VM_DIR="${VM_DIR}.restore.$$"
+    rm -rf -- "${TMP_VM_DIR}"
+    "${PYTHON3}" "${SCRIPT_DIR}/vm_snapshot.py" restore --store "${SNAPSHOT_STORE}" --name "${NAME}" \
+        --dest "${TMP_VM_DIR}" --reuse "${VM_DIR}" || { rm -rf -- "${TMP_VM_DIR}"; exit 1; }
+    safe_clear_vm_dir
+    find "${TMP_VM_DIR}" -mindepth 1 -maxdepth 1 -exec mv -- {} "${VM_DIR}/" \;
+    rmdir "${TMP_VM_DIR}"
+    echo "${NAME}" > "${VM_DIR}/.vm_name"
+    echo ""
+    echo "=== Restored '${NAME}' ==="
+    echo "Next: make boot"
+    exit 0
+fi
+
 safe_clear_vm_dir
 
 while IFS= read -r -d '' item; do
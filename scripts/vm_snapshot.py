@@ -0,0 +1,494 @@
+#!/usr/bin/env python3
+"""
+vm_snapshot.py — Deduplicated, incremental VM snapshots in a block store.
+
+Every file in the VM directory is split into fixed 1 MiB blocks that are
+stored once, under their SHA-256, in a shared store:
+
+    <store>/blocks/ab/abcdef...        raw block
+    <store>/blocks/ab/abcdef....z      zlib-compressed block
+    <store>/snapshots/<name>.json      file list + block hashes
+
+All-zero blocks are not stored; they restore as holes in a sparse file.
+Holes in the source are found with SEEK_DATA/SEEK_HOLE and recorded as zero
+blocks without being read, so a save reads only the allocated data.
+Disk.img is written by the guest filesystem in aligned blocks, so fixed
+blocks dedupe as well as content-defined chunking would, without a rolling
+hash over 64 GB. Snapshots of the same base share all untouched blocks.
+
+The store can be any mounted path: a second disk, an external SSD, or an
+SMB/NFS share. Files whose size, mtime and inode match the previous save
+reuse the recorded block list (cached in <vm>/.snapshot_index.json), so
+unchanged IPSW directories and ROMs are not re-read.
+
+Usage:
+    vm_snapshot.py save    --store S --vm-dir vm --name N [--include-ipsw]
+    vm_snapshot.py restore --store S --name N --dest DIR [--reuse vm]
+    vm_snapshot.py list    --store S
+    vm_snapshot.py delete  --store S --name N
+    vm_snapshot.py gc      --store S [--dry-run]
+
+Do not run gc while a save to the same store is in progress.
+"""
+
+from __future__ import annotations
+
+import argparse
+import concurrent.futures
+import errno
+import hashlib
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import zlib
+from pathlib import Path
+
+BLOCK_SIZE = 1 << 20
+FORMAT_VERSION = 1
+INDEX_NAME = ".snapshot_index.json"
+ZERO_BLOCK_HASH = hashlib.sha256(bytes(BLOCK_SIZE)).hexdigest()
+WORKERS = max(4, min(16, (os.cpu_count() or 4) * 2))
+# Blocks in flight per file; bounds memory to about WORKERS * 2 MiB.
+MAX_PENDING = WORKERS * 2
+
+
+class SnapshotError(Exception):
+    pass
+
+
+# ─── Store ───────────────────────────────────────────────────────
+
+
+class BlockStore:
+    def __init__(self, root: Path):
+        self.root = root
+        self.blocks = root / "blocks"
+        self.snapshots = root / "snapshots"
+        self._known: set[str] = set()
+        self._lock = threading.Lock()
+
+    def ensure(self):
+        self.blocks.mkdir(parents=True, exist_ok=True)
+        self.snapshots.mkdir(parents=True, exist_ok=True)
+
+    def _path(self, digest: str) -> Path:
+        return self.blocks / digest[:2] / digest
+
+    def has(self, digest: str) -> bool:
+        with self._lock:
+            if digest in self._known:
+                return True
+        base = self._path(digest)
+        found = base.exists() or base.with_name(digest + ".z").exists()
+        if found:
+            with self._lock:
+                self._known.add(digest)
+        return found
+
+    def put(self, digest: str, data: bytes) -> int:
+        """Store `data` unless present. Returns the bytes written."""
+        if self.has(digest):
+            return 0
+        packed = zlib.compress(data, 1)
+        target = self._path(digest)
+        if len(packed) < len(data) * 0.9:
+            target = target.with_name(digest + ".z")
+            data = packed
+        target.parent.mkdir(parents=True, exist_ok=True)
+        # Write-then-rename so an interrupted save never leaves a torn block.
+        fd, tmp = tempfile.mkstemp(dir=target.parent, prefix=".tmp-")
+        try:
+            with os.fdopen(fd, "wb") as f:
+                f.write(data)
+            os.replace(tmp, target)
+        except BaseException:
+            os.unlink(tmp)
+            raise
+        with self._lock:
+            self._known.add(digest)
+        return len(data)
+
+    def get(self, digest: str) -> bytes:
+        base = self._path(digest)
+        try:
+            data = base.read_bytes()
+        except FileNotFoundError:
+            try:
+                data = zlib.decompress(base.with_name(digest + ".z").read_bytes())
+            except FileNotFoundError:
+                raise SnapshotError(f"missing block {digest}") from None
+        if hashlib.sha256(data).hexdigest() != digest:
+            raise SnapshotError(f"corrupt block {digest}")
+        return data
+
+    def all_blocks(self):
+        for sub in self.blocks.glob("??"):
+            for p in sub.iterdir():
+                if not p.name.startswith(".tmp-"):
+                    yield p
+
+    def manifest_path(self, name: str) -> Path:
+        return self.snapshots / f"{name}.json"
+
+    def load_manifest(self, name: str) -> dict:
+        path = self.manifest_path(name)
+        if not path.exists():
+            raise SnapshotError(f"snapshot '{name}' not found in {self.root}")
+        manifest = json.loads(path.read_text())
+        if manifest.get("version") != FORMAT_VERSION:
+            raise SnapshotError(f"snapshot '{name}' has unsupported format {manifest.get('version')}")
+        return manifest
+
+    def write_manifest(self, name: str, manifest: dict):
+        path = self.manifest_path(name)
+        tmp = path.with_name(f".{path.name}.tmp")
+        tmp.write_text(json.dumps(manifest, separators=(",", ":")))
+        os.replace(tmp, path)
+
+
+# ─── Save ────────────────────────────────────────────────────────
+
+
+def _walk(vm_dir: Path, include_ipsw: bool):
+    """Yield (relative path, lstat) for everything under vm_dir, parents first."""
+    for root, dirs, files in os.walk(vm_dir):
+        rel_root = Path(root).relative_to(vm_dir)
+        if rel_root == Path("."):
+            if not include_ipsw:
+                dirs[:] = [d for d in dirs if "_Restore" not in d]
+            files = [f for f in files if f != INDEX_NAME]
+        dirs.sort()
+        for name in sorted(dirs) + sorted(files):
+            path = Path(root) / name
+            yield rel_root / name, path.lstat()
+
+
+def _data_blocks(fd: int, size: int):
+    """Yield, in order, the index of every block that holds allocated data.
+
+    Blocks lying entirely in a hole are skipped. Where the filesystem cannot
+    report holes, the remaining blocks are all yielded.
+    """
+    seek_data = getattr(os, "SEEK_DATA", None)
+    seek_hole = getattr(os, "SEEK_HOLE", None)
+    last = -1
+    offset = 0
+    while offset < size:
+        try:
+            if seek_data is None or seek_hole is None:
+                raise OSError(errno.EINVAL, "no SEEK_DATA")
+            start = os.lseek(fd, offset, seek_data)
+            end = min(os.lseek(fd, start, seek_hole), size)
+        except OSError as e:
+            if e.errno == errno.ENXIO:
+                return  # only a hole remains
+            start, end = offset, size
+        for index in range(max(start // BLOCK_SIZE, last + 1), (end + BLOCK_SIZE - 1) // BLOCK_SIZE):
+            yield index
+            last = index
+        offset = max(end, offset + 1)
+
+
+def _hash_file(store: BlockStore, path: Path, pool, stats: dict) -> list[str | None]:
+    size = path.stat().st_size
+    count = (size + BLOCK_SIZE - 1) // BLOCK_SIZE
+    # None is the zero marker; blocks in holes are never read.
+    hashes: list[str | None] = [None] * count
+    fd = os.open(path, os.O_RDONLY)
+
+    def work(index: int):
+        data = os.pread(fd, BLOCK_SIZE, index * BLOCK_SIZE)
+        digest = hashlib.sha256(data).hexdigest()
+        if len(data) == BLOCK_SIZE and digest == ZERO_BLOCK_HASH:
+            return index, None, 0
+        return index, digest, store.put(digest, data)
+
+    try:
+        pending = set()
+        read = 0
+        for i in _data_blocks(fd, size):
+            read += 1
+            pending.add(pool.submit(work, i))
+            if len(pending) >= MAX_PENDING:
+                done, pending = concurrent.futures.wait(pending, return_when=concurrent.futures.FIRST_COMPLETED)
+                for f in done:
+                    _record(f.result(), hashes, stats)
+        for f in concurrent.futures.as_completed(pending):
+            _record(f.result(), hashes, stats)
+        stats["hole_blocks"] += count - read
+    finally:
+        os.close(fd)
+    return hashes
+
+
+def _record(result, hashes, stats):
+    index, digest, written = result
+    hashes[index] = digest
+    stats["blocks"] += 1
+    if written:
+        stats["new_blocks"] += 1
+        stats["written"] += written
+
+
+def save(store: BlockStore, vm_dir: Path, name: str, include_ipsw: bool):
+    store.ensure()
+    index_path = vm_dir / INDEX_NAME
+    try:
+        index = json.loads(index_path.read_text())
+    except (OSError, ValueError):
+        index = {}
+    new_index = {}
+    stats = {"blocks": 0, "new_blocks": 0, "hole_blocks": 0, "written": 0, "reused_files": 0}
+    entries = []
+    start = time.monotonic()
+
+    with concurrent.futures.ThreadPoolExecutor(WORKERS) as pool:
+        for rel, st in _walk(vm_dir, include_ipsw):
+            entry = {"path": str(rel), "mode": st.st_mode & 0o7777, "mtime": st.st_mtime_ns}
+            if os.path.islink(vm_dir / rel):
+                entry["type"] = "link"
+                entry["target"] = os.readlink(vm_dir / rel)
+            elif (vm_dir / rel).is_dir():
+                entry["type"] = "dir"
+            else:
+                entry["type"] = "file"
+                entry["size"] = st.st_size
+                key = [st.st_size, st.st_mtime_ns, st.st_ino]
+                cached = index.get(str(rel))
+                if cached and cached["key"] == key and all(h is None or store.has(h) for h in cached["blocks"]):
+                    blocks = cached["blocks"]
+                    stats["reused_files"] += 1
+                else:
+                    print(f"  {rel} ({st.st_size / (1 << 30):.2f} GiB)" if st.st_size >= 1 << 30 else f"  {rel}")
+                    blocks = _hash_file(store, vm_dir / rel, pool, stats)
+                entry["blocks"] = blocks
+                new_index[str(rel)] = {"key": key, "blocks": blocks}
+            entries.append(entry)
+
+    manifest = {
+        "version": FORMAT_VERSION,
+        "name": name,
+        "created": int(time.time()),
+        "block_size": BLOCK_SIZE,
+        "files": entries,
+    }
+    store.write_manifest(name, manifest)
+    index_path.write_text(json.dumps(new_index, separators=(",", ":")))
+
+    logical = sum(e.get("size", 0) for e in entries)
+    print(
+        f"Saved '{name}': {logical / (1 << 30):.2f} GiB logical, "
+        f"{stats['new_blocks']} of {stats['blocks']} hashed blocks new, "
+        f"{stats['hole_blocks']} hole blocks skipped, "
+        f"{stats['written'] / (1 << 20):.1f} MiB written, "
+        f"{stats['reused_files']} unchanged files reused, "
+        f"{time.monotonic() - start:.1f}s"
+    )
+
+
+# ─── Restore ─────────────────────────────────────────────────────
+
+
+def _clone(src: Path, dst: Path) -> bool:
+    """APFS clone (cp -c) with a plain copy fallback."""
+    if subprocess.run(["cp", "-c", "-p", str(src), str(dst)], capture_output=True).returncode == 0:
+        return True
+    try:
+        shutil.copy2(src, dst)
+        return True
+    except OSError:
+        return False
+
+
+def restore(store: BlockStore, name: str, dest: Path, reuse: Path | None):
+    manifest = store.load_manifest(name)
+    if manifest.get("block_size") != BLOCK_SIZE:
+        raise SnapshotError(f"snapshot '{name}' uses block size {manifest.get('block_size')}")
+
+    # Files whose block list matches the reuse directory's last save are
+    # cloned instead of rebuilt, e.g. IPSW dirs shared by every snapshot.
+    reusable = {}
+    if reuse:
+        try:
+            reusable = json.loads((reuse / INDEX_NAME).read_text())
+        except (OSError, ValueError):
+            reusable = {}
+
+    dest.mkdir(parents=True, exist_ok=True)
+    start = time.monotonic()
+    stats = {"cloned": 0, "blocks": 0}
+    dirs = []
+    with concurrent.futures.ThreadPoolExecutor(WORKERS) as pool:
+        for entry in manifest["files"]:
+            target = dest / entry["path"]
+            kind = entry["type"]
+            if kind == "dir":
+                target.mkdir(parents=True, exist_ok=True)
+                dirs.append(entry)
+                continue
+            target.parent.mkdir(parents=True, exist_ok=True)
+            if kind == "link":
+                os.symlink(entry["target"], target)
+                continue
+
+            cached = reusable.get(entry["path"])
+            src = reuse / entry["path"] if reuse else None
+            if (
+                cached
+                and cached["blocks"] == entry["blocks"]
+                and src.is_file()
+                and src.stat().st_size == entry["size"]
+                and [src.stat().st_size, src.stat().st_mtime_ns, src.stat().st_ino] == cached["key"]
+                and _clone(src, target)
+            ):
+                stats["cloned"] += 1
+            else:
+                _write_file(store, target, entry, pool)
+                stats["blocks"] += sum(1 for h in entry["blocks"] if h)
+            os.chmod(target, entry["mode"])
+            os.utime(target, ns=(entry["mtime"], entry["mtime"]))
+
+    # Seed the change index so the next save of `dest` only re-reads files
+    # that changed after this restore.
+    index = {}
+    for entry in manifest["files"]:
+        if entry["type"] == "file":
+            st = (dest / entry["path"]).stat()
+            index[entry["path"]] = {"key": [st.st_size, st.st_mtime_ns, st.st_ino], "blocks": entry["blocks"]}
+    (dest / INDEX_NAME).write_text(json.dumps(index, separators=(",", ":")))
+
+    # Directory times last, after their contents were written.
+    for entry in reversed(dirs):
+        target = dest / entry["path"]
+        os.chmod(target, entry["mode"])
+        os.utime(target, ns=(entry["mtime"], entry["mtime"]))
+
+    print(
+        f"Restored '{name}': {stats['blocks']} blocks written, "
+        f"{stats['cloned']} files cloned, {time.monotonic() - start:.1f}s"
+    )
+
+
+def _write_file(store: BlockStore, target: Path, entry: dict, pool):
+    fd = os.open(target, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o600)
+    try:
+        # Size first: zero blocks stay holes and the file is sparse.
+        os.ftruncate(fd, entry["size"])
+
+        def work(index: int, digest: str):
+            data = store.get(digest)
+            os.pwrite(fd, data, index * BLOCK_SIZE)
+
+        pending = set()
+        for i, digest in enumerate(entry["blocks"]):
+            if digest is None:
+                continue
+            pending.add(pool.submit(work, i, digest))
+            if len(pending) >= MAX_PENDING:
+                done, pending = concurrent.futures.wait(pending, return_when=concurrent.futures.FIRST_COMPLETED)
+                for f in done:
+                    f.result()
+        for f in concurrent.futures.as_completed(pending):
+            f.result()
+    finally:
+        os.close(fd)
+
+
+# ─── Maintenance ─────────────────────────────────────────────────
+
+
+def list_snapshots(store: BlockStore):
+    if not store.snapshots.is_dir():
+        print("  (none)")
+        return
+    found = False
+    for path in sorted(store.snapshots.glob("*.json")):
+        try:
+            manifest = json.loads(path.read_text())
+        except ValueError:
+            continue
+        logical = sum(e.get("size", 0) for e in manifest.get("files", []))
+        created = time.strftime("%Y-%m-%d %H:%M", time.localtime(manifest.get("created", 0)))
+        print(f"  - {path.stem} ({logical / (1 << 30):.1f} GiB logical, {created})")
+        found = True
+    if not found:
+        print("  (none)")
+
+
+def gc(store: BlockStore, dry_run: bool):
+    live: set[str] = set()
+    for path in store.snapshots.glob("*.json"):
+        for entry in json.loads(path.read_text()).get("files", []):
+            live.update(h for h in entry.get("blocks", []) if h)
+    removed = freed = 0
+    for block in store.all_blocks():
+        if block.name.removesuffix(".z") in live:
+            continue
+        removed += 1
+        freed += block.stat().st_size
+        if not dry_run:
+            block.unlink()
+    verb = "Would remove" if dry_run else "Removed"
+    print(f"{verb} {removed} unreferenced blocks ({freed / (1 << 20):.1f} MiB); {len(live)} blocks live")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Deduplicated VM snapshots")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("save", help="Snapshot a VM directory")
+    p.add_argument("--store", required=True, type=Path)
+    p.add_argument("--vm-dir", required=True, type=Path)
+    p.add_argument("--name", required=True)
+    p.add_argument("--include-ipsw", action="store_true")
+
+    p = sub.add_parser("restore", help="Rebuild a snapshot into a directory")
+    p.add_argument("--store", required=True, type=Path)
+    p.add_argument("--name", required=True)
+    p.add_argument("--dest", required=True, type=Path)
+    p.add_argument("--reuse", type=Path, help="VM directory to clone unchanged files from")
+
+    p = sub.add_parser("list", help="List snapshots")
+    p.add_argument("--store", required=True, type=Path)
+
+    p = sub.add_parser("exists", help="Exit 0 if the snapshot exists")
+    p.add_argument("--store", required=True, type=Path)
+    p.add_argument("--name", required=True)
+
+    p = sub.add_parser("delete", help="Remove a snapshot (run gc to free blocks)")
+    p.add_argument("--store", required=True, type=Path)
+    p.add_argument("--name", required=True)
+
+    p = sub.add_parser("gc", help="Delete blocks no snapshot references")
+    p.add_argument("--store", required=True, type=Path)
+    p.add_argument("--dry-run", action="store_true")
+
+    args = parser.parse_args()
+    store = BlockStore(args.store)
+    try:
+        if args.command == "save":
+            save(store, args.vm_dir, args.name, args.include_ipsw)
+        elif args.command == "restore":
+            restore(store, args.name, args.dest, args.reuse)
+        elif args.command == "list":
+            list_snapshots(store)
+        elif args.command == "exists":
+            sys.exit(0 if store.manifest_path(args.name).exists() else 1)
+        elif args.command == "delete":
+            store.load_manifest(args.name)
+            store.manifest_path(args.name).unlink()
+            print(f"Deleted snapshot '{args.name}' (run gc to reclaim blocks)")
+        elif args.command == "gc":
+            gc(store, args.dry_run)
+    except SnapshotError as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -7,6 +7,10 @@
 # Usage:
 #   make vm_switch NAME=ios18
 #   make vm_switch NAME=ios18 BACKUP_INCLUDE_IPSW=1
+#   make vm_switch NAME=ios18 SNAPSHOT_STORE=/Volumes/nas/vphone-snapshots
+#
+# With SNAPSHOT_STORE set, both the save and the restore go through the
+# deduplicated snapshot store (vm_snapshot.py) instead of vm.backups/.
 
 set -euo pipefail
 
@@ -17,8 +21,21 @@ _vphone_cp() {
 
 VM_DIR="${VM_DIR:-vm}"
 BACKUPS_DIR="${BACKUPS_DIR:-vm.backups}"
+SNAPSHOT_STORE="${SNAPSHOT_STORE:-}"
 NAME="${NAME:-}"
 BACKUP_INCLUDE_IPSW="${BACKUP_INCLUDE_IPSW:-0}"
+SCRIPT_DIR="${0:a:h}"
+
+# Prefer the project venv's python3 for vm_snapshot.py.
+_resolve_python3() {
+    local venv_py="${SCRIPT_DIR:h}/.venv/bin/python3"
+    if [[ -x "$venv_py" ]]; then
+        echo "$venv_py"
+    else
+        command -v python3 || true
+    fi
+}
+PYTHON3=""
 
 validate_backup_name() {
     local name="$1"
@@ -45,7 +62,15 @@ validate_safe_path() {
     fi
 }
 
+snapshot() {
+    "${PYTHON3}" "${SCRIPT_DIR}/vm_snapshot.py" "$@"
+}
+
 list_backups() {
+    if [[ -n "${SNAPSHOT_STORE}" ]]; then
+        "$(_resolve_python3)" "${SCRIPT_DIR}/vm_snapshot.py" list --store "${SNAPSHOT_STORE}"
+        return
+    fi
     if [[ ! -d "${BACKUPS_DIR}" ]]; then
         echo "  (none)"
         return
@@ -110,8 +135,9 @@ while [[ $# -gt 0 ]]; do
     case "$1" in
         --name)          NAME="$2"; shift 2 ;;
         --include-ipsw)  BACKUP_INCLUDE_IPSW=1; shift ;;
+        --store)         SNAPSHOT_STORE="$2"; shift 2 ;;
         -h|--help)
-            echo "Usage: $0 --name <target> [--include-ipsw]"
+            echo "Usage: $0 --name <target> [--include-ipsw] [--store <snapshot store>]"
             exit 0
             ;;
         *) echo "Unknown option: $1"; exit 1 ;;
@@ -133,7 +159,17 @@ validate_safe_path "${BACKUPS_DIR}" "BACKUPS_DIR"
 
 TARGET="${BACKUPS_DIR}/${NAME}"
 
-if [[ ! -d "${TARGET}" || ! -f "${TARGET}/config.plist" ]]; then
+if [[ -n "${SNAPSHOT_STORE}" ]]; then
+    PYTHON3="$(_resolve_python3)"
+    [[ -x "${PYTHON3}" ]] || { echo "ERROR: python3 not found. Run: make setup_venv"; exit 1; }
+    if ! snapshot exists --store "${SNAPSHOT_STORE}" --name "${NAME}"; then
+        echo "ERROR: Snapshot '${NAME}' not found in ${SNAPSHOT_STORE}/"
+        echo ""
+        echo "Available snapshots:"
+        list_backups
+        exit 1
+    fi
+elif [[ ! -d "${TARGET}" || ! -f "${TARGET}/config.plist" ]]; then
     echo "ERROR: Backup '${NAME}' not found."
     echo ""
     echo "Available backups:"
@@ -177,16 +213,23 @@ if [[ -d "${VM_DIR}" && -f "${VM_DIR}/config.plist" ]]; then
 
     echo "=== Saving current VM as '${CURRENT}' ==="
 
-    CURRENT_DEST="${BACKUPS_DIR}/${CURRENT}"
-    TMP_CURRENT_DEST="${BACKUPS_DIR}/.${CURRENT}.tmp.$$"
+    if [[ -n "${SNAPSHOT_STORE}" ]]; then
+        echo "${CURRENT}" > "${VM_DIR}/.vm_name"
+        snapshot_args=(save --store "${SNAPSHOT_STORE}" --vm-dir "${VM_DIR}" --name "${CURRENT}")
+        [[ "${BACKUP_INCLUDE_IPSW}" == "1" ]] && snapshot_args+=(--include-ipsw)
+        snapshot "${snapshot_args[@]}"
+    else
+        CURRENT_DEST="${BACKUPS_DIR}/${CURRENT}"
+        TMP_CURRENT_DEST="${BACKUPS_DIR}/.${CURRENT}.tmp.$$"
 
-    rm -rf -- "${TMP_CURRENT_DEST}"
-    mkdir -p "${TMP_CURRENT_DEST}"
+        rm -rf -- "${TMP_CURRENT_DEST}"
+        mkdir -p "${TMP_CURRENT_DEST}"
 
-    copy_children "${VM_DIR}" "${TMP_CURRENT_DEST}" "${BACKUP_INCLUDE_IPSW}"
-    echo "${CURRENT}" > "${TMP_CURRENT_DEST}/.vm_name"
+        copy_children "${VM_DIR}" "${TMP_CURRENT_DEST}" "${BACKUP_INCLUDE_IPSW}"
+        echo "${CURRENT}" > "${TMP_CURRENT_DEST}/.vm_name"
 
-    replace_dir_with_tmp "${TMP_CURRENT_DEST}" "${CURRENT_DEST}"
+        replace_dir_with_tmp "${TMP_CURRENT_DEST}" "${CURRENT_DEST}"
+    fi
 
     echo ""
 fi
@@ -197,9 +240,15 @@ echo "=== Restoring '${NAME}' ==="
 TMP_VM_DIR="${VM_DIR}.restore.$$"
 
 rm -rf -- "${TMP_VM_DIR}"
-mkdir -p "${TMP_VM_DIR}"
 
-copy_children "${TARGET}" "${TMP_VM_DIR}" "1"
+if [[ -n "${SNAPSHOT_STORE}" ]]; then
+    # Files the outgoing VM shares with the target are cloned, not rebuilt.
+    snapshot restore --store "${SNAPSHOT_STORE}" --name "${NAME}" \
+        --dest "${TMP_VM_DIR}" --reuse "${VM_DIR}" || { rm -rf -- "${TMP_VM_DIR}"; exit 1; }
+else
+    mkdir -p "${TMP_VM_DIR}"
+    copy_children "${TARGET}" "${TMP_VM_DIR}" "1"
+fi
 echo "${NAME}" > "${TMP_VM_DIR}/.vm_name"
 
 replace_dir_with_tmp "${TMP_VM_DIR}" "${VM_DIR}"
@@ -1,3 +1,10 @@
 #import <Foundation/Foundation.h>
 
+/// Called after each entry is fully written, with its extracted path.
+typedef void (^vp_extract_entry_handler_t)(NSString *path, BOOL isRegularFile);
+
 extern int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString **errorOutput);
+
+/// Extract an archive read sequentially from `fd` (a pipe or socket; no
+/// seeking). `onEntry` may be nil.
+extern int vp_extract_archive_fd(int fd, NSString *extractionPath, vp_extract_entry_handler_t onEntry, NSString **errorOutput);
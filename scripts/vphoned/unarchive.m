@@ -20,33 +20,18 @@ static int copy_data(struct archive *ar, struct archive *aw) {
     }
 }
 
-int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString **errorOutput) {
+/// Extract every entry of the already-opened archive `a` below
+/// `resolvedPath`. Closes and frees `a`.
+static int extract_entries(struct archive *a, NSString *resolvedPath, vp_extract_entry_handler_t onEntry, NSString **errorOutput) {
     int flags = ARCHIVE_EXTRACT_TIME
               | ARCHIVE_EXTRACT_PERM
               | ARCHIVE_EXTRACT_SECURE_NODOTDOT;
 
-    // Resolve symlinks in extractionPath (e.g. /tmp -> /private/tmp on iOS)
-    // so ARCHIVE_EXTRACT_SECURE_SYMLINKS doesn't reject trusted system symlinks.
-    NSString *resolvedPath = [extractionPath stringByResolvingSymlinksInPath];
-    NSLog(@"vphoned: extract %@ -> %@ (resolved: %@)", archivePath, extractionPath, resolvedPath);
-
-    struct archive *a = archive_read_new();
-    archive_read_support_format_all(a);
-    archive_read_support_filter_all(a);
-
     struct archive *ext = archive_write_disk_new();
     archive_write_disk_set_options(ext, flags);
     archive_write_disk_set_standard_lookup(ext);
 
     int ret = 0;
-    if (archive_read_open_filename(a, archivePath.fileSystemRepresentation, 10240) != ARCHIVE_OK) {
-        NSString *err = [NSString stringWithFormat:@"archive_read_open failed: %s", archive_error_string(a)];
-        NSLog(@"vphoned: %@", err);
-        if (errorOutput) *errorOutput = err;
-        ret = 1;
-        goto cleanup;
-    }
-
     for (;;) {
         struct archive_entry *entry;
         int r = archive_read_next_header(a, &entry);
@@ -64,6 +49,7 @@ int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString
         if (!currentFile) { ret = 1; goto cleanup; }
         NSString *fullOutputPath = [resolvedPath stringByAppendingPathComponent:currentFile];
         archive_entry_set_pathname(entry, fullOutputPath.fileSystemRepresentation);
+        BOOL isRegularFile = archive_entry_filetype(entry) == AE_IFREG;
 
         r = archive_write_header(ext, entry);
         if (r < ARCHIVE_OK)
@@ -72,7 +58,8 @@ int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString
             if (errorOutput) *errorOutput = [NSString stringWithFormat:@"archive_write_header failed for %@: %s", currentFile, archive_error_string(ext)];
             ret = 1; goto cleanup;
         }
-        if (archive_entry_size(entry) > 0) {
+        // Streamed zip entries with a data descriptor have no size up front.
+        if (archive_entry_size(entry) > 0 || !archive_entry_size_is_set(entry)) {
             r = copy_data(a, ext);
             if (r < ARCHIVE_OK)
                 NSLog(@"vphoned: copy_data(%@): %s (r=%d)", currentFile, archive_error_string(ext), r);
@@ -89,6 +76,7 @@ int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString
             if (errorOutput) *errorOutput = [NSString stringWithFormat:@"archive_write_finish_entry failed for %@: %s", currentFile, archive_error_string(ext)];
             ret = 1; goto cleanup;
         }
+        if (onEntry) onEntry(fullOutputPath, isRegularFile);
     }
 
 cleanup:
@@ -98,3 +86,43 @@ cleanup:
     archive_write_free(ext);
     return ret;
 }
+
+static struct archive *new_reader(void) {
+    struct archive *a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+    return a;
+}
+
+int vp_extract_archive(NSString *archivePath, NSString *extractionPath, NSString **errorOutput) {
+    // Resolve symlinks in extractionPath (e.g. /tmp -> /private/tmp on iOS)
+    // so ARCHIVE_EXTRACT_SECURE_SYMLINKS doesn't reject trusted system symlinks.
+    NSString *resolvedPath = [extractionPath stringByResolvingSymlinksInPath];
+    NSLog(@"vphoned: extract %@ -> %@ (resolved: %@)", archivePath, extractionPath, resolvedPath);
+
+    struct archive *a = new_reader();
+    if (archive_read_open_filename(a, archivePath.fileSystemRepresentation, 10240) != ARCHIVE_OK) {
+        NSString *err = [NSString stringWithFormat:@"archive_read_open failed: %s", archive_error_string(a)];
+        NSLog(@"vphoned: %@", err);
+        if (errorOutput) *errorOutput = err;
+        archive_read_free(a);
+        return 1;
+    }
+    return extract_entries(a, resolvedPath, nil, errorOutput);
+}
+
+int vp_extract_archive_fd(int fd, NSString *extractionPath, vp_extract_entry_handler_t onEntry, NSString **errorOutput) {
+    NSString *resolvedPath = [extractionPath stringByResolvingSymlinksInPath];
+    NSLog(@"vphoned: extract stream fd=%d -> %@", fd, resolvedPath);
+
+    struct archive *a = new_reader();
+    // Larger blocks mean fewer read(2) calls on the pipe.
+    if (archive_read_open_fd(a, fd, 256 * 1024) != ARCHIVE_OK) {
+        NSString *err = [NSString stringWithFormat:@"archive_read_open failed: %s", archive_error_string(a)];
+        NSLog(@"vphoned: %@", err);
+        if (errorOutput) *errorOutput = err;
+        archive_read_free(a);
+        return 1;
+    }
+    return extract_entries(a, resolvedPath, onEntry, errorOutput);
+}
@@ -9,6 +9,11 @@
  * it to CACHE_PATH and exit — launchd restarts us, and the bootstrap
  * code in main() exec's the cached binary.
  *
+ * Concurrency: every accepted connection gets its own reader thread.
+ * Commands are dispatched to per-connection worker lanes (HID, file,
+ * keychain, apps, install, accessibility, misc) so a slow request only
+ * delays requests of the same class. Responses are matched by "id".
+ *
  * Build:
  *   make vphoned
  */
@@ -16,10 +21,13 @@
 #include <CommonCrypto/CommonDigest.h>
 #import <Foundation/Foundation.h>
 #include <arpa/inet.h>
+#include <compression.h>
 #include <ifaddrs.h>
 #include <mach-o/dyld.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -36,6 +44,7 @@
 #import "vphoned_notify.h"
 #import "vphoned_protocol.h"
 #import "vphoned_settings.h"
+#import "vphoned_stats.h"
 #import "vphoned_url.h"
 #import "vphoned_vcam.h"
 
@@ -45,13 +54,18 @@
 
 #define VMADDR_CID_ANY 0xFFFFFFFF
 #define VPHONED_PORT 1337
+#define VPHONED_BACKLOG 8
 
 #ifndef VPHONED_BUILD_HASH
 #define VPHONED_BUILD_HASH "unknown"
 #endif
 
+static BOOL gHIDAvailable = NO;
 static BOOL gClipboardAvailable = NO;
 static BOOL gAppsAvailable = NO;
+/// Private-framework subsystem loads. Sessions do not wait for them: hello
+/// advertises what is ready and a "caps" message follows once all are done.
+static dispatch_group_t gSubsystems;
 
 #define INSTALL_PATH "/usr/bin/vphoned"
 #define CACHE_PATH "/var/root/Library/Caches/vphoned"
@@ -67,6 +81,17 @@ struct sockaddr_vm {
 
 // MARK: - Self-hash
 
+static NSString *sha256_final_hex(CC_SHA256_CTX *ctx) {
+  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+  CC_SHA256_Final(digest, ctx);
+
+  NSMutableString *hex =
+      [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+  for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++)
+    [hex appendFormat:@"%02x", digest[i]];
+  return hex;
+}
+
 static NSString *sha256_of_file(const char *path) {
   int fd = open(path, O_RDONLY);
   if (fd < 0)
@@ -80,15 +105,7 @@ static NSString *sha256_of_file(const char *path) {
   while ((n = read(fd, buf, sizeof(buf))) > 0)
     CC_SHA256_Update(&ctx, buf, (CC_LONG)n);
   close(fd);
-
-  unsigned char digest[CC_SHA256_DIGEST_LENGTH];
-  CC_SHA256_Final(digest, &ctx);
-
-  NSMutableString *hex =
-      [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
-  for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++)
-    [hex appendFormat:@"%02x", digest[i]];
-  return hex;
+  return sha256_final_hex(&ctx);
 }
 
 static const char *self_executable_path(void) {
@@ -99,6 +116,18 @@ static const char *self_executable_path(void) {
   return path;
 }
 
+/// Digest of the running binary, hashed once per process. An update
+/// restarts the daemon, so it never goes stale.
+static NSString *self_digest(void) {
+  static NSString *digest;
+  static dispatch_once_t once;
+  dispatch_once(&once, ^{
+    const char *selfPath = self_executable_path();
+    digest = selfPath ? sha256_of_file(selfPath) : nil;
+  });
+  return digest;
+}
+
 // MARK: - Network
 
 /// Returns the first non-loopback IPv4 address, preferring en* interfaces
@@ -139,37 +168,119 @@ static NSString *primary_ipv4_address(void) {
 
 // MARK: - Auto-update
 
-/// Receive raw binary from host, write to CACHE_PATH, chmod +x.
-static BOOL receive_update(int fd, NSUInteger size) {
+static BOOL write_update_chunk(int fd, CC_SHA256_CTX *sha, const uint8_t *p,
+                               size_t n, NSUInteger *written) {
+  CC_SHA256_Update(sha, p, (CC_LONG)n);
+  *written += n;
+  if (write(fd, p, n) == (ssize_t)n)
+    return YES;
+  NSLog(@"vphoned: update write failed: %s", strerror(errno));
+  return NO;
+}
+
+/// Receive the binary from host, write to CACHE_PATH, chmod +x.
+/// With encoding "lzfse" the `size` bytes on the wire inflate to `rawSize`.
+/// A non-empty `expectHash` must match the SHA-256 of the written binary.
+/// The whole payload is always consumed so the stream stays framed.
+static BOOL receive_update(int fd, NSUInteger size, NSString *encoding,
+                           NSUInteger rawSize, NSString *expectHash) {
+  BOOL lzfse = [encoding isEqualToString:@"lzfse"];
+  if (encoding.length > 0 && !lzfse) {
+    NSLog(@"vphoned: unknown update encoding %@", encoding);
+    vp_drain(fd, size);
+    return NO;
+  }
   mkdir(CACHE_DIR, 0755);
 
   char tmp_path[] = CACHE_DIR "/vphoned.XXXXXX";
   int tmp_fd = mkstemp(tmp_path);
   if (tmp_fd < 0) {
     NSLog(@"vphoned: mkstemp failed: %s", strerror(errno));
+    vp_drain(fd, size);
+    return NO;
+  }
+
+  compression_stream zs;
+  if (lzfse && compression_stream_init(&zs, COMPRESSION_STREAM_DECODE,
+                                       COMPRESSION_LZFSE) !=
+                   COMPRESSION_STATUS_OK) {
+    NSLog(@"vphoned: compression_stream_init failed");
+    close(tmp_fd);
+    unlink(tmp_path);
+    vp_drain(fd, size);
     return NO;
   }
 
+  CC_SHA256_CTX sha;
+  CC_SHA256_Init(&sha);
   uint8_t buf[32768];
+  uint8_t out[65536];
   NSUInteger remaining = size;
+  NSUInteger written = 0;
+  BOOL ok = YES;
+  BOOL ended = !lzfse;
   while (remaining > 0) {
     size_t chunk = remaining < sizeof(buf) ? remaining : sizeof(buf);
     if (!vp_read_fully(fd, buf, chunk)) {
       NSLog(@"vphoned: update read failed at %lu/%lu",
             (unsigned long)(size - remaining), (unsigned long)size);
-      close(tmp_fd);
-      unlink(tmp_path);
-      return NO;
-    }
-    if (write(tmp_fd, buf, chunk) != (ssize_t)chunk) {
-      NSLog(@"vphoned: update write failed: %s", strerror(errno));
-      close(tmp_fd);
-      unlink(tmp_path);
-      return NO;
+      ok = NO;
+      break;
     }
     remaining -= chunk;
+    if (!ok)
+      continue; // keep draining after a decode or write failure
+
+    if (!lzfse) {
+      ok = write_update_chunk(tmp_fd, &sha, buf, chunk, &written);
+      continue;
+    }
+    if (ended) {
+      NSLog(@"vphoned: trailing data after compressed update");
+      ok = NO;
+      continue;
+    }
+    zs.src_ptr = buf;
+    zs.src_size = chunk;
+    int flags = remaining == 0 ? COMPRESSION_STREAM_FINALIZE : 0;
+    while (ok) {
+      zs.dst_ptr = out;
+      zs.dst_size = sizeof(out);
+      compression_status st = compression_stream_process(&zs, flags);
+      size_t produced = sizeof(out) - zs.dst_size;
+      if (st == COMPRESSION_STATUS_ERROR || written + produced > rawSize) {
+        NSLog(@"vphoned: update inflate failed at %lu bytes",
+              (unsigned long)written);
+        ok = NO;
+        break;
+      }
+      if (produced > 0)
+        ok = write_update_chunk(tmp_fd, &sha, out, produced, &written);
+      if (st == COMPRESSION_STATUS_END) {
+        ended = YES;
+        break;
+      }
+      if (zs.src_size == 0 && zs.dst_size > 0)
+        break;
+    }
   }
+  if (lzfse)
+    compression_stream_destroy(&zs);
   close(tmp_fd);
+
+  NSString *hash = sha256_final_hex(&sha);
+  if (ok && (!ended || (lzfse && written != rawSize))) {
+    NSLog(@"vphoned: update truncated (%lu bytes)", (unsigned long)written);
+    ok = NO;
+  }
+  if (ok && expectHash.length > 0 && ![hash isEqualToString:expectHash]) {
+    NSLog(@"vphoned: update digest mismatch (got %@)", hash);
+    ok = NO;
+  }
+  if (!ok) {
+    unlink(tmp_path);
+    return NO;
+  }
   chmod(tmp_path, 0755);
 
   if (rename(tmp_path, CACHE_PATH) != 0) {
@@ -179,7 +290,7 @@ static BOOL receive_update(int fd, NSUInteger size) {
   }
 
   NSLog(@"vphoned: update written to %s (%lu bytes)", CACHE_PATH,
-        (unsigned long)size);
+        (unsigned long)written);
   return YES;
 }
 
@@ -278,8 +389,249 @@ static NSDictionary *handle_command(NSDictionary *msg) {
   return r;
 }
 
+// MARK: - Worker Lanes
+
+typedef enum {
+  VP_LANE_HID,
+  VP_LANE_FILE,
+  VP_LANE_KEYCHAIN,
+  VP_LANE_APPS,
+  VP_LANE_INSTALL,
+  VP_LANE_ACCESSIBILITY,
+  VP_LANE_MISC,
+  VP_LANE_COUNT
+} vp_lane_t;
+
+static vp_lane_t lane_for_command(NSString *t) {
+  if ([t isEqualToString:@"hid"] || [t isEqualToString:@"touch"] ||
+      [t isEqualToString:@"hid_batch"])
+    return VP_LANE_HID;
+  if ([t hasPrefix:@"file_"])
+    return VP_LANE_FILE;
+  if ([t hasPrefix:@"keychain_"])
+    return VP_LANE_KEYCHAIN;
+  if ([t hasPrefix:@"app_"])
+    return VP_LANE_APPS;
+  if ([t hasPrefix:@"ipa_"])
+    return VP_LANE_INSTALL;
+  if ([t isEqualToString:@"accessibility_tree"])
+    return VP_LANE_ACCESSIBILITY;
+  return VP_LANE_MISC;
+}
+
+/// Serial queues for one connection. HID gets a user-interactive lane so
+/// touches and key presses never queue behind slow file or app work.
+static void create_lanes(dispatch_queue_t lanes[VP_LANE_COUNT]) {
+  static const char *names[VP_LANE_COUNT] = {
+      "com.vphone.vphoned.lane.hid",     "com.vphone.vphoned.lane.file",
+      "com.vphone.vphoned.lane.keychain", "com.vphone.vphoned.lane.apps",
+      "com.vphone.vphoned.lane.install", "com.vphone.vphoned.lane.ax",
+      "com.vphone.vphoned.lane.misc",
+  };
+  for (int i = 0; i < VP_LANE_COUNT; i++) {
+    qos_class_t qos =
+        i == VP_LANE_HID ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_UTILITY;
+    dispatch_queue_attr_t attr =
+        dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qos, 0);
+    lanes[i] = dispatch_queue_create(names[i], attr);
+  }
+}
+
+/// Commands that consume an inline binary payload from the socket. These
+/// must run on the reader thread, before the next message is read.
+static BOOL command_reads_socket(NSString *t) {
+  return [t isEqualToString:@"file_put"] ||
+         [t isEqualToString:@"clipboard_set"];
+}
+
+/// Commands that write a header plus raw bytes inline. Unless the request
+/// asks for payload frames, they hold the connection's write lock for the
+/// whole handler so no other response can interleave with the payload.
+static BOOL command_writes_inline(NSString *t) {
+  return [t isEqualToString:@"file_get"] ||
+         [t isEqualToString:@"clipboard_get"];
+}
+
+/// Route a non-update command to its subsystem handler. Returns the
+/// response dict, or nil if the handler already wrote it inline.
+/// `payloadLock` is set when an inline writer should send payload frames.
+static NSDictionary *dispatch_command(int fd, NSDictionary *msg,
+                                      NSLock *payloadLock) {
+  NSString *t = msg[@"t"];
+
+  // File operations (need fd for inline binary transfer)
+  if ([t hasPrefix:@"file_"])
+    return vp_handle_file_command(fd, msg, payloadLock);
+
+  // Keychain operations
+  if ([t hasPrefix:@"keychain_"])
+    return vp_handle_keychain_command(msg);
+
+  // Clipboard operations (need fd for inline binary transfer)
+  if ([t hasPrefix:@"clipboard_"])
+    return vp_handle_clipboard_command(fd, msg, payloadLock);
+
+  // App management operations
+  if ([t hasPrefix:@"app_"])
+    return vp_handle_apps_command(msg);
+
+  // Streaming IPA install (ipa_stream_data is handled by the reader loop)
+  if ([t hasPrefix:@"ipa_stream_"])
+    return vp_handle_install_stream(fd, msg);
+
+  // URL opening
+  if ([t isEqualToString:@"open_url"])
+    return vp_handle_url_command(msg);
+
+  // Settings operations
+  if ([t hasPrefix:@"settings_"])
+    return vp_handle_settings_command(msg);
+
+  // Timed HID/touch event batch (queued for the HID replay thread)
+  if ([t isEqualToString:@"hid_batch"])
+    return vp_handle_hid_batch(msg);
+
+  // Accessibility tree
+  if ([t isEqualToString:@"accessibility_tree"])
+    return vp_handle_accessibility_command(msg);
+
+  // Per-command counters and latency histograms
+  if ([t isEqualToString:@"stats"])
+    return vp_handle_stats_command(msg);
+
+  // Low power mode sync
+  if ([t isEqualToString:@"low_power_mode"])
+    return vp_handle_notify_command(msg);
+
+  return handle_command(msg);
+}
+
+/// Run one command and write its response under writeLock, recording
+/// stats and a signpost interval. `readNs` is when its frame was read and
+/// `frameBytes` the frame's size on the wire. Returns NO if the write failed.
+static BOOL run_command(int fd, NSDictionary *msg, NSLock *writeLock,
+                        BOOL writesInline, uint64_t readNs,
+                        uint64_t frameBytes) {
+  NSString *t = msg[@"t"];
+  vp_io_counters_t *io = vp_io_counters();
+  vp_io_counters_t before = *io;
+  uint64_t start = vp_stats_now_ns();
+  os_log_t log = vp_stats_log();
+  os_signpost_id_t spid = os_signpost_id_generate(log);
+  os_signpost_interval_begin(log, spid, "command", "%{public}@", t);
+
+  // Framed payloads take the lock per frame; legacy inline writers hold it
+  // across the whole transfer.
+  BOOL framed = writesInline && [msg[@"frames"] boolValue];
+  BOOL holdsLock = writesInline && !framed;
+  if (holdsLock)
+    [writeLock lock];
+  NSDictionary *resp = dispatch_command(fd, msg, framed ? writeLock : nil);
+  uint64_t handled = vp_stats_now_ns();
+  if (!holdsLock)
+    [writeLock lock];
+  BOOL ok = !resp || vp_write_message(fd, resp);
+  [writeLock unlock];
+
+  os_signpost_interval_end(log, spid, "command");
+  vp_stats_record(t, start - readNs, handled - start,
+                  io->serialize_ns - before.serialize_ns,
+                  frameBytes + io->bytes_read - before.bytes_read,
+                  io->bytes_written - before.bytes_written,
+                  !ok || [resp[@"t"] isEqualToString:@"err"]);
+  return ok;
+}
+
+// MARK: - Binary Fast Path
+
+static NSString *binary_stats_name(uint8_t op) {
+  switch (op) {
+  case VP_BIN_TOUCH:
+    return @"bin_touch";
+  case VP_BIN_HID:
+    return @"bin_hid";
+  case VP_BIN_LOCATION:
+    return @"bin_location";
+  default:
+    return @"bin_unknown";
+  }
+}
+
+static vp_lane_t lane_for_binary(uint8_t op) {
+  return op == VP_BIN_LOCATION ? VP_LANE_MISC : VP_LANE_HID;
+}
+
+/// Apply one binary fast-path event. No response is sent.
+static void handle_binary_frame(const vp_bin_frame_t *f) {
+  switch (f->hdr.op) {
+  case VP_BIN_TOUCH: {
+    vp_bin_touch_t b;
+    if (f->hdr.body_len < sizeof(b))
+      return;
+    memcpy(&b, f->body, sizeof(b));
+    vp_hid_touch(b.phase, b.x, b.y);
+    return;
+  }
+  case VP_BIN_HID: {
+    vp_bin_hid_t b;
+    if (f->hdr.body_len < sizeof(b))
+      return;
+    memcpy(&b, f->body, sizeof(b));
+    if (b.down < 0)
+      vp_hid_press(b.page, b.usage);
+    else
+      vp_hid_key(b.page, b.usage, b.down != 0);
+    return;
+  }
+  case VP_BIN_LOCATION: {
+    vp_bin_location_t b;
+    if (f->hdr.body_len < sizeof(b))
+      return;
+    memcpy(&b, f->body, sizeof(b));
+    vp_location_simulate(b.lat, b.lon, b.alt, b.hacc, b.vacc, b.speed,
+                         b.course);
+    return;
+  }
+  default:
+    NSLog(@"vphoned: unknown binary op %u", f->hdr.op);
+    return;
+  }
+}
+
 // MARK: - Client Session
 
+/// Capabilities of the subsystems loaded so far.
+static NSArray *current_caps(void) {
+  NSMutableArray *caps = [NSMutableArray array];
+  if (gHIDAvailable) {
+    [caps addObject:@"hid"];
+    [caps addObject:@"touch"];
+    [caps addObject:@"hid_batch"];
+  }
+  [caps addObjectsFromArray:@[ @"devmode", @"file", @"keychain" ]];
+  if (vp_location_available())
+    [caps addObject:@"location"];
+  if (vp_custom_installer_available()) {
+    [caps addObject:@"ipa_install"];
+    [caps addObject:@"ipa_stream"];
+  }
+  if (gClipboardAvailable)
+    [caps addObject:@"clipboard"];
+  if (gAppsAvailable) {
+    [caps addObject:@"apps"];
+    [caps addObject:@"app_watch"];
+  }
+  [caps addObject:@"url"];
+  [caps addObject:@"settings"];
+  [caps addObject:@"concurrent"];
+  [caps addObject:@"file_chunked"];
+  [caps addObject:@"payload_frames"];
+  [caps addObject:@"file_list_bulk"];
+  [caps addObject:@"stats"];
+  [caps addObject:@"update_lzfse"];
+  return caps;
+}
+
 /// Returns YES if daemon should exit for restart (after update).
 static BOOL handle_client(int fd) {
   BOOL should_restart = NO;
@@ -314,10 +666,10 @@ static BOOL handle_client(int fd) {
 
     // Hash comparison for auto-update
     NSString *hostHash = hello[@"bin_hash"];
+
     BOOL needUpdate = NO;
     if (hostHash.length > 0) {
-      const char *selfPath = self_executable_path();
-      NSString *selfHash = selfPath ? sha256_of_file(selfPath) : nil;
+      NSString *selfHash = self_digest();
       if (selfHash && ![selfHash isEqualToString:hostHash]) {
         NSLog(@"vphoned: hash mismatch (self=%@ host=%@)", selfHash, hostHash);
         needUpdate = YES;
@@ -326,20 +678,10 @@ static BOOL handle_client(int fd) {
       }
     }
 
-    // Build capabilities list
-    NSMutableArray *caps = [NSMutableArray
-        arrayWithObjects:@"hid", @"devmode", @"file", @"keychain", nil];
-    if (vp_location_available())
-      [caps addObject:@"location"];
-    if (vp_custom_installer_available())
-      [caps addObject:@"ipa_install"];
-    if (gClipboardAvailable)
-      [caps addObject:@"clipboard"];
-    if (gAppsAvailable)
-      [caps addObject:@"apps"];
-    [caps addObject:@"url"];
-    [caps addObject:@"settings"];
-    [caps addObject:@"touch"];
+    // Capabilities of the subsystems loaded so far
+    BOOL subsystemsLoaded =
+        dispatch_group_wait(gSubsystems, DISPATCH_TIME_NOW) == 0;
+    NSArray *caps = current_caps();
 
     NSMutableDictionary *helloResp = [@{
       @"v" : @PROTOCOL_VERSION,
@@ -357,115 +699,214 @@ static BOOL handle_client(int fd) {
       helloResp[@"ip"] = ip;
     if (needUpdate)
       helloResp[@"need_update"] = @YES;
+    if (!subsystemsLoaded)
+      helloResp[@"caps_pending"] = @YES;
+    // Binary fast-path framing: agree on the lower of both versions.
+    NSInteger hostBin = [hello[@"bin"] integerValue];
+    if (hostBin > 0)
+      helloResp[@"bin"] = @(MIN(hostBin, (NSInteger)PROTOCOL_BINARY_VERSION));
 
     if (!vp_write_message(fd, helloResp)) {
       close(fd);
       return NO;
     }
-    NSLog(@"vphoned: client connected (v%d)%s", PROTOCOL_VERSION,
+    NSLog(@"vphoned: client connected fd=%d (v%d)%s", fd, PROTOCOL_VERSION,
           needUpdate ? " [update pending]" : "");
 
+    // Responses come from several lanes; every write to fd goes through
+    // writeLock. inflight lets us wait for queued work before closing fd.
+    NSLock *writeLock = [[NSLock alloc] init];
+    dispatch_group_t inflight = dispatch_group_create();
+    dispatch_queue_t lanes[VP_LANE_COUNT];
+    create_lanes(lanes);
+
+    // Send the full list once loading finishes. Counted in inflight, so fd
+    // stays open until it is written. A host about to push an update does
+    // not need it, and the restart should not wait for the loads.
+    if (!subsystemsLoaded && !needUpdate) {
+      dispatch_group_enter(inflight);
+      dispatch_group_notify(
+          gSubsystems, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+          ^{
+            NSMutableDictionary *r = vp_make_response(@"caps", nil);
+            r[@"caps"] = current_caps();
+            [writeLock lock];
+            vp_write_message(fd, r);
+            [writeLock unlock];
+            dispatch_group_leave(inflight);
+          });
+    }
+
     NSDictionary *msg;
-    while ((msg = vp_read_message(fd)) != nil) {
+    vp_bin_frame_t bin;
+    vp_frame_kind_t kind;
+    vp_io_counters_t *readerIO = vp_io_counters();
+    uint64_t frameStart = readerIO->bytes_read;
+    while ((kind = vp_read_frame(fd, &msg, &bin)) != VP_FRAME_EOF) {
+      uint64_t readNs = vp_stats_now_ns();
+      uint64_t frameBytes = readerIO->bytes_read - frameStart;
+      frameStart = readerIO->bytes_read;
+      if (kind == VP_FRAME_BINARY) {
+        vp_bin_frame_t frame = bin;
+        dispatch_group_async(inflight, lanes[lane_for_binary(frame.hdr.op)], ^{
+          uint64_t start = vp_stats_now_ns();
+          handle_binary_frame(&frame);
+          vp_stats_record(binary_stats_name(frame.hdr.op), start - readNs,
+                          vp_stats_now_ns() - start, 0, frameBytes, 0, NO);
+        });
+        continue;
+      }
       @autoreleasepool {
         NSString *t = msg[@"t"];
         NSLog(@"vphoned: recv cmd: %@", t);
 
         if ([t isEqualToString:@"update"]) {
           NSUInteger size = [msg[@"size"] unsignedIntegerValue];
+          NSString *encoding = msg[@"encoding"];
+          NSUInteger rawSize =
+              encoding ? [msg[@"raw_size"] unsignedIntegerValue] : size;
           id reqId = msg[@"id"];
-          NSLog(@"vphoned: receiving update (%lu bytes)", (unsigned long)size);
-          if (size > 0 && size < 10 * 1024 * 1024 && receive_update(fd, size)) {
+          NSLog(@"vphoned: receiving update (%lu bytes, %@)",
+                (unsigned long)size, encoding ?: @"raw");
+          BOOL inRange = size > 0 && rawSize > 0 && rawSize < 10 * 1024 * 1024;
+          if (!inRange) {
+            // Skip the payload so the next frame is read from its start.
+            NSLog(@"vphoned: update size out of range (raw %lu)",
+                  (unsigned long)rawSize);
+            vp_drain(fd, size);
+          }
+          if (inRange &&
+              receive_update(fd, size, encoding, rawSize, msg[@"hash"])) {
             NSMutableDictionary *r = vp_make_response(@"ok", reqId);
             r[@"msg"] = @"updated, restarting";
+            [writeLock lock];
             vp_write_message(fd, r);
+            [writeLock unlock];
             should_restart = YES;
             break;
           } else {
             NSMutableDictionary *r = vp_make_response(@"err", reqId);
             r[@"msg"] = @"update failed";
+            [writeLock lock];
             vp_write_message(fd, r);
+            [writeLock unlock];
           }
           continue;
         }
 
-        // File operations (need fd for inline binary transfer)
-        if ([t hasPrefix:@"file_"]) {
-          NSDictionary *resp = vp_handle_file_command(fd, msg);
-          if (resp && !vp_write_message(fd, resp))
-            break;
-          continue;
-        }
-
-        // Keychain operations
-        if ([t hasPrefix:@"keychain_"]) {
-          NSDictionary *resp = vp_handle_keychain_command(msg);
-          if (resp && !vp_write_message(fd, resp))
+        // app_watch registers this connection's fd and writeLock for
+        // unsolicited app_changed pushes, so it is handled here.
+        if ([t isEqualToString:@"app_watch"]) {
+          if ([msg[@"enable"] boolValue])
+            vp_apps_watch(fd, writeLock);
+          else
+            vp_apps_unwatch(fd);
+          NSMutableDictionary *r = vp_make_response(@"ok", msg[@"id"]);
+          [writeLock lock];
+          BOOL ok = vp_write_message(fd, r);
+          [writeLock unlock];
+          if (!ok)
             break;
           continue;
         }
 
-        // Clipboard operations (need fd for inline binary transfer)
-        if ([t hasPrefix:@"clipboard_"]) {
-          NSDictionary *resp = vp_handle_clipboard_command(fd, msg);
-          if (resp && !vp_write_message(fd, resp))
+        // ipa_stream_data copies its chunk off the socket here and lets the
+        // stream's feeder queue wait on the extractor, so a backed-up
+        // install never stalls HID and touch frames behind it.
+        if ([t isEqualToString:@"ipa_stream_data"]) {
+          BOOL ok = vp_install_stream_data(fd, msg, writeLock);
+          uint64_t bytesIn = readerIO->bytes_read - frameStart + frameBytes;
+          vp_stats_record(t, 0, vp_stats_now_ns() - readNs, 0, bytesIn, 0, !ok);
+          frameStart = readerIO->bytes_read;
+          if (!ok)
             break;
           continue;
         }
 
-        // App management operations
-        if ([t hasPrefix:@"app_"]) {
-          NSDictionary *resp = vp_handle_apps_command(msg);
-          if (resp && !vp_write_message(fd, resp))
+        if (command_reads_socket(t)) {
+          BOOL ok = run_command(fd, msg, writeLock, NO, readNs, frameBytes);
+          // The command's payload was counted against it; skip past it.
+          frameStart = readerIO->bytes_read;
+          if (!ok)
             break;
           continue;
         }
 
-        // URL opening
-        if ([t isEqualToString:@"open_url"]) {
-          NSDictionary *resp = vp_handle_url_command(msg);
-          if (resp && !vp_write_message(fd, resp))
-            break;
-          continue;
-        }
-
-        // Settings operations
-        if ([t hasPrefix:@"settings_"]) {
-          NSDictionary *resp = vp_handle_settings_command(msg);
-          if (resp && !vp_write_message(fd, resp))
-            break;
-          continue;
-        }
-
-        // Accessibility tree
-        if ([t isEqualToString:@"accessibility_tree"]) {
-          NSDictionary *resp = vp_handle_accessibility_command(msg);
-          if (resp && !vp_write_message(fd, resp))
-            break;
-          continue;
-        }
-
-        // Low power mode sync
-        if ([t isEqualToString:@"low_power_mode"]) {
-          NSDictionary *resp = vp_handle_notify_command(msg);
-          if (resp && !vp_write_message(fd, resp))
-            break;
-          continue;
-        }
-
-        NSDictionary *resp = handle_command(msg);
-        if (resp && !vp_write_message(fd, resp))
-          break;
+        BOOL writesInline = command_writes_inline(t);
+        dispatch_group_async(inflight, lanes[lane_for_command(t)], ^{
+          @autoreleasepool {
+            // Wake the reader so the session tears down.
+            if (!run_command(fd, msg, writeLock, writesInline, readNs,
+                             frameBytes))
+              shutdown(fd, SHUT_RDWR);
+          }
+        });
       }
     }
 
-    NSLog(@"vphoned: client disconnected%s",
+    dispatch_group_wait(inflight, DISPATCH_TIME_FOREVER);
+    vp_apps_unwatch(fd);
+    vp_install_streams_abort(fd);
+    NSLog(@"vphoned: client fd=%d disconnected%s", fd,
           should_restart ? " (restarting for update)" : "");
     close(fd);
   }
   return should_restart;
 }
 
+static void *client_thread(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  if (handle_client(fd)) {
+    NSLog(@"vphoned: exiting for update restart");
+    exit(0);
+  }
+  return NULL;
+}
+
+static BOOL spawn_client(int fd) {
+  pthread_t thr;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int rc = pthread_create(&thr, &attr, client_thread, (void *)(intptr_t)fd);
+  pthread_attr_destroy(&attr);
+  if (rc != 0) {
+    NSLog(@"vphoned: pthread_create failed: %d", rc);
+    return NO;
+  }
+  return YES;
+}
+
+// MARK: - Subsystems
+
+/// Load the subsystems concurrently in the background so main() can start
+/// listening right away; the self digest is primed alongside them.
+static void load_subsystems(void) {
+  gSubsystems = dispatch_group_create();
+  dispatch_queue_t q = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+  dispatch_group_async(gSubsystems, q, ^{
+    gHIDAvailable = vp_hid_load();
+    if (!gHIDAvailable)
+      NSLog(@"vphoned: HID unavailable, input injection disabled");
+  });
+  dispatch_group_async(gSubsystems, q, ^{
+    if (!vp_devmode_load())
+      NSLog(@"vphoned: XPC unavailable, devmode disabled");
+  });
+  dispatch_group_async(gSubsystems, q, ^{
+    vp_location_load();
+  });
+  dispatch_group_async(gSubsystems, q, ^{
+    gClipboardAvailable = vp_clipboard_load();
+  });
+  dispatch_group_async(gSubsystems, q, ^{
+    gAppsAvailable = vp_apps_load();
+  });
+  dispatch_group_async(gSubsystems, q, ^{
+    (void)self_digest();
+  });
+}
+
 // MARK: - Main
 
 int main(int argc, char *argv[]) {
@@ -486,16 +927,13 @@ int main(int argc, char *argv[]) {
     }
 #endif
 
-    if (!vp_hid_load())
-      return 1;
-    if (!vp_devmode_load())
-      NSLog(@"vphoned: XPC unavailable, devmode disabled");
-    vp_location_load();
-
-    gClipboardAvailable = vp_clipboard_load();
-    gAppsAvailable = vp_apps_load();
+    load_subsystems();
     vp_vcam_start();
 
+    // Workers may still be writing when a host disconnects; report EPIPE
+    // instead of dying.
+    signal(SIGPIPE, SIG_IGN);
+
     int sock = socket(AF_VSOCK, SOCK_STREAM, 0);
     if (sock < 0) {
       perror("vphoned: socket(AF_VSOCK)");
@@ -517,7 +955,7 @@ int main(int argc, char *argv[]) {
       close(sock);
       return 1;
     }
-    if (listen(sock, 2) < 0) {
+    if (listen(sock, VPHONED_BACKLOG) < 0) {
       perror("vphoned: listen");
       close(sock);
       return 1;
@@ -532,11 +970,8 @@ int main(int argc, char *argv[]) {
         sleep(1);
         continue;
       }
-      if (handle_client(client)) {
-        NSLog(@"vphoned: exiting for update restart");
-        close(sock);
-        return 0;
-      }
+      if (!spawn_client(client))
+        close(client);
     }
   }
 }
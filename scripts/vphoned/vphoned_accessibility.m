@@ -7,6 +7,12 @@
  *   2. AXUIElement private API (may not be available on iOS)
  *   3. Dylib injection into SpringBoard
  *   4. Direct UIAccessibility traversal via task_for_pid
+ *
+ * Targeted queries (find by identifier/label/role, subtree by node handle,
+ * diff against a snapshot generation) and the notification-invalidated
+ * cache they need are deferred until one of these yields a tree: there is
+ * nothing to search, cache or diff before that. The cap is not advertised,
+ * so the host refuses the command without a round trip.
  */
 
 #import "vphoned_accessibility.h"
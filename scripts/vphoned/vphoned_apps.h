@@ -3,6 +3,13 @@
  *
  * Handles app_list, app_launch, app_terminate, app_foreground using
  * private APIs: LSApplicationWorkspace, FBSSystemService, SpringBoardServices.
+ *
+ * app_list is served from a cached inventory that is rebuilt when
+ * LaunchServices reports an install or uninstall. Running state comes from
+ * one process-table scan rather than a FrontBoard call per app. Each entry
+ * carries the generation in which it last changed, so {"since": gen,
+ * "session": s} returns only changed entries and removed bundle IDs.
+ * Watching connections get the same delta pushed as "app_changed".
  */
 
 #pragma once
@@ -13,3 +20,18 @@ BOOL vp_apps_load(void);
 
 /// Handle an app command. Returns a response dict.
 NSDictionary *vp_handle_apps_command(NSDictionary *msg);
+
+/// Mark the inventory stale, e.g. after registering or unregistering an app.
+void vp_apps_invalidate(void);
+
+/// Lowercased bundle IDs of installed apps outside /private/var/containers.
+NSSet<NSString *> *vp_apps_immutable_bundle_identifiers(void);
+
+/// Push "app_changed" deltas to `fd` (writes take `writeLock`) until
+/// vp_apps_unwatch. Install/uninstall and running-state changes are
+/// detected guest-side; the host never polls.
+void vp_apps_watch(int fd, NSLock *writeLock);
+
+/// Stop pushing to `fd`. No push to it is in flight once this returns; a
+/// push still blocked after a short grace period gets the socket shut down.
+void vp_apps_unwatch(int fd);
@@ -8,10 +8,19 @@
 #import "vphoned_apps.h"
 #import "vphoned_protocol.h"
 #include <dlfcn.h>
+#include <notify.h>
 #include <objc/message.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include <sys/param.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
+// libproc is not in the iOS SDK headers.
+extern int proc_listallpids(void *buffer, int buffersize);
+extern int proc_pidpath(int pid, void *buffer, uint32_t buffersize);
+#define VP_PROC_PIDPATHINFO_MAXSIZE (4 * MAXPATHLEN)
+
 // MARK: - Private API Declarations
 
 @interface LSApplicationProxy : NSObject
@@ -80,6 +89,307 @@ static NSString *state_for_pid(pid_t pid) {
   return @"not_running";
 }
 
+// MARK: - Inventory Cache
+
+// Re-enumerate LaunchServices at least this often, in case a notification
+// was missed.
+#define VP_APPS_MAX_AGE_SEC 30
+#define VP_APPS_WATCH_INTERVAL_MS 1000
+/// Undelivered pushes after which a watcher counts as stuck.
+#define VP_APPS_PUSH_BACKLOG 8
+/// How long unwatch waits for queued pushes before shutting the socket.
+#define VP_APPS_UNWATCH_TIMEOUT_MS 2000
+
+/// One app_watch connection. Pushes to it are written on its own queue, so
+/// a host that stops reading only ever stalls its own deliveries.
+@interface VPAppWatcher : NSObject
+@property (nonatomic) int fd;
+@property (nonatomic, strong) NSLock *writeLock;
+@property (nonatomic, strong) dispatch_queue_t queue;
+/// Count a push as queued; returns the backlog before it.
+- (long)beginPush;
+/// Count a queued push as written (or abandoned).
+- (void)endPush;
+@end
+
+@implementation VPAppWatcher {
+  // Incremented on the inventory queue, decremented on the push queue.
+  _Atomic long _backlog;
+}
+
+- (long)beginPush {
+  return atomic_fetch_add(&_backlog, 1);
+}
+
+- (void)endPush {
+  atomic_fetch_sub(&_backlog, 1);
+}
+@end
+
+// All state below is owned by inventory_queue().
+static NSMutableDictionary<NSString *, NSDictionary *> *gInventory; // bundle_id -> entry
+static NSMutableDictionary<NSString *, NSNumber *> *gEntryGen;      // bundle_id -> generation
+static NSMutableDictionary<NSString *, NSNumber *> *gRemoved;       // bundle_id -> generation
+static NSDictionary<NSString *, NSDictionary *> *gStatic;           // bundle_id -> LS attributes
+static NSDictionary<NSString *, NSString *> *gResolvedPaths;        // bundle_id -> realpath of bundle
+static uint64_t gGeneration;
+static uint64_t gPushedGeneration; // last generation sent to watchers
+static uint32_t gSession;
+static BOOL gStale = YES;
+static CFAbsoluteTime gStaticAt;
+static NSMutableDictionary<NSNumber *, VPAppWatcher *> *gWatchers; // fd -> watcher
+static dispatch_source_t gWatchTimer;
+
+static void push_changes(void);
+
+static dispatch_queue_t inventory_queue(void) {
+  static dispatch_queue_t queue;
+  static dispatch_once_t once;
+  dispatch_once(&once, ^{
+    queue = dispatch_queue_create("com.vphone.vphoned.apps", DISPATCH_QUEUE_SERIAL);
+    gInventory = [NSMutableDictionary dictionary];
+    gEntryGen = [NSMutableDictionary dictionary];
+    gRemoved = [NSMutableDictionary dictionary];
+    gWatchers = [NSMutableDictionary dictionary];
+    gSession = arc4random();
+
+    static const char *names[] = {
+        "com.apple.LaunchServices.ApplicationsChanged",
+        "com.apple.mobile.application_installed",
+        "com.apple.mobile.application_uninstalled",
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+      int token;
+      notify_register_dispatch(names[i], &token, queue, ^(int t) {
+        (void)t;
+        gStale = YES;
+        push_changes();
+      });
+    }
+  });
+  return queue;
+}
+
+/// Real paths of running apps' bundles -> pid, from one process-table pass.
+/// Only main executables count (directly inside the .app), not extensions.
+static NSDictionary<NSString *, NSNumber *> *running_bundles(void) {
+  int n = proc_listallpids(NULL, 0);
+  if (n <= 0)
+    return @{};
+  int cap = n + 64;
+  pid_t *pids = malloc(cap * sizeof(pid_t));
+  if (!pids)
+    return @{};
+  n = proc_listallpids(pids, cap * (int)sizeof(pid_t));
+
+  NSMutableDictionary *out = [NSMutableDictionary dictionary];
+  char path[VP_PROC_PIDPATHINFO_MAXSIZE];
+  for (int i = 0; i < n; i++) {
+    if (pids[i] <= 0 || proc_pidpath(pids[i], path, sizeof(path)) <= 0)
+      continue;
+    char *app = strstr(path, ".app/");
+    if (!app || strchr(app + 5, '/'))
+      continue;
+    app[4] = '\0';
+    out[@(path)] = @(pids[i]);
+  }
+  free(pids);
+  return out;
+}
+
+/// Re-read LaunchServices attributes for every installed app.
+static void reload_static(void) {
+  NSMutableDictionary *attrs = [NSMutableDictionary dictionary];
+  NSMutableDictionary *resolved = [NSMutableDictionary dictionary];
+  for (LSApplicationProxy *proxy in [[LSApplicationWorkspace defaultWorkspace] allInstalledApplications]) {
+    NSString *bundleID = proxy.bundleIdentifier;
+    if (bundleID.length == 0)
+      continue;
+    NSString *path = proxy.bundleURL.path ?: @"";
+    attrs[bundleID] = @{
+      @"bundle_id" : bundleID,
+      @"name" : proxy.localizedName ?: @"",
+      @"version" : proxy.shortVersionString ?: @"",
+      @"type" : [proxy.applicationType isEqualToString:@"System"] ? @"system" : @"user",
+      @"path" : path,
+      @"data_container" : proxy.dataContainerURL.path ?: @"",
+    };
+    char real[MAXPATHLEN];
+    resolved[bundleID] = realpath(path.fileSystemRepresentation, real) ? @(real) : path;
+  }
+  gStatic = attrs;
+  gResolvedPaths = resolved;
+  gStale = NO;
+  gStaticAt = CFAbsoluteTimeGetCurrent();
+}
+
+/// Bring gInventory up to date. Changed and removed entries are stamped
+/// with one new generation. Returns YES when anything changed.
+static BOOL refresh_inventory(void) {
+  if (gStale || CFAbsoluteTimeGetCurrent() - gStaticAt > VP_APPS_MAX_AGE_SEC)
+    reload_static();
+  NSDictionary *running = running_bundles();
+
+  uint64_t gen = gGeneration + 1;
+  BOOL changed = NO;
+  for (NSString *bundleID in gStatic) {
+    pid_t pid = [running[gResolvedPaths[bundleID]] intValue];
+    NSMutableDictionary *entry = [gStatic[bundleID] mutableCopy];
+    entry[@"state"] = state_for_pid(pid);
+    entry[@"pid"] = @(pid > 0 ? pid : 0);
+    if ([gInventory[bundleID] isEqualToDictionary:entry])
+      continue;
+    gInventory[bundleID] = entry;
+    gEntryGen[bundleID] = @(gen);
+    [gRemoved removeObjectForKey:bundleID];
+    changed = YES;
+  }
+  for (NSString *bundleID in gInventory.allKeys) {
+    if (gStatic[bundleID])
+      continue;
+    [gInventory removeObjectForKey:bundleID];
+    [gEntryGen removeObjectForKey:bundleID];
+    gRemoved[bundleID] = @(gen);
+    changed = YES;
+  }
+  if (changed)
+    gGeneration = gen;
+  return changed;
+}
+
+/// Fill app_list fields: entries changed after `since` (all when `since`
+/// is 0) matching `filter`, plus removed IDs for deltas.
+static void fill_inventory(NSMutableDictionary *r, NSString *filter, uint64_t since) {
+  NSMutableArray *apps = [NSMutableArray array];
+  for (NSString *bundleID in gInventory) {
+    if ([gEntryGen[bundleID] unsignedLongLongValue] <= since)
+      continue;
+    NSDictionary *entry = gInventory[bundleID];
+    if ([filter isEqualToString:@"user"] && [entry[@"type"] isEqualToString:@"system"])
+      continue;
+    if ([filter isEqualToString:@"system"] && ![entry[@"type"] isEqualToString:@"system"])
+      continue;
+    if ([filter isEqualToString:@"running"] && [entry[@"pid"] intValue] <= 0)
+      continue;
+    [apps addObject:entry];
+  }
+  r[@"apps"] = apps;
+  r[@"generation"] = @(gGeneration);
+  r[@"session"] = @(gSession);
+  r[@"delta"] = @(since > 0);
+  if (since > 0) {
+    NSMutableArray *removed = [NSMutableArray array];
+    for (NSString *bundleID in gRemoved)
+      if ([gRemoved[bundleID] unsignedLongLongValue] > since)
+        [removed addObject:bundleID];
+    r[@"removed"] = removed;
+  }
+}
+
+/// Refresh and push everything changed since the last push to every
+/// watcher, including changes an app_list refresh picked up in between.
+/// "since" lets a watcher notice it missed a push. Runs on inventory_queue().
+static void push_changes(void) {
+  if (gWatchers.count == 0)
+    return;
+  refresh_inventory();
+  if (gGeneration == gPushedGeneration)
+    return;
+  uint64_t since = gPushedGeneration;
+  gPushedGeneration = gGeneration;
+  NSMutableDictionary *msg = vp_make_response(@"app_changed", nil);
+  fill_inventory(msg, @"all", since);
+  msg[@"since"] = @(since);
+  for (VPAppWatcher *watcher in gWatchers.allValues) {
+    // A watcher this far behind is not reading; drop the connection rather
+    // than queue without bound. Its reader unwatches on the way out.
+    if ([watcher beginPush] >= VP_APPS_PUSH_BACKLOG) {
+      [watcher endPush];
+      NSLog(@"vphoned: app_watch fd=%d stopped reading, disconnecting", watcher.fd);
+      shutdown(watcher.fd, SHUT_RDWR);
+      continue;
+    }
+    dispatch_async(watcher.queue, ^{
+      [watcher.writeLock lock];
+      BOOL ok = vp_write_message(watcher.fd, msg);
+      [watcher.writeLock unlock];
+      [watcher endPush];
+      // Wake the reader; it unwatches on the way out.
+      if (!ok)
+        shutdown(watcher.fd, SHUT_RDWR);
+    });
+  }
+}
+
+void vp_apps_invalidate(void) {
+  dispatch_async(inventory_queue(), ^{
+    gStale = YES;
+    push_changes();
+  });
+}
+
+NSSet<NSString *> *vp_apps_immutable_bundle_identifiers(void) {
+  __block NSMutableSet<NSString *> *out = [NSMutableSet set];
+  dispatch_sync(inventory_queue(), ^{
+    if (gStale || CFAbsoluteTimeGetCurrent() - gStaticAt > VP_APPS_MAX_AGE_SEC)
+      reload_static();
+    for (NSString *bundleID in gStatic) {
+      if (![gStatic[bundleID][@"path"] hasPrefix:@"/private/var/containers"])
+        [out addObject:bundleID.lowercaseString];
+    }
+  });
+  return out;
+}
+
+void vp_apps_watch(int fd, NSLock *writeLock) {
+  dispatch_sync(inventory_queue(), ^{
+    if (gWatchers[@(fd)])
+      return;
+    VPAppWatcher *watcher = [[VPAppWatcher alloc] init];
+    watcher.fd = fd;
+    watcher.writeLock = writeLock;
+    watcher.queue = dispatch_queue_create("com.vphone.vphoned.apps.push", DISPATCH_QUEUE_SERIAL);
+    gWatchers[@(fd)] = watcher;
+    if (gWatchTimer)
+      return;
+    // Launches and exits have no LaunchServices notification; rescan the
+    // process table while anyone is watching.
+    refresh_inventory();
+    gPushedGeneration = gGeneration;
+    gWatchTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, inventory_queue());
+    dispatch_source_set_timer(gWatchTimer,
+                              dispatch_time(DISPATCH_TIME_NOW, VP_APPS_WATCH_INTERVAL_MS * NSEC_PER_MSEC),
+                              VP_APPS_WATCH_INTERVAL_MS * NSEC_PER_MSEC, 250 * NSEC_PER_MSEC);
+    dispatch_source_set_event_handler(gWatchTimer, ^{
+      push_changes();
+    });
+    dispatch_resume(gWatchTimer);
+  });
+}
+
+void vp_apps_unwatch(int fd) {
+  __block VPAppWatcher *watcher = nil;
+  dispatch_sync(inventory_queue(), ^{
+    watcher = gWatchers[@(fd)];
+    [gWatchers removeObjectForKey:@(fd)];
+    if (gWatchers.count == 0 && gWatchTimer) {
+      dispatch_source_cancel(gWatchTimer);
+      gWatchTimer = nil;
+    }
+  });
+  if (!watcher)
+    return;
+  // Drain pushes already queued for this connection only. If one is stuck
+  // on a peer that stopped reading, shutting the socket down fails it.
+  dispatch_block_t drained = dispatch_block_create(0, ^{});
+  dispatch_async(watcher.queue, drained);
+  if (dispatch_block_wait(drained, dispatch_time(DISPATCH_TIME_NOW, VP_APPS_UNWATCH_TIMEOUT_MS * NSEC_PER_MSEC))) {
+    NSLog(@"vphoned: app_watch fd=%d push stuck, disconnecting", fd);
+    shutdown(fd, SHUT_RDWR);
+    dispatch_block_wait(drained, DISPATCH_TIME_FOREVER);
+  }
+}
+
 // MARK: - Command Handler
 
 NSDictionary *vp_handle_apps_command(NSDictionary *msg) {
@@ -94,39 +404,17 @@ NSDictionary *vp_handle_apps_command(NSDictionary *msg) {
 
   // -- app_list --
   if ([type isEqualToString:@"app_list"]) {
-    LSApplicationWorkspace *ws = [LSApplicationWorkspace defaultWorkspace];
-    NSArray *allApps = [ws allInstalledApplications];
     NSString *filter = msg[@"filter"] ?: @"all";
-
-    NSMutableArray *result = [NSMutableArray array];
-    for (LSApplicationProxy *proxy in allApps) {
-      NSString *appType = proxy.applicationType;
-      BOOL isSystem = [appType isEqualToString:@"System"];
-
-      if ([filter isEqualToString:@"user"] && isSystem)
-        continue;
-      if ([filter isEqualToString:@"system"] && !isSystem)
-        continue;
-
-      pid_t pid = pid_for_app(proxy.bundleIdentifier);
-
-      if ([filter isEqualToString:@"running"] && pid <= 0)
-        continue;
-
-      [result addObject:@{
-        @"bundle_id" : proxy.bundleIdentifier ?: @"",
-        @"name" : proxy.localizedName ?: @"",
-        @"version" : proxy.shortVersionString ?: @"",
-        @"type" : isSystem ? @"system" : @"user",
-        @"state" : state_for_pid(pid),
-        @"pid" : @(pid > 0 ? pid : 0),
-        @"path" : proxy.bundleURL.path ?: @"",
-        @"data_container" : proxy.dataContainerURL.path ?: @"",
-      }];
-    }
+    // Deltas need the full picture, so they are only served unfiltered.
+    BOOL delta = msg[@"since"] && [msg[@"session"] unsignedIntValue] == gSession &&
+                 [filter isEqualToString:@"all"];
+    uint64_t since = delta ? [msg[@"since"] unsignedLongLongValue] : 0;
 
     NSMutableDictionary *r = vp_make_response(@"app_list", reqId);
-    r[@"apps"] = result;
+    dispatch_sync(inventory_queue(), ^{
+      refresh_inventory();
+      fill_inventory(r, filter, since);
+    });
     return r;
   }
 
@@ -13,4 +13,6 @@ BOOL vp_clipboard_load(void);
 
 /// Handle a clipboard command. May write binary data inline for images.
 /// Returns a response dict, or nil if the response was written inline.
-NSDictionary *vp_handle_clipboard_command(int fd, NSDictionary *msg);
+/// With `writeLock` an image goes out as payload frames instead.
+NSDictionary *vp_handle_clipboard_command(int fd, NSDictionary *msg,
+                                          NSLock *writeLock);
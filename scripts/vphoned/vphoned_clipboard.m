@@ -9,6 +9,7 @@
 #import "vphoned_protocol.h"
 #include <dlfcn.h>
 #include <objc/message.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 static BOOL gClipboardLoaded = NO;
@@ -47,7 +48,8 @@ static id get_general_pasteboard(void) {
       gPasteboardClass, sel_registerName("generalPasteboard"));
 }
 
-NSDictionary *vp_handle_clipboard_command(int fd, NSDictionary *msg) {
+NSDictionary *vp_handle_clipboard_command(int fd, NSDictionary *msg,
+                                          NSLock *writeLock) {
   NSString *type = msg[@"t"];
   id reqId = msg[@"id"];
 
@@ -95,6 +97,16 @@ NSDictionary *vp_handle_clipboard_command(int fd, NSDictionary *msg) {
       r[@"has_image"] = @YES;
       r[@"image_size"] = @(pngData.length);
 
+      if (writeLock) {
+        if (!vp_write_payload(fd, writeLock, reqId, pngData.bytes,
+                              pngData.length)) {
+          shutdown(fd, SHUT_RDWR);
+          return nil;
+        }
+        r[@"chunked"] = @YES;
+        return r;
+      }
+
       // Write JSON header, then binary PNG data
       if (!vp_write_message(fd, r))
         return nil;
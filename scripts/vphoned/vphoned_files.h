@@ -1,8 +1,18 @@
 /*
  * vphoned_files — Remote file operations over vsock.
  *
- * Handles file_list, file_get, file_put, file_mkdir, file_delete, file_rename.
- * file_get and file_put perform inline binary I/O on the socket.
+ * Handles file_list, file_stat, file_get, file_put, file_mkdir, file_delete,
+ * file_rename. file_get and file_put perform inline binary I/O on the socket.
+ *
+ * Chunked mode: file_get/file_put carrying an "offset" move one bounded
+ * chunk with a SHA-256, so the host can pipeline, verify and resume.
+ * Chunked uploads land in "<path>.vphonepart" and are renamed into place
+ * by the chunk marked "final". file_stat reports the part size for resume,
+ * and the "source" the first chunk recorded in "<path>.vphonepart.source".
+ *
+ * Bulk listing: file_list with "bulk" walks the directory with
+ * getattrlistbulk and answers in columns (names/types/sizes/mtimes/perms),
+ * paged by "cursor"/"limit", optionally recursing "depth" levels.
  */
 
 #pragma once
@@ -10,4 +20,6 @@
 
 /// Handle a file command. Returns a response dict, or nil if the response
 /// was already written inline (e.g. file_get with streaming data).
-NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg);
+/// `writeLock` is set for a file_get asking for payload frames; it is taken
+/// per frame. Without it the caller holds the write lock throughout.
+NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg, NSLock *writeLock);
@@ -1,9 +1,484 @@
 #import "vphoned_files.h"
 #import "vphoned_protocol.h"
+#include <CommonCrypto/CommonDigest.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/attr.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/vnode.h>
 #include <unistd.h>
 
-NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg) {
+#define VP_FILE_CHUNK_MAX (8 * 1024 * 1024)
+#define VP_FILE_MAP_WINDOW (16 * 1024 * 1024)
+#define VP_FILE_PART_SUFFIX @".vphonepart"
+#define VP_FILE_SOURCE_SUFFIX @".vphonepart.source"
+#define VP_LIST_PAGE_DEFAULT 2000
+#define VP_LIST_PAGE_MAX 10000
+#define VP_LIST_DEPTH_MAX 32
+
+/// Set once sendfile(2) fails with "not supported" on our vsock socket, so
+/// later downloads skip straight to the mmap path.
+static atomic_bool gSendfileUnsupported;
+
+/// Map [offset, offset+length) of fileFd read-only. Returns a pointer to
+/// the first byte of the range, or NULL if mapping failed. The caller
+/// munmaps (*mapBase, *mapLen).
+static const uint8_t *map_file_range(int fileFd, off_t offset, size_t length,
+                                     void **mapBase, size_t *mapLen) {
+    off_t pageMask = (off_t)getpagesize() - 1;
+    off_t base = offset & ~pageMask;
+    size_t skew = (size_t)(offset - base);
+    void *map = mmap(NULL, length + skew, PROT_READ, MAP_PRIVATE, fileFd, base);
+    if (map == MAP_FAILED) return NULL;
+    madvise(map, length + skew, MADV_SEQUENTIAL);
+    *mapBase = map;
+    *mapLen = length + skew;
+    return (const uint8_t *)map + skew;
+}
+
+/// Stream exactly `length` bytes of fileFd starting at `offset` to sock.
+///
+/// Tries sendfile(2) first; Darwin only supports it on some socket
+/// families, so the first "not supported" error disables it. Otherwise
+/// writes straight out of VP_FILE_MAP_WINDOW-sized mmap windows (one write
+/// per window, no userspace copy), and falls back to a pread/write loop if
+/// mapping fails. Returns NO on socket errors or if the file shrank.
+static BOOL send_file_span(int sock, int fileFd, off_t offset, off_t length) {
+    if (!atomic_load_explicit(&gSendfileUnsupported, memory_order_relaxed)) {
+        while (length > 0) {
+            off_t len = length;
+            int rc = sendfile(fileFd, sock, offset, &len, NULL, 0);
+            offset += len;
+            length -= len;
+            vp_io_counters()->bytes_written += (uint64_t)len;
+            if (rc == 0) {
+                if (len == 0) return NO;  // EOF before `length` bytes
+                continue;
+            }
+            if (errno == EINTR || errno == EAGAIN) continue;
+            if (errno == ENOTSOCK || errno == ENOTSUP || errno == EOPNOTSUPP || errno == EINVAL) {
+                atomic_store_explicit(&gSendfileUnsupported, true, memory_order_relaxed);
+                NSLog(@"vphoned: sendfile unsupported (%s), using mmap", strerror(errno));
+                break;
+            }
+            return NO;
+        }
+        if (length == 0) return YES;
+    }
+
+    while (length > 0) {
+        size_t span = length < VP_FILE_MAP_WINDOW ? (size_t)length : VP_FILE_MAP_WINDOW;
+        // Re-check the size per window: touching a mapped page past EOF of
+        // a file truncated under us would SIGBUS.
+        struct stat st;
+        if (fstat(fileFd, &st) != 0 || st.st_size < offset + (off_t)span) return NO;
+        void *mapBase = NULL;
+        size_t mapLen = 0;
+        const uint8_t *p = map_file_range(fileFd, offset, span, &mapBase, &mapLen);
+        if (!p) break;
+        BOOL ok = vp_write_fully(sock, p, span);
+        munmap(mapBase, mapLen);
+        if (!ok) return NO;
+        offset += span;
+        length -= span;
+    }
+
+    uint8_t buf[32768];
+    while (length > 0) {
+        size_t want = length < (off_t)sizeof(buf) ? (size_t)length : sizeof(buf);
+        ssize_t n = pread(fileFd, buf, want, offset);
+        if (n <= 0) return NO;
+        if (!vp_write_fully(sock, buf, (size_t)n)) return NO;
+        offset += n;
+        length -= n;
+    }
+    return YES;
+}
+
+/// Armed while a thread reads through a file mapping. A file truncated
+/// under the mapping faults with SIGBUS on the next page touched; the
+/// handler unwinds to the reader instead of killing the daemon.
+static __thread sigjmp_buf *tMapFaultJump;
+
+static void map_fault_handler(int sig, siginfo_t *info, void *ctx) {
+    if (tMapFaultJump) siglongjmp(*tMapFaultJump, 1);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void install_map_fault_handler(void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        struct sigaction sa = {0};
+        sa.sa_sigaction = map_fault_handler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGBUS, &sa, NULL);
+    });
+}
+
+static NSString *hex_digest(const unsigned char *digest) {
+    NSMutableString *hex = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) [hex appendFormat:@"%02x", digest[i]];
+    return hex;
+}
+
+static NSString *sha256_hex(const void *bytes, size_t len) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(bytes, (CC_LONG)len, digest);
+    return hex_digest(digest);
+}
+
+/// sha256_hex over a file mapping. Returns nil if the file shrank and the
+/// mapping faulted part way through.
+static NSString *sha256_hex_mapped(const void *bytes, size_t len) {
+    install_map_fault_handler();
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 1)) {
+        tMapFaultJump = NULL;
+        return nil;
+    }
+    tMapFaultJump = &jump;
+    CC_SHA256(bytes, (CC_LONG)len, digest);
+    tMapFaultJump = NULL;
+    return hex_digest(digest);
+}
+
+static NSDictionary *error_response(id reqId, NSString *msg) {
+    NSMutableDictionary *r = vp_make_response(@"err", reqId);
+    r[@"msg"] = msg;
+    return r;
+}
+
+/// Stream `length` bytes of fileFd from `offset` as payload frames for
+/// reqId, taking writeLock around each frame.
+static BOOL send_file_frames(int sock, NSLock *writeLock, int fileFd, id reqId, off_t offset, off_t length) {
+    NSMutableDictionary *frame = vp_make_response(@"payload", reqId);
+    while (length > 0) {
+        off_t span = MIN(length, (off_t)VP_PAYLOAD_FRAME_MAX);
+        frame[@"size"] = @((unsigned long long)span);
+        [writeLock lock];
+        BOOL ok = vp_write_message(sock, frame) && send_file_span(sock, fileFd, offset, span);
+        [writeLock unlock];
+        if (!ok) return NO;
+        offset += span;
+        length -= span;
+    }
+    return YES;
+}
+
+/// Chunked file_get: send [offset, offset+length) of an open file as one
+/// file_data message carrying offset, total size and the chunk's SHA-256.
+/// With a writeLock the bytes go out as payload frames first and the
+/// file_data header is returned, marked "chunked".
+static NSDictionary *send_file_range(int fd, NSLock *writeLock, int fileFd, off_t total, NSDictionary *msg, id reqId) {
+    unsigned long long offset = [msg[@"offset"] unsignedLongLongValue];
+    unsigned long long length = [msg[@"length"] unsignedLongLongValue];
+    if (length == 0 || length > VP_FILE_CHUNK_MAX) length = VP_FILE_CHUNK_MAX;
+    if (offset > (unsigned long long)total) offset = (unsigned long long)total;
+    if (length > (unsigned long long)total - offset) length = (unsigned long long)total - offset;
+
+    // Prefer hashing and sending straight from a mapping of the range;
+    // fall back to a heap copy if the file can't be mapped.
+    void *mapBase = NULL;
+    size_t mapLen = 0;
+    const uint8_t *bytes = length ? map_file_range(fileFd, (off_t)offset, length, &mapBase, &mapLen) : NULL;
+    uint8_t *buf = NULL;
+    if (length && !bytes) {
+        buf = malloc(length);
+        if (!buf) return error_response(reqId, @"out of memory");
+        size_t got = 0;
+        while (got < length) {
+            ssize_t n = pread(fileFd, buf + got, length - got, (off_t)(offset + got));
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        if (got != length) {
+            free(buf);
+            return error_response(reqId, [NSString stringWithFormat:@"read failed: %s", strerror(errno)]);
+        }
+        bytes = buf;
+    }
+
+    NSMutableDictionary *header = vp_make_response(@"file_data", reqId);
+    header[@"size"] = @(length);
+    header[@"offset"] = @(offset);
+    header[@"total"] = @((unsigned long long)total);
+    // Writes from a truncated mapping fail with EFAULT, but hashing touches
+    // the pages directly.
+    NSString *digest = mapBase ? sha256_hex_mapped(bytes, length) : sha256_hex(bytes, length);
+    if (!digest) {
+        munmap(mapBase, mapLen);
+        return error_response(reqId, @"file changed while reading");
+    }
+    header[@"sha256"] = digest;
+    if (writeLock) {
+        header[@"chunked"] = @YES;
+        BOOL ok = vp_write_payload(fd, writeLock, reqId, bytes, length);
+        if (mapBase) munmap(mapBase, mapLen);
+        free(buf);
+        if (ok) return header;
+        shutdown(fd, SHUT_RDWR);
+        return nil;
+    }
+    BOOL ok = vp_write_message(fd, header) && (length == 0 || vp_write_fully(fd, bytes, length));
+    if (mapBase) munmap(mapBase, mapLen);
+    free(buf);
+    // A header without its promised bytes leaves the stream out of sync.
+    if (!ok) shutdown(fd, SHUT_RDWR);
+    return nil;  // Response already written inline
+}
+
+/// Chunked file_put: consume `size` bytes from the socket, verify them and
+/// write them at "offset" into the part file. The "final" chunk truncates
+/// the part to "total", applies permissions and renames it over `path`.
+static NSDictionary *receive_file_chunk(int fd, NSString *path, NSUInteger size, NSDictionary *msg, id reqId) {
+    if (size > VP_FILE_CHUNK_MAX) {
+        vp_drain(fd, size);
+        return error_response(reqId, @"chunk too large");
+    }
+    uint8_t *buf = size ? malloc(size) : NULL;
+    if (size && !buf) {
+        vp_drain(fd, size);
+        return error_response(reqId, @"out of memory");
+    }
+    if (size && !vp_read_fully(fd, buf, size)) {
+        free(buf);
+        return error_response(reqId, @"file transfer failed");
+    }
+
+    NSString *expected = msg[@"sha256"];
+    if (expected && ![sha256_hex(buf, size) isEqualToString:expected]) {
+        free(buf);
+        return error_response(reqId, @"checksum mismatch");
+    }
+
+    NSString *parent = [path stringByDeletingLastPathComponent];
+    [[NSFileManager defaultManager] createDirectoryAtPath:parent
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+
+    // A chunk at offset 0 starts a fresh upload and discards any stale part.
+    // Its "source" identifies the host file, so a later resume can tell
+    // whether the part is a prefix of the same file.
+    unsigned long long offset = [msg[@"offset"] unsignedLongLongValue];
+    NSString *partPath = [path stringByAppendingString:VP_FILE_PART_SUFFIX];
+    NSString *sourcePath = [path stringByAppendingString:VP_FILE_SOURCE_SUFFIX];
+    if (offset == 0) {
+        NSString *source = msg[@"source"];
+        if ([source isKindOfClass:[NSString class]])
+            [source writeToFile:sourcePath atomically:YES encoding:NSUTF8StringEncoding error:nil];
+        else
+            unlink([sourcePath fileSystemRepresentation]);
+    }
+    int flags = O_WRONLY | O_CREAT | (offset == 0 ? O_TRUNC : 0);
+    int partFd = open([partPath fileSystemRepresentation], flags, 0644);
+    if (partFd < 0) {
+        free(buf);
+        return error_response(reqId, [NSString stringWithFormat:@"open failed: %s", strerror(errno)]);
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(partFd, buf + done, size - done, (off_t)(offset + done));
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    free(buf);
+    if (done != size) {
+        close(partFd);
+        return error_response(reqId, [NSString stringWithFormat:@"write failed: %s", strerror(errno)]);
+    }
+
+    if ([msg[@"final"] boolValue]) {
+        unsigned long long total = [msg[@"total"] unsignedLongLongValue];
+        NSString *perm = msg[@"perm"];
+        ftruncate(partFd, (off_t)total);
+        fchmod(partFd, perm ? (mode_t)strtoul([perm UTF8String], NULL, 8) : 0644);
+        close(partFd);
+        if (rename([partPath fileSystemRepresentation], [path fileSystemRepresentation]) != 0)
+            return error_response(reqId, [NSString stringWithFormat:@"rename failed: %s", strerror(errno)]);
+        unlink([sourcePath fileSystemRepresentation]);
+        NSLog(@"vphoned: file_put %@ (%llu bytes, chunked)", path, total);
+    } else {
+        close(partFd);
+    }
+
+    NSMutableDictionary *r = vp_make_response(@"ok", reqId);
+    r[@"received"] = @(offset + size);
+    return r;
+}
+
+// MARK: - Bulk Listing
+
+typedef BOOL (^vp_dir_visitor_t)(const char *name, fsobj_type_t objType, off_t size,
+                                 uint32_t mode, time_t mtime);
+
+/// Enumerate one open directory with getattrlistbulk, calling `visit` for
+/// each entry until it returns NO. Returns 0 or an errno value.
+static int enumerate_dir_bulk(int dirFd, vp_dir_visitor_t visit) {
+    struct attrlist attrs = {
+        .bitmapcount = ATTR_BIT_MAP_COUNT,
+        .commonattr = ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_NAME | ATTR_CMN_ERROR |
+                      ATTR_CMN_OBJTYPE | ATTR_CMN_MODTIME | ATTR_CMN_ACCESSMASK,
+        .fileattr = ATTR_FILE_DATALENGTH,
+    };
+    size_t bufSize = 64 * 1024;
+    char *buf = malloc(bufSize);
+    if (!buf) return ENOMEM;
+
+    for (;;) {
+        int count = getattrlistbulk(dirFd, &attrs, buf, bufSize, 0);
+        if (count < 0) {
+            int e = errno;
+            free(buf);
+            return e;
+        }
+        if (count == 0) break;
+
+        // Entries are variable-length; each field is present only if its
+        // bit is set in the returned attribute set, in attribute-bit order.
+        char *entry = buf;
+        for (int i = 0; i < count; i++) {
+            char *p = entry;
+            uint32_t length;
+            memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            attribute_set_t returned;
+            memcpy(&returned, p, sizeof(returned));
+            p += sizeof(returned);
+            entry += length;
+
+            uint32_t entryErr = 0;
+            if (returned.commonattr & ATTR_CMN_ERROR) {
+                memcpy(&entryErr, p, sizeof(entryErr));
+                p += sizeof(entryErr);
+            }
+            const char *name = NULL;
+            if (returned.commonattr & ATTR_CMN_NAME) {
+                attrreference_t ref;
+                memcpy(&ref, p, sizeof(ref));
+                name = p + ref.attr_dataoffset;
+                p += sizeof(ref);
+            }
+            fsobj_type_t objType = VNON;
+            if (returned.commonattr & ATTR_CMN_OBJTYPE) {
+                memcpy(&objType, p, sizeof(objType));
+                p += sizeof(objType);
+            }
+            struct timespec mtime = {0};
+            if (returned.commonattr & ATTR_CMN_MODTIME) {
+                memcpy(&mtime, p, sizeof(mtime));
+                p += sizeof(mtime);
+            }
+            uint32_t mode = 0;
+            if (returned.commonattr & ATTR_CMN_ACCESSMASK) {
+                memcpy(&mode, p, sizeof(mode));
+                p += sizeof(mode);
+            }
+            off_t size = 0;
+            if (returned.fileattr & ATTR_FILE_DATALENGTH) {
+                memcpy(&size, p, sizeof(size));
+                p += sizeof(size);
+            }
+
+            if (entryErr || !name) continue;
+            if (!visit(name, objType, size, mode, mtime.tv_sec)) {
+                free(buf);
+                return 0;
+            }
+        }
+    }
+    free(buf);
+    return 0;
+}
+
+/// file_list with "bulk": breadth-first walk of `path` down to "depth"
+/// levels, returning at most "limit" entries after skipping "cursor" and a
+/// "next" cursor when more remain. Names are relative to `path`. Types are
+/// one character per entry: f(ile), d(ir), l(ink), L(ink to a directory).
+static NSDictionary *list_directory_bulk(NSString *path, NSDictionary *msg, id reqId) {
+    NSUInteger cursor = [msg[@"cursor"] unsignedIntegerValue];
+    NSUInteger limit = [msg[@"limit"] unsignedIntegerValue];
+    if (limit == 0) limit = VP_LIST_PAGE_DEFAULT;
+    if (limit > VP_LIST_PAGE_MAX) limit = VP_LIST_PAGE_MAX;
+    NSInteger depth = [msg[@"depth"] integerValue];
+    if (depth < 0 || depth > VP_LIST_DEPTH_MAX) depth = VP_LIST_DEPTH_MAX;
+
+    NSMutableArray *names = [NSMutableArray array];
+    NSMutableString *types = [NSMutableString string];
+    NSMutableArray *sizes = [NSMutableArray array];
+    NSMutableArray *mtimes = [NSMutableArray array];
+    NSMutableArray *perms = [NSMutableArray array];
+    __block NSUInteger seen = 0;
+    __block BOOL more = NO;
+
+    NSMutableArray *queue = [NSMutableArray arrayWithObject:@[ @"", @0 ]];
+    while (queue.count > 0 && !more) {
+        NSArray *item = queue.firstObject;
+        [queue removeObjectAtIndex:0];
+        NSString *rel = item[0];
+        NSInteger level = [item[1] integerValue];
+        NSString *dirPath = rel.length ? [path stringByAppendingPathComponent:rel] : path;
+
+        int dirFd = open([dirPath fileSystemRepresentation], O_RDONLY | O_DIRECTORY);
+        if (dirFd < 0) {
+            if (rel.length == 0)
+                return error_response(reqId, [NSString stringWithFormat:@"open failed: %s", strerror(errno)]);
+            continue;  // Unreadable subdirectory: skip it, keep walking.
+        }
+
+        int err = enumerate_dir_bulk(dirFd, ^BOOL(const char *cname, fsobj_type_t objType, off_t size,
+                                                  uint32_t mode, time_t mtime) {
+            NSString *name = [NSString stringWithUTF8String:cname];
+            if (!name) return YES;
+            NSString *relName = rel.length ? [rel stringByAppendingPathComponent:name] : name;
+            // Queue subdirectories even while skipping so the walk order,
+            // and therefore the cursor, stays deterministic.
+            if (objType == VDIR && level < depth) [queue addObject:@[ relName, @(level + 1) ]];
+            if (seen++ < cursor) return YES;
+            if (names.count == limit) {
+                more = YES;
+                return NO;
+            }
+
+            char code = 'f';
+            if (objType == VDIR) {
+                code = 'd';
+            } else if (objType == VLNK) {
+                struct stat resolved;
+                code = (fstatat(dirFd, cname, &resolved, 0) == 0 && S_ISDIR(resolved.st_mode)) ? 'L' : 'l';
+            }
+            [types appendFormat:@"%c", code];
+            [names addObject:relName];
+            [sizes addObject:@(size)];
+            [mtimes addObject:@(mtime)];
+            [perms addObject:@(mode & 0777)];
+            return YES;
+        });
+        close(dirFd);
+        if (err && rel.length == 0)
+            return error_response(reqId, [NSString stringWithFormat:@"list failed: %s", strerror(err)]);
+    }
+
+    NSMutableDictionary *r = vp_make_response(@"ok", reqId);
+    r[@"names"] = names;
+    r[@"types"] = types;
+    r[@"sizes"] = sizes;
+    r[@"mtimes"] = mtimes;
+    r[@"perms"] = perms;
+    if (more) r[@"next"] = @(cursor + names.count);
+    return r;
+}
+
+// MARK: - Command Dispatch
+
+NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg, NSLock *writeLock) {
     NSString *type = msg[@"t"];
     id reqId = msg[@"id"];
 
@@ -16,6 +491,9 @@ NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg) {
             return r;
         }
 
+        if ([msg[@"bulk"] boolValue])
+            return list_directory_bulk(path, msg, reqId);
+
         NSFileManager *fm = [NSFileManager defaultManager];
         NSError *err = nil;
         NSArray *contents = [fm contentsOfDirectoryAtPath:path error:&err];
@@ -63,6 +541,33 @@ NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg) {
         return r;
     }
 
+    // -- file_stat: size and type, plus any partial upload for resume --
+    if ([type isEqualToString:@"file_stat"]) {
+        NSString *path = msg[@"path"];
+        if (!path) return error_response(reqId, @"missing path");
+
+        NSMutableDictionary *r = vp_make_response(@"ok", reqId);
+        struct stat st;
+        if (stat([path fileSystemRepresentation], &st) == 0) {
+            r[@"exists"] = @YES;
+            r[@"type"] = S_ISDIR(st.st_mode) ? @"dir" : @"file";
+            r[@"size"] = @(st.st_size);
+            r[@"mtime"] = @(st.st_mtimespec.tv_sec);
+            r[@"mtime_ns"] = @(st.st_mtimespec.tv_nsec);
+        } else {
+            r[@"exists"] = @NO;
+        }
+        NSString *partPath = [path stringByAppendingString:VP_FILE_PART_SUFFIX];
+        if (stat([partPath fileSystemRepresentation], &st) == 0 && S_ISREG(st.st_mode)) {
+            r[@"part_size"] = @(st.st_size);
+            NSString *source = [NSString stringWithContentsOfFile:[path stringByAppendingString:VP_FILE_SOURCE_SUFFIX]
+                                                         encoding:NSUTF8StringEncoding
+                                                            error:nil];
+            if (source) r[@"part_source"] = source;
+        }
+        return r;
+    }
+
     // -- file_get: download file from guest to host --
     if ([type isEqualToString:@"file_get"]) {
         NSString *path = msg[@"path"];
@@ -93,23 +598,36 @@ NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg) {
             return r;
         }
 
+        if (msg[@"offset"] != nil) {
+            NSDictionary *r = send_file_range(fd, writeLock, fileFd, st.st_size, msg, reqId);
+            close(fileFd);
+            return r;
+        }
+
         // Send header with file size
         NSMutableDictionary *header = vp_make_response(@"file_data", reqId);
         header[@"size"] = @((unsigned long long)st.st_size);
+        if (writeLock) {
+            BOOL ok = send_file_frames(fd, writeLock, fileFd, reqId, 0, st.st_size);
+            close(fileFd);
+            if (ok) {
+                header[@"chunked"] = @YES;
+                return header;
+            }
+            NSLog(@"vphoned: file_get write failed for %@", path);
+            shutdown(fd, SHUT_RDWR);
+            return nil;
+        }
         if (!vp_write_message(fd, header)) {
             close(fileFd);
             return nil;
         }
 
-        // Stream file data in chunks
-        uint8_t buf[32768];
-        ssize_t n;
-        while ((n = read(fileFd, buf, sizeof(buf))) > 0) {
-            if (!vp_write_fully(fd, buf, (size_t)n)) {
-                NSLog(@"vphoned: file_get write failed for %@", path);
-                close(fileFd);
-                return nil;
-            }
+        // Stream file data (sendfile, then mmap, then read loop)
+        if (!send_file_span(fd, fileFd, 0, st.st_size)) {
+            // The header promised st_size bytes; the stream is out of sync now.
+            NSLog(@"vphoned: file_get write failed for %@", path);
+            shutdown(fd, SHUT_RDWR);
         }
         close(fileFd);
         return nil;  // Response already written inline
@@ -129,6 +647,9 @@ NSDictionary *vp_handle_file_command(int fd, NSDictionary *msg) {
             return r;
         }
 
+        if (msg[@"offset"] != nil)
+            return receive_file_chunk(fd, path, size, msg, reqId);
+
         // Create parent directories if needed
         NSString *parent = [path stringByDeletingLastPathComponent];
         [[NSFileManager defaultManager] createDirectoryAtPath:parent
@@ -3,15 +3,23 @@
  *
  * Matches TrollVNC's STHIDEventGenerator approach: create an
  * IOHIDEventSystemClient, fabricate keyboard events, and dispatch.
+ *
+ * Every event, single or batched, is dispatched from one real-time replay
+ * thread in submission order. hid_batch events carry microsecond offsets
+ * from the start of their batch and are paced with mach_wait_until, so a
+ * swipe or a typed string never holds up a connection lane.
  */
 
 #pragma once
 #import <Foundation/Foundation.h>
 
-/// Load IOKit symbols and create HID event client. Returns NO on failure.
+/// Load IOKit symbols, create HID event client and start the replay
+/// thread. Events queued before it finishes are replayed once it does.
+/// Returns NO on failure, after which events are dropped.
 BOOL vp_hid_load(void);
 
-/// Send a full key press (down + 100ms delay + up).
+/// Send a full key press (down, then up 100ms later). Returns immediately;
+/// the up event is paced by the replay thread.
 void vp_hid_press(uint32_t page, uint32_t usage);
 
 /// Send a single key down or key up event.
@@ -22,3 +30,29 @@ void vp_hid_key(uint32_t page, uint32_t usage, BOOL down);
 /// origin at the top-left. Used for iOS 18 bases where the VZ USB touchscreen
 /// dext produces no digitizer events on the 26.x kernel.
 void vp_hid_touch(int phase, double x, double y);
+
+enum {
+    VP_HID_EV_TOUCH = 0,
+    VP_HID_EV_KEY = 1,
+};
+
+/// One replayed event. Touch events use phase/x/y, key events page/usage
+/// and down (1 = down, 0 = up).
+typedef struct {
+    uint64_t at_us; // offset from the start of the batch
+    uint8_t kind;
+    int32_t phase;
+    double x, y;
+    uint32_t page, usage;
+    BOOL down;
+} vp_hid_event_t;
+
+/// Queue `count` events for replay after everything already queued.
+/// Returns immediately.
+void vp_hid_replay(const vp_hid_event_t *events, size_t count);
+
+/// Handle "hid_batch": {"events": [[at_us, kind, a, b, c], ...]} where a
+/// touch (kind 0) is [phase, x, y] and a key (kind 1) is [page, usage, down].
+/// Every element must be a number and every event exactly five long;
+/// anything else rejects the whole batch.
+NSDictionary *vp_handle_hid_batch(NSDictionary *msg);
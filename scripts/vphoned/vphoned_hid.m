@@ -1,6 +1,10 @@
 #import "vphoned_hid.h"
+#import "vphoned_protocol.h"
 #include <dlfcn.h>
+#include <mach/mach.h>
 #include <mach/mach_time.h>
+#include <math.h>
+#include <pthread.h>
 #include <unistd.h>
 
 typedef void *IOHIDEventSystemClientRef;
@@ -25,7 +29,28 @@ static void (*pAppend)(IOHIDEventRef, IOHIDEventRef, uint32_t);
 static void (*pSetInt)(IOHIDEventRef, uint32_t, int);
 
 static IOHIDEventSystemClientRef gClient;
-static dispatch_queue_t gHIDQueue;
+static mach_timebase_info_data_t gTimebase;
+
+#define VP_HID_PRESS_US 100000
+#define VP_HID_BATCH_MAX 4096
+#define VP_HID_BATCH_MAX_SPAN_US (60ull * 1000000ull)
+
+// Replay queue: batches are replayed one after another on gReplayThread.
+typedef struct vp_hid_batch {
+    struct vp_hid_batch *next;
+    size_t count;
+    vp_hid_event_t events[];
+} vp_hid_batch_t;
+
+static pthread_mutex_t gReplayLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gReplayCond = PTHREAD_COND_INITIALIZER;
+static vp_hid_batch_t *gReplayHead;
+static vp_hid_batch_t *gReplayTail;
+static pthread_t gReplayThread;
+/// Set if vp_hid_load failed: nothing will ever drain the queue.
+static BOOL gReplayDisabled;
+
+static void *replay_thread(void *arg);
 
 // Digitizer event-mask bits and transducer types (IOHIDEventTypes.h).
 #define VP_DIG_RANGE     0x00000001u
@@ -37,7 +62,7 @@ static dispatch_queue_t gHIDQueue;
 // kIOHIDEventFieldDigitizerIsDisplayIntegrated: (kIOHIDEventTypeDigitizer<<16)|offset.
 #define VP_FIELD_IS_DISPLAY_INTEGRATED ((((uint32_t)11) << 16) | 25)
 
-BOOL vp_hid_load(void) {
+static BOOL hid_load(void) {
     void *h = dlopen("/System/Library/Frameworks/IOKit.framework/IOKit", RTLD_NOW);
     if (!h) { NSLog(@"vphoned: dlopen IOKit failed"); return NO; }
 
@@ -61,40 +86,41 @@ BOOL vp_hid_load(void) {
     gClient = pCreate(kCFAllocatorDefault);
     if (!gClient) { NSLog(@"vphoned: IOHIDEventSystemClientCreate returned NULL"); return NO; }
 
-    dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(
-        DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INTERACTIVE, 0);
-    gHIDQueue = dispatch_queue_create("com.vphone.vphoned.hid", attr);
+    mach_timebase_info(&gTimebase);
+    if (pthread_create(&gReplayThread, NULL, replay_thread, NULL) != 0) {
+        NSLog(@"vphoned: failed to start HID replay thread");
+        return NO;
+    }
+    pthread_detach(gReplayThread);
 
     NSLog(@"vphoned: IOKit loaded");
     return YES;
 }
 
-static void send_hid_event(IOHIDEventRef event) {
-    IOHIDEventRef strong = (IOHIDEventRef)CFRetain(event);
-    dispatch_async(gHIDQueue, ^{
-        pSetSender(strong, 0x8000000817319372);
-        pDispatch(gClient, strong);
-        CFRelease(strong);
-    });
+BOOL vp_hid_load(void) {
+    if (hid_load())
+        return YES;
+    // Events queued while loading are dropped, and so is anything later.
+    pthread_mutex_lock(&gReplayLock);
+    gReplayDisabled = YES;
+    vp_hid_batch_t *batch = gReplayHead;
+    gReplayHead = gReplayTail = NULL;
+    pthread_mutex_unlock(&gReplayLock);
+    while (batch) {
+        vp_hid_batch_t *next = batch->next;
+        free(batch);
+        batch = next;
+    }
+    return NO;
 }
 
-void vp_hid_press(uint32_t page, uint32_t usage) {
-    IOHIDEventRef down = pKeyboard(kCFAllocatorDefault, mach_absolute_time(),
-                                   page, usage, 1, 0);
-    if (!down) return;
-    send_hid_event(down);
-    CFRelease(down);
-
-    usleep(100000);
-
-    IOHIDEventRef up = pKeyboard(kCFAllocatorDefault, mach_absolute_time(),
-                                 page, usage, 0, 0);
-    if (!up) return;
-    send_hid_event(up);
-    CFRelease(up);
+// Called on the replay thread only.
+static void send_hid_event(IOHIDEventRef event) {
+    pSetSender(event, 0x8000000817319372);
+    pDispatch(gClient, event);
 }
 
-void vp_hid_key(uint32_t page, uint32_t usage, BOOL down) {
+static void dispatch_key(uint32_t page, uint32_t usage, BOOL down) {
     IOHIDEventRef ev = pKeyboard(kCFAllocatorDefault, mach_absolute_time(),
                                  page, usage, down ? 1 : 0, 0);
     if (ev) { send_hid_event(ev); CFRelease(ev); }
@@ -120,16 +146,11 @@ static void dispatch_digitizer(double x, double y, boolean_t range,
         CFRelease(finger);
     }
 
-    IOHIDEventRef strong = (IOHIDEventRef)CFRetain(parent);
-    dispatch_async(gHIDQueue, ^{
-        pSetSender(strong, 0x8000000817319372);
-        pDispatch(gClient, strong);
-        CFRelease(strong);
-    });
+    send_hid_event(parent);
     CFRelease(parent);
 }
 
-void vp_hid_touch(int phase, double x, double y) {
+static void dispatch_touch(int phase, double x, double y) {
     switch (phase) {
     case 0: // down
         dispatch_digitizer(x, y, 1, 1, VP_DIG_TOUCH | VP_DIG_IDENTITY);
@@ -143,3 +164,158 @@ void vp_hid_touch(int phase, double x, double y) {
         break;
     }
 }
+
+// MARK: - Replay
+
+static uint64_t us_to_abs(uint64_t us) {
+    return us * 1000 * gTimebase.denom / gTimebase.numer;
+}
+
+/// Ask for a time-constraint (real-time) slot so pacing survives load.
+static void make_realtime(void) {
+    thread_time_constraint_policy_data_t policy = {
+        .period = (uint32_t)us_to_abs(5000),
+        .computation = (uint32_t)us_to_abs(500),
+        .constraint = (uint32_t)us_to_abs(2000),
+        .preemptible = TRUE,
+    };
+    kern_return_t kr = thread_policy_set(
+        pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+        (thread_policy_t)&policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    if (kr != KERN_SUCCESS)
+        NSLog(@"vphoned: HID replay thread not real-time (kr=%d)", kr);
+}
+
+static void *replay_thread(void *arg) {
+    (void)arg;
+    pthread_setname_np("com.vphone.vphoned.hid");
+    make_realtime();
+
+    for (;;) {
+        pthread_mutex_lock(&gReplayLock);
+        while (!gReplayHead)
+            pthread_cond_wait(&gReplayCond, &gReplayLock);
+        vp_hid_batch_t *batch = gReplayHead;
+        gReplayHead = batch->next;
+        if (!gReplayHead)
+            gReplayTail = NULL;
+        pthread_mutex_unlock(&gReplayLock);
+
+        uint64_t start = mach_absolute_time();
+        for (size_t i = 0; i < batch->count; i++) {
+            const vp_hid_event_t *ev = &batch->events[i];
+            uint64_t deadline = start + us_to_abs(ev->at_us);
+            if (deadline > mach_absolute_time())
+                mach_wait_until(deadline);
+            @autoreleasepool {
+                if (ev->kind == VP_HID_EV_TOUCH)
+                    dispatch_touch(ev->phase, ev->x, ev->y);
+                else
+                    dispatch_key(ev->page, ev->usage, ev->down);
+            }
+        }
+        free(batch);
+    }
+    return NULL;
+}
+
+void vp_hid_replay(const vp_hid_event_t *events, size_t count) {
+    if (count == 0)
+        return;
+    vp_hid_batch_t *batch =
+        malloc(sizeof(vp_hid_batch_t) + count * sizeof(vp_hid_event_t));
+    if (!batch)
+        return;
+    batch->next = NULL;
+    batch->count = count;
+    memcpy(batch->events, events, count * sizeof(vp_hid_event_t));
+
+    pthread_mutex_lock(&gReplayLock);
+    if (gReplayDisabled) {
+        pthread_mutex_unlock(&gReplayLock);
+        free(batch);
+        return;
+    }
+    if (gReplayTail)
+        gReplayTail->next = batch;
+    else
+        gReplayHead = batch;
+    gReplayTail = batch;
+    pthread_cond_signal(&gReplayCond);
+    pthread_mutex_unlock(&gReplayLock);
+}
+
+void vp_hid_press(uint32_t page, uint32_t usage) {
+    vp_hid_event_t evs[2] = {
+        {.at_us = 0, .kind = VP_HID_EV_KEY, .page = page, .usage = usage, .down = YES},
+        {.at_us = VP_HID_PRESS_US, .kind = VP_HID_EV_KEY, .page = page, .usage = usage, .down = NO},
+    };
+    vp_hid_replay(evs, 2);
+}
+
+void vp_hid_key(uint32_t page, uint32_t usage, BOOL down) {
+    vp_hid_event_t ev = {.kind = VP_HID_EV_KEY, .page = page, .usage = usage, .down = down};
+    vp_hid_replay(&ev, 1);
+}
+
+void vp_hid_touch(int phase, double x, double y) {
+    vp_hid_event_t ev = {.kind = VP_HID_EV_TOUCH, .phase = phase, .x = x, .y = y};
+    vp_hid_replay(&ev, 1);
+}
+
+NSDictionary *vp_handle_hid_batch(NSDictionary *msg) {
+    id reqId = msg[@"id"];
+    NSArray *events = msg[@"events"];
+    if (![events isKindOfClass:[NSArray class]] || events.count == 0 ||
+        events.count > VP_HID_BATCH_MAX) {
+        NSMutableDictionary *r = vp_make_response(@"err", reqId);
+        r[@"msg"] = [NSString stringWithFormat:@"hid_batch needs 1..%d events", VP_HID_BATCH_MAX];
+        return r;
+    }
+
+    size_t count = events.count;
+    vp_hid_event_t *buf = calloc(count, sizeof(vp_hid_event_t));
+    if (!buf) {
+        NSMutableDictionary *r = vp_make_response(@"err", reqId);
+        r[@"msg"] = @"out of memory";
+        return r;
+    }
+    for (size_t i = 0; i < count; i++) {
+        NSArray *e = events[i];
+        BOOL ok = [e isKindOfClass:[NSArray class]] && e.count == 5;
+        for (NSUInteger j = 0; ok && j < 5; j++)
+            ok = [e[j] isKindOfClass:[NSNumber class]];
+        if (ok) {
+            buf[i].at_us = [e[0] unsignedLongLongValue];
+            buf[i].kind = (uint8_t)[e[1] intValue];
+            ok = buf[i].at_us <= VP_HID_BATCH_MAX_SPAN_US;
+        }
+        if (ok && buf[i].kind == VP_HID_EV_TOUCH) {
+            buf[i].phase = [e[2] intValue];
+            buf[i].x = [e[3] doubleValue];
+            buf[i].y = [e[4] doubleValue];
+            ok = isfinite(buf[i].x) && isfinite(buf[i].y);
+        } else if (ok && buf[i].kind == VP_HID_EV_KEY) {
+            buf[i].page = [e[2] unsignedIntValue];
+            buf[i].usage = [e[3] unsignedIntValue];
+            buf[i].down = [e[4] boolValue];
+        } else {
+            ok = NO;
+        }
+        if (!ok) {
+            free(buf);
+            NSMutableDictionary *r = vp_make_response(@"err", reqId);
+            r[@"msg"] = [NSString stringWithFormat:@"hid_batch: malformed event %zu", i];
+            return r;
+        }
+    }
+
+    vp_hid_replay(buf, count);
+    uint64_t span = buf[count - 1].at_us;
+    free(buf);
+
+    NSMutableDictionary *r = vp_make_response(@"ok", reqId);
+    r[@"queued"] = @(count);
+    r[@"duration_ms"] = @(span / 1000);
+    return r;
+}
@@ -2,3 +2,17 @@
 
 BOOL vp_custom_installer_available(void);
 NSDictionary *vp_handle_custom_install(NSDictionary *msg);
+
+/// ipa_stream_begin / ipa_stream_end / ipa_stream_abort: install an IPA
+/// streamed over the connection, extracting and signing while it arrives.
+NSDictionary *vp_handle_install_stream(int fd, NSDictionary *msg);
+
+/// ipa_stream_data: read one chunk from `fd` on the reader thread and queue
+/// it for the stream's pipe without waiting on the extractor. The response
+/// is written under `writeLock` once the chunk is piped. Returns NO if the
+/// socket read failed.
+BOOL vp_install_stream_data(int fd, NSDictionary *msg, NSLock *writeLock);
+
+/// Drop the streams opened by connection `fd` and wait for their queued
+/// chunk responses. Their workers see EOF and clean up on their own.
+void vp_install_streams_abort(int fd);
@@ -12,6 +12,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#import "vphoned_apps.h"
 #import "vphoned_protocol.h"
 
 typedef struct __SecCode const *SecStaticCodeRef;
@@ -318,7 +319,142 @@ static int vp_sign_binary(
     return ret;
 }
 
-static int vp_sign_app(NSString *appPath, NSString *certPath, NSString *ldidPath, NSString **errorOutput) {
+/// Sign the main executable of the bundle described by `infoPlistPath`
+/// with its own entitlements. Bundles without an executable and frameworks
+/// are skipped. Returns 0, or 173 with ldid's output on failure.
+static int vp_sign_bundle_executable(NSString *infoPlistPath, BOOL isMainBundle, NSString *certPath, NSString *ldidPath, NSString **errorOutput) {
+    NSDictionary *infoDict = [NSDictionary dictionaryWithContentsOfFile:infoPlistPath];
+    NSString *bundleId = infoDict[@"CFBundleIdentifier"];
+    NSString *bundleExecutable = infoDict[@"CFBundleExecutable"];
+    if (bundleId.length == 0 || bundleExecutable.length == 0) {
+        return 0;
+    }
+
+    NSString *bundleMainExecutablePath = [[infoPlistPath stringByDeletingLastPathComponent]
+        stringByAppendingPathComponent:bundleExecutable];
+    if (![[NSFileManager defaultManager] fileExistsAtPath:bundleMainExecutablePath]) {
+        return 0;
+    }
+
+    NSString *packageType = infoDict[@"CFBundlePackageType"];
+    if ([packageType isEqualToString:@"FMWK"]) {
+        return 0;
+    }
+
+    NSMutableDictionary *entitlementsToUse = [vp_dump_entitlements_from_binary_at_path(bundleMainExecutablePath) mutableCopy];
+    if (!entitlementsToUse && isMainBundle) {
+        entitlementsToUse = [@{
+            @"application-identifier": @"TROLLTROLL.*",
+            @"com.apple.developer.team-identifier": @"TROLLTROLL",
+            @"get-task-allow": @YES,
+            @"keychain-access-groups": @[@"TROLLTROLL.*", @"com.apple.token"],
+        } mutableCopy];
+    }
+    if (!entitlementsToUse) {
+        entitlementsToUse = [NSMutableDictionary dictionary];
+    }
+
+    NSObject *containerRequired = entitlementsToUse[@"com.apple.private.security.container-required"];
+    BOOL shouldWriteContainerRequired = YES;
+    if ([containerRequired isKindOfClass:[NSString class]]) {
+        shouldWriteContainerRequired = NO;
+    } else if ([containerRequired isKindOfClass:[NSNumber class]]) {
+        shouldWriteContainerRequired = [(NSNumber *)containerRequired boolValue];
+    }
+    BOOL noContainer = [entitlementsToUse[@"com.apple.private.security.no-container"] respondsToSelector:@selector(boolValue)]
+        ? [entitlementsToUse[@"com.apple.private.security.no-container"] boolValue]
+        : NO;
+    BOOL noSandbox = [entitlementsToUse[@"com.apple.private.security.no-sandbox"] respondsToSelector:@selector(boolValue)]
+        ? [entitlementsToUse[@"com.apple.private.security.no-sandbox"] boolValue]
+        : NO;
+    if (shouldWriteContainerRequired && !noContainer && !noSandbox) {
+        entitlementsToUse[@"com.apple.private.security.container-required"] = bundleId;
+    }
+    entitlementsToUse[@"jb.pmap_cs_custom_trust"] = @"PMAP_CS_APP_STORE";
+
+    NSString *signOutput = @"";
+    int ret = vp_sign_binary(bundleMainExecutablePath, entitlementsToUse, certPath, ldidPath, &signOutput);
+    if (ret != 0) {
+        if (errorOutput) *errorOutput = signOutput;
+        return 173;
+    }
+    return 0;
+}
+
+// MARK: - Signing Pool
+
+/// Runs vp_sign_bundle_executable jobs on at most one ldid per core.
+/// submit blocks while the pool is full, which also throttles a caller that
+/// is still extracting. Keeps the first failure.
+@interface VPSignPool : NSObject
+- (instancetype)initWithCertPath:(NSString *)certPath ldidPath:(NSString *)ldidPath;
+- (void)submitInfoPlist:(NSString *)infoPlistPath isMainBundle:(BOOL)isMainBundle;
+/// Wait for every submitted job. Returns 0 or the first job's error code.
+- (int)waitWithError:(NSString **)errorOutput;
+@property (readonly) NSString *certPath;
+@property (readonly) NSString *ldidPath;
+@end
+
+@implementation VPSignPool {
+    dispatch_semaphore_t _slots;
+    dispatch_group_t _group;
+    NSLock *_lock;
+    NSMutableSet<NSString *> *_submitted;
+    int _ret;
+    NSString *_error;
+}
+
+- (instancetype)initWithCertPath:(NSString *)certPath ldidPath:(NSString *)ldidPath {
+    if ((self = [super init])) {
+        _certPath = certPath;
+        _ldidPath = ldidPath;
+        _slots = dispatch_semaphore_create((long)MAX(1, [NSProcessInfo processInfo].activeProcessorCount));
+        _group = dispatch_group_create();
+        _lock = [[NSLock alloc] init];
+        _submitted = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (void)submitInfoPlist:(NSString *)infoPlistPath isMainBundle:(BOOL)isMainBundle {
+    [_lock lock];
+    BOOL fresh = ![_submitted containsObject:infoPlistPath] && _ret == 0;
+    [_submitted addObject:infoPlistPath];
+    [_lock unlock];
+    if (!fresh) return;
+
+    dispatch_semaphore_wait(_slots, DISPATCH_TIME_FOREVER);
+    dispatch_group_async(_group, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        @autoreleasepool {
+            NSString *output = nil;
+            int ret = vp_sign_bundle_executable(infoPlistPath, isMainBundle, self.certPath, self.ldidPath, &output);
+            if (ret != 0) {
+                [self->_lock lock];
+                if (self->_ret == 0) {
+                    self->_ret = ret;
+                    self->_error = output;
+                }
+                [self->_lock unlock];
+            }
+            dispatch_semaphore_signal(self->_slots);
+        }
+    });
+}
+
+- (int)waitWithError:(NSString **)errorOutput {
+    dispatch_group_wait(_group, DISPATCH_TIME_FOREVER);
+    [_lock lock];
+    int ret = _ret;
+    if (ret != 0 && errorOutput) *errorOutput = _error;
+    [_lock unlock];
+    return ret;
+}
+
+@end
+
+/// Sign every bundle executable in `appPath` (in parallel, skipping those
+/// `pool` already handled), then the app as a whole.
+static int vp_sign_app(NSString *appPath, VPSignPool *pool, NSString **errorOutput) {
     if (!vp_info_dictionary_for_app_path(appPath)) {
         if (errorOutput) *errorOutput = @"missing app Info.plist";
         return 172;
@@ -330,6 +466,7 @@ static int vp_sign_app(NSString *appPath, NSString *certPath, NSString *ldidPath
         return 174;
     }
 
+    NSString *mainInfoPlistPath = [appPath stringByAppendingPathComponent:@"Info.plist"];
     NSURL *fileURL = nil;
     NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager]
         enumeratorAtURL:[NSURL fileURLWithPath:appPath]
@@ -341,66 +478,15 @@ static int vp_sign_app(NSString *appPath, NSString *certPath, NSString *ldidPath
         if (![filePath.lastPathComponent isEqualToString:@"Info.plist"]) {
             continue;
         }
-
-        NSDictionary *infoDict = [NSDictionary dictionaryWithContentsOfFile:filePath];
-        NSString *bundleId = infoDict[@"CFBundleIdentifier"];
-        NSString *bundleExecutable = infoDict[@"CFBundleExecutable"];
-        if (bundleId.length == 0 || bundleExecutable.length == 0) {
-            continue;
-        }
-
-        NSString *bundleMainExecutablePath = [[filePath stringByDeletingLastPathComponent]
-            stringByAppendingPathComponent:bundleExecutable];
-        if (![[NSFileManager defaultManager] fileExistsAtPath:bundleMainExecutablePath]) {
-            continue;
-        }
-
-        NSString *packageType = infoDict[@"CFBundlePackageType"];
-        if ([packageType isEqualToString:@"FMWK"]) {
-            continue;
-        }
-
-        NSMutableDictionary *entitlementsToUse = [vp_dump_entitlements_from_binary_at_path(bundleMainExecutablePath) mutableCopy];
-        if (!entitlementsToUse && [bundleMainExecutablePath isEqualToString:mainExecutablePath]) {
-            entitlementsToUse = [@{
-                @"application-identifier": @"TROLLTROLL.*",
-                @"com.apple.developer.team-identifier": @"TROLLTROLL",
-                @"get-task-allow": @YES,
-                @"keychain-access-groups": @[@"TROLLTROLL.*", @"com.apple.token"],
-            } mutableCopy];
-        }
-        if (!entitlementsToUse) {
-            entitlementsToUse = [NSMutableDictionary dictionary];
-        }
-
-        NSObject *containerRequired = entitlementsToUse[@"com.apple.private.security.container-required"];
-        BOOL shouldWriteContainerRequired = YES;
-        if ([containerRequired isKindOfClass:[NSString class]]) {
-            shouldWriteContainerRequired = NO;
-        } else if ([containerRequired isKindOfClass:[NSNumber class]]) {
-            shouldWriteContainerRequired = [(NSNumber *)containerRequired boolValue];
-        }
-        BOOL noContainer = [entitlementsToUse[@"com.apple.private.security.no-container"] respondsToSelector:@selector(boolValue)]
-            ? [entitlementsToUse[@"com.apple.private.security.no-container"] boolValue]
-            : NO;
-        BOOL noSandbox = [entitlementsToUse[@"com.apple.private.security.no-sandbox"] respondsToSelector:@selector(boolValue)]
-            ? [entitlementsToUse[@"com.apple.private.security.no-sandbox"] boolValue]
-            : NO;
-        if (shouldWriteContainerRequired && !noContainer && !noSandbox) {
-            entitlementsToUse[@"com.apple.private.security.container-required"] = bundleId;
-        }
-        entitlementsToUse[@"jb.pmap_cs_custom_trust"] = @"PMAP_CS_APP_STORE";
-
-        NSString *signOutput = @"";
-        int ret = vp_sign_binary(bundleMainExecutablePath, entitlementsToUse, certPath, ldidPath, &signOutput);
-        if (ret != 0) {
-            if (errorOutput) *errorOutput = signOutput;
-            return 173;
-        }
+        [pool submitInfoPlist:filePath isMainBundle:[filePath isEqualToString:mainInfoPlistPath]];
+    }
+    int ret = [pool waitWithError:errorOutput];
+    if (ret != 0) {
+        return ret;
     }
 
     NSString *recursiveOutput = @"";
-    int recursiveRet = vp_sign_binary(appPath, nil, certPath, ldidPath, &recursiveOutput);
+    int recursiveRet = vp_sign_binary(appPath, nil, pool.certPath, pool.ldidPath, &recursiveOutput);
     if (recursiveRet != 0) {
         if (errorOutput) *errorOutput = recursiveOutput;
         return 173;
@@ -461,18 +547,6 @@ static NSDictionary *vp_construct_environment_variables_for_container_path(NSStr
     };
 }
 
-static NSSet<NSString *> *vp_immutable_app_bundle_identifiers(void) {
-    NSMutableSet<NSString *> *systemAppIdentifiers = [NSMutableSet set];
-    LSEnumerator *enumerator = [LSEnumerator enumeratorForApplicationProxiesWithOptions:0];
-    LSApplicationProxy *appProxy = nil;
-    while ((appProxy = [enumerator nextObject])) {
-        if (appProxy.installed && ![appProxy.bundleURL.path hasPrefix:@"/private/var/containers"]) {
-            [systemAppIdentifiers addObject:appProxy.bundleIdentifier.lowercaseString];
-        }
-    }
-    return systemAppIdentifiers.copy;
-}
-
 static BOOL vp_register_path(NSString *path, BOOL unregister, BOOL forceSystem) {
     if (path.length == 0) return NO;
 
@@ -488,7 +562,7 @@ static BOOL vp_register_path(NSString *path, BOOL unregister, BOOL forceSystem)
     NSDictionary *appInfoPlist = [NSDictionary dictionaryWithContentsOfFile:[path stringByAppendingPathComponent:@"Info.plist"]];
     NSString *appBundleID = appInfoPlist[@"CFBundleIdentifier"];
     if (appBundleID.length == 0) return NO;
-    if ([vp_immutable_app_bundle_identifiers() containsObject:appBundleID.lowercaseString]) return NO;
+    if ([vp_apps_immutable_bundle_identifiers() containsObject:appBundleID.lowercaseString]) return NO;
 
     if (!unregister) {
         NSString *appExecutablePath = [path stringByAppendingPathComponent:appInfoPlist[@"CFBundleExecutable"]];
@@ -677,8 +751,7 @@ static BOOL vp_mark_container_as_managed(NSString *containerPath) {
 static int vp_install_app_from_package(
     NSString *appPackagePath,
     BOOL forceSystem,
-    NSString *certPath,
-    NSString *ldidPath,
+    VPSignPool *pool,
     NSString **detailOutput
 ) {
     NSString *appPayloadPath = [appPackagePath stringByAppendingPathComponent:@"Payload"];
@@ -694,13 +767,13 @@ static int vp_install_app_from_package(
         return 176;
     }
 
-    if ([vp_immutable_app_bundle_identifiers() containsObject:appId.lowercaseString]) {
+    if ([vp_apps_immutable_bundle_identifiers() containsObject:appId.lowercaseString]) {
         if (detailOutput) *detailOutput = @"cannot overwrite immutable system app";
         return 179;
     }
 
     NSString *signOutput = @"";
-    int signRet = vp_sign_app(appBundleToInstallPath, certPath, ldidPath, &signOutput);
+    int signRet = vp_sign_app(appBundleToInstallPath, pool, &signOutput);
     if (signRet != 0) {
         if (detailOutput) *detailOutput = signOutput;
         return signRet;
@@ -755,6 +828,8 @@ static int vp_install_app_from_package(
         if (detailOutput) *detailOutput = @"install copied files but LaunchServices registration failed";
         return 181;
     }
+    // Don't wait for the LaunchServices notification before app_list sees it.
+    vp_apps_invalidate();
 
     if (detailOutput) {
         *detailOutput = [NSString stringWithFormat:@"%@ (%@)", updatedAppURL.lastPathComponent, appId];
@@ -782,13 +857,60 @@ BOOL vp_custom_installer_available(void) {
         && NSClassFromString(@"LSApplicationWorkspace") != Nil;
 }
 
+/// Validate installer prerequisites and resolve ldid. Returns an error
+/// response, or nil with `ldidOutput` set.
+static NSDictionary *vp_check_installer(id reqId, NSString **ldidOutput) {
+    if (!vp_custom_installer_available()) {
+        NSMutableDictionary *response = vp_make_response(@"err", reqId);
+        NSMutableArray<NSString *> *missing = [NSMutableArray array];
+        if (NSClassFromString(@"MCMAppContainer") == Nil) [missing addObject:@"MCMAppContainer"];
+        if (NSClassFromString(@"LSApplicationWorkspace") == Nil) [missing addObject:@"LSApplicationWorkspace"];
+        NSString *detail = missing.count > 0 ? [missing componentsJoinedByString:@", "] : @"unknown";
+        response[@"msg"] = [NSString stringWithFormat:@"Built-in IPA installer prerequisites are missing: %@", detail];
+        return response;
+    }
+    NSString *ldidPath = vp_find_ldid_path();
+    if (ldidPath.length == 0) {
+        NSMutableDictionary *response = vp_make_response(@"err", reqId);
+        response[@"msg"] = @"Built-in IPA installer could not find a guest-side iOS ldid.";
+        return response;
+    }
+    *ldidOutput = ldidPath;
+    return nil;
+}
+
+static NSString *vp_make_extraction_directory(void) {
+    NSString *tmpPackagePath = [[NSTemporaryDirectory() stringByResolvingSymlinksInPath] stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    if (![[NSFileManager defaultManager] createDirectoryAtPath:tmpPackagePath withIntermediateDirectories:NO attributes:nil error:nil]) {
+        return nil;
+    }
+    return tmpPackagePath;
+}
+
+static NSDictionary *vp_install_response(id reqId, int extractRet, int installRet, BOOL forceSystem, NSString *detail) {
+    if (extractRet != 0 || installRet != 0) {
+        NSMutableDictionary *response = vp_make_response(@"err", reqId);
+        int retCode = extractRet != 0 ? extractRet : installRet;
+        NSString *trimmed = vp_trimmed_output(detail ?: @"");
+        response[@"msg"] = trimmed.length > 0
+            ? [NSString stringWithFormat:@"built-in installer failed (%d)\n%@", retCode, trimmed]
+            : [NSString stringWithFormat:@"built-in installer failed (%d)", retCode];
+        return response;
+    }
+
+    NSMutableDictionary *response = vp_make_response(@"ok", reqId);
+    response[@"msg"] = forceSystem
+        ? [NSString stringWithFormat:@"Installed via built-in installer as System: %@", detail]
+        : [NSString stringWithFormat:@"Installed via built-in installer as User: %@", detail];
+    return response;
+}
+
 NSDictionary *vp_handle_custom_install(NSDictionary *msg) {
     vp_load_private_frameworks();
     id reqId = msg[@"id"];
     NSString *ipaPath = msg[@"path"];
     NSString *registration = msg[@"registration"];
     NSString *certPath = msg[@"cert_path"];
-    NSString *ldidPath = vp_find_ldid_path();
     BOOL forceSystem = [registration isEqualToString:@"System"];
 
     if (ipaPath.length == 0) {
@@ -801,26 +923,15 @@ NSDictionary *vp_handle_custom_install(NSDictionary *msg) {
         response[@"msg"] = [NSString stringWithFormat:@"IPA not found: %@", ipaPath];
         return response;
     }
-    if (!vp_custom_installer_available()) {
-        NSMutableDictionary *response = vp_make_response(@"err", reqId);
-        NSMutableArray<NSString *> *missing = [NSMutableArray array];
-        if (NSClassFromString(@"MCMAppContainer") == Nil) [missing addObject:@"MCMAppContainer"];
-        if (NSClassFromString(@"LSApplicationWorkspace") == Nil) [missing addObject:@"LSApplicationWorkspace"];
-        NSString *detail = missing.count > 0 ? [missing componentsJoinedByString:@", "] : @"unknown";
-        response[@"msg"] = [NSString stringWithFormat:@"Built-in IPA installer prerequisites are missing: %@", detail];
-        return response;
-    }
-    if (ldidPath.length == 0) {
-        NSMutableDictionary *response = vp_make_response(@"err", reqId);
-        response[@"msg"] = @"Built-in IPA installer could not find a guest-side iOS ldid.";
-        return response;
-    }
+    NSString *ldidPath = nil;
+    NSDictionary *failure = vp_check_installer(reqId, &ldidPath);
+    if (failure) return failure;
     if (certPath.length > 0 && ![[NSFileManager defaultManager] fileExistsAtPath:certPath]) {
         certPath = nil;
     }
 
-    NSString *tmpPackagePath = [[NSTemporaryDirectory() stringByResolvingSymlinksInPath] stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
-    if (![[NSFileManager defaultManager] createDirectoryAtPath:tmpPackagePath withIntermediateDirectories:NO attributes:nil error:nil]) {
+    NSString *tmpPackagePath = vp_make_extraction_directory();
+    if (!tmpPackagePath) {
         NSMutableDictionary *response = vp_make_response(@"err", reqId);
         response[@"msg"] = @"failed to create temporary extraction directory";
         return response;
@@ -830,7 +941,8 @@ NSDictionary *vp_handle_custom_install(NSDictionary *msg) {
     int extractRet = vp_extract_package_to_directory(ipaPath, tmpPackagePath, &detail);
     int installRet = 0;
     if (extractRet == 0) {
-        installRet = vp_install_app_from_package(tmpPackagePath, forceSystem, certPath, ldidPath, &detail);
+        VPSignPool *pool = [[VPSignPool alloc] initWithCertPath:certPath ldidPath:ldidPath];
+        installRet = vp_install_app_from_package(tmpPackagePath, forceSystem, pool, &detail);
     }
 
     [[NSFileManager defaultManager] removeItemAtPath:tmpPackagePath error:nil];
@@ -838,19 +950,259 @@ NSDictionary *vp_handle_custom_install(NSDictionary *msg) {
     if (certPath.length > 0) {
         [[NSFileManager defaultManager] removeItemAtPath:certPath error:nil];
     }
-    if (extractRet != 0 || installRet != 0) {
+    return vp_install_response(reqId, extractRet, installRet, forceSystem, detail);
+}
+
+// MARK: - Streaming Install
+
+/// One ipa_stream_begin ... ipa_stream_end session. The reader thread
+/// copies each chunk off the socket and hands it to `feeder`, which writes
+/// it into a pipe that libarchive reads on `worker`; bundle executables
+/// are handed to the signing pool as soon as both their Info.plist and
+/// binary are on disk. Only `feeder` touches `writeFd`.
+@interface VPInstallStream : NSObject
+@property (nonatomic) int ownerFd;
+@property (nonatomic) int writeFd;
+@property (nonatomic) dispatch_queue_t feeder;
+@property (nonatomic) unsigned long long received;
+@property (nonatomic) BOOL forceSystem;
+@property (nonatomic) dispatch_group_t worker;
+@property (nonatomic) int extractRet;
+@property (nonatomic) int installRet;
+@property (nonatomic, copy) NSString *detail;
+@end
+
+@implementation VPInstallStream
+@end
+
+static NSMutableDictionary<NSString *, VPInstallStream *> *gStreams;
+static NSLock *gStreamsLock;
+
+static void vp_streams_init(void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        gStreams = [NSMutableDictionary dictionary];
+        gStreamsLock = [[NSLock alloc] init];
+    });
+}
+
+static VPInstallStream *vp_stream_lookup(NSString *streamId) {
+    vp_streams_init();
+    [gStreamsLock lock];
+    VPInstallStream *stream = streamId ? gStreams[streamId] : nil;
+    [gStreamsLock unlock];
+    return stream;
+}
+
+/// Close the feeding end so the extractor sees EOF. Idempotent; runs on
+/// the stream's feeder queue.
+static void vp_stream_close_input(VPInstallStream *stream) {
+    int writeFd = stream.writeFd;
+    stream.writeFd = -1;
+    if (writeFd >= 0) close(writeFd);
+}
+
+/// Let queued chunks reach the pipe, then close it.
+static void vp_stream_finish_input(VPInstallStream *stream) {
+    dispatch_sync(stream.feeder, ^{
+        vp_stream_close_input(stream);
+    });
+}
+
+/// Remove `streamId` from the registry and return it.
+static VPInstallStream *vp_stream_take(NSString *streamId) {
+    vp_streams_init();
+    [gStreamsLock lock];
+    VPInstallStream *stream = streamId ? gStreams[streamId] : nil;
+    if (stream) [gStreams removeObjectForKey:streamId];
+    [gStreamsLock unlock];
+    return stream;
+}
+
+/// Extract from `readFd`, signing as entries land, then install.
+static void vp_stream_run(VPInstallStream *stream, int readFd, BOOL forceSystem, NSString *certPath, NSString *ldidPath) {
+    NSString *tmpPackagePath = vp_make_extraction_directory();
+    if (!tmpPackagePath) {
+        close(readFd);
+        stream.extractRet = 168;
+        stream.detail = @"failed to create temporary extraction directory";
+        return;
+    }
+
+    VPSignPool *pool = [[VPSignPool alloc] initWithCertPath:certPath ldidPath:ldidPath];
+    // Bundle directory -> CFBundleExecutable for Info.plists whose binary
+    // has not been extracted yet.
+    NSMutableDictionary<NSString *, NSString *> *awaitingExecutable = [NSMutableDictionary dictionary];
+    void (^submit)(NSString *) = ^(NSString *bundlePath) {
+        BOOL isMain = [[bundlePath stringByDeletingLastPathComponent].lastPathComponent isEqualToString:@"Payload"];
+        [pool submitInfoPlist:[bundlePath stringByAppendingPathComponent:@"Info.plist"] isMainBundle:isMain];
+    };
+
+    NSString *archiveError = nil;
+    int ret = vp_extract_archive_fd(readFd, tmpPackagePath, ^(NSString *path, BOOL isRegularFile) {
+        if (!isRegularFile) return;
+        NSString *bundlePath = [path stringByDeletingLastPathComponent];
+        if ([path.lastPathComponent isEqualToString:@"Info.plist"]) {
+            NSDictionary *info = [NSDictionary dictionaryWithContentsOfFile:path];
+            NSString *executable = info[@"CFBundleExecutable"];
+            if (executable.length == 0 || [info[@"CFBundlePackageType"] isEqualToString:@"FMWK"]) return;
+            if ([[NSFileManager defaultManager] fileExistsAtPath:[bundlePath stringByAppendingPathComponent:executable]]) {
+                submit(bundlePath);
+            } else {
+                awaitingExecutable[bundlePath] = executable;
+            }
+        } else if ([awaitingExecutable[bundlePath] isEqualToString:path.lastPathComponent]) {
+            [awaitingExecutable removeObjectForKey:bundlePath];
+            submit(bundlePath);
+        }
+    }, &archiveError);
+    close(readFd);
+
+    NSString *detail = @"";
+    if (ret != 0) {
+        stream.extractRet = 168;
+        detail = archiveError ?: @"libarchive extraction failed";
+        [pool waitWithError:nil];
+    } else {
+        stream.installRet = vp_install_app_from_package(tmpPackagePath, forceSystem, pool, &detail);
+    }
+    stream.detail = detail;
+
+    [[NSFileManager defaultManager] removeItemAtPath:tmpPackagePath error:nil];
+    if (certPath.length > 0) {
+        [[NSFileManager defaultManager] removeItemAtPath:certPath error:nil];
+    }
+}
+
+static NSDictionary *vp_stream_begin(int fd, NSDictionary *msg, id reqId) {
+    NSString *certPath = msg[@"cert_path"];
+    BOOL forceSystem = [msg[@"registration"] isEqualToString:@"System"];
+    NSString *ldidPath = nil;
+    NSDictionary *failure = vp_check_installer(reqId, &ldidPath);
+    if (failure) return failure;
+    if (certPath.length > 0 && ![[NSFileManager defaultManager] fileExistsAtPath:certPath]) {
+        certPath = nil;
+    }
+
+    // Close-on-exec so ldid children never hold the pipe open.
+    int fds[2];
+    if (pipe(fds) != 0) {
         NSMutableDictionary *response = vp_make_response(@"err", reqId);
-        int retCode = extractRet != 0 ? extractRet : installRet;
-        NSString *trimmed = vp_trimmed_output(detail ?: @"");
-        response[@"msg"] = trimmed.length > 0
-            ? [NSString stringWithFormat:@"built-in installer failed (%d)\n%@", retCode, trimmed]
-            : [NSString stringWithFormat:@"built-in installer failed (%d)", retCode];
+        response[@"msg"] = [NSString stringWithFormat:@"pipe failed: %s", strerror(errno)];
         return response;
     }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    VPInstallStream *stream = [[VPInstallStream alloc] init];
+    stream.ownerFd = fd;
+    stream.forceSystem = forceSystem;
+    stream.writeFd = fds[1];
+    stream.feeder = dispatch_queue_create("com.vphone.vphoned.ipa_stream", DISPATCH_QUEUE_SERIAL);
+    stream.worker = dispatch_group_create();
+    NSString *streamId = [NSUUID UUID].UUIDString;
+    vp_streams_init();
+    [gStreamsLock lock];
+    gStreams[streamId] = stream;
+    [gStreamsLock unlock];
+
+    int readFd = fds[0];
+    dispatch_group_async(stream.worker, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        @autoreleasepool {
+            vp_stream_run(stream, readFd, forceSystem, certPath, ldidPath);
+        }
+    });
 
+    NSLog(@"vphoned: ipa_stream %@ started", streamId);
     NSMutableDictionary *response = vp_make_response(@"ok", reqId);
-    response[@"msg"] = forceSystem
-        ? [NSString stringWithFormat:@"Installed via built-in installer as System: %@", detail]
-        : [NSString stringWithFormat:@"Installed via built-in installer as User: %@", detail];
+    response[@"stream"] = streamId;
     return response;
 }
+
+/// Largest ipa_stream_data chunk buffered in memory; the host sends 1 MiB.
+static const NSUInteger kStreamChunkLimit = 16 * 1024 * 1024;
+
+BOOL vp_install_stream_data(int fd, NSDictionary *msg, NSLock *writeLock) {
+    id reqId = msg[@"id"];
+    NSUInteger size = [msg[@"size"] unsignedIntegerValue];
+    VPInstallStream *stream = vp_stream_lookup(msg[@"stream"]);
+    NSMutableData *chunk = stream && size <= kStreamChunkLimit ? [NSMutableData dataWithLength:size] : nil;
+    if (!chunk) {
+        vp_drain(fd, size);
+        NSMutableDictionary *response = vp_make_response(@"err", reqId);
+        response[@"msg"] = stream ? @"install stream chunk too large" : @"unknown or aborted install stream";
+        [writeLock lock];
+        BOOL ok = vp_write_message(fd, response);
+        [writeLock unlock];
+        return ok;
+    }
+    // The connection is gone if this fails; the reader loop tears down.
+    if (size > 0 && !vp_read_fully(fd, chunk.mutableBytes, size)) return NO;
+
+    // Ack once the chunk is in the pipe, so the host's window bounds what
+    // is buffered here. Once the extractor stops reading (done at the zip
+    // central directory, or failed) the rest is dropped; ipa_stream_end
+    // reports the outcome.
+    dispatch_async(stream.feeder, ^{
+        if (stream.writeFd >= 0 && !vp_write_fully(stream.writeFd, chunk.bytes, chunk.length)) {
+            vp_stream_close_input(stream);
+        }
+        stream.received += chunk.length;
+        NSMutableDictionary *response = vp_make_response(@"ok", reqId);
+        response[@"received"] = @(stream.received);
+        [writeLock lock];
+        BOOL ok = vp_write_message(fd, response);
+        [writeLock unlock];
+        if (!ok) shutdown(fd, SHUT_RDWR);
+    });
+    return YES;
+}
+
+static NSDictionary *vp_stream_end(NSDictionary *msg, id reqId) {
+    NSString *streamId = msg[@"stream"];
+    VPInstallStream *stream = vp_stream_take(streamId);
+    if (!stream) {
+        NSMutableDictionary *response = vp_make_response(@"err", reqId);
+        response[@"msg"] = @"unknown install stream";
+        return response;
+    }
+    vp_stream_finish_input(stream);
+    dispatch_group_wait(stream.worker, DISPATCH_TIME_FOREVER);
+    NSLog(@"vphoned: ipa_stream %@ finished (%llu bytes)", streamId, stream.received);
+    return vp_install_response(reqId, stream.extractRet, stream.installRet, stream.forceSystem, stream.detail);
+}
+
+/// The host gave up on the stream; the worker sees EOF and cleans up.
+static NSDictionary *vp_stream_abort(NSDictionary *msg, id reqId) {
+    NSString *streamId = msg[@"stream"];
+    VPInstallStream *stream = vp_stream_take(streamId);
+    if (stream) {
+        vp_stream_finish_input(stream);
+        NSLog(@"vphoned: ipa_stream %@ aborted by host", streamId);
+    }
+    return vp_make_response(@"ok", reqId);
+}
+
+NSDictionary *vp_handle_install_stream(int fd, NSDictionary *msg) {
+    vp_load_private_frameworks();
+    NSString *type = msg[@"t"];
+    id reqId = msg[@"id"];
+    if ([type isEqualToString:@"ipa_stream_end"]) return vp_stream_end(msg, reqId);
+    if ([type isEqualToString:@"ipa_stream_abort"]) return vp_stream_abort(msg, reqId);
+    return vp_stream_begin(fd, msg, reqId);
+}
+
+void vp_install_streams_abort(int fd) {
+    vp_streams_init();
+    [gStreamsLock lock];
+    NSDictionary *streams = [gStreams copy];
+    [gStreamsLock unlock];
+    for (NSString *streamId in streams) {
+        VPInstallStream *stream = streams[streamId];
+        if (stream.ownerFd != fd) continue;
+        vp_stream_take(streamId);
+        // Waits out queued chunk acks, which still write to fd.
+        vp_stream_finish_input(stream);
+        NSLog(@"vphoned: ipa_stream %@ aborted", streamId);
+    }
+}
@@ -1,8 +1,9 @@
 /*
  * vphoned_keychain — Remote keychain enumeration over vsock.
  *
- * Handles keychain_list: queries SecItemCopyMatching for all keychain
- * classes and returns attributes as JSON.
+ * Handles keychain_list: pages through the keychain database for all
+ * classes and returns attributes as JSON, optionally as a delta against a
+ * change token. keychain_get fetches one item with its value.
  */
 
 #pragma once
@@ -9,6 +9,7 @@
 #import "vphoned_keychain.h"
 #import "vphoned_protocol.h"
 #import <Security/Security.h>
+#include <pthread.h>
 #import <sqlite3.h>
 
 // MARK: - Helpers
@@ -33,16 +34,6 @@ static id safe_value(id val) {
 
 static NSString *KEYCHAIN_DB_PATH = @"/var/Keychains/keychain-2.db";
 
-/// Map sqlite table name to our class abbreviation.
-static NSDictionary *tableToClass(void) {
-    return @{
-        @"genp": @"genp",
-        @"inet": @"inet",
-        @"cert": @"cert",
-        @"keys": @"keys",
-    };
-}
-
 /// Read a text column, returning @"" if NULL.
 static NSString *col_text(sqlite3_stmt *stmt, int col) {
     const unsigned char *val = sqlite3_column_text(stmt, col);
@@ -50,145 +41,333 @@ static NSString *col_text(sqlite3_stmt *stmt, int col) {
     return [NSString stringWithUTF8String:(const char *)val];
 }
 
-/// Read a blob column as base64 string.
-static NSString *col_blob_base64(sqlite3_stmt *stmt, int col) {
-    const void *blob = sqlite3_column_blob(stmt, col);
-    int size = sqlite3_column_bytes(stmt, col);
-    if (!blob || size <= 0) return @"";
-    NSData *data = [NSData dataWithBytes:blob length:size];
-    // Try UTF-8 first
-    NSString *str = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-    if (str) return str;
-    return [data base64EncodedStringWithOptions:0];
+/*
+ * One read-only connection stays open for the daemon's lifetime, with a
+ * persistent prepared statement per table, so keychain_list does not
+ * reopen the database or re-parse SQL on every call.
+ *
+ * Listing uses keyset pagination ("cursor" = "<class>:<rowid>", "limit").
+ * "values": false leaves the data blob out (valueSize is still reported);
+ * keychain_get fetches a single item with its value.
+ *
+ * Every response carries a change "token": a per-process session id, the
+ * connection's PRAGMA data_version, and each table's rowid and mdat high-
+ * water marks. Passing it back as "since" returns "unchanged" if
+ * nothing committed in between. Otherwise it returns only rows that are
+ * new or modified since the token, plus every live rowid on the last
+ * page so the client can drop deleted items. A multi-page scan should
+ * keep the token from its first page.
+ */
+
+typedef struct {
+    const char *name;
+    BOOL isInet;
+    BOOL hasAccount;
+    sqlite3_stmt *list;   // page of rows after a rowid (see list_sql)
+    sqlite3_stmt *stats;  // max(rowid), max(mdat)
+    sqlite3_stmt *rowids; // every rowid, for delta deletes
+} vp_kc_table_t;
+
+static vp_kc_table_t gTables[] = {
+    {"genp", NO, YES, NULL, NULL, NULL},
+    {"inet", YES, YES, NULL, NULL, NULL},
+    {"cert", NO, NO, NULL, NULL, NULL},
+    {"keys", NO, NO, NULL, NULL, NULL},
+};
+#define VP_KC_TABLE_COUNT (sizeof(gTables) / sizeof(gTables[0]))
+
+static pthread_mutex_t gKCLock = PTHREAD_MUTEX_INITIALIZER;
+static sqlite3 *gKCDB;
+static sqlite3_stmt *gKCVersion;
+static uint32_t gKCSession;
+/// Set when a query fails mid-step; the connection is reopened next time.
+static BOOL gKCBroken;
+
+/// Bindings: ?1 after rowid, ?2 limit (-1 = all), ?3 include data,
+/// ?4 since rowid (NULL = full listing), ?5 since mdat.
+static NSString *list_sql(const vp_kc_table_t *t) {
+    NSMutableString *cols = [NSMutableString stringWithString:@"rowid"];
+    if (t->hasAccount) [cols appendString:@", acct, svce"];
+    [cols appendString:@", agrp, labl, CASE WHEN ?3 THEN data END, length(data), cdat, mdat, pdmn"];
+    if (t->isInet) [cols appendString:@", srvr, ptcl, port, path"];
+    return [NSString stringWithFormat:
+        @"SELECT %@ FROM %s WHERE rowid > ?1 AND (?4 IS NULL OR rowid > ?4 OR mdat > ?5) "
+        @"ORDER BY rowid LIMIT ?2", cols, t->name];
 }
 
-/// Query one table from the keychain DB via sqlite3.
-static NSArray *query_db_table(sqlite3 *db, NSString *table, NSString *className, NSMutableArray *diag) {
-    // Columns available in genp/inet tables:
-    //   rowid, acct, svce, agrp, labl, data, cdat, mdat, desc, icmt, type, crtr, pdmn
-    // inet also has: srvr, ptcl, port, path
-    NSString *sql;
-    BOOL isInet = [table isEqualToString:@"inet"];
-    BOOL isCert = [table isEqualToString:@"cert"];
-    BOOL isKeys = [table isEqualToString:@"keys"];
-
-    if (isInet) {
-        sql = [NSString stringWithFormat:
-            @"SELECT rowid, acct, svce, agrp, labl, data, cdat, mdat, pdmn, srvr, ptcl, port, path FROM %@", table];
-    } else if (isCert || isKeys) {
-        sql = [NSString stringWithFormat:
-            @"SELECT rowid, agrp, labl, data, cdat, mdat, pdmn FROM %@", table];
-    } else {
-        sql = [NSString stringWithFormat:
-            @"SELECT rowid, acct, svce, agrp, labl, data, cdat, mdat, pdmn FROM %@", table];
+static sqlite3_stmt *prepare(NSString *sql) {
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v3(gKCDB, sql.UTF8String, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL) != SQLITE_OK)
+        return NULL;
+    return stmt;
+}
+
+static void kc_close(void) {
+    for (size_t i = 0; i < VP_KC_TABLE_COUNT; i++) {
+        sqlite3_finalize(gTables[i].list);
+        sqlite3_finalize(gTables[i].stats);
+        sqlite3_finalize(gTables[i].rowids);
+        gTables[i].list = gTables[i].stats = gTables[i].rowids = NULL;
     }
+    sqlite3_finalize(gKCVersion);
+    gKCVersion = NULL;
+    sqlite3_close(gKCDB);
+    gKCDB = NULL;
+}
 
-    sqlite3_stmt *stmt = NULL;
-    int rc = sqlite3_prepare_v2(db, sql.UTF8String, -1, &stmt, NULL);
+/// Open the shared connection if needed. Caller holds gKCLock.
+static BOOL kc_open(NSMutableArray *diag) {
+    if (gKCDB) return YES;
+    int rc = sqlite3_open_v2(KEYCHAIN_DB_PATH.UTF8String, &gKCDB,
+                             SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
     if (rc != SQLITE_OK) {
-        [diag addObject:[NSString stringWithFormat:@"%@: sqlite error %d", className, rc]];
-        return @[];
+        [diag addObject:[NSString stringWithFormat:@"db open failed: %d", rc]];
+        NSLog(@"vphoned: sqlite3_open(%@) failed: %d", KEYCHAIN_DB_PATH, rc);
+        sqlite3_close(gKCDB);
+        gKCDB = NULL;
+        return NO;
+    }
+    sqlite3_busy_timeout(gKCDB, 250);
+
+    gKCVersion = prepare(@"PRAGMA data_version");
+    for (size_t i = 0; i < VP_KC_TABLE_COUNT; i++) {
+        vp_kc_table_t *t = &gTables[i];
+        t->list = prepare(list_sql(t));
+        t->stats = prepare([NSString stringWithFormat:@"SELECT max(rowid), max(mdat) FROM %s", t->name]);
+        t->rowids = prepare([NSString stringWithFormat:@"SELECT rowid FROM %s ORDER BY rowid", t->name]);
     }
+    gKCSession = arc4random();
+    [diag addObject:[NSString stringWithFormat:@"opened %@", KEYCHAIN_DB_PATH]];
+    return YES;
+}
 
-    NSMutableArray *output = [NSMutableArray array];
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        NSMutableDictionary *entry = [NSMutableDictionary dictionary];
-        entry[@"class"] = className;
+static vp_kc_table_t *table_named(NSString *name) {
+    for (size_t i = 0; i < VP_KC_TABLE_COUNT; i++)
+        if ([name isEqualToString:@(gTables[i].name)]) return &gTables[i];
+    return NULL;
+}
 
-        int col = 0;
-        int rowid = sqlite3_column_int(stmt, col++);
+static sqlite3_int64 data_version(void) {
+    if (!gKCVersion) return -1;
+    sqlite3_int64 v = sqlite3_step(gKCVersion) == SQLITE_ROW ? sqlite3_column_int64(gKCVersion, 0) : -1;
+    sqlite3_reset(gKCVersion);
+    return v;
+}
 
-        if (!isCert && !isKeys) {
-            entry[@"account"] = col_text(stmt, col++);
-            entry[@"service"] = col_text(stmt, col++);
-        }
-        entry[@"accessGroup"] = col_text(stmt, col++);
-        entry[@"label"] = col_text(stmt, col++);
-
-        // Value data
-        const void *blob = sqlite3_column_blob(stmt, col);
-        int blobSize = sqlite3_column_bytes(stmt, col);
-        if (blob && blobSize > 0) {
-            NSData *data = [NSData dataWithBytes:blob length:blobSize];
-            NSString *str = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-            if (str) {
-                entry[@"value"] = str;
-                entry[@"valueEncoding"] = @"utf8";
-            } else {
-                entry[@"value"] = [data base64EncodedStringWithOptions:0];
-                entry[@"valueEncoding"] = @"base64";
-            }
-            entry[@"valueSize"] = @(blobSize);
-        }
-        col++;
-
-        // Dates (stored as text in sqlite, e.g. "2025-01-15 12:34:56")
-        NSString *cdat = col_text(stmt, col++);
-        NSString *mdat = col_text(stmt, col++);
-        if (cdat.length > 0) entry[@"createdStr"] = cdat;
-        if (mdat.length > 0) entry[@"modifiedStr"] = mdat;
-
-        // Protection class (pdmn)
-        NSString *pdmn = col_text(stmt, col++);
-        if (pdmn.length > 0) entry[@"protection"] = pdmn;
-
-        // inet-specific fields
-        if (isInet) {
-            NSString *server = col_text(stmt, col++);
-            if (server.length > 0) entry[@"server"] = server;
-            NSString *protocol = col_text(stmt, col++);
-            if (protocol.length > 0) entry[@"protocol"] = protocol;
-            int port = sqlite3_column_int(stmt, col++);
-            if (port > 0) entry[@"port"] = @(port);
-            NSString *path = col_text(stmt, col++);
-            if (path.length > 0) entry[@"path"] = path;
-        }
+/// High-water marks for `t`: {"rowid": N, "mdat": "..."}.
+static NSDictionary *table_marks(vp_kc_table_t *t) {
+    if (!t->stats) return nil;
+    NSDictionary *marks = nil;
+    if (sqlite3_step(t->stats) == SQLITE_ROW) {
+        marks = @{
+            @"rowid": @(sqlite3_column_int64(t->stats, 0)),
+            @"mdat": sqlite3_column_type(t->stats, 1) == SQLITE_NULL ? (id)[NSNull null] : col_text(t->stats, 1),
+        };
+    }
+    sqlite3_reset(t->stats);
+    return marks;
+}
+
+static NSArray *table_rowids(vp_kc_table_t *t) {
+    if (!t->rowids) return @[];
+    NSMutableArray *out = [NSMutableArray array];
+    while (sqlite3_step(t->rowids) == SQLITE_ROW)
+        [out addObject:@(sqlite3_column_int64(t->rowids, 0))];
+    sqlite3_reset(t->rowids);
+    return out;
+}
 
-        // Use rowid for unique ID generation
-        entry[@"_rowid"] = @(rowid);
-        [output addObject:entry];
+/// Decode the current row of `t->list`.
+static NSDictionary *row_entry(const vp_kc_table_t *t) {
+    sqlite3_stmt *stmt = t->list;
+    NSMutableDictionary *entry = [NSMutableDictionary dictionary];
+    entry[@"class"] = @(t->name);
+
+    int col = 0;
+    sqlite3_int64 rowid = sqlite3_column_int64(stmt, col++);
+
+    if (t->hasAccount) {
+        entry[@"account"] = col_text(stmt, col++);
+        entry[@"service"] = col_text(stmt, col++);
+    }
+    entry[@"accessGroup"] = col_text(stmt, col++);
+    entry[@"label"] = col_text(stmt, col++);
+
+    // Value data (NULL when the request omitted values)
+    const void *blob = sqlite3_column_blob(stmt, col);
+    int blobSize = sqlite3_column_bytes(stmt, col);
+    if (blob && blobSize > 0) {
+        NSData *data = [NSData dataWithBytesNoCopy:(void *)blob length:blobSize freeWhenDone:NO];
+        NSString *str = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+        if (str) {
+            entry[@"value"] = str;
+            entry[@"valueEncoding"] = @"utf8";
+        } else {
+            entry[@"value"] = [data base64EncodedStringWithOptions:0];
+            entry[@"valueEncoding"] = @"base64";
+        }
+    }
+    col++;
+    int valueSize = sqlite3_column_int(stmt, col++);
+    if (valueSize > 0) entry[@"valueSize"] = @(valueSize);
+
+    // Dates (stored as text in sqlite, e.g. "2025-01-15 12:34:56")
+    NSString *cdat = col_text(stmt, col++);
+    NSString *mdat = col_text(stmt, col++);
+    if (cdat.length > 0) entry[@"createdStr"] = cdat;
+    if (mdat.length > 0) entry[@"modifiedStr"] = mdat;
+
+    // Protection class (pdmn)
+    NSString *pdmn = col_text(stmt, col++);
+    if (pdmn.length > 0) entry[@"protection"] = pdmn;
+
+    // inet-specific fields
+    if (t->isInet) {
+        NSString *server = col_text(stmt, col++);
+        if (server.length > 0) entry[@"server"] = server;
+        NSString *protocol = col_text(stmt, col++);
+        if (protocol.length > 0) entry[@"protocol"] = protocol;
+        int port = sqlite3_column_int(stmt, col++);
+        if (port > 0) entry[@"port"] = @(port);
+        NSString *path = col_text(stmt, col++);
+        if (path.length > 0) entry[@"path"] = path;
     }
 
-    sqlite3_finalize(stmt);
+    // Use rowid for unique ID generation
+    entry[@"_rowid"] = @(rowid);
+    return entry;
+}
 
-    NSUInteger count = output.count;
-    if (count > 0) {
-        [diag addObject:[NSString stringWithFormat:@"%@: %lu rows", className, (unsigned long)count]];
+/// Append up to `limit` rows of `t` after `after` (-1 = no limit). `since`
+/// is the table's marks from a change token, or nil for a full listing.
+/// Returns the number of rows read, or -1 on a database error.
+static int read_page(vp_kc_table_t *t, sqlite3_int64 after, int limit, BOOL values,
+                     NSDictionary *since, NSMutableArray *items, sqlite3_int64 *last) {
+    sqlite3_stmt *stmt = t->list;
+    if (!stmt) return -1;
+    sqlite3_bind_int64(stmt, 1, after);
+    sqlite3_bind_int(stmt, 2, limit);
+    sqlite3_bind_int(stmt, 3, values ? 1 : 0);
+    if (since) {
+        sqlite3_bind_int64(stmt, 4, [since[@"rowid"] longLongValue]);
+        NSString *mdat = since[@"mdat"];
+        if ([mdat isKindOfClass:[NSString class]])
+            sqlite3_bind_text(stmt, 5, mdat.UTF8String, -1, SQLITE_TRANSIENT);
+        else
+            sqlite3_bind_null(stmt, 5);
     } else {
-        [diag addObject:[NSString stringWithFormat:@"%@: empty", className]];
+        sqlite3_bind_null(stmt, 4);
+        sqlite3_bind_null(stmt, 5);
     }
-    return output;
-}
 
-/// Read all keychain items directly from the sqlite database.
-static NSDictionary *query_keychain_db(NSString *filterClass, NSMutableArray *diag) {
-    sqlite3 *db = NULL;
-    int rc = sqlite3_open_v2(KEYCHAIN_DB_PATH.UTF8String, &db, SQLITE_OPEN_READONLY, NULL);
-    if (rc != SQLITE_OK) {
-        [diag addObject:[NSString stringWithFormat:@"db open failed: %d", rc]];
-        NSLog(@"vphoned: sqlite3_open(%@) failed: %d", KEYCHAIN_DB_PATH, rc);
-        return @{@"items": @[], @"diag": diag};
+    int rows = 0, rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        @autoreleasepool {
+            NSDictionary *entry = row_entry(t);
+            *last = [entry[@"_rowid"] longLongValue];
+            [items addObject:entry];
+        }
+        rows++;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (rc != SQLITE_DONE) {
+        gKCBroken = YES;
+        return -1;
     }
+    return rows;
+}
 
-    [diag addObject:[NSString stringWithFormat:@"opened %@", KEYCHAIN_DB_PATH]];
+/// keychain_list. Caller holds gKCLock and has opened the connection.
+static void list_items(NSDictionary *msg, NSMutableDictionary *resp, NSMutableArray *diag) {
+    NSString *filterClass = msg[@"class"];
+    int limit = [msg[@"limit"] intValue];
+    if (limit <= 0) limit = -1;
+    BOOL values = msg[@"values"] ? [msg[@"values"] boolValue] : YES;
+
+    vp_kc_table_t *cursorTable = NULL;
+    sqlite3_int64 cursorRowid = 0;
+    NSString *cursor = msg[@"cursor"];
+    if ([cursor isKindOfClass:[NSString class]]) {
+        NSArray *parts = [cursor componentsSeparatedByString:@":"];
+        if (parts.count == 2) {
+            cursorTable = table_named(parts[0]);
+            cursorRowid = [parts[1] longLongValue];
+        }
+    }
 
-    NSMutableArray *allItems = [NSMutableArray array];
+    sqlite3_int64 version = data_version();
+    NSDictionary *since = msg[@"since"];
+    BOOL delta = [since isKindOfClass:[NSDictionary class]] &&
+                 [since[@"session"] unsignedIntValue] == gKCSession && version >= 0;
+    NSDictionary *sinceTables = delta ? since[@"tables"] : nil;
+
+    if (delta && !cursorTable && [since[@"version"] longLongValue] == version) {
+        resp[@"items"] = @[];
+        resp[@"count"] = @0;
+        resp[@"delta"] = @YES;
+        resp[@"unchanged"] = @YES;
+        resp[@"token"] = since;
+        return;
+    }
 
-    struct { NSString *table; NSString *name; } tables[] = {
-        { @"genp", @"genp" },
-        { @"inet", @"inet" },
-        { @"cert", @"cert" },
-        { @"keys", @"keys" },
-    };
+    NSMutableArray *items = [NSMutableArray array];
+    NSMutableDictionary *marks = [NSMutableDictionary dictionary];
+    NSMutableDictionary *live = [NSMutableDictionary dictionary];
+    NSString *next = nil;
+    BOOL reached = cursorTable == NULL;
+
+    for (size_t i = 0; i < VP_KC_TABLE_COUNT; i++) {
+        vp_kc_table_t *t = &gTables[i];
+        NSString *name = @(t->name);
+        if (filterClass && ![filterClass isEqualToString:name]) continue;
+        NSDictionary *m = table_marks(t);
+        if (m) marks[name] = m;
+
+        if (!reached && t != cursorTable) continue;
+        sqlite3_int64 after = reached ? 0 : cursorRowid;
+        reached = YES;
+        if (next) continue;
+
+        NSDictionary *tableSince = [sinceTables isKindOfClass:[NSDictionary class]] ? sinceTables[name] : nil;
+        int remaining = limit < 0 ? -1 : limit - (int)items.count;
+        sqlite3_int64 last = after;
+        int rows = read_page(t, after, remaining, values, tableSince, items, &last);
+        if (rows < 0) {
+            [diag addObject:[NSString stringWithFormat:@"%@: sqlite error %d", name, sqlite3_errcode(gKCDB)]];
+            continue;
+        }
+        [diag addObject:rows > 0 ? [NSString stringWithFormat:@"%@: %d rows", name, rows]
+                                 : [NSString stringWithFormat:@"%@: empty", name]];
+        if (remaining > 0 && rows == remaining)
+            next = [NSString stringWithFormat:@"%@:%lld", name, last];
+    }
 
-    for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
-        if (filterClass && ![filterClass isEqualToString:tables[i].name]) continue;
-        NSArray *items = query_db_table(db, tables[i].table, tables[i].name, diag);
-        [allItems addObjectsFromArray:items];
+    if (delta && !next) {
+        for (NSString *name in marks) live[name] = table_rowids(table_named(name));
+        resp[@"rowids"] = live;
     }
 
-    sqlite3_close(db);
-    return @{@"items": allItems};
+    resp[@"items"] = items;
+    resp[@"count"] = @(items.count);
+    resp[@"delta"] = @(delta);
+    if (next) resp[@"next_cursor"] = next;
+    resp[@"token"] = @{@"session": @(gKCSession), @"version": @(version), @"tables": marks};
+}
+
+/// keychain_get: one item with its value. Caller holds gKCLock.
+static void get_item(NSDictionary *msg, NSMutableDictionary *resp) {
+    vp_kc_table_t *t = table_named(msg[@"class"]);
+    sqlite3_int64 rowid = [msg[@"rowid"] longLongValue];
+    NSMutableArray *items = [NSMutableArray array];
+    sqlite3_int64 last = 0;
+    if (t && rowid > 0 && read_page(t, rowid - 1, 1, YES, nil, items, &last) == 1 && last == rowid) {
+        resp[@"item"] = items[0];
+        resp[@"ok"] = @YES;
+    } else {
+        resp[@"ok"] = @NO;
+        resp[@"msg"] = @"no such keychain item";
+    }
 }
 
 // MARK: - Command Handler
@@ -230,20 +409,29 @@ NSDictionary *vp_handle_keychain_command(NSDictionary *msg) {
         return resp;
     }
 
-    if ([type isEqualToString:@"keychain_list"]) {
-        NSString *filterClass = msg[@"class"];
+    if ([type isEqualToString:@"keychain_list"] || [type isEqualToString:@"keychain_get"]) {
         NSMutableArray *diag = [NSMutableArray array];
+        NSMutableDictionary *resp = vp_make_response(type, reqId);
+
+        // Read directly from the sqlite DB (bypasses entitlement checks)
+        pthread_mutex_lock(&gKCLock);
+        if (!kc_open(diag)) {
+            resp[@"items"] = @[];
+            resp[@"count"] = @0;
+        } else if ([type isEqualToString:@"keychain_get"]) {
+            get_item(msg, resp);
+        } else {
+            list_items(msg, resp, diag);
+        }
+        // A failing connection (e.g. the database was replaced) is
+        // reopened on the next request.
+        if (gKCBroken) {
+            kc_close();
+            gKCBroken = NO;
+        }
+        pthread_mutex_unlock(&gKCLock);
 
-        // Primary: read directly from sqlite DB (bypasses entitlement checks)
-        NSDictionary *dbResult = query_keychain_db(filterClass, diag);
-        NSArray *dbItems = dbResult[@"items"];
-
-        NSLog(@"vphoned: keychain_list: %lu items (sqlite), diag: %@",
-              (unsigned long)dbItems.count, diag);
-
-        NSMutableDictionary *resp = vp_make_response(@"keychain_list", reqId);
-        resp[@"items"] = dbItems;
-        resp[@"count"] = @(dbItems.count);
+        NSLog(@"vphoned: %@: %@ items, diag: %@", type, resp[@"count"] ?: @(resp[@"item"] ? 1 : 0), diag);
         resp[@"diag"] = diag;
         return resp;
     }
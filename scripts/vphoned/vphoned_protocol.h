@@ -2,12 +2,88 @@
  * vphoned_protocol — Length-prefixed JSON framing over vsock.
  *
  * Each message: [uint32 big-endian length][UTF-8 JSON payload]
+ *
+ * Binary fast path: when the hello exchange agrees on "bin", the host may
+ * also send frames whose length word has VP_BIN_FLAG set. The payload is a
+ * fixed vp_bin_header_t followed by a fixed-layout little-endian body.
+ * These carry high-rate fire-and-forget events (touch, hid, location) and
+ * get no response. JSON stays the format for everything else.
+ *
+ * Payload frames: a file_get or clipboard_get carrying "frames" gets its
+ * data as {"t":"payload","id":...,"size":n} messages, each followed by n raw
+ * bytes, then a final response marked "chunked" with nothing after it. The
+ * write lock is taken per frame, so other responses interleave.
  */
 
 #pragma once
 #import <Foundation/Foundation.h>
 
 #define PROTOCOL_VERSION 1
+#define PROTOCOL_BINARY_VERSION 1
+
+#define VP_BIN_FLAG 0x80000000u
+#define VP_BIN_MAX_BODY 64
+
+enum {
+    VP_BIN_TOUCH = 1,
+    VP_BIN_HID = 2,
+    VP_BIN_LOCATION = 3,
+};
+
+typedef struct __attribute__((packed)) {
+    uint8_t op;
+    uint8_t flags;
+    uint16_t body_len;
+    uint32_t seq;
+} vp_bin_header_t;
+
+typedef struct __attribute__((packed)) {
+    vp_bin_header_t hdr;
+    uint8_t body[VP_BIN_MAX_BODY];
+} vp_bin_frame_t;
+
+/// VP_BIN_TOUCH body. phase/x/y match the JSON "touch" command.
+typedef struct __attribute__((packed)) {
+    int32_t phase;
+    double x;
+    double y;
+} vp_bin_touch_t;
+
+/// VP_BIN_HID body. down: 1 = key down, 0 = key up, -1 = full press.
+typedef struct __attribute__((packed)) {
+    uint32_t page;
+    uint32_t usage;
+    int8_t down;
+    uint8_t _pad[3];
+} vp_bin_hid_t;
+
+/// VP_BIN_LOCATION body. Fields match the JSON "location" command.
+typedef struct __attribute__((packed)) {
+    double lat;
+    double lon;
+    double alt;
+    double hacc;
+    double vacc;
+    double speed;
+    double course;
+} vp_bin_location_t;
+
+typedef enum {
+    VP_FRAME_EOF = 0,
+    VP_FRAME_JSON,
+    VP_FRAME_BINARY,
+} vp_frame_kind_t;
+
+/// Per-thread I/O accounting. vp_read_fully/vp_write_fully add to the byte
+/// counts and vp_write_message adds its JSON encoding time; the stats code
+/// diffs them around each command.
+typedef struct {
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t serialize_ns;
+} vp_io_counters_t;
+
+vp_io_counters_t *vp_io_counters(void);
 
 BOOL vp_read_fully(int fd, void *buf, size_t count);
 BOOL vp_write_fully(int fd, const void *buf, size_t count);
@@ -16,7 +92,20 @@ BOOL vp_write_fully(int fd, const void *buf, size_t count);
 void vp_drain(int fd, size_t size);
 
 NSDictionary *vp_read_message(int fd);
+
+/// Read one frame of either kind. JSON frames set *json; binary frames are
+/// copied into *bin without allocating. Returns VP_FRAME_EOF on disconnect
+/// or a malformed frame.
+vp_frame_kind_t vp_read_frame(int fd, NSDictionary **json, vp_bin_frame_t *bin);
 BOOL vp_write_message(int fd, NSDictionary *dict);
 
+/// Largest payload frame. Keeps the time one transfer holds the write lock
+/// short enough for HID and touch responses to slip in between.
+#define VP_PAYLOAD_FRAME_MAX (256 * 1024)
+
+/// Write `count` bytes for request `reqId` as payload frames, taking `lock`
+/// around each one.
+BOOL vp_write_payload(int fd, NSLock *lock, id reqId, const void *bytes, size_t count);
+
 /// Build a response dict with protocol version, type, and optional request ID echo.
 NSMutableDictionary *vp_make_response(NSString *type, id reqId);
@@ -1,12 +1,20 @@
 #import "vphoned_protocol.h"
+#include <time.h>
 #include <unistd.h>
 
+static __thread vp_io_counters_t tIOCounters;
+
+vp_io_counters_t *vp_io_counters(void) {
+    return &tIOCounters;
+}
+
 BOOL vp_read_fully(int fd, void *buf, size_t count) {
     size_t offset = 0;
     while (offset < count) {
         ssize_t n = read(fd, (uint8_t *)buf + offset, count - offset);
         if (n <= 0) return NO;
         offset += n;
+        tIOCounters.bytes_read += (uint64_t)n;
     }
     return YES;
 }
@@ -17,6 +25,7 @@ BOOL vp_write_fully(int fd, const void *buf, size_t count) {
         ssize_t n = write(fd, (const uint8_t *)buf + offset, count - offset);
         if (n <= 0) return NO;
         offset += n;
+        tIOCounters.bytes_written += (uint64_t)n;
     }
     return YES;
 }
@@ -31,10 +40,7 @@ void vp_drain(int fd, size_t size) {
     }
 }
 
-NSDictionary *vp_read_message(int fd) {
-    uint32_t header = 0;
-    if (!vp_read_fully(fd, &header, 4)) return nil;
-    uint32_t length = ntohl(header);
+static NSDictionary *read_json_payload(int fd, uint32_t length) {
     if (length == 0 || length > 4 * 1024 * 1024) return nil;
 
     NSMutableData *payload = [NSMutableData dataWithLength:length];
@@ -46,9 +52,35 @@ NSDictionary *vp_read_message(int fd) {
     return obj;
 }
 
+NSDictionary *vp_read_message(int fd) {
+    uint32_t header = 0;
+    if (!vp_read_fully(fd, &header, 4)) return nil;
+    return read_json_payload(fd, ntohl(header));
+}
+
+vp_frame_kind_t vp_read_frame(int fd, NSDictionary **json, vp_bin_frame_t *bin) {
+    uint32_t header = 0;
+    if (!vp_read_fully(fd, &header, 4)) return VP_FRAME_EOF;
+    uint32_t length = ntohl(header);
+
+    if (length & VP_BIN_FLAG) {
+        length &= ~VP_BIN_FLAG;
+        if (length < sizeof(vp_bin_header_t) || length > sizeof(vp_bin_frame_t)) return VP_FRAME_EOF;
+        memset(bin, 0, sizeof(*bin));
+        if (!vp_read_fully(fd, bin, length)) return VP_FRAME_EOF;
+        if (bin->hdr.body_len > length - sizeof(vp_bin_header_t)) return VP_FRAME_EOF;
+        return VP_FRAME_BINARY;
+    }
+
+    *json = read_json_payload(fd, length);
+    return *json ? VP_FRAME_JSON : VP_FRAME_EOF;
+}
+
 BOOL vp_write_message(int fd, NSDictionary *dict) {
     NSError *err = nil;
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
     NSData *json = [NSJSONSerialization dataWithJSONObject:dict options:0 error:&err];
+    tIOCounters.serialize_ns += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
     if (!json) return NO;
 
     uint32_t header = htonl((uint32_t)json.length);
@@ -57,6 +89,20 @@ BOOL vp_write_message(int fd, NSDictionary *dict) {
     return YES;
 }
 
+BOOL vp_write_payload(int fd, NSLock *lock, id reqId, const void *bytes, size_t count) {
+    NSMutableDictionary *frame = vp_make_response(@"payload", reqId);
+    for (size_t offset = 0; offset < count;) {
+        size_t span = MIN(count - offset, (size_t)VP_PAYLOAD_FRAME_MAX);
+        frame[@"size"] = @(span);
+        [lock lock];
+        BOOL ok = vp_write_message(fd, frame) && vp_write_fully(fd, (const uint8_t *)bytes + offset, span);
+        [lock unlock];
+        if (!ok) return NO;
+        offset += span;
+    }
+    return YES;
+}
+
 NSMutableDictionary *vp_make_response(NSString *type, id reqId) {
     NSMutableDictionary *r = [@{@"v": @PROTOCOL_VERSION, @"t": type} mutableCopy];
     if (reqId) r[@"id"] = reqId;
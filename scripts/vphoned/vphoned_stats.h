@@ -0,0 +1,29 @@
+/*
+ * vphoned_stats — Per-command counters and latency histograms.
+ *
+ * Every command records queue wait (frame read -> lane start), handling
+ * time, JSON serialization time and bytes in/out into a per-type entry
+ * with log2 microsecond histograms. The "stats" command returns them.
+ * Each command is also an os_signpost interval ("command") on the
+ * com.vphone.vphoned subsystem, so Instruments can show them in line with
+ * the rest of the guest.
+ */
+
+#pragma once
+#import <Foundation/Foundation.h>
+#include <os/log.h>
+#include <os/signpost.h>
+
+/// Monotonic nanoseconds.
+uint64_t vp_stats_now_ns(void);
+
+/// One finished command. Times are nanoseconds.
+void vp_stats_record(NSString *type, uint64_t queue_ns, uint64_t handle_ns,
+                     uint64_t serialize_ns, uint64_t bytes_in,
+                     uint64_t bytes_out, BOOL failed);
+
+/// Log handle for command signposts.
+os_log_t vp_stats_log(void);
+
+/// stats {"reset": bool}: snapshot (and optionally clear) all counters.
+NSDictionary *vp_handle_stats_command(NSDictionary *msg);
@@ -0,0 +1,140 @@
+/*
+ * vphoned_stats — Per-command counters and latency histograms.
+ */
+
+#import "vphoned_stats.h"
+#import "vphoned_protocol.h"
+#include <mach/mach_time.h>
+#include <pthread.h>
+
+// Bucket i counts samples in [2^(i-1), 2^i) microseconds; bucket 0 is < 1 us
+// and the last bucket is open-ended (~8.4 s and up).
+#define VP_STATS_BUCKETS 24
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[VP_STATS_BUCKETS];
+} vp_histogram_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    vp_histogram_t queue;
+    vp_histogram_t handle;
+    vp_histogram_t serialize;
+} vp_command_stats_t;
+
+static pthread_mutex_t gStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary<NSString *, NSMutableData *> *gStats; // type -> vp_command_stats_t
+static uint64_t gStatsSince;
+
+uint64_t vp_stats_now_ns(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+os_log_t vp_stats_log(void) {
+    static os_log_t log;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        log = os_log_create("com.vphone.vphoned", "commands");
+    });
+    return log;
+}
+
+static void histogram_add(vp_histogram_t *h, uint64_t ns) {
+    uint64_t us = ns / 1000;
+    int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    if (bucket >= VP_STATS_BUCKETS) bucket = VP_STATS_BUCKETS - 1;
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+void vp_stats_record(NSString *type, uint64_t queue_ns, uint64_t handle_ns,
+                     uint64_t serialize_ns, uint64_t bytes_in,
+                     uint64_t bytes_out, BOOL failed) {
+    if (!type) type = @"unknown";
+    pthread_mutex_lock(&gStatsLock);
+    if (!gStats) {
+        gStats = [NSMutableDictionary dictionary];
+        gStatsSince = vp_stats_now_ns();
+    }
+    NSMutableData *slot = gStats[type];
+    if (!slot) {
+        slot = [NSMutableData dataWithLength:sizeof(vp_command_stats_t)];
+        gStats[type] = slot;
+    }
+    vp_command_stats_t *s = slot.mutableBytes;
+    s->count++;
+    if (failed) s->errors++;
+    s->bytes_in += bytes_in;
+    s->bytes_out += bytes_out;
+    histogram_add(&s->queue, queue_ns);
+    histogram_add(&s->handle, handle_ns);
+    histogram_add(&s->serialize, serialize_ns);
+    pthread_mutex_unlock(&gStatsLock);
+}
+
+/// Upper bound (us) of the bucket holding quantile q.
+static uint64_t histogram_quantile(const vp_histogram_t *h, double q) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(h->count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < VP_STATS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = 1ULL << i;
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+static NSDictionary *histogram_json(const vp_histogram_t *h) {
+    // Trim trailing empty buckets to keep the response small.
+    int last = VP_STATS_BUCKETS - 1;
+    while (last >= 0 && h->buckets[last] == 0) last--;
+    NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:(NSUInteger)(last + 1)];
+    for (int i = 0; i <= last; i++) [buckets addObject:@(h->buckets[i])];
+    return @{
+        @"mean" : @(h->count ? h->sum_us / h->count : 0),
+        @"p50" : @(histogram_quantile(h, 0.50)),
+        @"p90" : @(histogram_quantile(h, 0.90)),
+        @"p99" : @(histogram_quantile(h, 0.99)),
+        @"max" : @(h->max_us),
+        @"buckets" : buckets,
+    };
+}
+
+NSDictionary *vp_handle_stats_command(NSDictionary *msg) {
+    NSMutableDictionary *commands = [NSMutableDictionary dictionary];
+    pthread_mutex_lock(&gStatsLock);
+    uint64_t since = gStatsSince ?: vp_stats_now_ns();
+    for (NSString *type in gStats) {
+        const vp_command_stats_t *s = gStats[type].bytes;
+        commands[type] = @{
+            @"count" : @(s->count),
+            @"errors" : @(s->errors),
+            @"bytes_in" : @(s->bytes_in),
+            @"bytes_out" : @(s->bytes_out),
+            @"queue_us" : histogram_json(&s->queue),
+            @"handle_us" : histogram_json(&s->handle),
+            @"serialize_us" : histogram_json(&s->serialize),
+        };
+    }
+    if ([msg[@"reset"] boolValue]) {
+        [gStats removeAllObjects];
+        gStatsSince = vp_stats_now_ns();
+    }
+    pthread_mutex_unlock(&gStatsLock);
+
+    NSMutableDictionary *r = vp_make_response(@"stats", msg[@"id"]);
+    r[@"commands"] = commands;
+    r[@"window_ms"] = @((vp_stats_now_ns() - since) / 1000000);
+    return r;
+}
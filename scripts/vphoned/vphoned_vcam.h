@@ -46,7 +46,7 @@ typedef struct __attribute__((packed)) {
   uint64_t frame_index;
   uint32_t pixels_length;
   uint32_t _pad;
-  /* pixels start at offset 64; capacity = total mmap size - 64. */
+  /* pixels start at offset 64; capacity = VPHONED_VCAM_SHM_MAX_PIXELS. */
 } vphoned_vcam_shm_header_t;
 
 #define VPHONED_VCAM_SHM_HEADER_SIZE 64
@@ -54,6 +54,96 @@ typedef struct __attribute__((packed)) {
 #define VPHONED_VCAM_SHM_TOTAL_SIZE                                            \
   (VPHONED_VCAM_SHM_HEADER_SIZE + VPHONED_VCAM_SHM_MAX_PIXELS)
 
+/*
+ * Frame ring. The legacy header + pixels above double as slot 0; the
+ * ring control block follows them and slots 1..N-1 follow the control
+ * block. The writer always fills the slot after the published head, so it
+ * never waits on a reader, and a reader always has N-1 frame intervals to
+ * copy the head slot before it is reused.
+ *
+ * Legacy readers that only know the 64-byte header keep working: the
+ * header's seq/fields are updated (seqlock) whenever slot 0 is written,
+ * so they see every Nth frame instead of a torn one.
+ *
+ * Ring readers keep a local cursor (the last frame_index they consumed),
+ * load `head`, and copy slot `head % slot_count` under that slot's own
+ * seq. A changed seq after the copy means the writer lapped the reader;
+ * reload head and retry.
+ */
+#define VPHONED_VCAM_RING_MAGIC 0x47524356u  /* 'VCRG' */
+#define VPHONED_VCAM_RING_VERSION 1
+#define VPHONED_VCAM_RING_SLOTS 3
+#define VPHONED_VCAM_RING_OFFSET                                               \
+  ((VPHONED_VCAM_SHM_TOTAL_SIZE + 0x3fff) & ~(size_t)0x3fff)
+#define VPHONED_VCAM_RING_CTRL_SIZE 4096
+
+typedef struct __attribute__((packed)) {
+  uint64_t seq;            /* per-slot seqlock, odd = writing */
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row;
+  uint32_t pixel_format;
+  uint64_t timestamp_ns;
+  uint64_t frame_index;
+  uint32_t pixels_length;
+  uint32_t _pad;
+  uint64_t pixels_offset;  /* from the start of the mapping */
+  uint64_t _reserved;
+} vphoned_vcam_ring_slot_t;  /* 64 bytes */
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_capacity;  /* bytes of pixels per slot */
+  uint64_t head;           /* frame_index of the newest complete frame */
+  uint8_t  _reserved[40];
+  vphoned_vcam_ring_slot_t slots[VPHONED_VCAM_RING_SLOTS];
+} vphoned_vcam_ring_t;
+
+#define VPHONED_VCAM_RING_SLOT_OFFSET(i)                                       \
+  ((i) == 0 ? (size_t)VPHONED_VCAM_SHM_HEADER_SIZE                             \
+            : VPHONED_VCAM_RING_OFFSET + VPHONED_VCAM_RING_CTRL_SIZE +         \
+                  ((size_t)(i) - 1) * VPHONED_VCAM_SHM_MAX_PIXELS)
+#define VPHONED_VCAM_SHM_MAP_SIZE                                              \
+  VPHONED_VCAM_RING_SLOT_OFFSET(VPHONED_VCAM_RING_SLOTS)
+
+/*
+ * Transport negotiation. On accept, vphoned writes one caps record; hosts
+ * that never read it keep sending legacy JSON-header frames. A host that
+ * sees the caps may instead send fixed binary headers, which the receiver
+ * tells apart from a legacy frame by the first word: a legacy
+ * total_payload_length can never be as large as the magic.
+ */
+#define VPHONED_VCAM_CAPS_MAGIC 0x50414356u   /* 'VCAP' */
+#define VPHONED_VCAM_FRAME_MAGIC 0x31464356u  /* 'VCF1' */
+#define VPHONED_VCAM_WIRE_VERSION 1
+
+#define VPHONED_VCAM_FMT_BGRA 0x42475241u  /* kCVPixelFormatType_32BGRA */
+#define VPHONED_VCAM_FMT_420V 0x34323076u  /* 420YpCbCr8BiPlanarVideoRange */
+
+#define VPHONED_VCAM_CAP_BGRA (1u << 0)
+#define VPHONED_VCAM_CAP_420V (1u << 1)
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;    /* VPHONED_VCAM_CAPS_MAGIC */
+  uint32_t version;  /* VPHONED_VCAM_WIRE_VERSION */
+  uint32_t formats;  /* VPHONED_VCAM_CAP_* */
+} vphoned_vcam_caps_t;
+
+/* Binary frame: this header, then pixels_length bytes. For 420v the
+ * pixels are the Y plane (bytes_per_row * height) followed by the
+ * interleaved CbCr plane (bytes_per_row * height / 2), same stride. */
+typedef struct __attribute__((packed)) {
+  uint32_t magic;  /* VPHONED_VCAM_FRAME_MAGIC, little-endian */
+  uint32_t pixel_format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_row;
+  uint32_t pixels_length;
+  uint64_t timestamp_ns;
+} vphoned_vcam_wire_header_t;
+
 /* Starts the listener on a background thread. Idempotent. */
 void vp_vcam_start(void);
 
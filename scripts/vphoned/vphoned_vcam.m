@@ -2,13 +2,19 @@
  * vphoned_vcam — vsock 1338 -> shared mmap frame publisher.
  *
  * Wire protocol (matches host VPhoneCameraServer.swift):
- *   uint32 LE  total_payload_length
- *   uint32 LE  header_json_length
- *   bytes      JSON header { w, h, bpr, fmt, ts }
- *   bytes      raw pixel data (width*height aligned by bpr)
+ *   on accept, vphoned sends one vphoned_vcam_caps_t. Then, per frame,
+ *   either the legacy JSON framing:
+ *     uint32 LE  total_payload_length
+ *     uint32 LE  header_json_length
+ *     bytes      JSON header { w, h, bpr, fmt, ts }
+ *     bytes      raw pixel data (width*height aligned by bpr)
+ *   or, from hosts that read the caps, a fixed vphoned_vcam_wire_header_t
+ *   followed by pixels (BGRA or 420v).
  *
- * On each successful receive, the frame is written into the shm file
- * with a seq-counter discipline and a notify_post() fires so any
+ * Pixel bytes are read from the socket straight into the next slot of
+ * the shm ring (see vphoned_vcam.h) under a per-slot seq-counter
+ * discipline. Once the frame is complete its seq is flipped even, the
+ * ring head is advanced, and a notify_post() fires so any
  * libvcamcaptured-mapped reader can pick it up immediately.
  */
 
@@ -46,6 +52,7 @@ struct vp_sockaddr_vm {
 
 static pthread_once_t s_start_once = PTHREAD_ONCE_INIT;
 static uint8_t       *s_shm_base   = NULL;
+static vphoned_vcam_ring_t *s_ring  = NULL;
 static int            s_notify_token = -1;
 
 #define VVC_LOG_PATH "/var/jb/var/mobile/Library/vphone-vcam.log"
@@ -71,23 +78,37 @@ static int open_shm(void) {
           VPHONED_VCAM_SHM_PATH, strerror(errno));
     return -1;
   }
-  if (ftruncate(fd, VPHONED_VCAM_SHM_TOTAL_SIZE) < 0) {
+  if (ftruncate(fd, VPHONED_VCAM_SHM_MAP_SIZE) < 0) {
     vvc_logf("vphoned_vcam: ftruncate failed: %s", strerror(errno));
     close(fd);
     return -1;
   }
   /* Make sure other processes can map this file read-only. */
   fchmod(fd, 0644);
-  void *base = mmap(NULL, VPHONED_VCAM_SHM_TOTAL_SIZE,
+  void *base = mmap(NULL, VPHONED_VCAM_SHM_MAP_SIZE,
                     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
   close(fd);
   if (base == MAP_FAILED) {
     vvc_logf("vphoned_vcam: mmap failed: %s", strerror(errno));
     return -1;
   }
-  /* Zero the header on first init so seq starts at 0. */
+  /* Zero the header and ring control on first init so every seq and the
+   * head start at 0. magic is stored last so a reader never sees a
+   * half-initialised ring. */
   memset(base, 0, VPHONED_VCAM_SHM_HEADER_SIZE);
+  vphoned_vcam_ring_t *ring =
+      (vphoned_vcam_ring_t *)((uint8_t *)base + VPHONED_VCAM_RING_OFFSET);
+  memset(ring, 0, VPHONED_VCAM_RING_CTRL_SIZE);
+  ring->version = VPHONED_VCAM_RING_VERSION;
+  ring->slot_count = VPHONED_VCAM_RING_SLOTS;
+  ring->slot_capacity = VPHONED_VCAM_SHM_MAX_PIXELS;
+  for (uint32_t i = 0; i < VPHONED_VCAM_RING_SLOTS; i++) {
+    ring->slots[i].pixels_offset = VPHONED_VCAM_RING_SLOT_OFFSET(i);
+  }
+  atomic_store_explicit((_Atomic uint32_t *)&ring->magic,
+                        VPHONED_VCAM_RING_MAGIC, memory_order_release);
   s_shm_base = (uint8_t *)base;
+  s_ring = ring;
   return 0;
 }
 
@@ -104,35 +125,73 @@ static ssize_t read_full(int fd, void *buf, size_t n) {
   return (ssize_t)got;
 }
 
-static void publish_frame(uint32_t w, uint32_t h, uint32_t bpr,
-                          uint32_t fmt, uint64_t ts_ns,
-                          const uint8_t *pixels, size_t pixel_len) {
-  if (!s_shm_base) return;
-  if (pixel_len > VPHONED_VCAM_SHM_MAX_PIXELS) {
-    vvc_logf("vphoned_vcam: frame too large: %zu", pixel_len);
-    return;
+/* Claims the slot after the published head and marks it (and the legacy
+ * header, for slot 0) as being written. Returns the slot's pixel area,
+ * which the caller fills straight from the socket. The head never points
+ * at a claimed slot, so abandoning one (client gone mid-frame) needs no
+ * cleanup: it just stays odd until the next claim.
+ * Single producer: only the listener thread calls this. */
+static uint8_t *ring_begin(uint32_t *out_slot) {
+  uint64_t head = atomic_load_explicit((_Atomic uint64_t *)&s_ring->head,
+                                       memory_order_relaxed);
+  uint32_t slot = (uint32_t)((head + 1) % VPHONED_VCAM_RING_SLOTS);
+  vphoned_vcam_ring_slot_t *rs = &s_ring->slots[slot];
+
+  /* `| 1` rather than `+ 1`: a receive that died mid-frame leaves its
+   * slot odd, and the next claim must keep it odd. */
+  uint64_t seq = atomic_load_explicit((_Atomic uint64_t *)&rs->seq,
+                                      memory_order_relaxed);
+  atomic_store_explicit((_Atomic uint64_t *)&rs->seq, seq | 1ull,
+                        memory_order_relaxed);
+  if (slot == 0) {
+    vphoned_vcam_shm_header_t *hdr = (vphoned_vcam_shm_header_t *)s_shm_base;
+    uint64_t legacy = atomic_load_explicit((_Atomic uint64_t *)&hdr->seq,
+                                           memory_order_relaxed);
+    atomic_store_explicit((_Atomic uint64_t *)&hdr->seq, legacy | 1ull,
+                          memory_order_relaxed);
   }
-  vphoned_vcam_shm_header_t *hdr = (vphoned_vcam_shm_header_t *)s_shm_base;
-  uint8_t *dst = s_shm_base + VPHONED_VCAM_SHM_HEADER_SIZE;
-
-  uint64_t prev_seq = atomic_load_explicit(
-      (_Atomic uint64_t *)&hdr->seq, memory_order_acquire);
-  /* Mark write in progress (odd seq). */
-  uint64_t writing_seq = (prev_seq | 1ull) + 2ull;
-  atomic_store_explicit((_Atomic uint64_t *)&hdr->seq, writing_seq,
+  /* Odd seqs must be visible before any pixel store. */
+  atomic_thread_fence(memory_order_release);
+
+  *out_slot = slot;
+  return s_shm_base + rs->pixels_offset;
+}
+
+/* Fills in the slot descriptor, flips its seq back to even, and advances
+ * the head so readers pick it up. */
+static void ring_commit(uint32_t slot, uint32_t w, uint32_t h, uint32_t bpr,
+                        uint32_t fmt, uint64_t ts_ns, size_t pixel_len) {
+  vphoned_vcam_ring_slot_t *rs = &s_ring->slots[slot];
+  uint64_t frame_index = s_ring->head + 1;
+
+  rs->width = w;
+  rs->height = h;
+  rs->bytes_per_row = bpr;
+  rs->pixel_format = fmt;
+  rs->timestamp_ns = ts_ns;
+  rs->frame_index = frame_index;
+  rs->pixels_length = (uint32_t)pixel_len;
+  uint64_t seq = atomic_load_explicit((_Atomic uint64_t *)&rs->seq,
+                                      memory_order_relaxed);
+  atomic_store_explicit((_Atomic uint64_t *)&rs->seq, seq + 1,
                         memory_order_release);
 
-  hdr->width = w;
-  hdr->height = h;
-  hdr->bytes_per_row = bpr;
-  hdr->pixel_format = fmt;
-  hdr->timestamp_ns = ts_ns;
-  hdr->frame_index += 1;
-  hdr->pixels_length = (uint32_t)pixel_len;
-  memcpy(dst, pixels, pixel_len);
-
-  /* Mark write done (even seq). */
-  atomic_store_explicit((_Atomic uint64_t *)&hdr->seq, writing_seq + 1ull,
+  if (slot == 0) {
+    vphoned_vcam_shm_header_t *hdr = (vphoned_vcam_shm_header_t *)s_shm_base;
+    hdr->width = w;
+    hdr->height = h;
+    hdr->bytes_per_row = bpr;
+    hdr->pixel_format = fmt;
+    hdr->timestamp_ns = ts_ns;
+    hdr->frame_index = frame_index;
+    hdr->pixels_length = (uint32_t)pixel_len;
+    uint64_t legacy = atomic_load_explicit((_Atomic uint64_t *)&hdr->seq,
+                                           memory_order_relaxed);
+    atomic_store_explicit((_Atomic uint64_t *)&hdr->seq, legacy + 1ull,
+                          memory_order_release);
+  }
+
+  atomic_store_explicit((_Atomic uint64_t *)&s_ring->head, frame_index,
                         memory_order_release);
 
   if (s_notify_token >= 0) {
@@ -140,62 +199,142 @@ static void publish_frame(uint32_t w, uint32_t h, uint32_t bpr,
   }
 }
 
+/* Reads and drops n bytes so an oversized frame doesn't desync framing. */
+static ssize_t discard_full(int fd, size_t n) {
+  uint8_t scratch[16384];
+  size_t left = n;
+  while (left > 0) {
+    size_t want = left < sizeof(scratch) ? left : sizeof(scratch);
+    ssize_t r = read_full(fd, scratch, want);
+    if (r <= 0) return r;
+    left -= (size_t)r;
+  }
+  return (ssize_t)n;
+}
+
+typedef struct {
+  uint32_t w, h, bpr, fmt;
+  uint64_t ts;
+  size_t pixel_len;
+} vvc_frame_info_t;
+
+/* Smallest payload that covers every row of every plane. Unknown formats
+ * keep the original single-plane rule. */
+static size_t min_pixel_len(const vvc_frame_info_t *fi) {
+  size_t luma = (size_t)fi->bpr * fi->h;
+  if (fi->fmt == VPHONED_VCAM_FMT_420V) {
+    return luma + (size_t)fi->bpr * ((fi->h + 1) / 2);
+  }
+  return luma;
+}
+
+static void send_caps(int fd) {
+  vphoned_vcam_caps_t caps = {
+      .magic   = VPHONED_VCAM_CAPS_MAGIC,
+      .version = VPHONED_VCAM_WIRE_VERSION,
+      .formats = VPHONED_VCAM_CAP_BGRA | VPHONED_VCAM_CAP_420V,
+  };
+  /* Best effort: legacy hosts never read it and it fits in the socket
+   * buffer, so a short write just means no negotiation. */
+  if (write(fd, &caps, sizeof(caps)) != (ssize_t)sizeof(caps)) {
+    vvc_logf("vphoned_vcam: caps write failed: %s", strerror(errno));
+  }
+}
+
+/* Fixed binary header; `magic` has already been consumed. */
+static int read_binary_header(int fd, vvc_frame_info_t *fi) {
+  vphoned_vcam_wire_header_t wh;
+  if (read_full(fd, (uint8_t *)&wh + sizeof(wh.magic),
+                sizeof(wh) - sizeof(wh.magic)) <= 0) {
+    return -1;
+  }
+  if (wh.pixels_length > VPHONED_VCAM_SHM_MAX_PIXELS + 4096) {
+    vvc_logf("vphoned_vcam: framing error pixels=%u", wh.pixels_length);
+    return -1;
+  }
+  fi->w = wh.width;
+  fi->h = wh.height;
+  fi->bpr = wh.bytes_per_row;
+  fi->fmt = wh.pixel_format;
+  fi->ts = wh.timestamp_ns;
+  fi->pixel_len = wh.pixels_length;
+  return 0;
+}
+
+/* Legacy framing: total_len (already read), header_len, JSON header. */
+static int read_json_header(int fd, uint32_t total_len, vvc_frame_info_t *fi) {
+  uint32_t header_len = 0;
+  if (read_full(fd, &header_len, 4) <= 0) return -1;
+  if (total_len < 4 || header_len + 4 > total_len ||
+      total_len > VPHONED_VCAM_SHM_MAX_PIXELS + 4096) {
+    vvc_logf("vphoned_vcam: framing error total=%u header=%u",
+          total_len, header_len);
+    return -1;
+  }
+  uint8_t *header_buf = (uint8_t *)malloc(header_len);
+  if (!header_buf) return -1;
+  if (read_full(fd, header_buf, header_len) <= 0) {
+    free(header_buf);
+    return -1;
+  }
+  NSData *hd = [NSData dataWithBytesNoCopy:header_buf
+                                     length:header_len
+                               freeWhenDone:NO];
+  NSError *jerr = nil;
+  NSDictionary *hdict = [NSJSONSerialization JSONObjectWithData:hd
+                                                        options:0
+                                                          error:&jerr];
+  fi->w   = (uint32_t)[hdict[@"w"]   unsignedIntValue];
+  fi->h   = (uint32_t)[hdict[@"h"]   unsignedIntValue];
+  fi->bpr = (uint32_t)[hdict[@"bpr"] unsignedIntValue];
+  fi->fmt = (uint32_t)[hdict[@"fmt"] unsignedIntValue];
+  fi->ts  = (uint64_t)[hdict[@"ts"]  unsignedLongLongValue];
+  fi->pixel_len = (size_t)total_len - 4 - header_len;
+  free(header_buf);
+  if (!hdict || jerr) {
+    vvc_logf("vphoned_vcam: invalid header jerr=%s",
+          jerr ? jerr.localizedDescription.UTF8String : "(none)");
+    return -1;
+  }
+  return 0;
+}
+
 static void handle_client(int fd) {
   vvc_logf("vphoned_vcam: client connected fd=%d", fd);
+  send_caps(fd);
   uint64_t frames = 0;
   for (;;) {
-    uint32_t total_len = 0, header_len = 0;
-    if (read_full(fd, &total_len, 4) <= 0) break;
-    if (read_full(fd, &header_len, 4) <= 0) break;
-    if (total_len < 4 || header_len + 4 > total_len ||
-        total_len > VPHONED_VCAM_SHM_MAX_PIXELS + 4096) {
-      vvc_logf("vphoned_vcam: framing error total=%u header=%u",
-            total_len, header_len);
-      break;
-    }
-    uint8_t *header_buf = (uint8_t *)malloc(header_len);
-    if (!header_buf) break;
-    if (read_full(fd, header_buf, header_len) <= 0) {
-      free(header_buf);
+    uint32_t first = 0;
+    if (read_full(fd, &first, 4) <= 0) break;
+    vvc_frame_info_t fi = {0};
+    int rc = (first == VPHONED_VCAM_FRAME_MAGIC)
+                 ? read_binary_header(fd, &fi)
+                 : read_json_header(fd, first, &fi);
+    if (rc < 0) break;
+
+    if (fi.w == 0 || fi.h == 0 || fi.bpr == 0 ||
+        fi.pixel_len < min_pixel_len(&fi)) {
+      vvc_logf("vphoned_vcam: invalid frame w=%u h=%u bpr=%u fmt=0x%08x pixel_len=%zu",
+            fi.w, fi.h, fi.bpr, fi.fmt, fi.pixel_len);
       break;
     }
-    size_t pixel_len = (size_t)total_len - 4 - header_len;
-    uint8_t *pixel_buf = (uint8_t *)malloc(pixel_len);
-    if (!pixel_buf) { free(header_buf); break; }
-    if (read_full(fd, pixel_buf, pixel_len) <= 0) {
-      free(header_buf);
-      free(pixel_buf);
-      break;
+    if (!s_ring || fi.pixel_len > VPHONED_VCAM_SHM_MAX_PIXELS) {
+      vvc_logf("vphoned_vcam: dropping frame pixel_len=%zu", fi.pixel_len);
+      if (discard_full(fd, fi.pixel_len) <= 0) break;
+      continue;
     }
-    NSData *hd = [NSData dataWithBytesNoCopy:header_buf
-                                       length:header_len
-                                 freeWhenDone:NO];
-    NSError *jerr = nil;
-    NSDictionary *hdict = [NSJSONSerialization JSONObjectWithData:hd
-                                                          options:0
-                                                            error:&jerr];
-    uint32_t w   = (uint32_t)[hdict[@"w"]   unsignedIntValue];
-    uint32_t h   = (uint32_t)[hdict[@"h"]   unsignedIntValue];
-    uint32_t bpr = (uint32_t)[hdict[@"bpr"] unsignedIntValue];
-    uint32_t fmt = (uint32_t)[hdict[@"fmt"] unsignedIntValue];
-    uint64_t ts  = (uint64_t)[hdict[@"ts"]  unsignedLongLongValue];
-    free(header_buf);
 
-    if (!hdict || jerr || w == 0 || h == 0 || bpr == 0 ||
-        pixel_len < (size_t)bpr * h) {
-      vvc_logf("vphoned_vcam: invalid frame w=%u h=%u bpr=%u pixel_len=%zu jerr=%s",
-            w, h, bpr, pixel_len,
-            jerr ? jerr.localizedDescription.UTF8String : "(none)");
-      free(pixel_buf);
-      break;
-    }
-    publish_frame(w, h, bpr, fmt, ts, pixel_buf, pixel_len);
-    free(pixel_buf);
+    /* Pixels land directly in the next ring slot; commit just flips its
+     * seq and advances head, so there is no intermediate heap copy. */
+    uint32_t slot = 0;
+    uint8_t *dst = ring_begin(&slot);
+    if (read_full(fd, dst, fi.pixel_len) <= 0) break;
+    ring_commit(slot, fi.w, fi.h, fi.bpr, fi.fmt, fi.ts, fi.pixel_len);
 
     frames++;
     if ((frames & 29) == 1) {
-      vvc_logf("vphoned_vcam: published frame #%llu w=%u h=%u bpr=%u",
-            (unsigned long long)frames, w, h, bpr);
+      vvc_logf("vphoned_vcam: published frame #%llu w=%u h=%u bpr=%u fmt=0x%08x",
+            (unsigned long long)frames, fi.w, fi.h, fi.bpr, fi.fmt);
     }
   }
   vvc_logf("vphoned_vcam: client disconnected (%llu frames)",
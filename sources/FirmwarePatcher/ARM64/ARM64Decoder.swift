@@ -0,0 +1,199 @@
+// ARM64Decoder.swift — Allocation-free decoder for the hot opcode classes.
+//
+// Patch-site searches walk thousands of instructions looking for branches,
+// ADRP/ADD pairs, loads and prologue/epilogue markers. Going through Capstone
+// for each word costs a Data copy plus an [Instruction] allocation. This
+// decoder reads words straight from the buffer and understands only those
+// classes; anything else decodes to nil and callers fall back to
+// ARM64Disassembler.
+//
+// Mnemonics match Capstone's spelling so fast-path and fallback results can
+// be compared directly (round-trip checked in ARM64DecoderTests).
+
+import Foundation
+
+/// One instruction decoded by ``ARM64Decoder``.
+public struct ARM64Decoded: Sendable, Equatable {
+    public enum Kind: Sendable, Equatable {
+        /// B / BL imm26.
+        case branch(link: Bool, target: Int)
+        /// B.cond imm19 (cond 0x0–0xE; B.NV and BC.cond are left to Capstone).
+        case branchCond(cond: UInt32, target: Int)
+        /// CBZ / CBNZ.
+        case compareBranch(nonZero: Bool, is64: Bool, rt: UInt32, target: Int)
+        /// TBZ / TBNZ.
+        case testBranch(nonZero: Bool, rt: UInt32, bit: UInt32, target: Int)
+        /// ADRP — `page` is the target page, computed from the decode address.
+        case adrp(rd: UInt32, page: Int)
+        /// ADD (immediate), `imm` with its optional 12-bit shift applied.
+        case addImm(is64: Bool, rd: UInt32, rn: UInt32, imm: UInt32)
+        /// LDR Wt/Xt, [Xn, #imm] (unsigned offset, scaled).
+        case ldrImm(is64: Bool, rt: UInt32, rn: UInt32, offset: Int)
+        /// MOVZ (no shift), i.e. `mov Rd, #imm`.
+        case movImm(is64: Bool, rd: UInt32, imm: UInt32)
+        /// ORR Rd, ZR, Rm, i.e. `mov Rd, Rm`.
+        case movReg(is64: Bool, rd: UInt32, rm: UInt32)
+        case ret
+        case retaa
+        case retab
+        case pacibsp
+        case nop
+    }
+
+    /// Address the instruction was decoded at (file offset unless a VA was given).
+    public let address: Int
+    /// Raw little-endian instruction word.
+    public let word: UInt32
+    public let kind: Kind
+
+    /// Capstone-compatible mnemonic.
+    public var mnemonic: String {
+        switch kind {
+        case let .branch(link, _): link ? "bl" : "b"
+        case let .branchCond(cond, _): "b." + ARM64Decoder.conditionNames[Int(cond)]
+        case let .compareBranch(nonZero, _, _, _): nonZero ? "cbnz" : "cbz"
+        case let .testBranch(nonZero, _, _, _): nonZero ? "tbnz" : "tbz"
+        case .adrp: "adrp"
+        case .addImm: "add"
+        case .ldrImm: "ldr"
+        case .movImm, .movReg: "mov"
+        case .ret: "ret"
+        case .retaa: "retaa"
+        case .retab: "retab"
+        case .pacibsp: "pacibsp"
+        case .nop: "nop"
+        }
+    }
+
+    /// Target of a direct or conditional branch, else nil.
+    public var branchTarget: Int? {
+        switch kind {
+        case let .branch(_, target), let .branchCond(_, target),
+             let .compareBranch(_, _, _, target), let .testBranch(_, _, _, target):
+            target
+        default:
+            nil
+        }
+    }
+
+    /// B.cond, CBZ/CBNZ or TBZ/TBNZ.
+    public var isConditionalBranch: Bool {
+        switch kind {
+        case .branchCond, .compareBranch, .testBranch: true
+        default: false
+        }
+    }
+
+    /// RET / RETAA / RETAB.
+    public var isReturn: Bool {
+        switch kind {
+        case .ret, .retaa, .retab: true
+        default: false
+        }
+    }
+}
+
+/// Decoder for the opcode classes used by patch-site searches.
+public enum ARM64Decoder {
+    static let conditionNames = [
+        "eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+        "hi", "ls", "ge", "lt", "gt", "le", "al", "nv",
+    ]
+
+    @inline(__always)
+    private static func signExtend(_ value: UInt32, bits: UInt32) -> Int {
+        let shift = 32 - bits
+        return Int(Int32(bitPattern: value << shift) >> shift)
+    }
+
+    /// Decode `word` as if located at `address`; nil when it is not one of
+    /// the fast-path classes.
+    public static func decode(_ word: UInt32, at address: Int) -> ARM64Decoded? {
+        let kind: ARM64Decoded.Kind
+
+        switch word {
+        case ARM64.nopU32: kind = .nop
+        case ARM64.retU32: kind = .ret
+        case ARM64.retaaU32: kind = .retaa
+        case ARM64.retabU32: kind = .retab
+        case ARM64.pacibspU32: kind = .pacibsp
+        default:
+            if word & 0x7C00_0000 == 0x1400_0000 {
+                // B / BL: [30:26]=00101, bit31 = link.
+                kind = .branch(link: word >> 31 == 1, target: address + signExtend(word & 0x03FF_FFFF, bits: 26) * 4)
+            } else if word & 0xFF00_0010 == 0x5400_0000, word & 0xF != 0xF {
+                kind = .branchCond(cond: word & 0xF, target: address + signExtend((word >> 5) & 0x7FFFF, bits: 19) * 4)
+            } else if word & 0x7E00_0000 == 0x3400_0000 {
+                kind = .compareBranch(
+                    nonZero: word & 0x0100_0000 != 0,
+                    is64: word >> 31 == 1,
+                    rt: word & 0x1F,
+                    target: address + signExtend((word >> 5) & 0x7FFFF, bits: 19) * 4
+                )
+            } else if word & 0x7E00_0000 == 0x3600_0000 {
+                kind = .testBranch(
+                    nonZero: word & 0x0100_0000 != 0,
+                    rt: word & 0x1F,
+                    bit: ((word >> 31) << 5) | ((word >> 19) & 0x1F),
+                    target: address + signExtend((word >> 5) & 0x3FFF, bits: 14) * 4
+                )
+            } else if ARM64Inst.isADRP(word) {
+                let imm = ((word >> 5) & 0x7FFFF) << 2 | ((word >> 29) & 0x3)
+                kind = .adrp(rd: word & 0x1F, page: (address & ~0xFFF) + signExtend(imm, bits: 21) << 12)
+            } else if word & 0x7F80_0000 == 0x1100_0000 {
+                // ADD (immediate), sf in bit31, sh in bit22.
+                let imm = (word >> 10) & 0xFFF
+                // Capstone prints `add Rd, sp, #0` / `add sp, Rn, #0` as mov.
+                if imm == 0, word & 0x1F == 31 || (word >> 5) & 0x1F == 31 { return nil }
+                kind = .addImm(
+                    is64: word >> 31 == 1,
+                    rd: word & 0x1F,
+                    rn: (word >> 5) & 0x1F,
+                    imm: word & 0x0040_0000 != 0 ? imm << 12 : imm
+                )
+            } else if word & 0xBFC0_0000 == 0xB940_0000 {
+                // LDR Wt/Xt, [Xn, #imm]: size in bit30, scaled by 4 or 8.
+                let is64 = word & 0x4000_0000 != 0
+                kind = .ldrImm(
+                    is64: is64,
+                    rt: word & 0x1F,
+                    rn: (word >> 5) & 0x1F,
+                    offset: Int((word >> 10) & 0xFFF) << (is64 ? 3 : 2)
+                )
+            } else if word & 0x7FE0_0000 == 0x5280_0000 {
+                kind = .movImm(is64: word >> 31 == 1, rd: word & 0x1F, imm: (word >> 5) & 0xFFFF)
+            } else if word & 0x7FE0_FFE0 == 0x2A00_03E0 {
+                // ORR Rd, ZR, Rm (no shift).
+                kind = .movReg(is64: word >> 31 == 1, rd: word & 0x1F, rm: (word >> 16) & 0x1F)
+            } else {
+                return nil
+            }
+        }
+        return ARM64Decoded(address: address, word: word, kind: kind)
+    }
+
+    /// Decode the word at `offset` in `data`; nil when out of bounds or not a
+    /// fast-path class.
+    public static func decode(in data: Data, at offset: Int, address: Int? = nil) -> ARM64Decoded? {
+        guard offset >= 0, offset + 4 <= data.count else { return nil }
+        return decode(data.loadLE(UInt32.self, at: offset), at: address ?? offset)
+    }
+
+    /// Decode `count` consecutive words starting at `offset` in one pass.
+    ///
+    /// The result has one entry per word (nil for words outside the fast-path
+    /// classes) and is truncated at the end of `data`.
+    public static func decodeWindow(in data: Data, from offset: Int, count: Int, address: Int? = nil) -> [ARM64Decoded?] {
+        guard offset >= 0, count > 0 else { return [] }
+        let n = min(count, (data.count - offset) / 4)
+        guard n > 0 else { return [] }
+        let base = address ?? offset
+
+        return data.withUnsafeBytes { raw in
+            (0 ..< n).map { i in
+                let word = raw.loadUnaligned(fromByteOffset: offset + i * 4, as: UInt32.self).littleEndian
+                return decode(word, at: base + i * 4)
+            }
+        }
+    }
+}
@@ -18,10 +18,16 @@ extension Data {
 /// A mutable binary buffer for reading and patching firmware data.
 public final class BinaryBuffer: @unchecked Sendable {
     /// The mutable working data.
-    public var data: Data
+    ///
+    /// Replacing or mutating it directly drops cached search results; the
+    /// write helpers below keep them in sync instead.
+    public var data: Data {
+        didSet { matchCache.removeAll() }
+    }
 
-    /// The original immutable snapshot (for before/after comparison).
-    public let original: Data
+    /// Snapshot of the bytes as they were when the current patcher started
+    /// (for before/after comparison).
+    public private(set) var original: Data
 
     public var count: Int {
         data.count
@@ -38,6 +44,23 @@ public final class BinaryBuffer: @unchecked Sendable {
         try self.init(Data(contentsOf: url))
     }
 
+    /// Begin a new patch stage: the current bytes become `original`.
+    ///
+    /// Chained patchers share one buffer this way instead of each wrapping
+    /// a copy of the previous stage's output.
+    public func checkpoint() {
+        original = data
+    }
+
+    /// Independent buffer with the same bytes, original and cached search
+    /// results. Storage is shared until either side writes.
+    public func snapshot() -> BinaryBuffer {
+        let copy = BinaryBuffer(data)
+        copy.original = original
+        copy.matchCache = matchCache
+        return copy
+    }
+
     // MARK: - Read Helpers
 
     /// Read a little-endian UInt32 at the given byte offset.
@@ -60,31 +83,154 @@ public final class BinaryBuffer: @unchecked Sendable {
     // MARK: - Write Helpers
 
     /// Write a little-endian UInt32 at the given byte offset.
-    @inlinable
     public func writeU32(at offset: Int, value: UInt32) {
+        let cached = matchCache
         withUnsafeBytes(of: value.littleEndian) { src in
             data.replaceSubrange(offset ..< offset + 4, with: src)
         }
+        matchCache = refreshMatches(cached, overlapping: offset ..< offset + 4)
     }
 
     /// Write raw bytes at the given offset.
     public func writeBytes(at offset: Int, bytes: Data) {
+        let cached = matchCache
         data.replaceSubrange(offset ..< offset + bytes.count, with: bytes)
+        matchCache = refreshMatches(cached, overlapping: offset ..< offset + bytes.count)
     }
 
     // MARK: - Search Helpers
 
     /// Find all occurrences of a byte pattern in the data.
+    ///
+    /// Whole-buffer results are cached per pattern; a ranged search reuses a
+    /// cached result but scans only its range when the pattern is new.
     public func findAll(_ pattern: Data, in range: Range<Int>? = nil) -> [Int] {
-        let searchRange = range ?? 0 ..< data.count
+        guard !pattern.isEmpty else { return [] }
+        guard let range else { return matches(for: [pattern])[0] }
+
+        let all = matchCache[pattern] ?? Self.scan(data, for: [pattern], in: range)[0]
+        var lo = 0
+        var hi = all.count
+        while lo < hi {
+            let mid = (lo + hi) >> 1
+            if all[mid] < range.lowerBound { lo = mid + 1 } else { hi = mid }
+        }
         var results: [Int] = []
-        var offset = searchRange.lowerBound
-        while offset < searchRange.upperBound - pattern.count + 1 {
-            if let found = data.range(of: pattern, in: offset ..< searchRange.upperBound) {
-                results.append(found.lowerBound)
-                offset = found.lowerBound + 1
-            } else {
-                break
+        while lo < all.count, all[lo] + pattern.count <= range.upperBound {
+            results.append(all[lo])
+            lo += 1
+        }
+        return results
+    }
+
+    /// Resolve every pattern over the whole buffer in a single pass and cache
+    /// the results, so later `findAll`/`findString` calls are lookups.
+    ///
+    /// Patchers call this up front with the anchors they are about to query.
+    @discardableResult
+    public func findAll(_ patterns: [Data]) -> [Data: [Int]] {
+        let unique = Array(Set(patterns.filter { !$0.isEmpty }))
+        return Dictionary(uniqueKeysWithValues: zip(unique, matches(for: unique)))
+    }
+
+    /// Batch-resolve C-string anchors for `findString`/`findAllStrings`,
+    /// both NUL-terminated and bare.
+    public func prefetchStrings(_ strings: [String]) {
+        findAll(strings.flatMap { string -> [Data] in
+            let bare = Data(string.utf8)
+            return [bare + [0], bare]
+        })
+    }
+
+    /// First cached match of `pattern` at or after `from`.
+    private func firstMatch(_ pattern: Data, from: Int) -> Int? {
+        let all = matches(for: [pattern])[0]
+        var lo = 0
+        var hi = all.count
+        while lo < hi {
+            let mid = (lo + hi) >> 1
+            if all[mid] < from { lo = mid + 1 } else { hi = mid }
+        }
+        return lo < all.count ? all[lo] : nil
+    }
+
+    // MARK: - Search Engine
+
+    /// Whole-buffer match offsets per pattern, ascending.
+    private var matchCache: [Data: [Int]] = [:]
+
+    /// Cached results for `patterns`, scanning once for all the missing ones.
+    private func matches(for patterns: [Data]) -> [[Int]] {
+        let missing = patterns.filter { !$0.isEmpty && matchCache[$0] == nil }
+        if !missing.isEmpty {
+            let unique = Array(Set(missing))
+            for (pattern, found) in zip(unique, Self.scan(data, for: unique, in: 0 ..< data.count)) {
+                matchCache[pattern] = found
+            }
+        }
+        return patterns.map { matchCache[$0] ?? [] }
+    }
+
+    /// Re-check cached patterns around a write to `written`.
+    ///
+    /// Only matches that could overlap the written bytes change, so each
+    /// pattern drops those and rescans a window of `count - 1` on either side.
+    private func refreshMatches(_ cached: [Data: [Int]], overlapping written: Range<Int>) -> [Data: [Int]] {
+        guard !cached.isEmpty else { return cached }
+        var refreshed = cached
+        for (pattern, offsets) in cached {
+            let lo = max(0, written.lowerBound - pattern.count + 1)
+            let window = lo ..< min(data.count, written.upperBound + pattern.count - 1)
+            let kept = offsets.filter { $0 < lo || $0 >= written.upperBound }
+            let found = Self.scan(data, for: [pattern], in: window)[0]
+            refreshed[pattern] = found.isEmpty ? kept : (kept + found).sorted()
+        }
+        return refreshed
+    }
+
+    /// Find every (overlapping) occurrence of each pattern inside `range`.
+    ///
+    /// One pattern uses memchr on its first byte, which libc vectorises.
+    /// Several patterns share one pass: a 256-entry first-byte table picks
+    /// the candidate patterns at each position, then memcmp confirms.
+    static func scan(_ data: Data, for patterns: [Data], in range: Range<Int>) -> [[Int]] {
+        var results = [[Int]](repeating: [], count: patterns.count)
+        guard !patterns.isEmpty, !range.isEmpty else { return results }
+        let needles = patterns.map { [UInt8]($0) }
+
+        data.withUnsafeBytes { raw in
+            guard let base = raw.baseAddress?.assumingMemoryBound(to: UInt8.self) else { return }
+            let end = min(range.upperBound, raw.count)
+
+            if needles.count == 1 {
+                let needle = needles[0]
+                var off = range.lowerBound
+                while off + needle.count <= end {
+                    guard let hit = memchr(base + off, Int32(needle[0]), end - off - needle.count + 1) else { break }
+                    let pos = base.distance(to: hit.assumingMemoryBound(to: UInt8.self))
+                    if memcmp(base + pos, needle, needle.count) == 0 { results[0].append(pos) }
+                    off = pos + 1
+                }
+                return
+            }
+
+            var buckets = [[Int]](repeating: [], count: 256)
+            var firstBytes = [Bool](repeating: false, count: 256)
+            for (i, needle) in needles.enumerated() {
+                buckets[Int(needle[0])].append(i)
+                firstBytes[Int(needle[0])] = true
+            }
+            firstBytes.withUnsafeBufferPointer { isFirst in
+                var off = range.lowerBound
+                while off < end {
+                    let byte = Int(base[off])
+                    if isFirst[byte] {
+                        for i in buckets[byte] where off + needles[i].count <= end {
+                            if memcmp(base + off, needles[i], needles[i].count) == 0 { results[i].append(off) }
+                        }
+                    }
+                    off += 1
+                }
             }
         }
         return results
@@ -104,32 +250,22 @@ public final class BinaryBuffer: @unchecked Sendable {
     /// Matches Python `find_string()`: walks backward from the match to the
     /// preceding NUL byte so that the returned offset is the C-string start.
     public func findString(_ string: String, from: Int = 0) -> Int? {
-        guard let encoded = string.data(using: .utf8) else { return nil }
-        // Try with null terminator first (exact C-string match)
-        var pattern = encoded
-        pattern.append(0)
-        if let range = data.range(of: pattern, in: from ..< data.count) {
-            // Walk backward to the preceding NUL — that's the C string start
-            var cstr = range.lowerBound
-            while cstr > 0, data[cstr - 1] != 0 {
-                cstr -= 1
-            }
-            return cstr
+        let encoded = Data(string.utf8)
+        // Try with null terminator first (exact C-string match), then
+        // without (substring match).
+        guard let match = firstMatch(encoded + [0], from: from) ?? firstMatch(encoded, from: from) else {
+            return nil
         }
-        // Try without null terminator (substring match)
-        if let range = data.range(of: encoded, in: from ..< data.count) {
-            var cstr = range.lowerBound
-            while cstr > 0, data[cstr - 1] != 0 {
-                cstr -= 1
-            }
-            return cstr
+        // Walk backward to the preceding NUL — that's the C string start
+        var cstr = match
+        while cstr > 0, data[cstr - 1] != 0 {
+            cstr -= 1
         }
-        return nil
+        return cstr
     }
 
     /// Find all occurrences of a C string in the data.
     public func findAllStrings(_ string: String) -> [Int] {
-        guard let encoded = string.data(using: .utf8) else { return [] }
-        return findAll(encoded)
+        findAll(Data(string.utf8))
     }
 }
@@ -1,5 +1,6 @@
 // IM4PHandler.swift — Wrapper around Img4tool for IM4P firmware container handling.
 
+import Darwin
 import Foundation
 import Img4tool
 
@@ -24,6 +25,84 @@ public enum IM4PHandler {
         return (fileData, nil)
     }
 
+    /// Parse only the IM4P container at `url`, without decoding its payload.
+    /// Returns nil for raw files.
+    public static func loadContainer(contentsOf url: URL) throws -> IM4P? {
+        try? IM4P(Data(contentsOf: url))
+    }
+
+    // MARK: - Mapped Loading
+
+    /// Map `url` privately (copy-on-write): reads come from the page cache and
+    /// only pages a patch writes to become private memory. The file itself is
+    /// never modified through the mapping.
+    public static func mapPrivate(contentsOf url: URL) throws -> Data {
+        let fd = open(url.path, O_RDONLY)
+        guard fd >= 0 else { throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO) }
+        defer { close(fd) }
+
+        var st = stat()
+        guard fstat(fd, &st) == 0 else { throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO) }
+        let size = Int(st.st_size)
+        guard size > 0 else { return Data() }
+
+        guard let base = mmap(nil, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0), base != MAP_FAILED else {
+            throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .ENOMEM)
+        }
+        return Data(bytesNoCopy: base, count: size, deallocator: .custom { ptr, len in munmap(ptr, len) })
+    }
+
+    /// Replace the file at `url` with `data`, writing only the pages that
+    /// differ. Falls back to a full atomic write when the size changed or the
+    /// volume cannot clone.
+    ///
+    /// The pages are written into a clone of the file, which is then renamed
+    /// over it, so a crash leaves either the old file or the new one and
+    /// never a mix; at worst a hidden `.<name>.<pid>.dirty` clone is left
+    /// beside it. On APFS the clone shares every unchanged block. Mappings of
+    /// the old file, such as the one `mapPrivate` returns, keep the old bytes.
+    public static func writeDirtyPages(_ data: Data, to url: URL, pageSize: Int = 0x4000) throws {
+        let temp = url.deletingLastPathComponent()
+            .appendingPathComponent(".\(url.lastPathComponent).\(getpid()).dirty")
+        unlink(temp.path)
+        guard clonefile(url.path, temp.path, 0) == 0 else {
+            try data.write(to: url, options: .atomic)
+            return
+        }
+        var renamed = false
+        defer { if !renamed { unlink(temp.path) } }
+
+        let fd = open(temp.path, O_RDWR)
+        guard fd >= 0 else { throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO) }
+        defer { close(fd) }
+
+        var st = stat()
+        guard fstat(fd, &st) == 0, Int(st.st_size) == data.count else {
+            try data.write(to: url, options: .atomic)
+            return
+        }
+
+        var onDisk = [UInt8](repeating: 0, count: pageSize)
+        try data.withUnsafeBytes { raw in
+            guard let base = raw.baseAddress else { return }
+            var off = 0
+            while off < raw.count {
+                let len = min(pageSize, raw.count - off)
+                let got = pread(fd, &onDisk, len, off_t(off))
+                if got != len || memcmp(onDisk, base + off, len) != 0 {
+                    guard pwrite(fd, base + off, len, off_t(off)) == len else {
+                        throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO)
+                    }
+                }
+                off += len
+            }
+        }
+        guard fsync(fd) == 0, rename(temp.path, url.path) == 0 else {
+            throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO)
+        }
+        renamed = true
+    }
+
     /// Save patched data back to an IM4P container or as raw data.
     ///
     /// If the original was IM4P, re-packages with the same fourcc and LZFSE compression.
@@ -33,10 +112,12 @@ public enum IM4PHandler {
     ///   - patchedData: The patched payload bytes.
     ///   - originalIM4P: The original IM4P container (nil for raw files).
     ///   - url: Output file path.
+    ///   - options: Write options; `.atomic` keeps a mapped original intact.
     public static func save(
         patchedData: Data,
         originalIM4P: IM4P?,
-        to url: URL
+        to url: URL,
+        options: Data.WritingOptions = []
     ) throws {
         if let original = originalIM4P {
             // Rebuild the IM4P container with the patched payload. Do not force
@@ -53,9 +134,9 @@ public enum IM4PHandler {
             } else {
                 newIM4P.data
             }
-            try output.write(to: url)
+            try output.write(to: url, options: options)
         } else {
-            try patchedData.write(to: url)
+            try patchedData.write(to: url, options: options)
         }
     }
 
@@ -0,0 +1,178 @@
+// PatchProfiler.swift — Opt-in timing and memory counters for patch runs.
+//
+// The pipeline measures every patcher (plus load/save) per component, and
+// kernel patchers measure their analysis passes and each patch method. Samples
+// carry wall time, the net change in live malloc blocks/bytes, and resident
+// size including the growth of the process's peak RSS across the step.
+//
+// Nothing is recorded unless a profiler is attached; `bench-firmware` attaches
+// one per iteration and aggregates them with ``PatchProfiler/Report``.
+// Samples from concurrent components interleave, so profile serial runs.
+
+import Darwin
+import Foundation
+
+/// Collects ``PatchProfiler/Sample``s for one patch run.
+public final class PatchProfiler: @unchecked Sendable {
+    /// One measured step.
+    public struct Sample: Codable, Sendable {
+        /// Where the step ran, e.g. "kernelcache" or "kernelcache/KernelJBPatcher".
+        public let scope: String
+        /// Patcher type, patch method, or pipeline phase ("load", "save").
+        public let name: String
+        public let wallSeconds: Double
+        /// Net change in live malloc blocks (allocations minus frees).
+        public let heapBlocksDelta: Int
+        /// Net change in live malloc bytes.
+        public let heapBytesDelta: Int
+        /// Resident size when the step finished.
+        public let residentBytes: UInt64
+        /// How far the step raised the process's peak resident size.
+        public let peakResidentGrowth: UInt64
+    }
+
+    /// A named scope samples are recorded under.
+    public struct Scope: Sendable {
+        public let profiler: PatchProfiler
+        public let name: String
+
+        /// Child scope, e.g. a patcher inside a component.
+        public func nested(_ child: String) -> Scope {
+            Scope(profiler: profiler, name: "\(name)/\(child)")
+        }
+
+        /// Run `body`, recording it as `step` in this scope.
+        public func measure<T>(_ step: String, _ body: () throws -> T) rethrows -> T {
+            try profiler.measure(scope: name, step, body)
+        }
+    }
+
+    private let lock = NSLock()
+    private var recorded: [Sample] = []
+
+    public init() {}
+
+    /// Samples in completion order (a step finishes after its children).
+    public var samples: [Sample] {
+        lock.withLock { recorded }
+    }
+
+    public func scope(_ name: String) -> Scope {
+        Scope(profiler: self, name: name)
+    }
+
+    /// Run `body`, recording it as `name` under `scope`.
+    public func measure<T>(scope: String, _ name: String, _ body: () throws -> T) rethrows -> T {
+        let before = Counters.read()
+        let start = DispatchTime.now().uptimeNanoseconds
+        defer {
+            let elapsed = DispatchTime.now().uptimeNanoseconds - start
+            let after = Counters.read()
+            let sample = Sample(
+                scope: scope,
+                name: name,
+                wallSeconds: Double(elapsed) / 1e9,
+                heapBlocksDelta: after.heapBlocks - before.heapBlocks,
+                heapBytesDelta: after.heapBytes - before.heapBytes,
+                residentBytes: after.resident,
+                peakResidentGrowth: after.peakResident &- before.peakResident
+            )
+            lock.withLock { recorded.append(sample) }
+        }
+        return try body()
+    }
+
+    // MARK: - Counters
+
+    struct Counters {
+        var heapBlocks = 0
+        var heapBytes = 0
+        var resident: UInt64 = 0
+        var peakResident: UInt64 = 0
+
+        static func read() -> Counters {
+            var out = Counters()
+
+            var stats = malloc_statistics_t()
+            malloc_zone_statistics(nil, &stats)
+            out.heapBlocks = Int(stats.blocks_in_use)
+            out.heapBytes = Int(stats.size_in_use)
+
+            var info = task_vm_info_data_t()
+            var count = mach_msg_type_number_t(MemoryLayout<task_vm_info_data_t>.size / MemoryLayout<natural_t>.size)
+            let kr = withUnsafeMutablePointer(to: &info) {
+                $0.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+                    task_info(mach_task_self_, task_flavor_t(TASK_VM_INFO), $0, &count)
+                }
+            }
+            if kr == KERN_SUCCESS {
+                out.resident = info.resident_size
+                out.peakResident = info.resident_size_peak
+            }
+            return out
+        }
+    }
+
+    // MARK: - Report
+
+    /// Per-step statistics over several runs, stable for diffing.
+    public struct Report: Codable, Sendable {
+        public struct Entry: Codable, Sendable {
+            public let scope: String
+            public let name: String
+            public let runs: Int
+            public let wallSecondsMin: Double
+            public let wallSecondsMedian: Double
+            public let wallSecondsMax: Double
+            public let heapBlocksDeltaMedian: Int
+            public let heapBytesDeltaMedian: Int
+            public let residentBytesMax: UInt64
+            public let peakResidentGrowthMax: UInt64
+        }
+
+        public static let schemaVersion = 1
+
+        public var schema = Report.schemaVersion
+        public var metadata: [String: String]
+        public var entries: [Entry]
+
+        /// Aggregate one sample list per run. Entries keep first-run order;
+        /// steps that recur within a run (same scope and name) are summed.
+        public init(runs: [[Sample]], metadata: [String: String] = [:]) {
+            var order: [String] = []
+            var grouped: [String: [[Sample]]] = [:]
+            for (run, samples) in runs.enumerated() {
+                for sample in samples {
+                    let key = "\(sample.scope)\u{0}\(sample.name)"
+                    if grouped[key] == nil {
+                        order.append(key)
+                        grouped[key] = []
+                    }
+                    while grouped[key]!.count <= run { grouped[key]!.append([]) }
+                    grouped[key]![run].append(sample)
+                }
+            }
+
+            entries = order.map { key in
+                let perRun = grouped[key]!.filter { !$0.isEmpty }
+                let first = perRun[0][0]
+                let wall = perRun.map { $0.reduce(0) { $0 + $1.wallSeconds } }.sorted()
+                let blocks = perRun.map { $0.reduce(0) { $0 + $1.heapBlocksDelta } }.sorted()
+                let bytes = perRun.map { $0.reduce(0) { $0 + $1.heapBytesDelta } }.sorted()
+                return Entry(
+                    scope: first.scope,
+                    name: first.name,
+                    runs: perRun.count,
+                    wallSecondsMin: wall.first!,
+                    wallSecondsMedian: wall[wall.count / 2],
+                    wallSecondsMax: wall.last!,
+                    heapBlocksDeltaMedian: blocks[blocks.count / 2],
+                    heapBytesDeltaMedian: bytes[bytes.count / 2],
+                    residentBytesMax: perRun.joined().map(\.residentBytes).max()!,
+                    peakResidentGrowthMax: perRun.joined().map(\.peakResidentGrowth).max()!
+                )
+            }
+            self.metadata = metadata
+        }
+    }
+}
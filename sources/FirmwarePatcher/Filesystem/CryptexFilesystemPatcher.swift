@@ -86,15 +86,24 @@ public final class CryptexFilesystemPatcher: Patcher {
         let (unencryptedImage, aeaImage) = try mergeFilesystems()
         defer { try? FileManager.default.removeItem(at: unencryptedImage) }
         
-        print("Creating Trustcache")
-        let trustcachePath = try createTrustcache(filesystem: unencryptedImage)
-        
-        print("Creating mtree")
-        let didEdit = try removeSpecificSystemFiles(filesystem: unencryptedImage)
-        let mtreePath = try createMtree(filesystem: unencryptedImage)
-        
-        print("Creating DigestDB and Root Hash")
-        let (digestDbPath, rootHashPath) = try createDigestAndHash(filesystem: unencryptedImage, mtree: mtreePath, remap: didEdit)
+        // One attach serves every step on the merged image: prune it, scan it
+        // read-only, then hand the unmounted device to apfs_sealvolume.
+        let trustcacheDir = try createTmpDir()
+        let mtreeDir = try createTmpDir()
+        let (trustcachePath, mtreePath, digestDbPath, rootHashPath) = try withAttachedImage(path: unencryptedImage, forceRW: true) { device, mount in
+            let didEdit = try removeSpecificSystemFiles(mount: mount)
+            try remountReadOnly(device: device, mount: mount)
+
+            print("Creating Trustcache and mtree")
+            let (trustcachePath, mtreePath) = try runConcurrently(
+                { try self.createTrustcache(mount: mount, workDir: trustcacheDir) },
+                { try self.createMtree(mount: mount, workDir: mtreeDir) }
+            )
+
+            print("Creating DigestDB and Root Hash")
+            let (digestDbPath, rootHashPath) = try createDigestAndHash(device: device, mount: mount, mtree: mtreePath, remap: didEdit)
+            return (trustcachePath, mtreePath, digestDbPath, rootHashPath)
+        }
         let metadataPath = try compressCanonicalMetadata(mtree: mtreePath, digestDb: digestDbPath)
         let rootHashContainer = try wrapRootHash(rootHashPath)
         
@@ -408,10 +417,9 @@ public final class CryptexFilesystemPatcher: Patcher {
         return path
     }
     
-    func createDigestAndHash(filesystem: URL, mtree: URL, remap: Bool) throws -> (URL, URL) {
-        let (device, mount) = try attachImage(path: filesystem)
-        defer { try? detachImage(deviceNode: device) }
-
+    /// Seal the merged image attached at `device`. Unmounts `mount`; the
+    /// caller still owns the attachment.
+    func createDigestAndHash(device: String, mount: String, mtree: URL, remap: Bool) throws -> (URL, URL) {
         let tmpDir = try createTmpDir()
         let digestDbPath = tmpDir.appending(path: "digest.db")
         let rootHashPath = tmpDir.appending(path: "root_hash")
@@ -486,12 +494,8 @@ public final class CryptexFilesystemPatcher: Patcher {
         throw FirmwareManifest.ManifestError.fileNotFound("metadata")
     }
     
-    func createMtree(filesystem: URL) throws -> URL {
-        let (device, mount) = try attachImage(path: filesystem, readonly: true)
-        defer { try? detachImage(deviceNode: device) }
-        
-        let tmpDir = try createTmpDir()
-        let mtreeFile = tmpDir.appending(path: "mtree.txt")
+    func createMtree(mount: String, workDir: URL) throws -> URL {
+        let mtreeFile = workDir.appending(path: "mtree.txt")
         FileManager.default.createFile(atPath: mtreeFile.path, contents: nil)
         _ = try runProcess("/usr/sbin/mtree", [
             "-c",
@@ -500,10 +504,7 @@ public final class CryptexFilesystemPatcher: Patcher {
         return mtreeFile
     }
     
-    func removeSpecificSystemFiles(filesystem: URL) throws -> Bool {
-        let (device, mount) = try attachImage(path: filesystem, forceRW: true)
-        defer { try? detachImage(deviceNode: device) }
-        
+    func removeSpecificSystemFiles(mount: String) throws -> Bool {
         let removedPaths = [
             "/private/var/MobileAsset/PreinstalledAssets",
             "/private/var/MobileAsset/PreinstalledAssetsV2",
@@ -519,16 +520,12 @@ public final class CryptexFilesystemPatcher: Patcher {
         return didEdit
     }
     
-    func createTrustcache(filesystem: URL) throws -> URL {
-        let (device, mount) = try attachImage(path: filesystem, readonly: true)
-        defer { try? detachImage(deviceNode: device) }
-        
+    func createTrustcache(mount: String, workDir: URL) throws -> URL {
         let oldTrustcache = try getTrustcachePath()
         let oldTrustcachePath = self.restoreDir.appending(path: oldTrustcache)
         let newTrustcachePath = self.restoreDir.appending(path: "Firmware/new.trustcache")
-        let tmpDir = try createTmpDir()
         
-        let tcContainer = tmpDir.appending(path: "new.trustcache")
+        let tcContainer = workDir.appending(path: "new.trustcache")
         _ = try runProcess("/System/Library/SecurityResearch/usr/bin/cryptexctl", [
             "generate-trust-cache", "--type", "static",
             "--base-trust-cache", oldTrustcachePath.path,
@@ -982,6 +979,34 @@ public final class CryptexFilesystemPatcher: Patcher {
         _ = try runProcess("/usr/bin/hdiutil", ["detach", deviceNode])
     }
     
+    // withAttachedImage attaches the image once for every step in body and
+    // detaches it afterwards, also when a step fails.
+    func withAttachedImage<T>(path: URL, readonly: Bool = false, forceRW: Bool = false, _ body: (_ device: String, _ mount: String) throws -> T) throws -> T {
+        let (device, mount) = try attachImage(path: path, readonly: readonly, forceRW: forceRW)
+        defer { try? detachImage(deviceNode: device) }
+        return try body(device, mount)
+    }
+    
+    func remountReadOnly(device: String, mount: String) throws {
+        _ = try runProcess("/sbin/mount", ["-u", "-r", device, mount])
+    }
+    
+    // runConcurrently runs two independent steps at the same time and
+    // rethrows the first failure in argument order. Steps must not share
+    // mutable state (e.g. create their temporary directories beforehand).
+    func runConcurrently<A, B>(_ first: () throws -> A, _ second: () throws -> B) throws -> (A, B) {
+        var firstResult: Result<A, any Error>?
+        var secondResult: Result<B, any Error>?
+        DispatchQueue.concurrentPerform(iterations: 2) { index in
+            if index == 0 {
+                firstResult = Result(catching: first)
+            } else {
+                secondResult = Result(catching: second)
+            }
+        }
+        return try (firstResult!.get(), secondResult!.get())
+    }
+    
     func runProcess(_ launchPath: String, _ arguments: [String], sudo: Bool = false, output: URL? = nil) throws -> String {
         let process = Process()
         if sudo {
@@ -0,0 +1,164 @@
+// KernelAnalysisCache.swift — On-disk cache of kernelcache analysis results.
+//
+// The ADRP/BL index and the _panic offset depend only on the kernel bytes,
+// so they are stored under the VM directory keyed by the SHA-256 of the
+// decompressed payload. Re-patching an unchanged kernel maps the cached
+// file instead of rescanning the code ranges.
+//
+// File layout (little-endian, host word size):
+//   u32 magic 'VKAC', u32 version, u64 byteCount, u64 rangeCount, i64 panic
+//   rangeCount × (i64 start, i64 end)
+//   ADRP table, then BL table: u64 keyCount, u64 offsetCount,
+//     keys[keyCount], starts[keyCount + 1], offsets[offsetCount]
+
+import CryptoKit
+import Foundation
+
+/// Persistent cache of ``KernelCodeIndex`` and `_panic` per kernelcache.
+public struct KernelAnalysisCache: Sendable {
+    /// Analysis results restored from or written to the cache.
+    public struct Entry: Sendable {
+        public let index: KernelCodeIndex
+        public let panicOffset: Int?
+    }
+
+    static let magic: UInt32 = 0x4341_4B56 // 'VKAC'
+    /// Bump when index or panic-discovery semantics change.
+    static let version: UInt32 = 1
+
+    public let directory: URL
+
+    public init(directory: URL) {
+        self.directory = directory
+    }
+
+    /// Cache directory used by the pipeline for `vmDirectory`.
+    public init(vmDirectory: URL) {
+        self.init(directory: vmDirectory.appendingPathComponent(".cache/kernel_analysis", isDirectory: true))
+    }
+
+    /// Hex SHA-256 of `data`, used as the cache file name.
+    public static func key(for data: Data) -> String {
+        Data(SHA256.hash(data: data)).hexString
+    }
+
+    func fileURL(forKey key: String) -> URL {
+        directory.appendingPathComponent("\(key).bin")
+    }
+
+    // MARK: - Load / Store
+
+    /// Cached analysis for the kernel with digest `key`, or nil on a miss or
+    /// an unreadable file. A file that fails validation (truncated, trailing
+    /// bytes, unsorted keys, non-monotonic starts, offsets or ranges outside
+    /// `byteCount`) is also a miss, so it is simply rebuilt and overwritten.
+    public func load(key: String) -> Entry? {
+        guard let file = try? Data(contentsOf: fileURL(forKey: key), options: .alwaysMapped) else { return nil }
+        var reader = Reader(data: file)
+        guard reader.u32() == Self.magic, reader.u32() == Self.version,
+              let byteCount = reader.int(), let rangeCount = reader.int(), let panic = reader.int(),
+              byteCount >= 0, rangeCount >= 0, rangeCount < 64
+        else { return nil }
+
+        var ranges: [Range<Int>] = []
+        for _ in 0 ..< rangeCount {
+            guard let start = reader.int(), let end = reader.int(),
+                  start >= 0, start <= end, end <= byteCount
+            else { return nil }
+            ranges.append(start ..< end)
+        }
+        guard let adrp: KernelOffsetTable<UInt64> = reader.table(byteCount: byteCount),
+              let bl: KernelOffsetTable<Int> = reader.table(byteCount: byteCount),
+              reader.cursor == file.count
+        else { return nil }
+
+        return Entry(
+            index: KernelCodeIndex(adrp: adrp, bl: bl, codeRanges: ranges, byteCount: byteCount),
+            panicOffset: panic >= 0 ? panic : nil
+        )
+    }
+
+    /// Write `entry` for digest `key`. Failures are reported but leave no
+    /// partial file behind.
+    public func store(_ entry: Entry, key: String) throws {
+        var out = Data()
+        out.appendRaw(Self.magic)
+        out.appendRaw(Self.version)
+        out.appendRaw(Int64(entry.index.byteCount))
+        out.appendRaw(Int64(entry.index.codeRanges.count))
+        out.appendRaw(Int64(entry.panicOffset ?? -1))
+        for range in entry.index.codeRanges {
+            out.appendRaw(Int64(range.lowerBound))
+            out.appendRaw(Int64(range.upperBound))
+        }
+        out.appendTable(entry.index.adrp)
+        out.appendTable(entry.index.bl)
+
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        try out.write(to: fileURL(forKey: key), options: .atomic)
+    }
+
+    // MARK: - Decoding
+
+    private struct Reader {
+        let data: Data
+        var cursor = 0
+
+        mutating func u32() -> UInt32? {
+            guard cursor + 4 <= data.count else { return nil }
+            defer { cursor += 4 }
+            return data.loadLE(UInt32.self, at: cursor)
+        }
+
+        mutating func int() -> Int? {
+            guard cursor + 8 <= data.count else { return nil }
+            defer { cursor += 8 }
+            return Int(data.loadLE(Int64.self, at: cursor))
+        }
+
+        /// Bulk-copy `count` fixed-width values starting at the cursor.
+        mutating func array<T: FixedWidthInteger>(_: T.Type, count: Int) -> [T]? {
+            guard count >= 0, count <= (data.count - cursor) / MemoryLayout<T>.stride else { return nil }
+            let bytes = count * MemoryLayout<T>.stride
+            let start = cursor
+            cursor += bytes
+            return [T](unsafeUninitializedCapacity: count) { buf, initialized in
+                _ = data.copyBytes(to: buf, from: start ..< start + bytes)
+                initialized = count
+            }
+        }
+
+        /// One table, rejected unless keys strictly ascend, starts never
+        /// decrease and every offset lies in `0 ..< byteCount`.
+        mutating func table<Key: FixedWidthInteger & Sendable>(byteCount: Int) -> KernelOffsetTable<Key>? {
+            guard let keyCount = int(), let offsetCount = int(), keyCount >= 0,
+                  let keys = array(Key.self, count: keyCount),
+                  let starts = array(Int.self, count: keyCount + 1),
+                  let offsets = array(Int.self, count: offsetCount)
+            else { return nil }
+            for i in 1 ..< starts.count where starts[i] < starts[i - 1] {
+                return nil
+            }
+            for i in keys.indices.dropFirst() where keys[i] <= keys[i - 1] {
+                return nil
+            }
+            guard offsets.allSatisfy({ $0 >= 0 && $0 < byteCount }) else { return nil }
+            return KernelOffsetTable(keys: keys, starts: starts, offsets: offsets)
+        }
+    }
+}
+
+private extension Data {
+    mutating func appendRaw<T: FixedWidthInteger>(_ value: T) {
+        var le = value.littleEndian
+        Swift.withUnsafeBytes(of: &le) { append(contentsOf: $0) }
+    }
+
+    mutating func appendTable<Key: FixedWidthInteger & Sendable>(_ table: KernelOffsetTable<Key>) {
+        appendRaw(Int64(table.keys.count))
+        appendRaw(Int64(table.offsets.count))
+        table.keys.withUnsafeBytes { append(contentsOf: $0) }
+        table.starts.withUnsafeBytes { append(contentsOf: $0) }
+        table.offsets.withUnsafeBytes { append(contentsOf: $0) }
+    }
+}
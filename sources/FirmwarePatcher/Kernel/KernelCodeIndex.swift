@@ -0,0 +1,276 @@
+// KernelCodeIndex.swift — Flat ADRP/BL index shared across kernel patchers.
+//
+// One fused pass over the code ranges decodes every ADRP page and BL target
+// into sorted, contiguous (key, offset) tables. The pass is sharded across
+// cores on large kernelcaches. Chained patchers (base → JB → EXP) share one
+// index: after a patcher applies its records, only the instruction words
+// those records touched are re-decoded.
+
+import Foundation
+
+/// Sorted key → offsets table backed by three flat arrays.
+///
+/// Offsets for one key are contiguous and in ascending file order, matching
+/// the append order of the dictionary-based index this replaces. Lookups are
+/// a binary search over `keys`; iteration yields `(key, value)` groups like a
+/// dictionary so call sites can use `max(by:)`, `sorted`, and `for (k, v) in`.
+public struct KernelOffsetTable<Key: FixedWidthInteger & Sendable>: Sequence, Sendable {
+    /// Distinct keys in ascending order.
+    public private(set) var keys: [Key] = []
+
+    /// `starts[i] ..< starts[i + 1]` is the slice of `offsets` for `keys[i]`.
+    private(set) var starts: [Int] = [0]
+
+    /// All offsets, grouped by key.
+    private(set) var offsets: [Int] = []
+
+    public init() {}
+
+    /// Adopt already-grouped arrays (see KernelAnalysisCache).
+    init?(keys: [Key], starts: [Int], offsets: [Int]) {
+        guard starts.count == keys.count + 1, starts.first == 0, starts.last == offsets.count else { return nil }
+        self.keys = keys
+        self.starts = starts
+        self.offsets = offsets
+    }
+
+    /// Build from unsorted (key, offset) pairs.
+    init(pairs: [(key: Key, offset: Int)]) {
+        guard !pairs.isEmpty else { return }
+        let sorted = pairs.sorted { $0.key != $1.key ? $0.key < $1.key : $0.offset < $1.offset }
+
+        keys.reserveCapacity(sorted.count / 2)
+        offsets.reserveCapacity(sorted.count)
+        for (i, pair) in sorted.enumerated() {
+            if i == 0 || pair.key != keys[keys.count - 1] {
+                if i != 0 { starts.append(offsets.count) }
+                keys.append(pair.key)
+            }
+            offsets.append(pair.offset)
+        }
+        starts.append(offsets.count)
+    }
+
+    /// Number of distinct keys.
+    public var count: Int { keys.count }
+
+    public var isEmpty: Bool { keys.isEmpty }
+
+    /// Offsets recorded for `key`, or nil when absent.
+    public subscript(key: Key) -> ArraySlice<Int>? {
+        var lo = 0
+        var hi = keys.count
+        while lo < hi {
+            let mid = (lo + hi) >> 1
+            if keys[mid] < key { lo = mid + 1 } else { hi = mid }
+        }
+        guard lo < keys.count, keys[lo] == key else { return nil }
+        return offsets[starts[lo] ..< starts[lo + 1]]
+    }
+
+    /// Flatten back to (key, offset) pairs.
+    var pairs: [(key: Key, offset: Int)] {
+        var out: [(key: Key, offset: Int)] = []
+        out.reserveCapacity(offsets.count)
+        for (i, key) in keys.enumerated() {
+            for off in offsets[starts[i] ..< starts[i + 1]] {
+                out.append((key, off))
+            }
+        }
+        return out
+    }
+
+    public struct Iterator: IteratorProtocol {
+        let table: KernelOffsetTable
+        var index = 0
+
+        public mutating func next() -> (key: Key, value: ArraySlice<Int>)? {
+            guard index < table.keys.count else { return nil }
+            defer { index += 1 }
+            return (table.keys[index], table.offsets[table.starts[index] ..< table.starts[index + 1]])
+        }
+    }
+
+    public func makeIterator() -> Iterator {
+        Iterator(table: self)
+    }
+}
+
+/// ADRP page and BL target index over a kernelcache's code ranges.
+public struct KernelCodeIndex: Sendable {
+    /// ADRP index: page address → file offsets of ADRP instructions.
+    public let adrp: KernelOffsetTable<UInt64>
+
+    /// BL index: target file offset → caller file offsets.
+    public let bl: KernelOffsetTable<Int>
+
+    /// Code ranges the index was built over.
+    public let codeRanges: [Range<Int>]
+
+    /// Size of the buffer the index was built from.
+    public let byteCount: Int
+
+    /// Below this much code the scan stays on the calling thread.
+    static let shardThreshold = 4 * 1024 * 1024
+
+    /// Whether this index describes `codeRanges` of a buffer of `byteCount` bytes.
+    public func matches(codeRanges ranges: [(start: Int, end: Int)], byteCount count: Int) -> Bool {
+        count == byteCount && ranges.map { $0.start ..< $0.end } == codeRanges
+    }
+
+    // MARK: - Build
+
+    /// Scan every instruction word in `ranges` once, collecting ADRP and BL.
+    public init(data: Data, codeRanges ranges: [(start: Int, end: Int)]) {
+        let codeRanges = ranges.map { $0.start ..< $0.end }
+        let total = codeRanges.reduce(0) { $0 + $1.count }
+        let shards = Self.shard(codeRanges, total: total)
+
+        var results = [Scan](repeating: Scan(), count: shards.count)
+        data.withUnsafeBytes { raw in
+            results.withUnsafeMutableBufferPointer { out in
+                if shards.count == 1 {
+                    out[0] = Self.scan(raw, shards[0])
+                } else {
+                    DispatchQueue.concurrentPerform(iterations: shards.count) { i in
+                        out[i] = Self.scan(raw, shards[i])
+                    }
+                }
+            }
+        }
+
+        var adrpPairs = results.first?.adrp ?? []
+        var blPairs = results.first?.bl ?? []
+        for scan in results.dropFirst() {
+            adrpPairs.append(contentsOf: scan.adrp)
+            blPairs.append(contentsOf: scan.bl)
+        }
+
+        adrp = KernelOffsetTable(pairs: adrpPairs)
+        bl = KernelOffsetTable(pairs: blPairs)
+        self.codeRanges = codeRanges
+        byteCount = data.count
+    }
+
+    init(adrp: KernelOffsetTable<UInt64>, bl: KernelOffsetTable<Int>, codeRanges: [Range<Int>], byteCount: Int) {
+        self.adrp = adrp
+        self.bl = bl
+        self.codeRanges = codeRanges
+        self.byteCount = byteCount
+    }
+
+    /// Re-decode only the instruction words covered by `records` in `data`.
+    ///
+    /// `data` must be the buffer this index was built from with `records`
+    /// applied; bytes outside those records must be unchanged.
+    public func updated(applying records: [PatchRecord], to data: Data) -> KernelCodeIndex {
+        guard !records.isEmpty else { return self }
+
+        var touched = Set<Int>()
+        for record in records {
+            let lo = record.fileOffset
+            let hi = lo + record.patchedBytes.count
+            for range in codeRanges where lo < range.upperBound && hi > range.lowerBound {
+                var word = range.lowerBound + ((max(lo, range.lowerBound) - range.lowerBound) & ~3)
+                while word < hi, word + 4 <= range.upperBound {
+                    touched.insert(word)
+                    word += 4
+                }
+            }
+        }
+        guard !touched.isEmpty else { return self }
+
+        var adrpPairs = adrp.pairs.filter { !touched.contains($0.offset) }
+        var blPairs = bl.pairs.filter { !touched.contains($0.offset) }
+        data.withUnsafeBytes { raw in
+            for offset in touched {
+                let insn = raw.loadUnaligned(fromByteOffset: offset, as: UInt32.self).littleEndian
+                if let page = Self.adrpPage(insn, at: offset) { adrpPairs.append((page, offset)) }
+                if let target = Self.blTarget(insn, at: offset) { blPairs.append((target, offset)) }
+            }
+        }
+
+        return KernelCodeIndex(
+            adrp: KernelOffsetTable(pairs: adrpPairs),
+            bl: KernelOffsetTable(pairs: blPairs),
+            codeRanges: codeRanges,
+            byteCount: data.count
+        )
+    }
+
+    // MARK: - Decoding
+
+    private struct Scan {
+        var adrp: [(key: UInt64, offset: Int)] = []
+        var bl: [(key: Int, offset: Int)] = []
+    }
+
+    /// Split the code ranges into shards of roughly equal size. Cuts fall a
+    /// multiple of 4 bytes from their range's start, so every shard decodes
+    /// the same instruction words as one serial pass, even after a range
+    /// whose length is not a multiple of 4.
+    static func shard(
+        _ ranges: [Range<Int>], total: Int, cores: Int = ProcessInfo.processInfo.activeProcessorCount
+    ) -> [[Range<Int>]] {
+        guard total >= shardThreshold, cores > 1 else { return [ranges] }
+
+        let target = ((total / cores) + 3) & ~3
+        var shards: [[Range<Int>]] = []
+        var current: [Range<Int>] = []
+        var currentSize = 0
+        for range in ranges {
+            var start = range.lowerBound
+            while start < range.upperBound {
+                let end = min(range.upperBound, start + max(4, (target - currentSize) & ~3))
+                current.append(start ..< end)
+                currentSize += end - start
+                start = end
+                if currentSize >= target {
+                    shards.append(current)
+                    current = []
+                    currentSize = 0
+                }
+            }
+        }
+        if !current.isEmpty { shards.append(current) }
+        return shards
+    }
+
+    private static func scan(_ raw: UnsafeRawBufferPointer, _ ranges: [Range<Int>]) -> Scan {
+        var out = Scan()
+        for range in ranges {
+            var offset = range.lowerBound
+            let end = min(range.upperBound, raw.count)
+            while offset + 4 <= end {
+                let insn = raw.loadUnaligned(fromByteOffset: offset, as: UInt32.self).littleEndian
+                if let page = adrpPage(insn, at: offset) {
+                    out.adrp.append((page, offset))
+                } else if let target = blTarget(insn, at: offset) {
+                    out.bl.append((target, offset))
+                }
+                offset += 4
+            }
+        }
+        return out
+    }
+
+    /// ADRP: [31]=1, [28:24]=10000 — returns the referenced page address.
+    @inline(__always)
+    static func adrpPage(_ insn: UInt32, at offset: Int) -> UInt64? {
+        guard insn & 0x9F00_0000 == 0x9000_0000 else { return nil }
+        let immhi = (insn >> 5) & 0x7FFFF
+        let immlo = (insn >> 29) & 0x3
+        let imm21 = (immhi << 2) | immlo
+        let signedImm = Int64(Int32(bitPattern: imm21 << 11) >> 11)
+        return (UInt64(offset) & ~0xFFF) &+ UInt64(bitPattern: signedImm << 12)
+    }
+
+    /// BL: [31:26] = 100101 — returns the target file offset.
+    @inline(__always)
+    static func blTarget(_ insn: UInt32, at offset: Int) -> Int? {
+        guard insn >> 26 == 0b100101 else { return nil }
+        let imm26 = insn & 0x03FF_FFFF
+        let signedImm = Int32(bitPattern: imm26 << 6) >> 6
+        return offset + Int(signedImm) * 4
+    }
+}
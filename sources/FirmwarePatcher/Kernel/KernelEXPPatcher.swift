@@ -20,14 +20,14 @@ public final class KernelEXPPatcher: KernelJBPatcherBase, Patcher {
     public let component = "kernelcache_exp"
 
     public func findAll() throws -> [PatchRecord] {
-        try parseMachO()
-        buildADRPIndex()
-        buildBLIndex()
-        buildSymbolTable()
-        findPanic()
+        profile("parseMachO", parseMachO)
+        profile("buildADRPIndex", buildADRPIndex)
+        profile("buildBLIndex", buildBLIndex)
+        profile("buildSymbolTable", buildSymbolTable)
+        profile("findPanic", findPanic)
 
         // Experimental patches (EXP variant only)
-        patchHvVmmRename()
+        profile("patchHvVmmRename", patchHvVmmRename)
 
         return patches
     }
@@ -21,18 +21,31 @@ public final class KernelJBPatcher: KernelJBPatcherBase, Patcher {
     /// set (override with --target-os).
     public var applyIOS27 = false
 
+    /// How many discovery searches run at once (1 = serially on this patcher).
+    /// Each concurrent search holds its own copy of the buffer once it emits,
+    /// so this stays small.
+    public var discoveryConcurrency = FirmwarePipeline.defaultConcurrency
+
+    /// A named patch routine run by `runSearches(_:)`.
+    typealias Search = (name: String, run: (KernelJBPatcher) -> Bool)
+
     public func findAll() throws -> [PatchRecord] {
-        try parseMachO()
-        buildADRPIndex()
-        buildBLIndex()
-        buildSymbolTable()
-        findPanic()
-
-        // Group A
-        patchAmfiCdhashInTrustcache()
-        patchTaskConversionEvalInternal()
-        patchSandboxHooksExtended()
-        patchIoucFailedMacf()
+        profile("parseMachO", parseMachO)
+        profile("buildADRPIndex", buildADRPIndex)
+        profile("buildBLIndex", buildBLIndex)
+        profile("buildSymbolTable", buildSymbolTable)
+        profile("findPanic", findPanic)
+
+        // Groups A and B (and the first iOS-27 pair) are independent
+        // searches that patch in place, so they may run concurrently against
+        // a snapshot; see `runSearches(_:)`.
+        var searches: [Search] = [
+            // Group A
+            ("patchAmfiCdhashInTrustcache", { $0.patchAmfiCdhashInTrustcache() }),
+            ("patchTaskConversionEvalInternal", { $0.patchTaskConversionEvalInternal() }),
+            ("patchSandboxHooksExtended", { $0.patchSandboxHooksExtended() }),
+            ("patchIoucFailedMacf", { $0.patchIoucFailedMacf() }),
+        ]
 
         // iOS-27-only (gated — a 26.x base skips these entirely). Both target a 27
         // userland on the 26.4 kernel:
@@ -45,33 +58,38 @@ public final class KernelJBPatcher: KernelJBPatcherBase, Patcher {
         //    (/System/Developer auto-mount). Pairs with the sandbox ops[124] allow
         //    and the diskimagesiod isMountComplete→YES userland patch (cfw_install).
         if applyIOS27 {
-            patchIoucFailedSandbox()
-            patchDiskImages2ClientAbi()
+            searches += [
+                ("patchIoucFailedSandbox", { $0.patchIoucFailedSandbox() }),
+                ("patchDiskImages2ClientAbi", { $0.patchDiskImages2ClientAbi() }),
+            ]
         }
 
-        // Group B
-        patchPostValidationAdditional()
-        patchProcSecurityPolicy()
-        patchProcPidinfo()
-        patchConvertPortToMap()
-        patchBsdInitAuth()
-        patchDounmount()
-        patchIoSecureBsdRoot()
-        patchLoadDylinker()
-        patchMacMount()
-        patchNvramVerifyPermission()
-        patchSharedRegionMap()
-        patchSpawnValidatePersona()
-        patchTaskForPid()
-        patchThidShouldCrash()
-        patchVmFaultEnterPrepare()
-        patchVmMapProtect()
+        searches += [
+            // Group B
+            ("patchPostValidationAdditional", { $0.patchPostValidationAdditional() }),
+            ("patchProcSecurityPolicy", { $0.patchProcSecurityPolicy() }),
+            ("patchProcPidinfo", { $0.patchProcPidinfo() }),
+            ("patchConvertPortToMap", { $0.patchConvertPortToMap() }),
+            ("patchBsdInitAuth", { $0.patchBsdInitAuth() }),
+            ("patchDounmount", { $0.patchDounmount() }),
+            ("patchIoSecureBsdRoot", { $0.patchIoSecureBsdRoot() }),
+            ("patchLoadDylinker", { $0.patchLoadDylinker() }),
+            ("patchMacMount", { $0.patchMacMount() }),
+            ("patchNvramVerifyPermission", { $0.patchNvramVerifyPermission() }),
+            ("patchSharedRegionMap", { $0.patchSharedRegionMap() }),
+            ("patchSpawnValidatePersona", { $0.patchSpawnValidatePersona() }),
+            ("patchTaskForPid", { $0.patchTaskForPid() }),
+            ("patchThidShouldCrash", { $0.patchThidShouldCrash() }),
+            ("patchVmFaultEnterPrepare", { $0.patchVmFaultEnterPrepare() }),
+            ("patchVmMapProtect", { $0.patchVmMapProtect() }),
+        ]
+        runSearches(searches)
 
         // Group C
-        patchCredLabelUpdateExecve()
-        patchHookCredLabelUpdateExecve()
-        patchKcall10()
-        patchSyscallmaskApplyToProc()
+        profile("patchCredLabelUpdateExecve", patchCredLabelUpdateExecve)
+        profile("patchHookCredLabelUpdateExecve", patchHookCredLabelUpdateExecve)
+        profile("patchKcall10", patchKcall10)
+        profile("patchSyscallmaskApplyToProc", patchSyscallmaskApplyToProc)
 
         // iOS-27-only (gated — a 26.x base skips these entirely). All target a 27
         // userland on the 26.4 kernel and are unnecessary or actively harmful on 26.x:
@@ -89,16 +107,126 @@ public final class KernelJBPatcher: KernelJBPatcherBase, Patcher {
         //    sends the native 0x588, which the retargeted handler gate would then reject
         //    → every framebuffer swap fails → dead display (the 26.5 regression).
         if applyIOS27 {
-            patchExecSecurityPolicyKill()
-            patchContainerManagerUpcall()
-            patchIomfbSwapEndVariableSize()      // dispatch checkStructureInputSize → variable
-            patchIomfbSwapEndHandlerSize()       // handler cmp w2,#0x588 → 0x6e0
-            patchFpfsScopedVnodeOpen()           // ops[267] → FileProvider-scoped trampoline (fpfs respring fix)
+            profile("patchExecSecurityPolicyKill", patchExecSecurityPolicyKill)
+            profile("patchContainerManagerUpcall", patchContainerManagerUpcall)
+            profile("patchIomfbSwapEndVariableSize", patchIomfbSwapEndVariableSize)      // dispatch checkStructureInputSize → variable
+            profile("patchIomfbSwapEndHandlerSize", patchIomfbSwapEndHandlerSize)       // handler cmp w2,#0x588 → 0x6e0
+            profile("patchFpfsScopedVnodeOpen", patchFpfsScopedVnodeOpen)           // ops[267] → FileProvider-scoped trampoline (fpfs respring fix)
         }
 
         return patches
     }
 
+    // MARK: - Concurrent Discovery
+
+    /// Output of one search run on a forked worker.
+    private struct SearchResult {
+        var patches: [PatchRecord]
+        var lines: [String]
+        var scanCache: [String: Int]
+    }
+
+    private final class SearchRun: @unchecked Sendable {
+        let lock = NSLock()
+        var next = 0
+        var results: [SearchResult?]
+
+        init(count: Int) {
+            results = Array(repeating: nil, count: count)
+        }
+
+        func claim() -> Int? {
+            lock.withLock {
+                guard next < results.count else { return nil }
+                defer { next += 1 }
+                return next
+            }
+        }
+    }
+
+    /// Run `searches` in order with their emits landing in `patches` and
+    /// the buffer exactly as a serial run would.
+    ///
+    /// Concurrently, each search runs on a worker forked from this patcher
+    /// (shared indexes, private buffer snapshot and Capstone handle). Results
+    /// are merged in list order, with each search's log lines replayed after
+    /// it. If two searches patched overlapping bytes, their outcomes could
+    /// depend on order, so everything is discarded and rerun serially.
+    ///
+    /// Searches must not depend on bytes another search writes; routines that
+    /// allocate code caves therefore stay out of this list.
+    func runSearches(_ searches: [Search]) {
+        let width = min(discoveryConcurrency, searches.count)
+        guard width > 1 else {
+            for search in searches {
+                profile(search.name) { _ = search.run(self) }
+            }
+            return
+        }
+
+        let run = SearchRun(count: searches.count)
+        DispatchQueue.concurrentPerform(iterations: width) { _ in
+            while let index = run.claim() {
+                let worker = KernelJBPatcher(forking: self)
+                worker.applyIOS27 = applyIOS27
+                worker.inheritCaches(from: self)
+                var lines: [String] = []
+                worker.logSink = { lines.append($0) }
+
+                let search = searches[index]
+                worker.profile(search.name) { _ = search.run(worker) }
+
+                let result = SearchResult(patches: worker.patches, lines: lines, scanCache: worker.jbScanCache)
+                run.lock.withLock { run.results[index] = result }
+            }
+        }
+        let results = run.results.map { $0! }
+
+        if let (a, b, offset) = Self.firstOverlap(results.map(\.patches)) {
+            log("  [!] \(searches[a].name) and \(searches[b].name) both patch 0x\(String(format: "%X", offset)); rerunning serially")
+            for search in searches {
+                profile(search.name) { _ = search.run(self) }
+            }
+            return
+        }
+
+        for result in results {
+            for line in result.lines {
+                log(line)
+            }
+            for record in result.patches {
+                patches.append(record)
+                buffer.writeBytes(at: record.fileOffset, bytes: record.patchedBytes)
+            }
+            jbScanCache.merge(result.scanCache) { current, _ in current }
+        }
+    }
+
+    /// First pair of groups with overlapping record ranges, as
+    /// (earlier group, later group, offset of the later record).
+    ///
+    /// Only write/write conflicts are caught: reads are not tracked, so a
+    /// search that scans bytes an earlier search patches would see the
+    /// unpatched snapshot and pass this check. `runSearches(_:)` relies on
+    /// its callers to keep such searches out of the concurrent list.
+    static func firstOverlap(_ groups: [[PatchRecord]]) -> (Int, Int, Int)? {
+        let ranges = groups.enumerated()
+            .flatMap { group, records in
+                records.map { (group: group, lo: $0.fileOffset, hi: $0.fileOffset + $0.patchedBytes.count) }
+            }
+            .sorted { $0.lo < $1.lo }
+
+        for (i, lhs) in ranges.enumerated() {
+            for rhs in ranges[(i + 1)...] {
+                guard rhs.lo < lhs.hi else { break }
+                if rhs.group != lhs.group {
+                    return (min(lhs.group, rhs.group), max(lhs.group, rhs.group), rhs.lo)
+                }
+            }
+        }
+        return nil
+    }
+
     public func apply() throws -> Int {
         let records = try (patches.isEmpty ? findAll() : patches)
         for record in records {
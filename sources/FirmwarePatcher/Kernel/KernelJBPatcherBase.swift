@@ -22,6 +22,13 @@ public class KernelJBPatcherBase: KernelPatcherBase {
     /// JB scan cache for expensive searches.
     var jbScanCache: [String: Int] = [:]
 
+    /// Take over `other`'s symbol table and scan caches (see `init(forking:)`).
+    func inheritCaches(from other: KernelJBPatcherBase) {
+        symbols = other.symbols
+        procSecurityPolicyOff = other.procSecurityPolicyOff
+        jbScanCache = other.jbScanCache
+    }
+
     // MARK: - Symbol Table
 
     /// Build symbol table from LC_SYMTAB in the main Mach-O header AND all
@@ -294,8 +301,8 @@ public class KernelJBPatcherBase: KernelPatcherBase {
 
         let result = funcs.count == 1 ? funcs.first! : -1
         procSecurityPolicyOff = result
-        if verbose, result >= 0 {
-            print("  [+] _proc_security_policy at 0x\(String(format: "%X", result)) (PRIV_GLOBAL_PROC_INFO anchor)")
+        if result >= 0 {
+            log("  [+] _proc_security_policy at 0x\(String(format: "%X", result)) (PRIV_GLOBAL_PROC_INFO anchor)")
         }
         return result >= 0 ? result : nil
     }
@@ -34,34 +34,52 @@ public final class KernelPatcher: KernelPatcherBase, Patcher {
         patches = []
 
         // Parse Mach-O structure and build indices
-        parseMachO()
-        buildADRPIndex()
-        buildBLIndex()
-        findPanic()
+        profile("parseMachO", parseMachO)
+        profile("buildADRPIndex", buildADRPIndex)
+        profile("buildBLIndex", buildBLIndex)
+        profile("findPanic", findPanic)
+
+        // Resolve the patches' string anchors in one pass over the buffer.
+        buffer.prefetchStrings(Self.anchorStrings)
 
         // Apply patches in order (matching Python find_all)
-        patchApfsRootSnapshot() // 1
-        patchApfsSealBroken() // 2
-        patchBsdInitRootvp() // 3
-        patchLaunchConstraints() // 4-5
-        patchDebugger() // 6-7
-        patchPostValidationNOP() // 8
-        patchPostValidationCMP() // 9
-        patchDyldPolicy() // 10-11
-        patchApfsGraft() // 12
-        patchApfsMount() // 13-15
-        patchSandbox() // 16-25
+        profile("patchApfsRootSnapshot", patchApfsRootSnapshot) // 1
+        profile("patchApfsSealBroken", patchApfsSealBroken) // 2
+        profile("patchBsdInitRootvp", patchBsdInitRootvp) // 3
+        profile("patchLaunchConstraints", patchLaunchConstraints) // 4-5
+        profile("patchDebugger", patchDebugger) // 6-7
+        profile("patchPostValidationNOP", patchPostValidationNOP) // 8
+        profile("patchPostValidationCMP", patchPostValidationCMP) // 9
+        profile("patchDyldPolicy", patchDyldPolicy) // 10-11
+        profile("patchApfsGraft", patchApfsGraft) // 12
+        profile("patchApfsMount", patchApfsMount) // 13-15
+        profile("patchSandbox", patchSandbox) // 16-25
 
         // EXC_GUARD (Mach port guard) disable — applied on the dev variant
         // always, and on any variant with an iOS 18 base (see applyExcGuard).
         // Not applied to 26.x bases, which boot without it.
         if isDev || applyExcGuard {
-            patchExcGuardBehavior() // 26
+            profile("patchExcGuardBehavior", patchExcGuardBehavior) // 26
         }
 
         return patches
     }
 
+    /// C-string anchors looked up via `findString` by the patches above.
+    /// Missing entries are still found on demand; this only batches the scan.
+    static let anchorStrings = [
+        "AMFI: Validation Category info",
+        "AMFI: code signature validation failed",
+        "Seatbelt sandbox policy",
+        "TXM [Error]: CodeSignature",
+        "apfs_mount_upgrade_checks",
+        "com.apple.apfs.get-dev-by-role",
+        "com.apple.security.only-one-exception-port",
+        "root volume seal is broken",
+        "rootvp not authenticated after mounting",
+        "validate_payload_and_manifest",
+    ]
+
     @discardableResult
     public func apply() throws -> Int {
         let records = try (patches.isEmpty ? findAll() : patches)
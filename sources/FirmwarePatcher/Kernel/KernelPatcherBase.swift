@@ -12,7 +12,7 @@ open class KernelPatcherBase {
     // MARK: - Properties
 
     /// Mutable working buffer.
-    public let buffer: BinaryBuffer
+    public private(set) var buffer: BinaryBuffer
 
     /// Verbose logging.
     public let verbose: Bool
@@ -32,11 +32,15 @@ open class KernelPatcherBase {
     /// Parsed sections keyed by "segment,section".
     public var sections: [String: MachOSectionInfo] = [:]
 
-    /// ADRP index: page address → [file offsets of ADRP instructions].
-    public var adrpIndex: [UInt64: [Int]] = [:]
+    /// Fused ADRP/BL index over `codeRanges`. The pipeline seeds this from
+    /// the previous kernel patcher so chained patchers skip the rescan.
+    public var codeIndex: KernelCodeIndex?
 
-    /// BL index: target file offset → [caller file offsets].
-    public var blIndex: [Int: [Int]] = [:]
+    /// ADRP index: page address → file offsets of ADRP instructions.
+    public var adrpIndex: KernelOffsetTable<UInt64> { codeIndex?.adrp ?? KernelOffsetTable() }
+
+    /// BL index: target file offset → caller file offsets.
+    public var blIndex: KernelOffsetTable<Int> { codeIndex?.bl ?? KernelOffsetTable() }
 
     /// Cached panic function file offset.
     public var panicOffset: Int?
@@ -44,6 +48,12 @@ open class KernelPatcherBase {
     /// Disassembler instance.
     public let disasm = ARM64Disassembler()
 
+    /// Set by the pipeline when profiling; see ``profile(_:_:)``.
+    public var profiler: PatchProfiler.Scope?
+
+    /// Receives verbose output instead of stdout when set.
+    var logSink: ((String) -> Void)?
+
     // MARK: - Init
 
     public init(data: Data, verbose: Bool = true) {
@@ -51,6 +61,28 @@ open class KernelPatcherBase {
         self.verbose = verbose
     }
 
+    /// A patcher that continues from `other`'s parsed Mach-O state and
+    /// indexes, working on a copy-on-write snapshot of its buffer. Used for
+    /// concurrent discovery; `other` is not modified.
+    public init(forking other: KernelPatcherBase) {
+        buffer = other.buffer.snapshot()
+        verbose = other.verbose
+        baseVA = other.baseVA
+        codeRanges = other.codeRanges
+        segments = other.segments
+        sections = other.sections
+        codeIndex = other.codeIndex
+        panicOffset = other.panicOffset
+        profiler = other.profiler
+    }
+
+    /// Continue on the buffer an earlier kernel patcher in the chain patched,
+    /// instead of the one this patcher was created with. Call before findAll().
+    public func adopt(buffer shared: BinaryBuffer) {
+        shared.checkpoint()
+        buffer = shared
+    }
+
     // MARK: - Mach-O Parsing
 
     /// Parse the Mach-O structure and build indices.
@@ -108,9 +140,7 @@ open class KernelPatcherBase {
         // allocated shellcode and won't reuse the same cave region.
         buffer.writeBytes(at: offset, bytes: patchBytes)
 
-        if verbose {
-            print("  0x\(String(format: "%06X", offset)): \(beforeStr) → \(afterStr)  [\(description)]")
-        }
+        log("  0x\(String(format: "%06X", offset)): \(beforeStr) → \(afterStr)  [\(description)]")
     }
 
     /// Apply all collected patches to the buffer.
@@ -123,47 +153,23 @@ open class KernelPatcherBase {
 
     // MARK: - Index Building
 
-    /// Build ADRP index for O(1) page-address lookups.
+    /// Build the ADRP index for page-address lookups.
+    ///
+    /// ADRP and BL come from one fused scan; whichever builder runs first
+    /// does the work, and a seeded `codeIndex` for the same code ranges is
+    /// reused as-is.
     public func buildADRPIndex() {
-        adrpIndex = [:]
-        for (start, end) in codeRanges {
-            var offset = start
-            while offset + 4 <= end {
-                let insn = buffer.readU32(at: offset)
-                // ADRP: [31]=1, [28:24]=10000
-                if insn & 0x9F00_0000 == 0x9000_0000 {
-                    // Decode page address
-                    let immhi = (insn >> 5) & 0x7FFFF
-                    let immlo = (insn >> 29) & 0x3
-                    let imm21 = (immhi << 2) | immlo
-                    // Sign-extend
-                    let signedImm = Int64(Int32(bitPattern: imm21 << 11) >> 11)
-                    let pageAddr = (UInt64(offset) & ~0xFFF) &+ UInt64(bitPattern: signedImm << 12)
-
-                    adrpIndex[pageAddr, default: []].append(offset)
-                }
-                offset += 4
-            }
-        }
+        buildCodeIndexIfNeeded()
     }
 
-    /// Build BL index for target-to-callers mapping.
+    /// Build the BL index for target-to-callers mapping.
     public func buildBLIndex() {
-        blIndex = [:]
-        for (start, end) in codeRanges {
-            var offset = start
-            while offset + 4 <= end {
-                let insn = buffer.readU32(at: offset)
-                // BL: [31:26] = 100101
-                if insn >> 26 == 0b100101 {
-                    let imm26 = insn & 0x03FF_FFFF
-                    let signedImm = Int32(bitPattern: imm26 << 6) >> 6
-                    let target = offset + Int(signedImm) * 4
-                    blIndex[target, default: []].append(offset)
-                }
-                offset += 4
-            }
-        }
+        buildCodeIndexIfNeeded()
+    }
+
+    private func buildCodeIndexIfNeeded() {
+        if let codeIndex, codeIndex.matches(codeRanges: codeRanges, byteCount: buffer.count) { return }
+        codeIndex = KernelCodeIndex(data: buffer.data, codeRanges: codeRanges)
     }
 
     // MARK: - String Reference Search
@@ -252,11 +258,46 @@ open class KernelPatcherBase {
         return nil
     }
 
+    /// Conditional branch at `offset` in `data` (default: the working buffer),
+    /// decoded with ``ARM64Decoder`` instead of Capstone.
+    ///
+    /// The fast decoder covers every mnemonic in `conditionalBranchMnemonics`,
+    /// so a nil decode means the word is not one of them.
+    public func conditionalBranch(at offset: Int, in data: Data? = nil) -> (mnemonic: String, target: Int)? {
+        guard let insn = ARM64Decoder.decode(in: data ?? buffer.data, at: offset),
+              insn.isConditionalBranch, let target = insn.branchTarget
+        else { return nil }
+        return (insn.mnemonic, target)
+    }
+
+    // MARK: - Logging
+
+    /// Print `message` in verbose mode, or hand it to `logSink`.
+    func log(_ message: String) {
+        guard verbose else { return }
+        if let logSink {
+            logSink(message)
+        } else {
+            print(message)
+        }
+    }
+
+    // MARK: - Profiling
+
+    /// Run `body`, recording it as `step` when a profiler is attached.
+    @discardableResult
+    public func profile<T>(_ step: String, _ body: () throws -> T) rethrows -> T {
+        guard let profiler else { return try body() }
+        return try profiler.measure(step, body)
+    }
+
     // MARK: - Panic Discovery
 
     /// Find _panic: the most-called function whose callers reference '@%s:%d' strings.
-    /// Populates `panicOffset`.
+    /// Populates `panicOffset`; a value seeded from KernelAnalysisCache is kept.
     public func findPanic() {
+        guard panicOffset == nil else { return }
+
         // Sort targets by call-site count, descending.
         let sorted = blIndex.sorted { $0.value.count > $1.value.count }
 
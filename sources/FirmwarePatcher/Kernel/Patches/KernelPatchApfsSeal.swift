@@ -59,14 +59,9 @@ extension KernelPatcher {
 
             var back = adrpOff - 4
             while back >= backLimit {
-                guard let insn = disasm.disassembleOne(in: buffer.data, at: back) else {
-                    back -= 4
-                    continue
-                }
-
-                if let branchTarget = conditionalBranchTarget(insn: insn) {
-                    if branchTarget >= errLo, branchTarget <= errHi {
-                        let desc = "NOP \(insn.mnemonic) (seal broken) [_authapfs_seal_is_broken]"
+                if let branch = conditionalBranch(at: back) {
+                    if branch.target >= errLo, branch.target <= errHi {
+                        let desc = "NOP \(branch.mnemonic) (seal broken) [_authapfs_seal_is_broken]"
                         emit(back, ARM64.nop, patchID: "kernel.apfs_seal_broken", description: desc)
                         return true
                     }
@@ -7,18 +7,8 @@
 //   recover bsd_init → locate rootvp panic block → find the unique in-function BL
 //   → cbnz w0/x0 panic → bl imageboot_needed site → patch the branch gate only.
 
-import Capstone
 import Foundation
 
-// MARK: - Conditional branch mnemonics (ARM64)
-
-private let condBranchMnemonics: Set<String> = [
-    "b.eq", "b.ne", "b.cs", "b.hs", "b.cc", "b.lo",
-    "b.mi", "b.pl", "b.vs", "b.vc", "b.hi", "b.ls",
-    "b.ge", "b.lt", "b.gt", "b.le", "b.al",
-    "cbz", "cbnz", "tbz", "tbnz",
-]
-
 extension KernelPatcher {
     // MARK: - Panic Offset Resolution
 
@@ -107,21 +97,11 @@ extension KernelPatcher {
                 defer { back -= 4 }
                 guard back + 4 <= buffer.count else { continue }
 
-                // Use Capstone to decode and check for conditional branch.
-                // Addresses in Capstone match file offsets (address param == offset).
-                guard let insn = disasm.disassembleOne(in: buffer.original, at: back) else {
-                    continue
-                }
-
-                guard condBranchMnemonics.contains(insn.mnemonic) else { continue }
-
-                // Extract the branch target from operand string.
-                // Capstone renders CBZ/CBNZ as "cbz x0, #0x1234" and
-                // B.cond as "b.eq #0x1234". The immediate is the last token.
-                guard let branchTarget = decodeBranchTargetFromInsn(insn) else { continue }
+                // Decode the raw word; addresses match file offsets.
+                guard let branch = conditionalBranch(at: back, in: buffer.original) else { continue }
 
                 // Target must fall within the error path block.
-                guard branchTarget >= errLo, branchTarget < errHi else { continue }
+                guard branch.target >= errLo, branch.target < errHi else { continue }
 
                 // Found the gate branch — NOP it.
                 let va = fileOffsetToVA(back)
@@ -130,7 +110,7 @@ extension KernelPatcher {
                     ARM64.nop,
                     patchID: "kernel.bsd_init_rootvp",
                     virtualAddress: va,
-                    description: "NOP \(insn.mnemonic) (rootvp auth) [_bsd_init]"
+                    description: "NOP \(branch.mnemonic) (rootvp auth) [_bsd_init]"
                 )
                 return true
             }
@@ -139,28 +119,4 @@ extension KernelPatcher {
         log("  [-] conditional branch into panic path not found")
         return false
     }
-
-    // MARK: - Helpers
-
-    /// Extract the branch target (file offset) from a Capstone instruction's operand string.
-    ///
-    /// Capstone renders the target as a hex literal (e.g., `#0x1abc`).
-    /// We parse the last whitespace-separated token and strip the leading `#`.
-    private func decodeBranchTargetFromInsn(_ insn: Instruction) -> Int? {
-        // operandString examples:
-        //   "w0, #0xf7798c"   (cbz / cbnz)
-        //   "#0xf7798c"       (b.eq / b.ne / etc.)
-        //   "w0, #4, #0xf7798c"  (tbz / tbnz)
-        let tokens = insn.operandString
-            .split(separator: ",")
-            .map { String($0).trimmingCharacters(in: .whitespaces) }
-        guard let last = tokens.last else { return nil }
-
-        let hex = last.hasPrefix("#") ? String(last.dropFirst()) : last
-        // Capstone may emit "0x…" or a plain decimal.
-        if hex.hasPrefix("0x") || hex.hasPrefix("0X") {
-            return Int(hex.dropFirst(2), radix: 16)
-        }
-        return Int(hex)
-    }
 }
@@ -54,11 +54,45 @@ public final class FirmwarePipeline {
         }
 
         public func save(_ data: Data, to url: URL) throws {
-            let original = try IM4PHandler.load(contentsOf: url).im4p
+            let original = try IM4PHandler.loadContainer(contentsOf: url)
             try IM4PHandler.save(patchedData: data, originalIM4P: original, to: url)
         }
     }
 
+    /// Memory-mapped loader, used by default.
+    ///
+    /// Files are mapped copy-on-write, so a raw payload such as AVPBooter
+    /// costs only the pages a patch touches, and `save` rewrites only the
+    /// changed pages. IM4P payloads still have to be decoded into memory, but
+    /// the parsed container is kept from `load` so `save` neither rereads
+    /// nor decodes the file again.
+    public final class MappedFirmwareLoader: FirmwareLoader, @unchecked Sendable {
+        private let lock = NSLock()
+        private var containers: [URL: IM4P] = [:]
+
+        public init() {}
+
+        public func load(from url: URL) throws -> Data {
+            let mapped = try IM4PHandler.mapPrivate(contentsOf: url)
+            guard let im4p = try? IM4P(mapped) else { return mapped }
+            let payload = try im4p.payload()
+            lock.withLock { containers[url.standardizedFileURL] = im4p }
+            return payload
+        }
+
+        public func save(_ data: Data, to url: URL) throws {
+            let im4p = lock.withLock { containers.removeValue(forKey: url.standardizedFileURL) }
+            if let im4p {
+                // Atomic: the container still references the old mapping.
+                try IM4PHandler.save(patchedData: data, originalIM4P: im4p, to: url, options: .atomic)
+            } else if let original = try IM4PHandler.loadContainer(contentsOf: url) {
+                try IM4PHandler.save(patchedData: data, originalIM4P: original, to: url, options: .atomic)
+            } else {
+                try IM4PHandler.writeDirtyPages(data, to: url)
+            }
+        }
+    }
+
     // MARK: - Component Descriptor
 
     /// Describes a single firmware component in the pipeline.
@@ -71,6 +105,12 @@ public final class FirmwarePipeline {
         let searchPatterns: [String]
         /// Factories that create patchers to run in sequence for the loaded data.
         let patcherFactories: [(Data, Bool) -> any Patcher]
+        /// False when patching has side effects beyond the file itself, so the
+        /// patch manifest must never skip or replay it.
+        var incremental = true
+        /// True when its patchers read other components' files, so a
+        /// concurrent run holds it back until every other component is saved.
+        var readsOtherComponents = false
     }
 
     // MARK: - Properties
@@ -82,6 +122,29 @@ public final class FirmwarePipeline {
     let noVphoned: Bool
     let loader: any FirmwareLoader
 
+    /// Consult and maintain `<vm>/.cache/fw_patch_manifest.json`: skip
+    /// components already patched for this configuration and replay cached
+    /// records onto unchanged inputs. Set to false to re-run everything.
+    public var incremental = true
+
+    /// Loaded in `patchAll()` when `incremental` is set.
+    private var manifest: PatchManifest?
+
+    /// Manifest key for the current variant, base gates and patcher build.
+    private var manifestConfiguration = ""
+
+    /// Where kernelcache analysis (ADRP/BL index, _panic) is persisted between
+    /// runs, keyed by the kernel payload's SHA-256. Set to nil to always rescan.
+    public var kernelAnalysisCache: KernelAnalysisCache?
+
+    /// When set, every component's load/save, each patcher's findAll/apply
+    /// and the kernel patchers' individual passes are timed into it.
+    public var profiler: PatchProfiler?
+
+    /// Overrides `KernelJBPatcher.discoveryConcurrency` when set. Benchmarks
+    /// pin it to 1 so per-pass timings are not skewed by sibling searches.
+    public var kernelDiscoveryConcurrency: Int?
+
     /// Set when the iPhone base is iOS 18.x (read from iPhone-BuildManifest.plist).
     /// Gates the EXC_GUARD kernel patch, which iOS 18 bases need but 26.x don't.
     /// Computed in `patchAll()` before `buildComponentList()` runs.
@@ -107,16 +170,33 @@ public final class FirmwarePipeline {
         self.verbose = verbose
         self.noBinpack = noBinpack
         self.noVphoned = noVphoned
-        self.loader = loader ?? ContainerFirmwareLoader()
+        self.loader = loader ?? MappedFirmwareLoader()
+        kernelAnalysisCache = KernelAnalysisCache(vmDirectory: vmDirectory)
     }
 
     // MARK: - Pipeline Execution
 
+    /// Width used when callers ask for concurrency without picking one: the
+    /// component count patched at once, and KernelJBPatcher's discovery
+    /// width. Beyond four the kernelcache dominates anyway.
+    public static var defaultConcurrency: Int {
+        min(4, max(1, ProcessInfo.processInfo.activeProcessorCount))
+    }
+
     /// Run the full patching pipeline.
     ///
     /// Returns combined ``PatchRecord`` arrays from every component, in order.
     /// Throws on the first component that fails to patch.
-    public func patchAll() throws -> [PatchRecord] {
+    ///
+    /// With `concurrency > 1`, independent components (each is its own file)
+    /// are loaded, patched and saved on up to that many threads; patchers
+    /// within one component still run in sequence, and components that read
+    /// other components' files (the .less Manifest) run after the rest. Pipeline log lines are
+    /// buffered per component and printed in component order, and the
+    /// returned records keep component order, so output matches a serial
+    /// run. Patchers' own verbose output is suppressed in this mode since it
+    /// would interleave. After a failure no further components are started.
+    public func patchAll(concurrency: Int = 1) throws -> [PatchRecord] {
         let restoreDir = try findRestoreDirectory()
 
         log("[*] VM directory:      \(vmDirectory.path)")
@@ -132,40 +212,249 @@ public final class FirmwarePipeline {
             : iosBaseIs27 ? "  (enabling iOS-27 JB kernel patches)" : ""
         log("[*] iPhone base iOS:   \(baseVersion ?? "unknown")\(baseGateNote)")
 
-        let components = buildComponentList()
-        log("[*] Patching \(components.count) boot-chain components ...")
+        openManifest()
 
-        var allRecords: [PatchRecord] = []
+        let components = buildComponentList()
+        let width = min(max(concurrency, 1), components.count)
+        log("[*] Patching \(components.count) boot-chain components"
+            + (width > 1 ? " (\(width) at a time) ..." : " ..."))
 
-        for component in components {
+        // Resolve every file up front so a missing component fails before
+        // anything has been rewritten.
+        let jobs = try components.map { component in
             let baseDir = component.inRestoreDir ? restoreDir : vmDirectory
             let fileURL = try findFile(in: baseDir, patterns: component.searchPatterns, label: component.name)
+            return (component, fileURL)
+        }
 
-            log("\n\(String(repeating: "=", count: 60))")
-            log("  \(component.name): \(fileURL.path)")
-            log(String(repeating: "=", count: 60))
+        let allRecords = try patchJobs(jobs, width: width).flatMap { $0 }
 
-            // Load
-            let rawData = try loader.load(from: fileURL)
-            log("  format: \(rawData.count) bytes")
+        log("\n\(String(repeating: "=", count: 60))")
+        log("  All \(components.count) components patched successfully! (\(allRecords.count) total patches)")
+        log(String(repeating: "=", count: 60))
 
-            let (currentData, componentRecords) = try patchData(
-                rawData,
+        return allRecords
+    }
+
+    /// Patch resolved components, `width` at a time, returning each one's
+    /// records in `jobs` order.
+    func patchJobs(_ jobs: [(ComponentDescriptor, URL)], width: Int) throws -> [[PatchRecord]] {
+        if width > 1 {
+            return try patchConcurrently(jobs, width: width)
+        }
+        return try jobs.map { component, fileURL in
+            try patchComponent(component, at: fileURL, patcherVerbose: verbose, emit: log)
+        }
+    }
+
+    /// Load the patch manifest (when `incremental`) and key it on the
+    /// variant, base gates and patcher build detected by `patchAll`.
+    func openManifest() {
+        manifest = incremental ? PatchManifest(vmDirectory: vmDirectory) : nil
+        manifestConfiguration = [
+            variant.rawValue,
+            "ios18=\(iosBaseIs18)",
+            "ios27=\(iosBaseIs27)",
+            "binpack=\(!noBinpack)",
+            "vphoned=\(!noVphoned)",
+            PatchManifest.patcherVersion,
+        ].joined(separator: "|")
+    }
+
+    /// Load, patch and save one component. Progress goes to `emit`.
+    ///
+    /// The manifest entry is written before the save with no output digest
+    /// and completed after it. If a run dies in between, the next one finds
+    /// the pending entry and recognises the recorded payload on load instead
+    /// of patching the already-patched file again.
+    func patchComponent(
+        _ component: ComponentDescriptor,
+        at fileURL: URL,
+        patcherVerbose: Bool,
+        emit: (String) -> Void
+    ) throws -> [PatchRecord] {
+        emit("\n\(String(repeating: "=", count: 60))")
+        emit("  \(component.name): \(fileURL.path)")
+        emit(String(repeating: "=", count: 60))
+
+        let manifest = component.incremental ? manifest : nil
+        let inputDigest = try manifest.map { _ in try PatchManifest.digest(ofFileAt: fileURL) }
+        let cached = manifest?.entry(for: component.name).flatMap {
+            $0.configuration == manifestConfiguration ? $0 : nil
+        }
+        if let cached, inputDigest == cached.outputDigest {
+            emit("  [=] already patched for this configuration, skipping (\(cached.records.count) patches)")
+            return cached.records
+        }
+
+        // Load
+        let scope = profiler?.scope(component.name)
+        let rawData = try measure(scope, "load") { try loader.load(from: fileURL) }
+        emit("  format: \(rawData.count) bytes")
+
+        if let manifest, let inputDigest, var cached, cached.outputDigest == nil,
+           PatchManifest.digest(of: rawData) == cached.payloadDigest
+        {
+            emit("  [=] saved by an interrupted run, skipping (\(cached.records.count) patches)")
+            cached.outputDigest = inputDigest
+            do {
+                try manifest.update(cached, for: component.name)
+            } catch {
+                emit("  [!] patch manifest not updated: \(error.localizedDescription)")
+            }
+            return cached.records
+        }
+
+        var replayed: Data?
+        if let cached, inputDigest == cached.inputDigest {
+            let data = applyRecords(cached.records, to: rawData)
+            if PatchManifest.digest(of: data) == cached.payloadDigest {
+                emit("  [+] \(cached.records.count) cached \(component.name) patches re-applied")
+                replayed = data
+            } else {
+                emit("  [!] cached records do not reproduce the patched payload; re-running discovery")
+            }
+        }
+
+        let (currentData, componentRecords) = if let replayed, let cached {
+            (replayed, cached.records)
+        } else {
+            try patchData(
+                consume rawData,
                 componentName: component.name,
-                patcherFactories: component.patcherFactories
+                patcherFactories: component.patcherFactories,
+                patcherVerbose: patcherVerbose,
+                emit: emit
+            )
+        }
+
+        var entry: PatchManifest.Entry?
+        if let manifest, let inputDigest {
+            let pending = PatchManifest.Entry(
+                configuration: manifestConfiguration,
+                inputDigest: inputDigest,
+                payloadDigest: PatchManifest.digest(of: currentData),
+                outputDigest: nil,
+                records: componentRecords
             )
+            // Without it a crash during save would leave a patched file the
+            // manifest knows nothing about.
+            do {
+                try manifest.update(pending, for: component.name)
+                entry = pending
+            } catch {
+                emit("  [!] patch manifest not updated: \(error.localizedDescription)")
+            }
+        }
 
-            try loader.save(currentData, to: fileURL)
-            log("  [+] saved")
+        try measure(scope, "save") { try loader.save(currentData, to: fileURL) }
+        emit("  [+] saved")
 
-            allRecords.append(contentsOf: componentRecords)
+        if let manifest, var entry {
+            entry.outputDigest = try PatchManifest.digest(ofFileAt: fileURL)
+            do {
+                try manifest.update(entry, for: component.name)
+            } catch {
+                emit("  [!] patch manifest not updated: \(error.localizedDescription)")
+            }
         }
+        return componentRecords
+    }
 
-        log("\n\(String(repeating: "=", count: 60))")
-        log("  All \(components.count) components patched successfully! (\(allRecords.count) total patches)")
-        log(String(repeating: "=", count: 60))
+    /// Shared bookkeeping for ``patchConcurrently(_:width:)``.
+    private final class ConcurrentRun: @unchecked Sendable {
+        let lock = NSLock()
+        var next = 0
+        var flushed = 0
+        var failed = false
+        var results: [Result<[PatchRecord], any Error>?]
+        var logs: [[String]]
+
+        init(count: Int) {
+            results = Array(repeating: nil, count: count)
+            logs = Array(repeating: [], count: count)
+        }
+    }
 
-        return allRecords
+    private func patchConcurrently(
+        _ jobs: [(ComponentDescriptor, URL)],
+        width: Int
+    ) throws -> [[PatchRecord]] {
+        let run = ConcurrentRun(count: jobs.count)
+
+        // Components that resolve to the same file (the .less variant patches
+        // BuildManifest.plist twice) share a lane and run in list order.
+        // Components reading other files run serially once all lanes finish.
+        var lanes: [[Int]] = []
+        var laneForPath: [String: Int] = [:]
+        var last: [Int] = []
+        for (index, job) in jobs.enumerated() {
+            if job.0.readsOtherComponents {
+                last.append(index)
+                continue
+            }
+            let path = job.1.standardizedFileURL.path
+            if let lane = laneForPath[path] {
+                lanes[lane].append(index)
+            } else {
+                laneForPath[path] = lanes.count
+                lanes.append([index])
+            }
+        }
+
+        /// Patch one component; true when the run should stop.
+        let patchJob = { (index: Int) -> Bool in
+            var lines: [String] = []
+            let (component, fileURL) = jobs[index]
+            let result = Result {
+                try self.patchComponent(component, at: fileURL, patcherVerbose: false) { lines.append($0) }
+            }
+
+            run.lock.lock()
+            defer { run.lock.unlock() }
+            run.results[index] = result
+            run.logs[index] = lines
+            if case .failure = result { run.failed = true }
+            // Print every finished prefix so output stays in component order.
+            while run.flushed < jobs.count, run.results[run.flushed] != nil {
+                run.logs[run.flushed].forEach(self.log)
+                run.flushed += 1
+            }
+            return run.failed
+        }
+
+        DispatchQueue.concurrentPerform(iterations: min(width, lanes.count)) { _ in
+            while true {
+                run.lock.lock()
+                guard !run.failed, run.next < lanes.count else {
+                    run.lock.unlock()
+                    return
+                }
+                let lane = lanes[run.next]
+                run.next += 1
+                run.lock.unlock()
+
+                for index in lane {
+                    if patchJob(index) { return }
+                }
+            }
+        }
+
+        if !run.failed {
+            for index in last {
+                if patchJob(index) { break }
+            }
+        }
+
+        // After a failure, later components that had already finished are
+        // still worth seeing.
+        for index in run.flushed ..< jobs.count where run.results[index] != nil {
+            run.logs[index].forEach(log)
+        }
+        for case let .failure(error)? in run.results {
+            throw error
+        }
+        return try run.results.map { try $0!.get() }
     }
 
     func patchData(
@@ -173,22 +462,79 @@ public final class FirmwarePipeline {
         componentName: String,
         patcherFactories: [(Data, Bool) -> any Patcher]
     ) throws -> (Data, [PatchRecord]) {
-        var currentData = rawData
+        try patchData(
+            rawData,
+            componentName: componentName,
+            patcherFactories: patcherFactories,
+            patcherVerbose: verbose,
+            emit: log
+        )
+    }
+
+    /// `rawData` is consumed so the loaded payload is not kept alive next to
+    /// the patchers' working copies for the whole chain.
+    private func patchData(
+        _ rawData: consuming Data,
+        componentName: String,
+        patcherFactories: [(Data, Bool) -> any Patcher],
+        patcherVerbose: Bool,
+        emit: (String) -> Void
+    ) throws -> (Data, [PatchRecord]) {
+        var currentData = consume rawData
         var componentRecords: [PatchRecord] = []
+        // Chained kernel patchers (base → JB → EXP) work on one shared
+        // BinaryBuffer and one ADRP/BL index; each hand-off re-decodes only
+        // the words the previous patcher wrote. The first one is seeded from
+        // the on-disk analysis cache instead.
+        var sharedBuffer: BinaryBuffer?
+        var codeIndex: KernelCodeIndex?
+        var analysisKey: String?
+        let scope = profiler?.scope(componentName)
 
         for makePatcher in patcherFactories {
-            let patcher = makePatcher(currentData, verbose)
-            let records = try patcher.findAll()
+            let patcher = makePatcher(currentData, patcherVerbose)
+            let patcherName = String(describing: type(of: patcher))
+            let kernelPatcher = patcher as? KernelPatcherBase
+            if let kernelPatcher {
+                kernelPatcher.profiler = scope?.nested(patcherName)
+                if let sharedBuffer {
+                    kernelPatcher.adopt(buffer: sharedBuffer)
+                }
+                if let codeIndex {
+                    kernelPatcher.codeIndex = codeIndex
+                } else if let cache = kernelAnalysisCache {
+                    let key = KernelAnalysisCache.key(for: currentData)
+                    if let entry = cache.load(key: key), entry.index.byteCount == currentData.count {
+                        kernelPatcher.codeIndex = entry.index
+                        kernelPatcher.panicOffset = entry.panicOffset
+                        emit("  [*] \(componentName): kernel analysis cache hit (\(key.prefix(12)))")
+                    } else {
+                        analysisKey = key
+                    }
+                }
+            }
+            let records = try measure(scope, patcherName) { try patcher.findAll() }
+
+            if let key = analysisKey, let cache = kernelAnalysisCache, let index = kernelPatcher?.codeIndex {
+                analysisKey = nil
+                do {
+                    try cache.store(.init(index: index, panicOffset: kernelPatcher?.panicOffset), key: key)
+                } catch {
+                    emit("  [!] \(componentName): kernel analysis cache not written: \(error.localizedDescription)")
+                }
+            }
 
             guard !records.isEmpty else {
                 throw PatcherError.patchSiteNotFound("\(componentName): no patches found")
             }
 
-            let count = try patcher.apply()
-            log("  [+] \(count) \(componentName) patches applied")
+            let count = try measure(scope, "\(patcherName).apply") { try patcher.apply() }
+            emit("  [+] \(count) \(componentName) patches applied")
 
             componentRecords.append(contentsOf: records)
             currentData = extractPatchedData(from: patcher, fallback: currentData, records: records)
+            codeIndex = kernelPatcher?.codeIndex?.updated(applying: records, to: currentData)
+            sharedBuffer = kernelPatcher?.buffer
         }
 
         return (currentData, componentRecords)
@@ -208,6 +554,9 @@ public final class FirmwarePipeline {
         // JB kernel patches so 18.x/26.x bases apply none of them.
         let applyIOS27 = iosBaseIs27
 
+        // Same capture-by-value; nil keeps the JB patcher's own default.
+        let discoveryConcurrency = kernelDiscoveryConcurrency
+
         // iOS 18 bases: disable the skywalk flowswitch netagents via boot-arg so
         // Network.framework uses the BSD path (the 26.1-kernel skywalk
         // channel-create traps in the 18.x Network.framework and crash-loops
@@ -329,6 +678,7 @@ public final class FirmwarePipeline {
                         { data, verbose in
                             let p = KernelJBPatcher(data: data, verbose: verbose)
                             p.applyIOS27 = applyIOS27
+                            if let discoveryConcurrency { p.discoveryConcurrency = discoveryConcurrency }
                             return p
                         },
                     ]
@@ -340,6 +690,7 @@ public final class FirmwarePipeline {
                         { data, verbose in
                             let p = KernelJBPatcher(data: data, verbose: verbose)
                             p.applyIOS27 = applyIOS27
+                            if let discoveryConcurrency { p.discoveryConcurrency = discoveryConcurrency }
                             return p
                         },
                         { data, verbose in
@@ -381,7 +732,9 @@ public final class FirmwarePipeline {
                 case .regular, .dev, .jb, .exp:
                     []
                 }
-            }()
+            }(),
+            // Also assembles the cryptex contents, not just the manifest.
+            incremental: false
         ))
 
         // 9. Firmware Manifest - Only required when excluding the img4 signature patches.
@@ -398,7 +751,11 @@ public final class FirmwarePipeline {
                 case .regular, .dev, .jb, .exp:
                     []
                 }
-            }()
+            }(),
+            // Hashes the other components' patched files, which the
+            // manifest key does not cover.
+            incremental: false,
+            readsOtherComponents: true
         ))
 
         return components
@@ -535,7 +892,12 @@ public final class FirmwarePipeline {
         if let mh = patcher as? ManifestHashPatcher { return mh.patchedData }
 
         // Fallback: apply records manually to a copy of the original data.
-        var data = fallback
+        return applyRecords(records, to: fallback)
+    }
+
+    /// Apply `records` in order to a copy of `data`.
+    func applyRecords(_ records: [PatchRecord], to data: Data) -> Data {
+        var data = data
         for record in records {
             let range = record.fileOffset ..< record.fileOffset + record.patchedBytes.count
             data.replaceSubrange(range, with: record.patchedBytes)
@@ -543,6 +905,12 @@ public final class FirmwarePipeline {
         return data
     }
 
+    /// Run `body` as `step` under `scope` when profiling.
+    private func measure<T>(_ scope: PatchProfiler.Scope?, _ step: String, _ body: () throws -> T) rethrows -> T {
+        guard let scope else { return try body() }
+        return try scope.measure(step, body)
+    }
+
     // MARK: - Logging
 
     func log(_ message: String) {
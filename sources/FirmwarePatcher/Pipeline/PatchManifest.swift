@@ -0,0 +1,89 @@
+// PatchManifest.swift — Per-component record of what the last fw_patch run did.
+//
+// Stored at <vm>/.cache/fw_patch_manifest.json and rewritten around every
+// component's save, so an interrupted run leaves an accurate record behind. For each
+// component it keeps the on-disk digest before and after patching, the digest
+// of the patched payload, the run configuration and the emitted records.
+// FirmwarePipeline uses it to
+//   - skip a component whose file already matches the recorded output, and
+//   - replay the recorded PatchRecords onto an unchanged input instead of
+//     running discovery again.
+
+import CryptoKit
+import Foundation
+
+/// Persistent incremental-patch manifest for one VM directory.
+final class PatchManifest: @unchecked Sendable {
+    struct Entry: Codable {
+        /// Variant, base-version gates and patcher version; see `configuration`.
+        var configuration: String
+        /// SHA-256 of the file before it was patched.
+        var inputDigest: String
+        /// SHA-256 of the patched payload handed to the loader's `save`.
+        var payloadDigest: String
+        /// SHA-256 of the file after it was saved; nil while the save is in
+        /// progress.
+        var outputDigest: String?
+        var records: [PatchRecord]
+    }
+
+    private struct Contents: Codable {
+        var version = PatchManifest.version
+        var components: [String: Entry] = [:]
+    }
+
+    static let version = 1
+
+    let url: URL
+    private let lock = NSLock()
+    private var contents: Contents
+
+    init(vmDirectory: URL) {
+        url = vmDirectory.appendingPathComponent(".cache/fw_patch_manifest.json")
+        if let data = try? Data(contentsOf: url),
+           let decoded = try? JSONDecoder().decode(Contents.self, from: data),
+           decoded.version == Self.version
+        {
+            contents = decoded
+        } else {
+            contents = Contents()
+        }
+    }
+
+    func entry(for component: String) -> Entry? {
+        lock.withLock { contents.components[component] }
+    }
+
+    /// Record `entry` and rewrite the manifest file. The write stays under
+    /// the lock so concurrent components land on disk in update order and a
+    /// stale snapshot never replaces a newer one.
+    func update(_ entry: Entry, for component: String) throws {
+        try lock.withLock {
+            contents.components[component] = entry
+            let encoder = JSONEncoder()
+            encoder.outputFormatting = [.sortedKeys]
+            let data = try encoder.encode(contents)
+            try FileManager.default.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true)
+            try data.write(to: url, options: .atomic)
+        }
+    }
+
+    // MARK: - Digests
+
+    static func digest(of data: Data) -> String {
+        Data(SHA256.hash(data: data)).hexString
+    }
+
+    static func digest(ofFileAt url: URL) throws -> String {
+        try digest(of: Data(contentsOf: url, options: .alwaysMapped))
+    }
+
+    /// Digest of the running executable, so rebuilding the patcher with
+    /// different patch logic invalidates every entry.
+    static let patcherVersion: String = {
+        guard let exe = Bundle.main.executableURL,
+              let digest = try? digest(ofFileAt: exe)
+        else { return "unknown-\(UUID().uuidString)" }
+        return digest
+    }()
+}
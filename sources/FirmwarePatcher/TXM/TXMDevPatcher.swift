@@ -76,10 +76,7 @@ public final class TXMDevPatcher: TXMPatcher {
     private func findStringRefs(_ needle: Data) -> [(stringOff: Int, adrpOff: Int, addOff: Int)] {
         var results: [(Int, Int, Int)] = []
         var seen = Set<Int>()
-        var search = 0
-        while let range = buffer.data.range(of: needle, in: search ..< buffer.count) {
-            let sOff = range.lowerBound
-            search = sOff + 1
+        for sOff in buffer.findAll(needle) {
             for (adrpOff, addOff) in findRefsToOffset(sOff) {
                 if !seen.contains(adrpOff) {
                     seen.insert(adrpOff)
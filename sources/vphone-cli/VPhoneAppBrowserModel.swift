@@ -5,7 +5,6 @@ import Foundation
 class VPhoneAppBrowserModel {
     let control: VPhoneControl
 
-    var apps: [VPhoneControl.AppInfo] = []
     var filter: AppFilter = .installed
     var searchText = ""
     var isLoading = false
@@ -18,27 +17,75 @@ class VPhoneAppBrowserModel {
         case system
     }
 
+    /// Guest inventory by bundle ID, kept current by deltas and pushes.
+    private var inventory: [String: VPhoneControl.AppInfo] = [:]
+    private var generation: UInt64 = 0
+    private var session: UInt32?
+
+    var apps: [VPhoneControl.AppInfo] {
+        inventory.values.sorted {
+            $0.name.localizedCaseInsensitiveCompare($1.name) == .orderedAscending
+        }
+    }
+
     var filteredApps: [VPhoneControl.AppInfo] {
-        guard !searchText.isEmpty else { return apps }
         let query = searchText.lowercased()
-        return apps.filter {
-            $0.name.lowercased().contains(query)
-                || $0.bundleId.lowercased().contains(query)
+        return apps.filter { app in
+            switch filter {
+            case .installed: break
+            case .running: if app.pid <= 0 { return false }
+            case .user: if app.type == "system" { return false }
+            case .system: if app.type != "system" { return false }
+            }
+            return query.isEmpty
+                || app.name.lowercased().contains(query)
+                || app.bundleId.lowercased().contains(query)
         }
     }
 
     init(control: VPhoneControl) {
         self.control = control
+        control.onAppsChanged = { [weak self] inventory in
+            guard let self else { return }
+            // A push that starts past our generation means we missed one.
+            if inventory.since > generation || inventory.session != session {
+                Task { await self.refresh() }
+            } else {
+                apply(inventory)
+            }
+        }
     }
 
     func refresh() async {
         isLoading = true
         defer { isLoading = false }
         do {
-            apps = try await control.appList(filter: filter.rawValue)
+            let since = session.map { (generation: generation, session: $0) }
+            apply(try await control.appInventory(since: since))
+            // Idempotent on the guest; re-subscribes after a reconnect.
+            if control.supportsAppWatch {
+                try await control.watchApps(true)
+            }
             error = nil
         } catch {
             self.error = "\(error)"
         }
     }
+
+    private func apply(_ update: VPhoneControl.AppInventory) {
+        if update.isDelta {
+            // Pushes can race a refresh; ignore anything we already have.
+            guard update.session == session, update.generation > generation else { return }
+        } else {
+            inventory.removeAll()
+        }
+        for app in update.apps {
+            inventory[app.bundleId] = app
+        }
+        for bundleId in update.removed {
+            inventory.removeValue(forKey: bundleId)
+        }
+        generation = update.generation
+        session = update.generation > 0 ? update.session : nil
+    }
 }
@@ -67,9 +67,6 @@ struct VPhoneAppBrowserView: View {
         }
         .padding(.horizontal, 12)
         .padding(.vertical, 8)
-        .onChange(of: model.filter) {
-            Task { await model.refresh() }
-        }
     }
 
     // MARK: - Table
@@ -6,7 +6,7 @@ struct VPhoneCLI: ParsableCommand {
     static let configuration = CommandConfiguration(
         commandName: "vphone-cli",
         abstract: "Boot a virtual iPhone or patch firmware with the Swift pipeline",
-        subcommands: [VPhoneBootCLI.self, PatchFirmwareCLI.self, PatchComponentCLI.self],
+        subcommands: [VPhoneBootCLI.self, PatchFirmwareCLI.self, PatchComponentCLI.self, BenchFirmwareCLI.self],
         defaultSubcommand: VPhoneBootCLI.self
     )
 }
@@ -173,6 +173,15 @@ struct PatchFirmwareCLI: ParsableCommand {
     @Flag(name: .customLong("no-vphoned"), help: "Exclude vphoned from being installed (patchless-only).")
     var noVphoned: Bool = false
 
+    @Option(
+        name: .customLong("jobs"),
+        help: "Patch up to N independent components concurrently (0 = one per core up to 4; a positive N is used as given)."
+    )
+    var jobs: Int = 1
+
+    @Flag(name: .customLong("force"), help: "Ignore the incremental patch manifest and re-run every component.")
+    var force: Bool = false
+
     mutating func run() throws {
         let pipeline = FirmwarePipeline(
             vmDirectory: vmDirectory,
@@ -181,7 +190,10 @@ struct PatchFirmwareCLI: ParsableCommand {
             noBinpack: noBinpack,
             noVphoned: noVphoned
         )
-        let records = try pipeline.patchAll()
+        pipeline.incremental = !force
+        let records = try pipeline.patchAll(
+            concurrency: jobs > 0 ? jobs : FirmwarePipeline.defaultConcurrency
+        )
 
         if let recordsOut {
             let url = URL(fileURLWithPath: recordsOut)
@@ -298,3 +310,125 @@ struct PatchComponentCLI: ParsableCommand {
         }
     }
 }
+
+struct BenchFirmwareCLI: ParsableCommand {
+    static let configuration = CommandConfiguration(
+        commandName: "bench-firmware",
+        abstract: "Time the patch pipeline against a prepared VM directory without writing it",
+        discussion: """
+        Replays patch-firmware over the VM directory's *Restore* firmware. Patched
+        payloads are discarded, and neither the patch manifest nor the kernel
+        analysis cache is consulted unless --warm-analysis-cache is given, so every
+        iteration does the full work. Kernel JB discovery searches run serially so
+        each pass's timings are its own.
+
+        Reports wall time, net heap blocks/bytes and peak RSS growth for each
+        component's load/save, each patcher, and each kernel patch method, as JSON
+        with a stable layout for regression diffs.
+        """
+    )
+
+    /// Loads like the pipeline's default loader but never writes back.
+    struct ReplayLoader: FirmwarePipeline.FirmwareLoader {
+        let base = FirmwarePipeline.MappedFirmwareLoader()
+
+        func load(from url: URL) throws -> Data {
+            try base.load(from: url)
+        }
+
+        func save(_: Data, to _: URL) throws {}
+    }
+
+    @Option(
+        name: [.customLong("vm-directory"), .customShort("d")],
+        help: "Path to the VM directory that contains the *Restore* folder.",
+        transform: URL.init(fileURLWithPath:)
+    )
+    var vmDirectory: URL
+
+    @Option(help: "Firmware variant to benchmark (less is not supported: it assembles cryptexes).")
+    var variant: PatchFirmwareCLI.VariantOption = .jb
+
+    @Option(help: "Measured iterations.")
+    var iterations: Int = 5
+
+    @Option(help: "Unmeasured iterations run first.")
+    var warmup: Int = 1
+
+    @Flag(name: .customLong("warm-analysis-cache"), help: "Use <vm>/.cache/kernel_analysis like a repeat patch-firmware run.")
+    var warmAnalysisCache: Bool = false
+
+    @Option(
+        name: .customLong("output"),
+        help: "Write the JSON report here instead of stdout."
+    )
+    var output: String?
+
+    mutating func validate() throws {
+        guard variant != .less else {
+            throw ValidationError("`--variant less` patches the filesystem and cannot be replayed")
+        }
+        guard iterations > 0, warmup >= 0 else {
+            throw ValidationError("`--iterations` must be positive and `--warmup` non-negative")
+        }
+    }
+
+    mutating func run() throws {
+        var runs: [[PatchProfiler.Sample]] = []
+        var patchCount = 0
+
+        for iteration in 0 ..< warmup + iterations {
+            let pipeline = FirmwarePipeline(
+                vmDirectory: vmDirectory,
+                variant: variant.pipelineVariant,
+                verbose: false,
+                loader: ReplayLoader()
+            )
+            pipeline.incremental = false
+            pipeline.kernelDiscoveryConcurrency = 1
+            if !warmAnalysisCache {
+                pipeline.kernelAnalysisCache = nil
+            }
+            let profiler = PatchProfiler()
+            pipeline.profiler = profiler
+
+            let records = try profiler.measure(scope: "pipeline", "patchAll") {
+                try pipeline.patchAll()
+            }
+            let measured = iteration >= warmup
+            if measured {
+                runs.append(profiler.samples)
+                patchCount = records.count
+            }
+            let total = profiler.samples.last?.wallSeconds ?? 0
+            FileHandle.standardError.write(Data(
+                "[bench-firmware] \(measured ? "run" : "warmup") \(iteration + 1): \(records.count) patches in \(String(format: "%.3f", total))s\n".utf8
+            ))
+        }
+
+        let os = ProcessInfo.processInfo.operatingSystemVersion
+        let report = PatchProfiler.Report(runs: runs, metadata: [
+            "variant": variant.rawValue,
+            "iterations": String(iterations),
+            "warmup": String(warmup),
+            "warmAnalysisCache": String(warmAnalysisCache),
+            "discoveryConcurrency": "1",
+            "patches": String(patchCount),
+            "cpus": String(ProcessInfo.processInfo.activeProcessorCount),
+            "memory": String(ProcessInfo.processInfo.physicalMemory),
+            "os": "\(os.majorVersion).\(os.minorVersion).\(os.patchVersion)",
+        ])
+
+        let encoder = JSONEncoder()
+        encoder.outputFormatting = [.prettyPrinted, .sortedKeys]
+        let json = try encoder.encode(report)
+        if let output {
+            let url = URL(fileURLWithPath: output)
+            try json.write(to: url)
+            FileHandle.standardError.write(Data("[bench-firmware] wrote \(report.entries.count) entries to \(url.path)\n".utf8))
+        } else {
+            FileHandle.standardOutput.write(json)
+            FileHandle.standardOutput.write(Data("\n".utf8))
+        }
+    }
+}
@@ -1,3 +1,4 @@
+import Accelerate
 import CoreGraphics
 import Foundation
 import Virtualization
@@ -15,9 +16,12 @@ import Virtualization
 ///   bytes      header JSON (UTF-8), keys: w, h, bpr, fmt, ts
 ///   bytes      raw pixel data, exactly `bpr * h` bytes
 ///
-/// The header carries the format so the receiver doesn't have to
-/// assume; for now the producer fixes width/height/bpr/fmt at
-/// 1280x720 BGRA. Future producers may emit different formats.
+/// Newer guests write a caps record (`vphoned_vcam_caps_t`) right after
+/// accept. When it arrives the server switches to a fixed 32-byte binary
+/// header (`vphoned_vcam_wire_header_t`) and, if the guest accepts it,
+/// converts frames to NV12 (420v, 1.5 bytes/pixel instead of 4). Header
+/// and pixels go out in one `writev`, so nothing is concatenated per
+/// frame. Guests that never send caps keep the JSON/BGRA format above.
 @MainActor
 final class VPhoneCameraServer {
     enum SourceKind: String {
@@ -31,9 +35,32 @@ final class VPhoneCameraServer {
     nonisolated static let defaultHeight: Int = 720
     nonisolated static let defaultFPS: Double = 30.0
     nonisolated static let pixelFormat: UInt32 = 0x4247_5241  // 'BGRA' — kCMPixelFormat_32BGRA
+    nonisolated static let pixelFormatNV12: UInt32 = 0x3432_3076  // '420v' — 420YpCbCr8BiPlanarVideoRange
+
+    nonisolated static let capsMagic: UInt32 = 0x5041_4356  // 'VCAP'
+    nonisolated static let frameMagic: UInt32 = 0x3146_4356  // 'VCF1'
+    nonisolated static let capsSize = 12
+    nonisolated static let wireHeaderSize = 32
+    nonisolated static let capBGRA: UInt32 = 1 << 0
+    nonisolated static let capNV12: UInt32 = 1 << 1
+    nonisolated static let capsTimeoutMS: Int32 = 500
+
+    /// How frames are framed and encoded on the current connection.
+    enum Transport: Sendable, Equatable {
+        case legacyJSON
+        case binary(pixelFormat: UInt32)
+
+        var description: String {
+            switch self {
+            case .legacyJSON: "json/bgra"
+            case let .binary(fmt): fmt == VPhoneCameraServer.pixelFormatNV12 ? "binary/nv12" : "binary/bgra"
+            }
+        }
+    }
 
     private(set) var sourceKind: SourceKind = .off
     private(set) var isConnected = false
+    private(set) var transport: Transport = .legacyJSON
 
     private var device: VZVirtioSocketDevice?
     private var connection: VZVirtioSocketConnection?
@@ -46,6 +73,8 @@ final class VPhoneCameraServer {
         label: "com.vphone.camera.send", qos: .userInteractive)
     private let producerQueue = DispatchQueue(
         label: "com.vphone.camera.producer", qos: .userInteractive)
+    /// Conversion scratch; only touched on `producerQueue`.
+    private let encoder = VPhoneCameraWireEncoder()
 
     var onConnectionStateChange: ((Bool) -> Void)?
 
@@ -125,10 +154,12 @@ final class VPhoneCameraServer {
             guard let producer = self.producer else { return }
             let fd = self.connectionFD
             guard fd >= 0 else { return }
+            let transport = self.transport
+            let encoder = self.encoder
             let q = self.producerQueue
             q.async {
                 guard let frame = producer.nextFrame() else { return }
-                let ok = Self.send(fd: fd, frame: frame)
+                let ok = Self.send(fd: fd, frame: frame, transport: transport, encoder: encoder)
                 if !ok {
                     Task { @MainActor [weak self] in
                         guard let self else { return }
@@ -186,10 +217,7 @@ final class VPhoneCameraServer {
                 case let .success(conn):
                     self.connection = conn
                     self.connectionFD = conn.fileDescriptor
-                    self.isConnected = true
-                    print("[camera] connected on vsock port \(Self.vsockPort)")
-                    self.onConnectionStateChange?(true)
-                    if self.sourceKind != .off { self.startStreaming() }
+                    self.negotiateTransport(fd: conn.fileDescriptor, attemptToken: attemptToken)
                 case let .failure(error):
                     print("[camera] connect failed: \(error). Retrying in 3s.")
                     DispatchQueue.main.asyncAfter(deadline: .now() + 3.0) { [weak self] in
@@ -204,11 +232,92 @@ final class VPhoneCameraServer {
         }
     }
 
+    /// Waits briefly for the guest's caps record off the main thread, then
+    /// picks a transport and reports the connection as up.
+    private func negotiateTransport(fd: Int32, attemptToken: UInt64) {
+        producerQueue.async {
+            let formats = Self.readCaps(fd: fd)
+            Task { @MainActor [weak self] in
+                guard let self else { return }
+                guard self.connectionAttemptToken == attemptToken, self.connectionFD == fd else { return }
+                self.transport = Self.transport(forCaps: formats)
+                self.isConnected = true
+                print("[camera] connected on vsock port \(Self.vsockPort) (\(self.transport.description))")
+                self.onConnectionStateChange?(true)
+                if self.sourceKind != .off { self.startStreaming() }
+            }
+        }
+    }
+
+    nonisolated static func transport(forCaps formats: UInt32?) -> Transport {
+        guard let formats else { return .legacyJSON }
+        if formats & capNV12 != 0 { return .binary(pixelFormat: pixelFormatNV12) }
+        return .binary(pixelFormat: pixelFormat)
+    }
+
+    /// Returns the guest's advertised format mask, or nil for a guest that
+    /// predates negotiation (nothing arrives within `capsTimeoutMS`).
+    nonisolated private static func readCaps(fd: Int32) -> UInt32? {
+        var buf = [UInt8](repeating: 0, count: capsSize)
+        var got = 0
+        while got < capsSize {
+            var pfd = pollfd(fd: fd, events: Int16(POLLIN), revents: 0)
+            let ready = poll(&pfd, 1, capsTimeoutMS)
+            if ready < 0, errno == EINTR { continue }
+            guard ready > 0 else { return nil }
+            let n = buf.withUnsafeMutableBytes { read(fd, $0.baseAddress! + got, capsSize - got) }
+            if n < 0, errno == EINTR { continue }
+            guard n > 0 else { return nil }
+            got += n
+        }
+        return buf.withUnsafeBytes { raw -> UInt32? in
+            guard UInt32(littleEndian: raw.loadUnaligned(fromByteOffset: 0, as: UInt32.self)) == capsMagic
+            else { return nil }
+            return UInt32(littleEndian: raw.loadUnaligned(fromByteOffset: 8, as: UInt32.self))
+        }
+    }
+
     // MARK: - Wire
 
     @discardableResult
-    nonisolated private static func send(fd: Int32, frame: VPhoneCameraFrame) -> Bool {
-        // header
+    nonisolated private static func send(
+        fd: Int32, frame: VPhoneCameraFrame, transport: Transport, encoder: VPhoneCameraWireEncoder
+    ) -> Bool {
+        switch transport {
+        case .legacyJSON:
+            return sendJSON(fd: fd, frame: frame)
+        case let .binary(fmt) where fmt == pixelFormatNV12:
+            return encoder.withNV12(of: frame) { pixels, bytesPerRow in
+                sendBinary(fd: fd, frame: frame, pixelFormat: fmt, bytesPerRow: bytesPerRow, pixels: pixels)
+            }
+        case let .binary(fmt):
+            return frame.withPixels { pixels in
+                sendBinary(
+                    fd: fd, frame: frame, pixelFormat: fmt, bytesPerRow: frame.bytesPerRow, pixels: pixels)
+            }
+        }
+    }
+
+    nonisolated private static func sendBinary(
+        fd: Int32, frame: VPhoneCameraFrame, pixelFormat: UInt32, bytesPerRow: Int,
+        pixels: UnsafeRawBufferPointer
+    ) -> Bool {
+        // An unmapped buffer would fail the guest's length check and drop
+        // the connection; skip the tick instead.
+        guard !pixels.isEmpty else { return true }
+        return withUnsafeTemporaryAllocation(byteCount: wireHeaderSize, alignment: 8) { hdr in
+            hdr.storeBytes(of: frameMagic.littleEndian, toByteOffset: 0, as: UInt32.self)
+            hdr.storeBytes(of: pixelFormat.littleEndian, toByteOffset: 4, as: UInt32.self)
+            hdr.storeBytes(of: UInt32(frame.width).littleEndian, toByteOffset: 8, as: UInt32.self)
+            hdr.storeBytes(of: UInt32(frame.height).littleEndian, toByteOffset: 12, as: UInt32.self)
+            hdr.storeBytes(of: UInt32(bytesPerRow).littleEndian, toByteOffset: 16, as: UInt32.self)
+            hdr.storeBytes(of: UInt32(pixels.count).littleEndian, toByteOffset: 20, as: UInt32.self)
+            hdr.storeBytes(of: frame.timestampNS.littleEndian, toByteOffset: 24, as: UInt64.self)
+            return writeAll(fd: fd, [UnsafeRawBufferPointer(hdr), pixels])
+        }
+    }
+
+    nonisolated private static func sendJSON(fd: Int32, frame: VPhoneCameraFrame) -> Bool {
         let headerDict: [String: Any] = [
             "w": frame.width,
             "h": frame.height,
@@ -219,37 +328,120 @@ final class VPhoneCameraServer {
         guard
             let headerData = try? JSONSerialization.data(withJSONObject: headerDict, options: [])
         else { return false }
-        let totalLen = UInt32(4 + headerData.count + frame.pixels.count)
-        let headerLen = UInt32(headerData.count)
-        var prefix = Data()
-        prefix.append(contentsOf: withUnsafeBytes(of: totalLen.littleEndian) { Array($0) })
-        prefix.append(contentsOf: withUnsafeBytes(of: headerLen.littleEndian) { Array($0) })
-        // Concat all into one buffer to make a single write — short frames
-        // are cheap; large ones (1280*720*4 ≈ 3.5 MB) still fit comfortably
-        // in a vsock send buffer and a single write keeps frame integrity
-        // even if a future reader uses non-buffered I/O.
-        var out = Data(capacity: Int(totalLen) + 4)
-        out.append(prefix)
-        out.append(headerData)
-        out.append(frame.pixels)
-        var ok = true
-        out.withUnsafeBytes { bytes -> Void in
-            guard let base = bytes.baseAddress else { ok = false; return }
-            var remaining = bytes.count
-            var cursor = base
-            while remaining > 0 {
-                let n = write(fd, cursor, remaining)
-                if n < 0 {
-                    if errno == EINTR { continue }
-                    print("[camera] write errno=\(errno)")
-                    ok = false
-                    return
+        return frame.withPixels { pixelBytes in
+            guard !pixelBytes.isEmpty else { return true }
+            let totalLen = UInt32(4 + headerData.count + pixelBytes.count)
+            let headerLen = UInt32(headerData.count)
+            var prefix = (totalLen.littleEndian, headerLen.littleEndian)
+            return withUnsafeBytes(of: &prefix) { prefixBytes in
+                headerData.withUnsafeBytes { headerBytes in
+                    writeAll(fd: fd, [prefixBytes, headerBytes, pixelBytes])
                 }
-                if n == 0 { ok = false; return }
-                remaining -= n
-                cursor = cursor.advanced(by: n)
             }
         }
-        return ok
+    }
+
+    /// `writev` loop that resumes partial writes, so a frame goes out as
+    /// one logical write without first being copied into a single buffer.
+    nonisolated private static func writeAll(fd: Int32, _ parts: [UnsafeRawBufferPointer]) -> Bool {
+        var iov = parts.map { iovec(iov_base: UnsafeMutableRawPointer(mutating: $0.baseAddress), iov_len: $0.count) }
+        var first = 0
+        while first < iov.count {
+            let n = iov.withUnsafeMutableBufferPointer { buf in
+                writev(fd, buf.baseAddress! + first, Int32(buf.count - first))
+            }
+            if n < 0 {
+                if errno == EINTR { continue }
+                print("[camera] write errno=\(errno)")
+                return false
+            }
+            if n == 0 { return false }
+            var advanced = n
+            while first < iov.count, advanced >= iov[first].iov_len {
+                advanced -= iov[first].iov_len
+                first += 1
+            }
+            if first < iov.count, advanced > 0 {
+                iov[first].iov_base = iov[first].iov_base?.advanced(by: advanced)
+                iov[first].iov_len -= advanced
+            }
+        }
+        return true
+    }
+}
+
+// MARK: - NV12 encoder
+
+/// BGRA → NV12 (420v, ITU-R 709 video range) via vImage into a buffer that
+/// is reused across frames. Used only from the camera producer queue.
+final class VPhoneCameraWireEncoder: @unchecked Sendable {
+    private var buffer: UnsafeMutableRawPointer?
+    private var capacity = 0
+    private var conversion: vImage_ARGBToYpCbCr?
+
+    /// Converts `frame` and hands the NV12 bytes (Y plane, then CbCr plane,
+    /// same stride) to `body`. Returns false if the conversion fails.
+    func withNV12(
+        of frame: VPhoneCameraFrame, _ body: (UnsafeRawBufferPointer, Int) -> Bool
+    ) -> Bool {
+        guard var info = conversionInfo() else { return false }
+        let stride = (frame.width + 15) & ~15
+        let chromaRows = (frame.height + 1) / 2
+        let length = stride * (frame.height + chromaRows)
+        guard let dst = reserve(length) else { return false }
+
+        let err = frame.withPixels { src -> vImage_Error in
+            var srcBuf = vImage_Buffer(
+                data: UnsafeMutableRawPointer(mutating: src.baseAddress),
+                height: vImagePixelCount(frame.height), width: vImagePixelCount(frame.width),
+                rowBytes: frame.bytesPerRow)
+            var yBuf = vImage_Buffer(
+                data: dst,
+                height: vImagePixelCount(frame.height), width: vImagePixelCount(frame.width),
+                rowBytes: stride)
+            var cbcrBuf = vImage_Buffer(
+                data: dst + stride * frame.height,
+                height: vImagePixelCount(chromaRows), width: vImagePixelCount((frame.width + 1) / 2),
+                rowBytes: stride)
+            // BGRA in memory → vImage's ARGB channel order.
+            let permute: [UInt8] = [3, 2, 1, 0]
+            return vImageConvert_ARGB8888To420Yp8_CbCr8(
+                &srcBuf, &yBuf, &cbcrBuf, &info, permute, vImage_Flags(kvImageNoFlags))
+        }
+        guard err == kvImageNoError else {
+            print("[camera] NV12 conversion failed: \(err)")
+            return false
+        }
+        return body(UnsafeRawBufferPointer(start: dst, count: length), stride)
+    }
+
+    private func reserve(_ length: Int) -> UnsafeMutableRawPointer? {
+        if capacity < length {
+            buffer?.deallocate()
+            buffer = UnsafeMutableRawPointer.allocate(byteCount: length, alignment: 64)
+            capacity = length
+        }
+        return buffer
+    }
+
+    private func conversionInfo() -> vImage_ARGBToYpCbCr? {
+        if let conversion { return conversion }
+        var info = vImage_ARGBToYpCbCr()
+        var range = vImage_YpCbCrPixelRange(
+            Yp_bias: 16, CbCr_bias: 128, YpRangeMax: 235, CbCrRangeMax: 240,
+            YpMax: 235, YpMin: 16, CbCrMax: 240, CbCrMin: 16)
+        let err = vImageConvert_ARGBToYpCbCr_GenerateConversion(
+            kvImage_ARGBToYpCbCrMatrix_ITU_R_709_2, &range, &info,
+            kvImageARGB8888, kvImage420Yp8_CbCr8, vImage_Flags(kvImageNoFlags))
+        guard err == kvImageNoError else {
+            print("[camera] vImage conversion setup failed: \(err)")
+            return nil
+        }
+        conversion = info
+        return info
+    }
+
+    deinit {
+        buffer?.deallocate()
     }
 }
@@ -1,5 +1,6 @@
 import CryptoKit
 import Foundation
+import os
 import Virtualization
 
 /// Host-side client for the vphoned guest agent.
@@ -12,15 +13,27 @@ import Virtualization
 /// Auto-update: if `guestBinaryURL` is set, the hello message includes
 /// its SHA-256 hash. When the guest replies with `need_update`, we push
 /// the binary as a raw transfer (`{"t":"update","size":N}` + N bytes).
+///
+/// Binary fast path: the hello offers `"bin"`; if the guest echoes it,
+/// touch/HID/location events go out as fixed-layout binary frames (length
+/// word with the high bit set) instead of JSON. See vphoned_protocol.h.
 @MainActor
 class VPhoneControl {
     private static let protocolVersion = 1
+    private static let binaryProtocolVersion = 1
     private static let vsockPort: UInt32 = 1337
     private static let reconnectDelay: TimeInterval = 3
     private static let handshakeTimeout: TimeInterval = 8
     private static let defaultRequestTimeout: TimeInterval = 10
     private static let slowRequestTimeout: TimeInterval = 30
     private static let transferRequestTimeout: TimeInterval = 180
+    private static let fileChunkSize = 1 << 20
+    private static let fileTransferWindow = 4
+    private static let fileChunkRetries = 3
+    /// Suffix for partially transferred files, on both host and guest.
+    static let partialFileExtension = "vphonepart"
+    /// Next to a part file: the size and mtime of the file it is a prefix of.
+    static let partialSourceExtension = "source"
 
     private var connection: VZVirtioSocketConnection?
     private weak var device: VZVirtioSocketDevice?
@@ -28,8 +41,13 @@ class VPhoneControl {
     private(set) var guestName = ""
     private(set) var guestCaps: [String] = []
     private(set) var guestIP: String?
+    /// Guest-side touch moves are coalesced to one per refresh of the screen
+    /// showing the VM; the VM view sets this on each touch down.
+    var touchMoveInterval: TimeInterval = 1.0 / 60
     /// Guest userland iOS version reported at handshake (e.g. "18.6.2"), if known.
     private(set) var guestIOSVersion: String?
+    /// Whether the guest accepted binary fast-path frames at handshake.
+    private(set) var binaryFraming = false
 
     /// Whether touches should be injected guest-side via vphoned rather than the
     /// VZ USB touchscreen. True for iOS 18 bases: on the 26.x kernel their USB
@@ -45,16 +63,31 @@ class VPhoneControl {
     var guestBinaryURL: URL?
 
     /// Called when guest is ready (not updating). Receives guest capabilities.
+    /// Called again with the full list if the guest answered hello before
+    /// all its subsystems had loaded.
     var onConnect: (([String]) -> Void)?
 
     /// Called when the guest disconnects (before reconnect attempt).
     var onDisconnect: (() -> Void)?
 
+    /// Called on main with each `app_changed` delta after `watchApps(true)`.
+    var onAppsChanged: ((AppInventory) -> Void)?
+
     private var guestBinaryData: Data?
     private var guestBinaryHash: String?
+    /// Size and mtime `guestBinaryData` was read at; reconnects skip the
+    /// re-read and re-hash while it matches.
+    private var guestBinaryStamp: (size: Int, mtime: Date)?
+    /// LZFSE form of `guestBinaryData`, built on the first compressed push.
+    private var guestBinaryCompressed: Data?
     private var nextRequestId: UInt64 = 0
     private var connectionAttemptToken: UInt64 = 0
     private var reconnectWorkItem: DispatchWorkItem?
+    private var pendingTouchMove: (x: Double, y: Double)?
+    private var lastTouchMoveSent = DispatchTime(uptimeNanoseconds: 0)
+    /// Serial queue for the socket reader, response dispatch and request timeouts.
+    private let ioQueue = DispatchQueue(label: "vphone.control.io", qos: .userInitiated)
+    private var reader: ControlFrameReader?
     public var variant: VPhoneVirtualMachine.Variant = .regular
 
     init(variant: VPhoneVirtualMachine.Variant) {
@@ -63,35 +96,85 @@ class VPhoneControl {
     
     // MARK: - Pending Requests
 
-    /// Callback for a pending request. Called on the read-loop queue.
+    /// Callback for a pending request. Called on `ioQueue` for responses and
+    /// timeouts, or on main when the connection drops, so handlers must not
+    /// assume main-actor isolation.
     private struct PendingRequest: @unchecked Sendable {
-        let handler: (Result<([String: Any], Data?), any Error>) -> Void
+        let type: String
+        let start: UInt64
+        let signpost: OSSignpostIntervalState
+        let stats: VPhoneControlStats
+        let handler: @Sendable (Result<([String: Any], Data?), any Error>) -> Void
+        /// Bytes gathered from `payload` frames and their size on the wire.
+        var framedPayload = Data()
+        var framedBytes = 0
+
+        /// Record the round trip and deliver `result`. `bytesIn` is the size
+        /// of the response frame and its payload on the wire.
+        func finish(_ result: Result<([String: Any], Data?), any Error>, bytesIn: Int = 0) {
+            VPhoneControlStats.signposter.endInterval("request", signpost)
+            var failed = false
+            var timedOut = false
+            if case let .failure(error) = result {
+                failed = true
+                if case .requestTimedOut? = error as? ControlError { timedOut = true }
+            }
+            stats.recordCompletion(
+                type: type, roundTripNanos: DispatchTime.now().uptimeNanoseconds - start,
+                bytesIn: bytesIn, failed: failed, timedOut: timedOut
+            )
+            handler(result)
+        }
     }
 
+    /// Host-side per-command counters; see ``VPhoneControlStats``.
+    nonisolated let stats = VPhoneControlStats()
+
     private let pendingLock = NSLock()
     private nonisolated(unsafe) var pendingRequests: [String: PendingRequest] = [:]
 
     private nonisolated func addPending(
-        id: String, handler: @escaping (Result<([String: Any], Data?), any Error>) -> Void
+        id: String, type: String,
+        handler: @escaping @Sendable (Result<([String: Any], Data?), any Error>) -> Void
     ) {
+        let signposter = VPhoneControlStats.signposter
+        let signpost = signposter.beginInterval("request", id: signposter.makeSignpostID(), "\(type, privacy: .public)")
+        let request = PendingRequest(
+            type: type, start: DispatchTime.now().uptimeNanoseconds, signpost: signpost, stats: stats, handler: handler
+        )
         pendingLock.lock()
-        pendingRequests[id] = PendingRequest(handler: handler)
+        pendingRequests[id] = request
         pendingLock.unlock()
     }
 
+    /// Append a `payload` frame to its request, if it is still pending.
+    private nonisolated func appendPayload(id: String, _ payload: Data, bytes: Int) {
+        pendingLock.lock()
+        defer { pendingLock.unlock() }
+        pendingRequests[id]?.framedPayload.append(payload)
+        pendingRequests[id]?.framedBytes += bytes
+    }
+
     private nonisolated func removePending(id: String) -> PendingRequest? {
         pendingLock.lock()
         defer { pendingLock.unlock() }
         return pendingRequests.removeValue(forKey: id)
     }
 
+    /// Fail request `id` if it is still pending. Responses, timeouts, write
+    /// failures and disconnects all claim a request through `removePending`,
+    /// so whichever gets there first is the only one that completes it.
+    private nonisolated func failPending(id: String, with error: ControlError) {
+        removePending(id: id)?.finish(.failure(error))
+    }
+
     private nonisolated func failAllPending(with error: ControlError = .notConnected) {
         pendingLock.lock()
         let pending = pendingRequests
         pendingRequests.removeAll()
         pendingLock.unlock()
         for (_, req) in pending {
-            req.handler(.failure(error))
+            req.finish(.failure(error))
         }
     }
 
@@ -140,6 +223,17 @@ class VPhoneControl {
     // MARK: - Guest Binary Hash
 
     private func loadGuestBinary() {
+        let attrs = guestBinaryURL.flatMap { try? FileManager.default.attributesOfItem(atPath: $0.path) }
+        let size = (attrs?[.size] as? NSNumber)?.intValue
+        let mtime = attrs?[.modificationDate] as? Date
+        if let size, let mtime, let stamp = guestBinaryStamp,
+           stamp.size == size, stamp.mtime == mtime, guestBinaryData != nil
+        {
+            return
+        }
+
+        guestBinaryStamp = nil
+        guestBinaryCompressed = nil
         guard let url = guestBinaryURL,
               let data = try? Data(contentsOf: url)
         else {
@@ -147,8 +241,9 @@ class VPhoneControl {
             guestBinaryHash = nil
             return
         }
+        if let size, let mtime { guestBinaryStamp = (size, mtime) }
         guestBinaryData = data
-        guestBinaryHash = SHA256.hash(data: data).map { String(format: "%02x", $0) }.joined()
+        guestBinaryHash = Self.sha256Hex(data)
         print(
             "[control] vphoned binary: \(url.lastPathComponent) (\(data.count) bytes, \(guestBinaryHash!.prefix(12))...)"
         )
@@ -191,6 +286,7 @@ class VPhoneControl {
         if let hash = guestBinaryHash {
             hello["bin_hash"] = hash
         }
+        hello["bin"] = Self.binaryProtocolVersion
         guard writeMessage(fd: fd, dict: hello) else {
             print("[control] handshake: failed to send hello")
             disconnect(ifCurrentAttempt: attemptToken)
@@ -216,6 +312,7 @@ class VPhoneControl {
             let ip = resp["ip"] as? String
             let iosVersion = resp["ios"] as? String
             let needUpdate = resp["need_update"] as? Bool ?? false
+            let binaryVersion = resp["bin"] as? Int ?? 0
 
             Task { @MainActor in
                 guard let self else { return }
@@ -231,6 +328,7 @@ class VPhoneControl {
                 self.guestCaps = caps
                 self.guestIP = ip
                 self.guestIOSVersion = iosVersion
+                self.binaryFraming = binaryVersion >= 1
                 self.isConnected = true
                 let ipSuffix = ip.map { " (\($0))" } ?? ""
                 let iosSuffix = iosVersion.map { " iOS \($0)" } ?? ""
@@ -258,20 +356,35 @@ class VPhoneControl {
             return
         }
 
-        print("[control] pushing update (\(data.count) bytes)...")
         nextRequestId += 1
-        let header: [String: Any] = [
+        var header: [String: Any] = [
             "v": Self.protocolVersion, "t": "update", "id": String(nextRequestId, radix: 16),
             "size": data.count,
         ]
+        // Guests that can inflate LZFSE get the compressed binary plus its
+        // digest, which they check before installing it.
+        var body = data
+        if guestCaps.contains("update_lzfse") {
+            if guestBinaryCompressed == nil {
+                guestBinaryCompressed = try? (data as NSData).compressed(using: .lzfse) as Data
+            }
+            if let packed = guestBinaryCompressed, packed.count < data.count {
+                header["size"] = packed.count
+                header["raw_size"] = data.count
+                header["encoding"] = "lzfse"
+                header["hash"] = guestBinaryHash
+                body = packed
+            }
+        }
+        print("[control] pushing update (\(body.count) of \(data.count) bytes)...")
         guard writeMessage(fd: fd, dict: header) else {
             print("[control] update: failed to send header")
             disconnect()
             return
         }
 
-        let ok = data.withUnsafeBytes { buf in
-            Self.writeFully(fd: fd, buf: buf.baseAddress!, count: data.count)
+        let ok = body.withUnsafeBytes { buf in
+            Self.writeFully(fd: fd, buf: buf.baseAddress!, count: body.count)
         }
         guard ok else {
             print("[control] update: failed to send binary data")
@@ -298,16 +411,31 @@ class VPhoneControl {
     }
 
     private func sendHID(page: UInt32, usage: UInt32, down: Bool?) {
-        nextRequestId += 1
-        var msg: [String: Any] = [
-            "v": Self.protocolVersion,
-            "t": "hid",
-            "id": String(nextRequestId, radix: 16),
-            "page": page,
-            "usage": usage,
-        ]
-        if let down { msg["down"] = down }
-        guard let fd = connection?.fileDescriptor, writeMessage(fd: fd, dict: msg) else {
+        guard let fd = connection?.fileDescriptor else {
+            print("[control] send failed (not connected)")
+            return
+        }
+        let sent: Bool
+        if binaryFraming {
+            let downFlag: Int8 = down.map { $0 ? 1 : 0 } ?? -1
+            sent = writeBinary(fd: fd, op: .hid, bodySize: 12) { body in
+                body.storeBytes(of: page.littleEndian, toByteOffset: 0, as: UInt32.self)
+                body.storeBytes(of: usage.littleEndian, toByteOffset: 4, as: UInt32.self)
+                body.storeBytes(of: downFlag, toByteOffset: 8, as: Int8.self)
+            }
+        } else {
+            nextRequestId += 1
+            var msg: [String: Any] = [
+                "v": Self.protocolVersion,
+                "t": "hid",
+                "id": String(nextRequestId, radix: 16),
+                "page": page,
+                "usage": usage,
+            ]
+            if let down { msg["down"] = down }
+            sent = writeMessage(fd: fd, dict: msg)
+        }
+        guard sent else {
             print("[control] send failed (not connected)")
             return
         }
@@ -319,20 +447,97 @@ class VPhoneControl {
 
     /// Inject a single-finger digitizer touch guest-side (bypasses VZ USB touch).
     /// phase: 0 = down, 1 = move, 3 = up. x/y are normalized 0..1, top-left origin.
+    ///
+    /// Moves are coalesced to one per `touchMoveInterval`: the first move
+    /// after a quiet period goes out at once, later ones only update the
+    /// position flushed at the end of the interval. Down/up flush first.
     func sendTouch(phase: Int, x: Double, y: Double) {
-        nextRequestId += 1
-        let msg: [String: Any] = [
-            "v": Self.protocolVersion,
-            "t": "touch",
-            "id": String(nextRequestId, radix: 16),
-            "phase": phase,
-            "x": x,
-            "y": y,
-        ]
-        guard let fd = connection?.fileDescriptor, writeMessage(fd: fd, dict: msg) else {
+        guard phase == 1 else {
+            flushTouchMove()
+            writeTouch(phase: phase, x: x, y: y)
+            return
+        }
+        let now = DispatchTime.now()
+        if pendingTouchMove == nil, now >= lastTouchMoveSent + touchMoveInterval {
+            lastTouchMoveSent = now
+            writeTouch(phase: 1, x: x, y: y)
+            return
+        }
+        let scheduled = pendingTouchMove != nil
+        pendingTouchMove = (x, y)
+        guard !scheduled else { return }
+        DispatchQueue.main.asyncAfter(deadline: lastTouchMoveSent + touchMoveInterval) { [weak self] in
+            self?.flushTouchMove()
+        }
+    }
+
+    private func flushTouchMove() {
+        guard let move = pendingTouchMove else { return }
+        pendingTouchMove = nil
+        lastTouchMoveSent = .now()
+        writeTouch(phase: 1, x: move.x, y: move.y)
+    }
+
+    private func writeTouch(phase: Int, x: Double, y: Double) {
+        guard let fd = connection?.fileDescriptor else {
             print("[control] touch send failed (not connected)")
             return
         }
+        let sent: Bool
+        if binaryFraming {
+            sent = writeBinary(fd: fd, op: .touch, bodySize: 20) { body in
+                body.storeBytes(of: Int32(phase).littleEndian, toByteOffset: 0, as: Int32.self)
+                body.storeBytes(of: x.bitPattern.littleEndian, toByteOffset: 4, as: UInt64.self)
+                body.storeBytes(of: y.bitPattern.littleEndian, toByteOffset: 12, as: UInt64.self)
+            }
+        } else {
+            nextRequestId += 1
+            let msg: [String: Any] = [
+                "v": Self.protocolVersion,
+                "t": "touch",
+                "id": String(nextRequestId, radix: 16),
+                "phase": phase,
+                "x": x,
+                "y": y,
+            ]
+            sent = writeMessage(fd: fd, dict: msg)
+        }
+        if !sent {
+            print("[control] touch send failed (not connected)")
+        }
+    }
+
+    // MARK: - HID Batches
+
+    /// One event of a `hid_batch`. `at` is the offset in seconds from the
+    /// start of the batch; touch coordinates are as for ``sendTouch(phase:x:y:)``.
+    enum HIDBatchEvent {
+        case touch(at: TimeInterval, phase: Int, x: Double, y: Double)
+        case key(at: TimeInterval, page: UInt32, usage: UInt32, down: Bool)
+    }
+
+    /// Whether the guest can replay timed event batches.
+    var supportsHIDBatch: Bool {
+        isConnected && guestCaps.contains("hid_batch")
+    }
+
+    /// Send `events` as one `hid_batch`. The guest replays them on its HID
+    /// thread with the given spacing; this returns once they are queued.
+    @discardableResult
+    func sendHIDBatch(_ events: [HIDBatchEvent]) async throws -> Int {
+        guard supportsHIDBatch else {
+            throw ControlError.unsupportedCapability("hid_batch")
+        }
+        flushTouchMove()
+        let micros = { (at: TimeInterval) in Int((max(at, 0) * 1_000_000).rounded()) }
+        let encoded: [[Any]] = events.map { event in
+            switch event {
+            case let .touch(at, phase, x, y): [micros(at), 0, phase, x, y]
+            case let .key(at, page, usage, down): [micros(at), 1, page, usage, down ? 1 : 0]
+            }
+        }
+        let (resp, _) = try await sendRequest(["t": "hid_batch", "events": encoded])
+        return resp["queued"] as? Int ?? events.count
     }
 
     // MARK: - Developer Mode
@@ -356,6 +561,30 @@ class VPhoneControl {
         return resp["hash"] as? String ?? "unknown"
     }
 
+    /// Guest per-command counters and latency histograms. `reset` clears
+    /// them after the snapshot is taken.
+    func guestStats(reset: Bool = false) async throws -> [String: Any] {
+        guard guestCaps.contains("stats") else {
+            throw ControlError.unsupportedCapability("stats")
+        }
+        let (resp, _) = try await sendRequest(["t": "stats", "reset": reset])
+        return resp
+    }
+
+    /// Host and guest stats as plain text; the guest half is omitted when it
+    /// is unavailable.
+    func statsReport(reset: Bool = false) async -> String {
+        var report = stats.report()
+        do {
+            let guest = try await guestStats(reset: reset)
+            report += "\n\n" + VPhoneControlStats.report(guest: guest)
+        } catch {
+            report += "\n\nguest: \(error)"
+        }
+        if reset { stats.reset() }
+        return report
+    }
+
     /// Cancel all currently pending request continuations.
     func cancelPendingRequests(reason: String = "cancelled by host") {
         failAllPending(with: .cancelled(reason))
@@ -378,14 +607,13 @@ class VPhoneControl {
         let timeout = Self.timeoutForRequest(type: requestType)
 
         return try await withCheckedThrowingContinuation { continuation in
-            addPending(id: reqId) { result in
+            addPending(id: reqId, type: requestType) { result in
                 nonisolated(unsafe) let r = result
                 continuation.resume(with: r)
             }
             armRequestTimeout(id: reqId, type: requestType, timeout: timeout)
             guard writeMessage(fd: fd, dict: msg) else {
-                _ = removePending(id: reqId)
-                continuation.resume(throwing: ControlError.notConnected)
+                failPending(id: reqId, with: .notConnected)
                 return
             }
         }
@@ -401,8 +629,69 @@ class VPhoneControl {
         return entries
     }
 
+    struct FileListPage {
+        let entries: [VPhoneRemoteFile]
+        /// Cursor for the next page, or nil when the listing is complete.
+        let nextCursor: Int?
+    }
+
+    /// List one page of `path`. With `depth` > 0 the guest also walks that
+    /// many levels of subdirectories (breadth-first). Guests without
+    /// `file_list_bulk` return the whole directory as a single page.
+    func listFilesPage(
+        path: String, cursor: Int = 0, limit: Int = 2000, depth: Int = 0
+    ) async throws -> FileListPage {
+        guard guestCaps.contains("file_list_bulk") else {
+            let entries = try await listFiles(path: path)
+            return FileListPage(
+                entries: entries.compactMap { VPhoneRemoteFile(dir: path, entry: $0) }, nextCursor: nil
+            )
+        }
+
+        var req: [String: Any] = ["t": "file_list", "path": path, "bulk": true, "cursor": cursor, "limit": limit]
+        if depth != 0 { req["depth"] = depth }
+        let (resp, _) = try await sendRequest(req)
+        guard let names = resp["names"] as? [String],
+              let types = (resp["types"] as? String).map({ Array($0.utf8) }),
+              let sizes = resp["sizes"] as? [NSNumber],
+              let mtimes = resp["mtimes"] as? [NSNumber],
+              let perms = resp["perms"] as? [NSNumber],
+              types.count == names.count, sizes.count == names.count,
+              mtimes.count == names.count, perms.count == names.count
+        else {
+            throw ControlError.protocolError("malformed file_list page")
+        }
+
+        let entries = names.indices.compactMap { i in
+            VPhoneRemoteFile(
+                root: path, relativePath: names[i], typeCode: types[i],
+                size: sizes[i].uint64Value, mode: perms[i].intValue, mtime: mtimes[i].doubleValue
+            )
+        }
+        return FileListPage(entries: entries, nextCursor: resp["next"] as? Int)
+    }
+
+    /// All entries of `path`, fetched page by page.
+    func listAllFiles(path: String, depth: Int = 0) async throws -> [VPhoneRemoteFile] {
+        var page = try await listFilesPage(path: path, depth: depth)
+        var entries = page.entries
+        while let cursor = page.nextCursor {
+            page = try await listFilesPage(path: path, cursor: cursor, depth: depth)
+            entries.append(contentsOf: page.entries)
+        }
+        return entries
+    }
+
+    /// Ask inline writers for `payload` frames so a large download or
+    /// clipboard image does not hold the guest's write side for its whole
+    /// transfer.
+    private var payloadFramesRequest: [String: Any] {
+        guestCaps.contains("payload_frames") ? ["frames": true] : [:]
+    }
+
     func downloadFile(path: String) async throws -> Data {
-        let (_, data) = try await sendRequest(["t": "file_get", "path": path])
+        let request = payloadFramesRequest.merging(["t": "file_get", "path": path]) { $1 }
+        let (_, data) = try await sendRequest(request)
         guard let data else {
             throw ControlError.protocolError("no file data received")
         }
@@ -428,7 +717,7 @@ class VPhoneControl {
 
         try await withCheckedThrowingContinuation {
             (continuation: CheckedContinuation<Void, any Error>) in
-            addPending(id: reqId) { result in
+            addPending(id: reqId, type: "file_put") { result in
                 switch result {
                 case .success: continuation.resume()
                 case let .failure(error): continuation.resume(throwing: error)
@@ -438,21 +727,270 @@ class VPhoneControl {
 
             // Write header + raw data atomically (same pattern as pushUpdate)
             guard writeMessage(fd: fd, dict: header) else {
-                _ = removePending(id: reqId)
-                continuation.resume(throwing: ControlError.notConnected)
+                failPending(id: reqId, with: .notConnected)
                 return
             }
             let ok = data.withUnsafeBytes { buf in
                 Self.writeFully(fd: fd, buf: buf.baseAddress!, count: data.count)
             }
+            stats.recordSend(type: "file_put", bytes: data.count)
             guard ok else {
-                _ = removePending(id: reqId)
-                continuation.resume(throwing: ControlError.protocolError("failed to write file data"))
+                failPending(id: reqId, with: .protocolError("failed to write file data"))
                 return
             }
         }
     }
 
+    // MARK: - Chunked File Transfer
+
+    /// Download `path` straight into `destination` in fixed-size chunks.
+    ///
+    /// Keeps up to `fileTransferWindow` chunk requests in flight, verifies
+    /// each chunk's SHA-256 (retrying on mismatch) and writes through a
+    /// `FileHandle`, so memory stays bounded by the window. Data lands in
+    /// `<destination>.vphonepart` first; an existing part file is resumed
+    /// only if `<destination>.vphonepart.source` shows it came from the same
+    /// guest file (size and mtime).
+    /// Falls back to a whole-file `file_get` on guests without `file_chunked`.
+    func downloadFile(
+        path: String, to destination: URL,
+        progress: ((_ received: Int64, _ total: Int64) -> Void)? = nil
+    ) async throws {
+        guard guestCaps.contains("file_chunked") else {
+            let data = try await downloadFile(path: path)
+            try data.write(to: destination)
+            progress?(Int64(data.count), Int64(data.count))
+            return
+        }
+
+        let (info, _) = try await sendRequest(["t": "file_stat", "path": path])
+        guard info["exists"] as? Bool == true else {
+            throw ControlError.guestError("no such file: \(path)")
+        }
+        let total = (info["size"] as? NSNumber)?.int64Value ?? 0
+        let chunkSize = Int64(Self.fileChunkSize)
+        let windowBytes = chunkSize * Int64(Self.fileTransferWindow)
+        let mtime = (info["mtime"] as? NSNumber)?.int64Value ?? 0
+        let mtimeNanos = (info["mtime_ns"] as? NSNumber)?.int64Value ?? 0
+        let sourceID = "\(total):\(mtime).\(mtimeNanos)"
+
+        let fm = FileManager.default
+        let partURL = destination.appendingPathExtension(Self.partialFileExtension)
+        let sourceURL = partURL.appendingPathExtension(Self.partialSourceExtension)
+        let recorded = try? String(contentsOf: sourceURL, encoding: .utf8)
+        if recorded != sourceID || !fm.fileExists(atPath: partURL.path) {
+            // Missing or from another version of the file: start over.
+            fm.createFile(atPath: partURL.path, contents: nil)
+            try sourceID.write(to: sourceURL, atomically: true, encoding: .utf8)
+        }
+        let handle = try FileHandle(forWritingTo: partURL)
+        defer { try? handle.close() }
+
+        // Chunks are written strictly in order, so the part file is always a
+        // contiguous prefix. Resume from its last whole chunk.
+        let existing = Int64(try handle.seekToEnd())
+        var written = min(existing, total) / chunkSize * chunkSize
+        try handle.truncate(atOffset: UInt64(written))
+        progress?(written, total)
+
+        try await withThrowingTaskGroup(of: (Int64, Data).self) { group in
+            var next = written
+            var ready: [Int64: Data] = [:]
+            while next < total, next - written < windowBytes {
+                let offset = next
+                let length = Int(min(chunkSize, total - offset))
+                group.addTask { try await self.fetchFileChunk(path: path, offset: offset, length: length) }
+                next += Int64(length)
+            }
+            while let chunk = try await group.next() {
+                ready[chunk.0] = chunk.1
+                while let data = ready.removeValue(forKey: written) {
+                    try handle.write(contentsOf: data)
+                    written += Int64(data.count)
+                }
+                progress?(written, total)
+                while next < total, next - written < windowBytes {
+                    let offset = next
+                    let length = Int(min(chunkSize, total - offset))
+                    group.addTask { try await self.fetchFileChunk(path: path, offset: offset, length: length) }
+                    next += Int64(length)
+                }
+            }
+        }
+        try handle.close()
+
+        guard written == total else {
+            throw ControlError.protocolError("short download (\(written)/\(total) bytes)")
+        }
+        if fm.fileExists(atPath: destination.path) {
+            try fm.removeItem(at: destination)
+        }
+        try fm.moveItem(at: partURL, to: destination)
+        try? fm.removeItem(at: sourceURL)
+    }
+
+    /// Upload `source` to `path` in fixed-size chunks without loading the
+    /// whole file. Writes up to `fileTransferWindow` chunks back to back
+    /// before waiting for their acks, and resumes after the guest's existing
+    /// `<path>.vphonepart` when the source it recorded matches `source`'s
+    /// current size and mtime. Falls back to a single `file_put` on guests
+    /// without `file_chunked`.
+    func uploadFile(
+        path: String, from source: URL, permissions: String = "644",
+        progress: ((_ sent: Int64, _ total: Int64) -> Void)? = nil
+    ) async throws {
+        guard guestCaps.contains("file_chunked") else {
+            let data = try Data(contentsOf: source)
+            try await uploadFile(path: path, data: data, permissions: permissions)
+            progress?(Int64(data.count), Int64(data.count))
+            return
+        }
+
+        let handle = try FileHandle(forReadingFrom: source)
+        defer { try? handle.close() }
+        let total = Int64(try handle.seekToEnd())
+        let chunkSize = Int64(Self.fileChunkSize)
+        let modified = try source.resourceValues(forKeys: [.contentModificationDateKey]).contentModificationDate
+        let sourceID = "\(total):\(modified?.timeIntervalSince1970 ?? 0)"
+
+        // Resume after the last whole chunk the guest holds, but always
+        // resend the final chunk since that one performs the rename. A part
+        // recorded for a different source starts over at offset 0.
+        let (info, _) = try await sendRequest(["t": "file_stat", "path": path])
+        let partMatches = info["part_source"] as? String == sourceID
+        let partSize = partMatches ? (info["part_size"] as? NSNumber)?.int64Value ?? 0 : 0
+        var offset = min(partSize, max(total - 1, 0)) / chunkSize * chunkSize
+        progress?(offset, total)
+
+        repeat {
+            var batch: [(offset: Int64, data: Data)] = []
+            repeat {
+                try handle.seek(toOffset: UInt64(offset))
+                let data = try handle.read(upToCount: Self.fileChunkSize) ?? Data()
+                if data.isEmpty, offset < total {
+                    throw ControlError.protocolError("\(source.lastPathComponent) changed during upload")
+                }
+                batch.append((offset, data))
+                offset += Int64(data.count)
+            } while batch.count < Self.fileTransferWindow && offset < total
+            try await sendFileChunks(path: path, batch, total: total, permissions: permissions, source: sourceID)
+            progress?(offset, total)
+        } while offset < total
+    }
+
+    private func fetchFileChunk(path: String, offset: Int64, length: Int) async throws -> (Int64, Data) {
+        var attempt = 0
+        while true {
+            attempt += 1
+            let (resp, data) = try await sendRequest(payloadFramesRequest.merging([
+                "t": "file_get", "path": path, "offset": offset, "length": length,
+            ]) { $1 })
+            guard let data, data.count == length else {
+                throw ControlError.protocolError("short chunk at offset \(offset) of \(path)")
+            }
+            if let expected = resp["sha256"] as? String, Self.sha256Hex(data) != expected {
+                guard attempt < Self.fileChunkRetries else {
+                    throw ControlError.protocolError("checksum mismatch at offset \(offset) of \(path)")
+                }
+                print("[control] file_get \(path): checksum mismatch at \(offset), retrying")
+                continue
+            }
+            return (offset, data)
+        }
+    }
+
+    /// Write a batch of chunked `file_put` requests back to back and wait
+    /// until every one is acked. The last chunk of the file carries `final`.
+    private func sendFileChunks(
+        path: String, _ chunks: [(offset: Int64, data: Data)], total: Int64, permissions: String, source: String
+    ) async throws {
+        try await sendChunkBatch(chunks.map { chunk in
+            var request: [String: Any] = [
+                "t": "file_put", "path": path, "perm": permissions,
+                "offset": chunk.offset, "size": chunk.data.count, "total": total,
+                "sha256": Self.sha256Hex(chunk.data),
+                "final": chunk.offset + Int64(chunk.data.count) >= total,
+            ]
+            // The chunk that starts the part file records what it is a part of.
+            if chunk.offset == 0 { request["source"] = source }
+            return (request, chunk.data)
+        })
+    }
+
+    /// Write requests with inline payloads back to back and wait until every
+    /// one is acked, failing on the first error.
+    private func sendChunkBatch(_ requests: [(request: [String: Any], payload: Data)]) async throws {
+        try await withCheckedThrowingContinuation {
+            (continuation: CheckedContinuation<Void, any Error>) in
+            // Acks arrive on ioQueue while a failed write completes on main.
+            let batch = ChunkBatch(remaining: requests.count)
+            let complete: @Sendable (Result<Void, any Error>) -> Void = { result in
+                let done = batch.lock.withLock {
+                    guard !batch.finished else { return false }
+                    if case .success = result {
+                        batch.remaining -= 1
+                        guard batch.remaining == 0 else { return false }
+                    }
+                    batch.finished = true
+                    return true
+                }
+                if done { continuation.resume(with: result) }
+            }
+            for (request, payload) in requests {
+                let written = writeRequest(request, payload: payload) { result in
+                    complete(result.map { _ in () })
+                }
+                guard written else {
+                    complete(.failure(ControlError.notConnected))
+                    return
+                }
+            }
+        }
+    }
+
+    /// Completion bookkeeping for ``sendChunkBatch(_:)``.
+    private final class ChunkBatch: @unchecked Sendable {
+        let lock = NSLock()
+        var remaining: Int
+        var finished = false
+
+        init(remaining: Int) {
+            self.remaining = remaining
+        }
+    }
+
+    /// Write a request plus optional inline payload and register `handler`
+    /// for its response. Synchronous, so consecutive calls reach the socket
+    /// in call order. Returns false, after failing `handler` unless the
+    /// request already timed out, when the write does not go through.
+    private func writeRequest(
+        _ dict: [String: Any], payload: Data? = nil,
+        handler: @escaping @Sendable (Result<([String: Any], Data?), any Error>) -> Void
+    ) -> Bool {
+        guard let fd = connection?.fileDescriptor else { return false }
+        nextRequestId += 1
+        let reqId = String(nextRequestId, radix: 16)
+        var msg = dict
+        msg["v"] = Self.protocolVersion
+        msg["id"] = reqId
+        let requestType = msg["t"] as? String ?? "unknown"
+        addPending(id: reqId, type: requestType, handler: handler)
+        armRequestTimeout(id: reqId, type: requestType, timeout: Self.timeoutForRequest(type: requestType))
+        var ok = writeMessage(fd: fd, dict: msg)
+        if ok, let payload, !payload.isEmpty {
+            ok = payload.withUnsafeBytes { buf in
+                Self.writeFully(fd: fd, buf: buf.baseAddress!, count: payload.count)
+            }
+            stats.recordSend(type: requestType, bytes: payload.count)
+        }
+        if !ok { failPending(id: reqId, with: .notConnected) }
+        return ok
+    }
+
+    private nonisolated static func sha256Hex(_ data: Data) -> String {
+        SHA256.hash(data: data).map { String(format: "%02x", $0) }.joined()
+    }
+
     func createDirectory(path: String) async throws {
         _ = try await sendRequest(["t": "file_mkdir", "path": path])
     }
@@ -476,6 +1014,10 @@ class VPhoneControl {
     }
 
     private func installIPAWithBuiltInInstaller(localURL: URL) async throws -> String {
+        if guestCaps.contains("ipa_stream") {
+            return try await installIPAStreaming(localURL: localURL)
+        }
+
         let data: Data
         do {
             data = try Data(contentsOf: localURL)
@@ -520,22 +1062,137 @@ class VPhoneControl {
         return "Installed \(localURL.lastPathComponent) through the built-in IPA installer."
     }
 
+    /// Stream the IPA straight into the guest installer without staging it
+    /// in memory or on guest disk. The guest unpacks while chunks arrive
+    /// and signs binaries as they land; `ipa_stream_end` returns once the
+    /// app is installed.
+    private func installIPAStreaming(localURL: URL) async throws -> String {
+        let handle: FileHandle
+        do {
+            handle = try FileHandle(forReadingFrom: localURL)
+        } catch {
+            throw ControlError.protocolError("failed to read IPA: \(error)")
+        }
+        defer { try? handle.close() }
+
+        var begin: [String: Any] = ["t": "ipa_stream_begin", "registration": "User"]
+        var certRemotePath: String?
+        if let signCertURL = Self.signCertURL() {
+            let remoteDir = "/var/mobile/Documents/vphone-installs"
+            let remotePath = "\(remoteDir)/\(UUID().uuidString)-signcert.p12"
+            try await createDirectory(path: remoteDir)
+            try await uploadFile(path: remotePath, data: Data(contentsOf: signCertURL))
+            begin["cert_path"] = remotePath
+            certRemotePath = remotePath
+        }
+        defer {
+            // The guest removes the certificate once the stream finishes;
+            // this covers failures before it starts.
+            if let certRemotePath {
+                Task { try? await deleteFile(path: certRemotePath) }
+            }
+        }
+
+        let (started, _) = try await sendRequest(begin)
+        guard let stream = started["stream"] as? String else {
+            throw ControlError.protocolError("missing stream in ipa_stream_begin response")
+        }
+
+        do {
+            var chunks: [(request: [String: Any], payload: Data)] = []
+            while let data = try handle.read(upToCount: Self.fileChunkSize), !data.isEmpty {
+                chunks.append((["t": "ipa_stream_data", "stream": stream, "size": data.count], data))
+                if chunks.count == Self.fileTransferWindow {
+                    try await sendChunkBatch(chunks)
+                    chunks.removeAll()
+                }
+            }
+            if !chunks.isEmpty {
+                try await sendChunkBatch(chunks)
+            }
+        } catch {
+            // Otherwise the guest worker waits on the pipe until we disconnect.
+            _ = try? await sendRequest(["t": "ipa_stream_abort", "stream": stream])
+            throw error
+        }
+
+        let (resp, _) = try await sendRequest(["t": "ipa_stream_end", "stream": stream])
+        if let detail = resp["msg"] as? String, !detail.isEmpty {
+            return detail
+        }
+        return "Installed \(localURL.lastPathComponent) through the built-in IPA installer."
+    }
+
     // MARK: - Keychain Operations
 
+    private static let keychainPageSize = 500
+
     struct KeychainResult {
         let items: [[String: Any]]
         let diagnostics: [String]
+        /// Opaque change token; pass it back as `since` to fetch only changes.
+        var token: [String: Any]?
+        /// Whether `items` holds only rows changed since the given token.
+        var isDelta = false
+        /// Nothing committed since the given token; `items` is empty.
+        var isUnchanged = false
+        /// For deltas: every live rowid per class, to drop deleted items.
+        var liveRowids: [String: Set<Int>] = [:]
+    }
+
+    /// List keychain items page by page. With `since`, only items added or
+    /// modified after that token are returned (see vphoned_keychain.m).
+    /// `includeValues: false` leaves values out; fetch them with
+    /// ``keychainItem(class:rowid:)``.
+    func listKeychainItems(
+        filterClass: String? = nil, includeValues: Bool = true, since token: [String: Any]? = nil
+    ) async throws -> KeychainResult {
+        var items: [[String: Any]] = []
+        var diag: [String] = []
+        var cursor: String?
+        var result: KeychainResult?
+        repeat {
+            var req: [String: Any] = ["t": "keychain_list", "limit": Self.keychainPageSize]
+            if let filterClass { req["class"] = filterClass }
+            if !includeValues { req["values"] = false }
+            if let token { req["since"] = token }
+            if let cursor { req["cursor"] = cursor }
+            let (resp, _) = try await sendRequest(req)
+            guard let page = resp["items"] as? [[String: Any]] else {
+                throw ControlError.protocolError("missing items in keychain response")
+            }
+            items += page
+            diag += resp["diag"] as? [String] ?? []
+            cursor = resp["next_cursor"] as? String
+
+            // Keep the first page's token so changes during the scan are
+            // picked up by the next delta.
+            if result == nil {
+                result = KeychainResult(
+                    items: [], diagnostics: [], token: resp["token"] as? [String: Any],
+                    isDelta: resp["delta"] as? Bool ?? false,
+                    isUnchanged: resp["unchanged"] as? Bool ?? false
+                )
+            }
+            if let rowids = resp["rowids"] as? [String: [NSNumber]] {
+                result?.liveRowids = rowids.mapValues { Set($0.map(\.intValue)) }
+            }
+        } while cursor != nil
+
+        guard let result else { throw ControlError.protocolError("empty keychain response") }
+        return KeychainResult(
+            items: items, diagnostics: diag, token: result.token, isDelta: result.isDelta,
+            isUnchanged: result.isUnchanged, liveRowids: result.liveRowids
+        )
     }
 
-    func listKeychainItems(filterClass: String? = nil) async throws -> KeychainResult {
-        var req: [String: Any] = ["t": "keychain_list"]
-        if let filterClass { req["class"] = filterClass }
-        let (resp, _) = try await sendRequest(req)
-        guard let items = resp["items"] as? [[String: Any]] else {
-            throw ControlError.protocolError("missing items in keychain response")
+    /// Fetch one keychain item, including its value.
+    func keychainItem(class itemClass: String, rowid: Int) async throws -> [String: Any] {
+        let (resp, _) = try await sendRequest(["t": "keychain_get", "class": itemClass, "rowid": rowid])
+        guard resp["ok"] as? Bool == true, let item = resp["item"] as? [String: Any] else {
+            throw ControlError.guestError(resp["msg"] as? String ?? "keychain_get failed")
         }
-        let diag = resp["diag"] as? [String] ?? []
-        return KeychainResult(items: items, diagnostics: diag)
+        return item
     }
 
     func addKeychainItem(
@@ -564,7 +1221,7 @@ class VPhoneControl {
     }
 
     func clipboardGet() async throws -> ClipboardContent {
-        let (resp, data) = try await sendRequest(["t": "clipboard_get"])
+        let (resp, data) = try await sendRequest(payloadFramesRequest.merging(["t": "clipboard_get"]) { $1 })
         let text = resp["text"] as? String
         let types = resp["types"] as? [String] ?? []
         let hasImage = resp["has_image"] as? Bool ?? false
@@ -596,7 +1253,7 @@ class VPhoneControl {
 
         try await withCheckedThrowingContinuation {
             (continuation: CheckedContinuation<Void, any Error>) in
-            addPending(id: reqId) { result in
+            addPending(id: reqId, type: "clipboard_set") { result in
                 switch result {
                 case .success: continuation.resume()
                 case let .failure(error): continuation.resume(throwing: error)
@@ -605,16 +1262,15 @@ class VPhoneControl {
             armRequestTimeout(id: reqId, type: "clipboard_set", timeout: timeout)
 
             guard writeMessage(fd: fd, dict: header) else {
-                _ = removePending(id: reqId)
-                continuation.resume(throwing: ControlError.notConnected)
+                failPending(id: reqId, with: .notConnected)
                 return
             }
             let ok = imageData.withUnsafeBytes { buf in
                 Self.writeFully(fd: fd, buf: buf.baseAddress!, count: imageData.count)
             }
+            stats.recordSend(type: "clipboard_set", bytes: imageData.count)
             guard ok else {
-                _ = removePending(id: reqId)
-                continuation.resume(throwing: ControlError.protocolError("failed to write image data"))
+                failPending(id: reqId, with: .protocolError("failed to write image data"))
                 return
             }
         }
@@ -633,12 +1289,60 @@ class VPhoneControl {
         let dataContainer: String
     }
 
+    /// App list snapshot or delta from the guest's cached inventory.
+    struct AppInventory {
+        /// Entries changed since the requested generation (all when not a delta).
+        let apps: [AppInfo]
+        /// Bundle IDs uninstalled since the requested generation.
+        let removed: [String]
+        let generation: UInt64
+        /// Generation this delta starts from (pushes only; 0 otherwise).
+        let since: UInt64
+        /// Identifies the guest inventory; generations from another session
+        /// cannot be used as `since`.
+        let session: UInt32
+        let isDelta: Bool
+    }
+
+    /// Whether the guest pushes `app_changed` and answers `app_list` deltas.
+    var supportsAppWatch: Bool {
+        isConnected && guestCaps.contains("app_watch")
+    }
+
     func appList(filter: String = "all") async throws -> [AppInfo] {
         let (resp, _) = try await sendRequest(["t": "app_list", "filter": filter])
-        guard let apps = resp["apps"] as? [[String: Any]] else {
+        guard resp["apps"] is [[String: Any]] else {
+            throw ControlError.protocolError("missing apps in response")
+        }
+        return Self.parseAppInventory(resp).apps
+    }
+
+    /// Full inventory, or only what changed after `since` when the guest
+    /// still has that session.
+    func appInventory(since: (generation: UInt64, session: UInt32)? = nil) async throws -> AppInventory {
+        var req: [String: Any] = ["t": "app_list", "filter": "all"]
+        if let since, supportsAppWatch {
+            req["since"] = since.generation
+            req["session"] = since.session
+        }
+        let (resp, _) = try await sendRequest(req)
+        guard resp["apps"] is [[String: Any]] else {
             throw ControlError.protocolError("missing apps in response")
         }
-        return apps.map { app in
+        return Self.parseAppInventory(resp)
+    }
+
+    /// Start or stop `app_changed` pushes on this connection. The guest
+    /// forgets the subscription when the connection closes.
+    func watchApps(_ enable: Bool) async throws {
+        guard supportsAppWatch else {
+            throw ControlError.unsupportedCapability("app_watch")
+        }
+        _ = try await sendRequest(["t": "app_watch", "enable": enable])
+    }
+
+    private nonisolated static func parseAppInventory(_ msg: [String: Any]) -> AppInventory {
+        let apps = (msg["apps"] as? [[String: Any]] ?? []).map { app in
             AppInfo(
                 bundleId: app["bundle_id"] as? String ?? "",
                 name: app["name"] as? String ?? "",
@@ -650,6 +1354,14 @@ class VPhoneControl {
                 dataContainer: app["data_container"] as? String ?? ""
             )
         }
+        return AppInventory(
+            apps: apps,
+            removed: msg["removed"] as? [String] ?? [],
+            generation: (msg["generation"] as? NSNumber)?.uint64Value ?? 0,
+            since: (msg["since"] as? NSNumber)?.uint64Value ?? 0,
+            session: (msg["session"] as? NSNumber)?.uint32Value ?? 0,
+            isDelta: msg["delta"] as? Bool ?? false
+        )
     }
 
     func appLaunch(bundleId: String, url: String? = nil) async throws -> Int {
@@ -723,6 +1435,16 @@ class VPhoneControl {
         horizontalAccuracy: Double, verticalAccuracy: Double,
         speed: Double, course: Double
     ) {
+        if binaryFraming, let fd = connection?.fileDescriptor {
+            let fields = [latitude, longitude, altitude, horizontalAccuracy, verticalAccuracy, speed, course]
+            let sent = writeBinary(fd: fd, op: .location, bodySize: fields.count * 8) { body in
+                for (i, value) in fields.enumerated() {
+                    body.storeBytes(of: value.bitPattern.littleEndian, toByteOffset: i * 8, as: UInt64.self)
+                }
+            }
+            if sent { print("[control] location lat=\(latitude) lon=\(longitude)") }
+            return
+        }
         nextRequestId += 1
         let msg: [String: Any] = [
             "v": Self.protocolVersion,
@@ -765,11 +1487,15 @@ class VPhoneControl {
         let wasConnected = isConnected
         let hadConnection = connection != nil
         let fd = connection?.fileDescriptor
+        reader?.cancel()
+        reader = nil
         connection = nil
         isConnected = false
         guestName = ""
         guestCaps = []
         guestIP = nil
+        binaryFraming = false
+        pendingTouchMove = nil
 
         // Fail all pending requests
         failAllPending()
@@ -787,97 +1513,80 @@ class VPhoneControl {
         }
     }
 
-    // MARK: - Background Read Loop
+    // MARK: - Read Loop
 
+    /// Start the event-driven reader for `fd`. Frames are handled on
+    /// `ioQueue`; only the end-of-stream disconnect hops to main.
     private func startReadLoop(fd: Int32, attemptToken: UInt64) {
-        DispatchQueue.global(qos: .utility).async { [weak self] in
-            while let msg = Self.readMessage(fd: fd) {
-                guard let self else { break }
-                let type = msg["t"] as? String ?? ""
-                let reqId = msg["id"] as? String
-
-                // Check for pending request callback
-                if let reqId, let pending = removePending(id: reqId) {
-                    nonisolated(unsafe) let safeMsg = msg
-
-                    if type == "err" {
-                        let detail = msg["msg"] as? String ?? "unknown error"
-                        DispatchQueue.main.async { pending.handler(.failure(ControlError.guestError(detail))) }
-                        continue
-                    }
-
-                    // For file_data, read inline binary payload
-                    if type == "file_data" {
-                        let size = msg["size"] as? Int ?? 0
-                        if size > 0 {
-                            let buf = UnsafeMutablePointer<UInt8>.allocate(capacity: size)
-                            if Self.readFully(fd: fd, buf: buf, count: size) {
-                                let data = Data(bytes: buf, count: size)
-                                buf.deallocate()
-                                DispatchQueue.main.async { pending.handler(.success((safeMsg, data))) }
-                            } else {
-                                buf.deallocate()
-                                DispatchQueue.main.async {
-                                    pending.handler(.failure(ControlError.protocolError("failed to read file data")))
-                                }
-                            }
-                        } else {
-                            DispatchQueue.main.async { pending.handler(.success((safeMsg, Data()))) }
-                        }
-                        continue
-                    }
+        reader?.cancel()
+        reader = ControlFrameReader(
+            fd: fd, queue: ioQueue, keepAlive: connection,
+            onFrame: { [weak self] msg, payload, bytes in
+                self?.handleFrame(msg, payload: payload, bytes: bytes)
+            },
+            onClose: { [weak self] in
+                Task { @MainActor in
+                    guard let self else { return }
+                    guard self.isCurrentAttempt(attemptToken, fd: fd) else { return }
+                    print("[control] read loop ended")
+                    self.disconnect(ifCurrentAttempt: attemptToken)
+                }
+            }
+        )
+    }
 
-                    // For clipboard_get with image, read inline binary payload
-                    if type == "clipboard_get", msg["has_image"] as? Bool == true {
-                        let size = msg["image_size"] as? Int ?? 0
-                        if size > 0 {
-                            let buf = UnsafeMutablePointer<UInt8>.allocate(capacity: size)
-                            if Self.readFully(fd: fd, buf: buf, count: size) {
-                                let data = Data(bytes: buf, count: size)
-                                buf.deallocate()
-                                DispatchQueue.main.async { pending.handler(.success((safeMsg, data))) }
-                            } else {
-                                buf.deallocate()
-                                DispatchQueue.main.async {
-                                    pending.handler(
-                                        .failure(ControlError.protocolError("failed to read clipboard image data"))
-                                    )
-                                }
-                            }
-                        } else {
-                            DispatchQueue.main.async { pending.handler(.success((safeMsg, nil))) }
-                        }
-                        continue
-                    }
+    /// Route one guest frame. Runs on `ioQueue`: pending handlers are called
+    /// directly and resume their continuations without going through main.
+    /// `bytes` is the frame's size on the wire, including any payload.
+    private nonisolated func handleFrame(_ msg: [String: Any], payload: Data?, bytes: Int) {
+        let type = msg["t"] as? String ?? ""
 
-                    // Normal response (ok, pong, etc.)
-                    DispatchQueue.main.async { pending.handler(.success((safeMsg, nil))) }
-                    continue
-                }
+        if type == "payload", let reqId = msg["id"] as? String {
+            appendPayload(id: reqId, payload ?? Data(), bytes: bytes)
+            return
+        }
 
-                // No pending request — handle as before (fire-and-forget)
-                switch type {
-                case "ok":
-                    let detail = msg["msg"] as? String ?? ""
-                    if !detail.isEmpty { print("[vphoned] ok: \(detail)") }
-                case "pong":
-                    print("[vphoned] pong")
-                case "version":
-                    let hash = msg["hash"] as? String ?? "unknown"
-                    print("[vphoned] build: \(hash)")
-                case "err":
-                    let detail = msg["msg"] as? String ?? "unknown"
-                    print("[vphoned] error: \(detail)")
-                default:
-                    print("[vphoned] \(msg)")
-                }
+        if let reqId = msg["id"] as? String, let pending = removePending(id: reqId) {
+            let bytesIn = bytes + pending.framedBytes
+            if type == "err" {
+                let detail = msg["msg"] as? String ?? "unknown error"
+                pending.finish(.failure(ControlError.guestError(detail)), bytesIn: bytesIn)
+            } else if msg["chunked"] as? Bool == true {
+                pending.finish(.success((msg, pending.framedPayload)), bytesIn: bytesIn)
+            } else {
+                pending.finish(.success((msg, payload)), bytesIn: bytesIn)
             }
+            return
+        }
+
+        // No pending request — fire-and-forget
+        switch type {
+        case "ok":
+            let detail = msg["msg"] as? String ?? ""
+            if !detail.isEmpty { print("[vphoned] ok: \(detail)") }
+        case "pong":
+            print("[vphoned] pong")
+        case "version":
+            let hash = msg["hash"] as? String ?? "unknown"
+            print("[vphoned] build: \(hash)")
+        case "app_changed":
+            let inventory = Self.parseAppInventory(msg)
+            Task { @MainActor in self.onAppsChanged?(inventory) }
+        case "caps":
+            // Sent after a hello marked caps_pending, once the guest's
+            // subsystems have loaded.
+            let caps = msg["caps"] as? [String] ?? []
             Task { @MainActor in
-                guard let self else { return }
-                guard self.isCurrentAttempt(attemptToken, fd: fd) else { return }
-                print("[control] read loop ended")
-                self.disconnect(ifCurrentAttempt: attemptToken)
+                guard self.isConnected else { return }
+                self.guestCaps = caps
+                print("[control] guest caps updated: \(caps)")
+                self.onConnect?(caps)
             }
+        case "err":
+            let detail = msg["msg"] as? String ?? "unknown"
+            print("[vphoned] error: \(detail)")
+        default:
+            print("[vphoned] \(msg)")
         }
     }
 
@@ -931,9 +1640,9 @@ class VPhoneControl {
 
     private static func timeoutForRequest(type: String) -> TimeInterval {
         switch type {
-        case "file_get", "file_put", "ipa_install":
+        case "file_get", "file_put", "ipa_install", "ipa_stream_data", "ipa_stream_end":
             transferRequestTimeout
-        case "devmode", "file_list", "file_delete", "file_rename", "file_mkdir", "keychain_list",
+        case "devmode", "file_list", "file_stat", "file_delete", "file_rename", "file_mkdir", "keychain_list",
              "app_list", "app_launch", "open_url", "accessibility_tree":
             slowRequestTimeout
         default:
@@ -944,12 +1653,10 @@ class VPhoneControl {
     private func armRequestTimeout(id: String, type: String, timeout: TimeInterval) {
         guard timeout > 0 else { return }
         let timeoutSeconds = max(Int(timeout.rounded()), 1)
-        DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + timeout) { [weak self] in
+        ioQueue.asyncAfter(deadline: .now() + timeout) { [weak self] in
             guard let self else { return }
             guard let pending = removePending(id: id) else { return }
-            DispatchQueue.main.async {
-                pending.handler(.failure(ControlError.requestTimedOut(type: type, seconds: timeoutSeconds)))
-            }
+            pending.finish(.failure(ControlError.requestTimedOut(type: type, seconds: timeoutSeconds)))
         }
     }
 
@@ -957,7 +1664,12 @@ class VPhoneControl {
 
     @discardableResult
     private func writeMessage(fd: Int32, dict: [String: Any]) -> Bool {
+        let start = DispatchTime.now().uptimeNanoseconds
         guard let json = try? JSONSerialization.data(withJSONObject: dict) else { return false }
+        stats.recordSend(
+            type: dict["t"] as? String ?? "unknown", bytes: 4 + json.count,
+            serializeNanos: DispatchTime.now().uptimeNanoseconds - start
+        )
         let length = UInt32(json.count)
         var header = length.bigEndian
         let headerOK = withUnsafeBytes(of: &header) { buf in
@@ -969,6 +1681,39 @@ class VPhoneControl {
         }
     }
 
+    // MARK: - Framing: Binary Fast Path
+
+    /// Opcodes for host → guest binary frames. Body layouts match the
+    /// `vp_bin_*_t` structs in vphoned_protocol.h (little-endian, packed).
+    private enum BinaryOp: UInt8 {
+        case touch = 1
+        case hid = 2
+        case location = 3
+    }
+
+    private static let binaryFrameFlag: UInt32 = 0x8000_0000
+    private static let binaryHeaderSize = 8
+
+    /// Write one binary frame with a single `write`. The frame is built in a
+    /// zeroed stack buffer; `fill` stores the `bodySize`-byte body.
+    @discardableResult
+    private func writeBinary(
+        fd: Int32, op: BinaryOp, bodySize: Int, fill: (UnsafeMutableRawBufferPointer) -> Void
+    ) -> Bool {
+        nextRequestId += 1
+        let seq = UInt32(truncatingIfNeeded: nextRequestId)
+        let frameSize = Self.binaryHeaderSize + bodySize
+        return withUnsafeTemporaryAllocation(byteCount: 4 + frameSize, alignment: 8) { buf in
+            buf.initializeMemory(as: UInt8.self, repeating: 0)
+            buf.storeBytes(of: (UInt32(frameSize) | Self.binaryFrameFlag).bigEndian, as: UInt32.self)
+            buf.storeBytes(of: op.rawValue, toByteOffset: 4, as: UInt8.self)
+            buf.storeBytes(of: UInt16(bodySize).littleEndian, toByteOffset: 6, as: UInt16.self)
+            buf.storeBytes(of: seq.littleEndian, toByteOffset: 8, as: UInt32.self)
+            fill(UnsafeMutableRawBufferPointer(rebasing: buf[(4 + Self.binaryHeaderSize)...]))
+            return Self.writeFully(fd: fd, buf: buf.baseAddress!, count: buf.count)
+        }
+    }
+
     private nonisolated static func readMessage(fd: Int32) -> [String: Any]? {
         var header: UInt32 = 0
         let hRead = withUnsafeMutableBytes(of: &header) { buf in
@@ -1013,3 +1758,167 @@ class VPhoneControl {
         _ = Darwin.shutdown(fd, SHUT_RDWR)
     }
 }
+
+// MARK: - Control Frame Reader
+
+/// Event-driven reader for guest → host control frames.
+///
+/// A read source on the control queue drains whatever the socket holds into
+/// one reusable buffer and cuts complete messages out of it, together with
+/// the inline payload that follows `payload`, `file_data` and image
+/// `clipboard_get` messages. No thread parks in `read`, and frames are delivered on that
+/// queue instead of hopping to main.
+private final class ControlFrameReader: @unchecked Sendable {
+    private static let initialCapacity = 64 * 1024
+    /// Capacity kept after a large payload drains; above it the buffer
+    /// drops back to `initialCapacity`.
+    private static let retainedCapacity = 4 * 1024 * 1024
+    private static let minimumRead = 16 * 1024
+    private static let maxMessageLength = 4 * 1024 * 1024
+
+    private let fd: Int32
+    private let source: DispatchSourceRead
+    private let onFrame: @Sendable ([String: Any], Data?, Int) -> Void
+    private let onClose: @Sendable () -> Void
+    /// Owner of `fd`, held until the source is cancelled so the descriptor
+    /// is not closed while still registered.
+    private var keepAlive: AnyObject?
+
+    private var buffer: UnsafeMutableRawPointer
+    private var capacity: Int
+    /// Unconsumed bytes are `buffer[head ..< tail]`.
+    private var head = 0
+    private var tail = 0
+    /// Message whose inline payload is still arriving, the payload size and
+    /// the size of the message frame itself.
+    private var awaiting: (message: [String: Any], size: Int, frameBytes: Int)?
+    private var closed = false
+
+    init(
+        fd: Int32, queue: DispatchQueue, keepAlive: AnyObject?,
+        onFrame: @escaping @Sendable ([String: Any], Data?, Int) -> Void,
+        onClose: @escaping @Sendable () -> Void
+    ) {
+        self.fd = fd
+        self.keepAlive = keepAlive
+        self.onFrame = onFrame
+        self.onClose = onClose
+        capacity = Self.initialCapacity
+        buffer = .allocate(byteCount: capacity, alignment: 8)
+        source = DispatchSource.makeReadSource(fileDescriptor: fd, queue: queue)
+        // The handlers retain the reader until the source is cancelled.
+        source.setEventHandler { self.readAvailable() }
+        source.setCancelHandler { self.keepAlive = nil }
+        source.resume()
+    }
+
+    deinit {
+        buffer.deallocate()
+    }
+
+    /// Stop reading without calling `onClose`. Safe from any thread.
+    func cancel() {
+        source.cancel()
+    }
+
+    private func close() {
+        guard !closed else { return }
+        closed = true
+        source.cancel()
+        onClose()
+    }
+
+    private func readAvailable() {
+        guard !closed, !source.isCancelled else { return }
+        reserve(free: Self.minimumRead)
+        let n = Darwin.read(fd, buffer + tail, capacity - tail)
+        if n < 0, errno == EINTR || errno == EAGAIN { return }
+        guard n > 0 else { return close() }
+        tail += n
+        drainFrames()
+    }
+
+    /// Deliver every complete frame in the buffer.
+    private func drainFrames() {
+        while !closed {
+            let live = tail - head
+            if let pending = awaiting {
+                guard live >= pending.size else {
+                    reserve(free: pending.size - live)
+                    break
+                }
+                let payload = Data(bytes: buffer + head, count: pending.size)
+                head += pending.size
+                awaiting = nil
+                onFrame(pending.message, payload, pending.frameBytes + pending.size)
+                continue
+            }
+
+            guard live >= 4 else { break }
+            let length = Int(UInt32(bigEndian: buffer.loadUnaligned(fromByteOffset: head, as: UInt32.self)))
+            guard length > 0, length < Self.maxMessageLength else { return close() }
+            guard live >= 4 + length else {
+                reserve(free: 4 + length - live)
+                break
+            }
+            let json = Data(bytesNoCopy: buffer + head + 4, count: length, deallocator: .none)
+            let message = (try? JSONSerialization.jsonObject(with: json)) as? [String: Any]
+            head += 4 + length
+            guard let message else { return close() }
+
+            switch Self.inlinePayloadSize(of: message) {
+            case nil:
+                onFrame(message, nil, 4 + length)
+            case 0?:
+                onFrame(message, Data(), 4 + length)
+            case let size?:
+                guard size > 0 else { return close() }
+                awaiting = (message, size, 4 + length)
+            }
+        }
+
+        if head == tail {
+            head = 0
+            tail = 0
+            if awaiting == nil, capacity > Self.retainedCapacity {
+                buffer.deallocate()
+                capacity = Self.initialCapacity
+                buffer = .allocate(byteCount: capacity, alignment: 8)
+            }
+        }
+    }
+
+    /// Size of the raw payload that follows `message` on the wire, if any.
+    private static func inlinePayloadSize(of message: [String: Any]) -> Int? {
+        // A chunked response's bytes already arrived as `payload` frames.
+        if message["chunked"] as? Bool == true { return nil }
+        switch message["t"] as? String {
+        case "payload", "file_data":
+            return message["size"] as? Int ?? 0
+        case "clipboard_get" where message["has_image"] as? Bool == true:
+            let size = message["image_size"] as? Int ?? 0
+            return size != 0 ? size : nil
+        default:
+            return nil
+        }
+    }
+
+    /// Ensure at least `free` writable bytes after `tail`, compacting before
+    /// growing so one allocation is reused across frames.
+    private func reserve(free: Int) {
+        guard capacity - tail < free else { return }
+        let live = tail - head
+        if head > 0 {
+            memmove(buffer, buffer + head, live)
+            head = 0
+            tail = live
+        }
+        guard capacity - tail < free else { return }
+        let grown = max(capacity * 2, tail + free)
+        let next = UnsafeMutableRawPointer.allocate(byteCount: grown, alignment: 8)
+        next.copyMemory(from: buffer, byteCount: live)
+        buffer.deallocate()
+        buffer = next
+        capacity = grown
+    }
+}
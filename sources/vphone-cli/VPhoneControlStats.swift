@@ -0,0 +1,126 @@
+import Foundation
+import os
+
+// MARK: - Control Channel Stats
+
+/// Host-side per-command counters for the vphoned control channel.
+///
+/// Every request records its round trip (write to response), the time spent
+/// encoding its JSON, bytes written and bytes received, and whether it failed
+/// or timed out. Round trips also land in log2 microsecond histograms that
+/// line up with the guest's `stats` buckets, so the two can be read side by
+/// side. Each request is an `OSSignposter` interval ("request") on the
+/// `com.vphone.cli` subsystem for Instruments.
+final class VPhoneControlStats: @unchecked Sendable {
+    /// Histogram bucket `i` holds samples in [2^(i-1), 2^i) µs; bucket 0 is
+    /// under 1 µs and the last bucket is open-ended.
+    static let bucketCount = 24
+
+    struct Entry {
+        var count = 0
+        var errors = 0
+        var timeouts = 0
+        var bytesOut: UInt64 = 0
+        var bytesIn: UInt64 = 0
+        var serializeNanos: UInt64 = 0
+        var roundTripNanos: UInt64 = 0
+        var roundTripMaxNanos: UInt64 = 0
+        var buckets = [Int](repeating: 0, count: VPhoneControlStats.bucketCount)
+
+        var meanRoundTripMicros: Double {
+            count > 0 ? Double(roundTripNanos) / Double(count) / 1000 : 0
+        }
+
+        /// Upper bound of the bucket holding the `q` quantile, in µs.
+        func roundTripPercentileMicros(_ q: Double) -> Double {
+            let total = buckets.reduce(0, +)
+            guard total > 0 else { return 0 }
+            let rank = Int((Double(total) * q).rounded(.up))
+            var seen = 0
+            for (i, n) in buckets.enumerated() {
+                seen += n
+                if seen >= max(rank, 1) { return Double(UInt64(1) << i) }
+            }
+            return Double(roundTripMaxNanos) / 1000
+        }
+    }
+
+    static let signposter = OSSignposter(subsystem: "com.vphone.cli", category: "control")
+
+    private let lock = NSLock()
+    private var entries: [String: Entry] = [:]
+    private var since = DispatchTime.now().uptimeNanoseconds
+
+    /// Snapshot of every entry and the milliseconds they cover.
+    var snapshot: (entries: [String: Entry], windowMillis: UInt64) {
+        lock.withLock { (entries, (DispatchTime.now().uptimeNanoseconds - since) / 1_000_000) }
+    }
+
+    func reset() {
+        lock.withLock {
+            entries.removeAll()
+            since = DispatchTime.now().uptimeNanoseconds
+        }
+    }
+
+    /// A frame or inline payload written for `type`.
+    func recordSend(type: String, bytes: Int, serializeNanos: UInt64 = 0) {
+        lock.withLock {
+            entries[type, default: Entry()].bytesOut += UInt64(bytes)
+            entries[type, default: Entry()].serializeNanos += serializeNanos
+        }
+    }
+
+    /// A finished request. `bytesIn` is the response frame plus payload.
+    func recordCompletion(type: String, roundTripNanos: UInt64, bytesIn: Int, failed: Bool, timedOut: Bool) {
+        let micros = roundTripNanos / 1000
+        let bucket = micros == 0 ? 0 : min(Self.bucketCount - 1, 64 - micros.leadingZeroBitCount)
+        lock.withLock {
+            var entry = entries[type, default: Entry()]
+            entry.count += 1
+            if failed { entry.errors += 1 }
+            if timedOut { entry.timeouts += 1 }
+            entry.bytesIn += UInt64(bytesIn)
+            entry.roundTripNanos += roundTripNanos
+            entry.roundTripMaxNanos = max(entry.roundTripMaxNanos, roundTripNanos)
+            entry.buckets[bucket] += 1
+            entries[type] = entry
+        }
+    }
+
+    /// Plain-text table of the host entries, busiest first.
+    func report() -> String {
+        let (entries, window) = snapshot
+        var lines = ["host (\(window / 1000)s window): type count err/timeout rtt mean/p50/p99/max µs  out/in bytes"]
+        for (type, e) in entries.sorted(by: { $0.value.count > $1.value.count }) {
+            lines.append(String(
+                format: "  %@ %ld %ld/%ld %.0f/%.0f/%.0f/%.0f  %llu/%llu",
+                type, e.count, e.errors, e.timeouts, e.meanRoundTripMicros,
+                e.roundTripPercentileMicros(0.5), e.roundTripPercentileMicros(0.99),
+                Double(e.roundTripMaxNanos) / 1000, e.bytesOut, e.bytesIn
+            ))
+        }
+        return lines.joined(separator: "\n")
+    }
+
+    /// Plain-text table of a guest `stats` response, busiest first.
+    static func report(guest resp: [String: Any]) -> String {
+        let commands = resp["commands"] as? [String: [String: Any]] ?? [:]
+        let window = (resp["window_ms"] as? NSNumber)?.uint64Value ?? 0
+        var lines = ["guest (\(window / 1000)s window): type count err queue/handle/serialize p50 µs, handle p99  in/out bytes"]
+        let num = { (entry: [String: Any], key: String, field: String) -> Double in
+            ((entry[key] as? [String: Any])?[field] as? NSNumber)?.doubleValue ?? 0
+        }
+        let sorted = commands.sorted { ($0.value["count"] as? Int ?? 0) > ($1.value["count"] as? Int ?? 0) }
+        for (type, e) in sorted {
+            lines.append(String(
+                format: "  %@ %ld %ld %.0f/%.0f/%.0f, %.0f  %llu/%llu",
+                type, e["count"] as? Int ?? 0, e["errors"] as? Int ?? 0,
+                num(e, "queue_us", "p50"), num(e, "handle_us", "p50"), num(e, "serialize_us", "p50"),
+                num(e, "handle_us", "p99"),
+                (e["bytes_in"] as? NSNumber)?.uint64Value ?? 0, (e["bytes_out"] as? NSNumber)?.uint64Value ?? 0
+            ))
+        }
+        return lines.joined(separator: "\n")
+    }
+}
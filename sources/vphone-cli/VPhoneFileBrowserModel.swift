@@ -145,9 +145,17 @@ class VPhoneFileBrowserModel {
     func refresh() async {
         isLoading = true
         error = nil
+        let path = currentPath
         do {
-            let entries = try await control.listFiles(path: currentPath)
-            files = entries.compactMap { VPhoneRemoteFile(dir: currentPath, entry: $0) }
+            // Show the first page right away, then append the rest for as
+            // long as the user stays in this directory.
+            var page = try await control.listFilesPage(path: path)
+            files = page.entries
+            while let cursor = page.nextCursor, currentPath == path {
+                page = try await control.listFilesPage(path: path, cursor: cursor)
+                guard currentPath == path else { break }
+                files.append(contentsOf: page.entries)
+            }
         } catch {
             self.error = "\(error)"
             files = []
@@ -175,11 +183,12 @@ class VPhoneFileBrowserModel {
         transferTotal = Int64(size)
         transferCurrent = 0
         do {
-            let data = try await control.downloadFile(path: remotePath)
-            transferCurrent = Int64(data.count)
             let dest = directory.appendingPathComponent(name)
-            try data.write(to: dest)
-            print("[files] downloaded \(remotePath) (\(data.count) bytes)")
+            try await control.downloadFile(path: remotePath, to: dest) { [weak self] received, total in
+                self?.transferCurrent = received
+                self?.transferTotal = total
+            }
+            print("[files] downloaded \(remotePath) (\(transferCurrent) bytes)")
         } catch {
             self.error = "Download failed: \(error)"
         }
@@ -194,15 +203,14 @@ class VPhoneFileBrowserModel {
             return
         }
 
-        let entries: [[String: Any]]
+        let children: [VPhoneRemoteFile]
         do {
-            entries = try await control.listFiles(path: remotePath)
+            children = try await control.listAllFiles(path: remotePath)
         } catch {
             self.error = "List directory failed: \(error)"
             return
         }
 
-        let children = entries.compactMap { VPhoneRemoteFile(dir: remotePath, entry: $0) }
         for child in children {
             if child.isDirectory {
                 await downloadDirectory(remotePath: child.path, name: child.name, to: localDir)
@@ -219,18 +227,20 @@ class VPhoneFileBrowserModel {
         var uploadError: String?
         for url in urls {
             let name = url.lastPathComponent
-            guard let data = try? Data(contentsOf: url) else {
+            guard FileManager.default.isReadableFile(atPath: url.path) else {
                 uploadError = "Could not read \"\(name)\" from disk."
                 break
             }
             let dest = (currentPath as NSString).appendingPathComponent(name)
             transferName = name
-            transferTotal = Int64(data.count)
+            transferTotal = 0
             transferCurrent = 0
             do {
-                try await control.uploadFile(path: dest, data: data)
-                transferCurrent = Int64(data.count)
-                print("[files] uploaded \(name) (\(data.count) bytes)")
+                try await control.uploadFile(path: dest, from: url) { [weak self] sent, total in
+                    self?.transferCurrent = sent
+                    self?.transferTotal = total
+                }
+                print("[files] uploaded \(name) (\(transferTotal) bytes)")
             } catch {
                 uploadError = "Upload failed for \"\(name)\": \(error)"
                 break
@@ -1,16 +1,80 @@
+import Accelerate
 import AVFoundation
-import CoreGraphics
-import CoreImage
 import CoreVideo
 import Foundation
 
 /// A single BGRA frame produced by a frame source.
-struct VPhoneCameraFrame: Sendable {
+///
+/// Pixels live in a `CVPixelBuffer`, normally drawn from a producer's
+/// `VPhoneFramePool`, so a frame that has been sent and dropped returns
+/// its IOSurface to the pool instead of being freed. `@unchecked Sendable`
+/// because the buffer is written once by the producer and only read after
+/// that.
+struct VPhoneCameraFrame: @unchecked Sendable {
     let width: Int
     let height: Int
     let bytesPerRow: Int
     let timestampNS: UInt64
-    let pixels: Data
+    let pixelBuffer: CVPixelBuffer
+
+    init(pixelBuffer: CVPixelBuffer, timestampNS: UInt64) {
+        self.pixelBuffer = pixelBuffer
+        self.width = CVPixelBufferGetWidth(pixelBuffer)
+        self.height = CVPixelBufferGetHeight(pixelBuffer)
+        self.bytesPerRow = CVPixelBufferGetBytesPerRow(pixelBuffer)
+        self.timestampNS = timestampNS
+    }
+
+    /// Calls `body` with the frame's pixel bytes (`bytesPerRow * height`)
+    /// while the buffer is locked read-only.
+    func withPixels<R>(_ body: (UnsafeRawBufferPointer) -> R) -> R {
+        CVPixelBufferLockBaseAddress(pixelBuffer, .readOnly)
+        defer { CVPixelBufferUnlockBaseAddress(pixelBuffer, .readOnly) }
+        let base = CVPixelBufferGetBaseAddress(pixelBuffer)
+        return body(UnsafeRawBufferPointer(start: base, count: base == nil ? 0 : bytesPerRow * height))
+    }
+}
+
+/// IOSurface-backed BGRA buffer pool for one output size.
+///
+/// Buffers go back to the pool when the last frame referencing them is
+/// released, so steady-state production allocates nothing. The allocation
+/// threshold bounds how many frames can be in flight; past it `make()`
+/// returns nil and the tick is dropped rather than growing the pool.
+final class VPhoneFramePool: @unchecked Sendable {
+    static let maxInFlight = 4
+
+    private let pool: CVPixelBufferPool
+
+    init?(width: Int, height: Int) {
+        let pixelAttrs: [String: Any] = [
+            kCVPixelBufferPixelFormatTypeKey as String: Int(kCVPixelFormatType_32BGRA),
+            kCVPixelBufferWidthKey as String: width,
+            kCVPixelBufferHeightKey as String: height,
+            kCVPixelBufferBytesPerRowAlignmentKey as String: 16,
+            kCVPixelBufferIOSurfacePropertiesKey as String: [String: Any](),
+        ]
+        let poolAttrs: [String: Any] = [
+            kCVPixelBufferPoolMinimumBufferCountKey as String: 2,
+        ]
+        var pool: CVPixelBufferPool?
+        guard CVPixelBufferPoolCreate(
+            kCFAllocatorDefault, poolAttrs as CFDictionary, pixelAttrs as CFDictionary, &pool
+        ) == kCVReturnSuccess, let pool
+        else { return nil }
+        self.pool = pool
+    }
+
+    func make() -> CVPixelBuffer? {
+        let aux: [String: Any] = [
+            kCVPixelBufferPoolAllocationThresholdKey as String: Self.maxInFlight,
+        ]
+        var buffer: CVPixelBuffer?
+        let status = CVPixelBufferPoolCreatePixelBufferWithAuxAttributes(
+            kCFAllocatorDefault, pool, aux as CFDictionary, &buffer)
+        guard status == kCVReturnSuccess else { return nil }
+        return buffer
+    }
 }
 
 /// Frame source for the host-side virtual camera server.
@@ -32,48 +96,43 @@ protocol VPhoneFrameProducer: AnyObject, Sendable {
 final class VPhoneTestPatternProducer: VPhoneFrameProducer, @unchecked Sendable {
     private let width: Int
     private let height: Int
-    private let bytesPerRow: Int
+    private let pool: VPhoneFramePool?
     private var frameIndex: UInt64 = 0
     private let startedAt: TimeInterval
 
     init(width: Int, height: Int) {
         self.width = width
         self.height = height
-        // Round bytesPerRow up to 16-byte alignment — common requirement for
-        // IOSurfaces and BGRA hardware paths. For 1280 width: 1280*4 = 5120
-        // (already 16-aligned).
-        let stride = ((width * 4) + 15) & ~15
-        self.bytesPerRow = stride
+        // The pool rounds bytesPerRow up to 16-byte alignment — common
+        // requirement for IOSurfaces and BGRA hardware paths.
+        self.pool = VPhoneFramePool(width: width, height: height)
         self.startedAt = ProcessInfo.processInfo.systemUptime
     }
 
     func nextFrame() -> VPhoneCameraFrame? {
+        guard let pb = pool?.make() else { return nil }
         let now = ProcessInfo.processInfo.systemUptime
         let elapsed = now - startedAt
-        let pixelCount = bytesPerRow * height
-        var bytes = [UInt8](repeating: 0, count: pixelCount)
 
-        // Vertical gradient. Hue rolls with time.
+        CVPixelBufferLockBaseAddress(pb, [])
+        defer { CVPixelBufferUnlockBaseAddress(pb, []) }
+        guard let base = CVPixelBufferGetBaseAddress(pb) else { return nil }
+        let bytesPerRow = CVPixelBufferGetBytesPerRow(pb)
+
+        // Vertical gradient. Hue rolls with time. Every pixel in a row is
+        // the same colour, so each row is one pattern fill.
         let hueOffset = elapsed * 0.4  // turns per second
         for y in 0..<height {
             let v = Double(y) / Double(height)
             // Simple HSV → RGB on hue, full sat/val.
             let h = (v + hueOffset).truncatingRemainder(dividingBy: 1.0)
             let (r, g, b) = Self.hsvToRGB(h: h, s: 0.85, v: 0.85)
-            let rB = UInt8(min(255, max(0, Int(r * 255))))
-            let gB = UInt8(min(255, max(0, Int(g * 255))))
-            let bB = UInt8(min(255, max(0, Int(b * 255))))
-
-            let rowStart = y * bytesPerRow
-            var idx = rowStart
+            let rB = UInt32(min(255, max(0, Int(r * 255))))
+            let gB = UInt32(min(255, max(0, Int(g * 255))))
+            let bB = UInt32(min(255, max(0, Int(b * 255))))
             // BGRA order on little-endian Apple platforms.
-            for _ in 0..<width {
-                bytes[idx + 0] = bB  // B
-                bytes[idx + 1] = gB  // G
-                bytes[idx + 2] = rB  // R
-                bytes[idx + 3] = 255  // A
-                idx += 4
-            }
+            Self.fill(base.advanced(by: y * bytesPerRow), pixels: width,
+                      bgra: bB | (gB << 8) | (rB << 16) | (0xFF << 24))
         }
 
         // Counter overlay: a moving small white square (poor man's frame
@@ -82,24 +141,17 @@ final class VPhoneTestPatternProducer: VPhoneFrameProducer, @unchecked Sendable
         let xPos = Int(elapsed * 200) % max(1, width - sqSize)
         let yPos = max(8, (height - sqSize) / 8)
         for dy in 0..<sqSize {
-            let row = (yPos + dy) * bytesPerRow
-            for dx in 0..<sqSize {
-                let off = row + (xPos + dx) * 4
-                bytes[off + 0] = 255
-                bytes[off + 1] = 255
-                bytes[off + 2] = 255
-                bytes[off + 3] = 255
-            }
+            Self.fill(base.advanced(by: (yPos + dy) * bytesPerRow + xPos * 4),
+                      pixels: sqSize, bgra: 0xFFFF_FFFF)
         }
 
         frameIndex &+= 1
-        let ts = UInt64(now * 1_000_000_000)
-        return VPhoneCameraFrame(
-            width: width,
-            height: height,
-            bytesPerRow: bytesPerRow,
-            timestampNS: ts,
-            pixels: Data(bytes))
+        return VPhoneCameraFrame(pixelBuffer: pb, timestampNS: UInt64(now * 1_000_000_000))
+    }
+
+    private static func fill(_ dst: UnsafeMutableRawPointer, pixels: Int, bgra: UInt32) {
+        var pattern = bgra
+        memset_pattern4(dst, &pattern, pixels * 4)
     }
 
     // MARK: - HSV helpers
@@ -129,30 +181,35 @@ final class VPhoneTestPatternProducer: VPhoneFrameProducer, @unchecked Sendable
 /// (`.mkv`, `.webm`, `.avi`) convert externally first
 /// (e.g. `ffmpeg -i in.mkv -c copy out.mov` if codecs are compatible).
 ///
-/// The producer rescales the input video to the configured camera
-/// width/height using a Core Image render so the wire-format payload
-/// length stays constant regardless of the source resolution. Output is
-/// always 8-bit BGRA, top-down, 16-byte aligned bytesPerRow.
+/// Frames whose size already matches are passed through as the reader's
+/// own pixel buffers (no copy). Anything else is rescaled with vImage into
+/// a pooled buffer at the configured camera width/height, so the
+/// wire-format payload length stays constant regardless of the source
+/// resolution. Output is always 8-bit BGRA, top-down.
 final class VPhoneVideoFileProducer: VPhoneFrameProducer, @unchecked Sendable {
     private let url: URL
     private let width: Int
     private let height: Int
-    private let bytesPerRow: Int
     private var asset: AVURLAsset
     private var reader: AVAssetReader?
     private var readerOutput: AVAssetReaderTrackOutput?
-    private let ciContext: CIContext
+    private let pool: VPhoneFramePool?
+    private var scaleTemp: UnsafeMutableRawPointer?
+    private var scaleTempSize = 0
 
     init(url: URL, width: Int, height: Int) throws {
         self.url = url
         self.width = width
         self.height = height
-        self.bytesPerRow = ((width * 4) + 15) & ~15
         self.asset = AVURLAsset(url: url)
-        self.ciContext = CIContext(options: [.useSoftwareRenderer: false])
+        self.pool = VPhoneFramePool(width: width, height: height)
         try restartReader()
     }
 
+    deinit {
+        scaleTemp?.deallocate()
+    }
+
     private func restartReader() throws {
         guard let track = asset.tracks(withMediaType: .video).first else {
             throw NSError(
@@ -166,6 +223,7 @@ final class VPhoneVideoFileProducer: VPhoneFrameProducer, @unchecked Sendable {
             outputSettings: [
                 kCVPixelBufferPixelFormatTypeKey as String:
                     Int(kCVPixelFormatType_32BGRA),
+                kCVPixelBufferIOSurfacePropertiesKey as String: [String: Any](),
             ])
         output.alwaysCopiesSampleData = false
         r.add(output)
@@ -191,59 +249,49 @@ final class VPhoneVideoFileProducer: VPhoneFrameProducer, @unchecked Sendable {
             do { try restartReader() } catch {}
             return nil
         }
-
-        let srcWidth = CVPixelBufferGetWidth(pb)
-        let srcHeight = CVPixelBufferGetHeight(pb)
+        let ts = UInt64(ProcessInfo.processInfo.systemUptime * 1e9)
 
         // Fast path: source already matches our requested dimensions and is
-        // BGRA — copy the planar bytes directly without going through Core
-        // Image. Saves the GPU render.
-        if srcWidth == width, srcHeight == height,
-            CVPixelBufferGetPixelFormatType(pb) == kCVPixelFormatType_32BGRA {
-            CVPixelBufferLockBaseAddress(pb, .readOnly)
-            defer { CVPixelBufferUnlockBaseAddress(pb, .readOnly) }
-            let srcBPR = CVPixelBufferGetBytesPerRow(pb)
-            guard let base = CVPixelBufferGetBaseAddress(pb) else { return nil }
-            var out = Data(count: bytesPerRow * height)
-            out.withUnsafeMutableBytes { dst in
-                let dstBase = dst.baseAddress!
-                for y in 0..<height {
-                    let dstRow = dstBase.advanced(by: y * bytesPerRow)
-                    let srcRow = base.advanced(by: y * srcBPR)
-                    let copyLen = min(srcBPR, bytesPerRow)
-                    memcpy(dstRow, srcRow, copyLen)
-                }
-            }
-            return VPhoneCameraFrame(
-                width: width, height: height,
-                bytesPerRow: bytesPerRow,
-                timestampNS: UInt64(ProcessInfo.processInfo.systemUptime * 1e9),
-                pixels: out)
+        // BGRA — hand the decoder's buffer straight through.
+        if CVPixelBufferGetWidth(pb) == width, CVPixelBufferGetHeight(pb) == height,
+           CVPixelBufferGetPixelFormatType(pb) == kCVPixelFormatType_32BGRA {
+            return VPhoneCameraFrame(pixelBuffer: pb, timestampNS: ts)
+        }
+
+        // Slow path: stretch-to-fit with vImage into a pooled buffer. Pick
+        // an aspect strategy here if you want letterboxing instead.
+        guard let out = pool?.make() else { return nil }
+        CVPixelBufferLockBaseAddress(pb, .readOnly)
+        CVPixelBufferLockBaseAddress(out, [])
+        defer {
+            CVPixelBufferUnlockBaseAddress(out, [])
+            CVPixelBufferUnlockBaseAddress(pb, .readOnly)
         }
+        var src = vImage_Buffer(
+            data: CVPixelBufferGetBaseAddress(pb),
+            height: vImagePixelCount(CVPixelBufferGetHeight(pb)),
+            width: vImagePixelCount(CVPixelBufferGetWidth(pb)),
+            rowBytes: CVPixelBufferGetBytesPerRow(pb))
+        var dst = vImage_Buffer(
+            data: CVPixelBufferGetBaseAddress(out),
+            height: vImagePixelCount(height),
+            width: vImagePixelCount(width),
+            rowBytes: CVPixelBufferGetBytesPerRow(out))
+        guard src.data != nil, dst.data != nil else { return nil }
 
-        // Slow path: resize via Core Image. Stretches to fit; pick aspect
-        // strategy here if you want letterboxing instead.
-        let srcImage = CIImage(cvPixelBuffer: pb)
-        let scaleX = CGFloat(width) / CGFloat(srcWidth)
-        let scaleY = CGFloat(height) / CGFloat(srcHeight)
-        let scaled = srcImage.transformed(
-            by: CGAffineTransform(scaleX: scaleX, y: scaleY))
-
-        var out = Data(count: bytesPerRow * height)
-        out.withUnsafeMutableBytes { dst in
-            let dstBase = dst.baseAddress!
-            ciContext.render(
-                scaled,
-                toBitmap: dstBase,
-                rowBytes: bytesPerRow,
-                bounds: CGRect(x: 0, y: 0, width: width, height: height),
-                format: .BGRA8,
-                colorSpace: CGColorSpaceCreateDeviceRGB())
+        // vImage would otherwise malloc its scratch on every call.
+        let flags = vImage_Flags(kvImageHighQualityResampling)
+        let needed = vImageScale_ARGB8888(&src, &dst, nil, flags | vImage_Flags(kvImageGetTempBufferSize))
+        if needed > scaleTempSize {
+            scaleTemp?.deallocate()
+            scaleTemp = UnsafeMutableRawPointer.allocate(byteCount: needed, alignment: 64)
+            scaleTempSize = needed
+        }
+        let err = vImageScale_ARGB8888(&src, &dst, scaleTemp, flags)
+        guard err == kvImageNoError else {
+            print("[camera] vImage scale failed: \(err)")
+            return nil
         }
-        return VPhoneCameraFrame(
-            width: width, height: height,
-            bytesPerRow: bytesPerRow,
-            timestampNS: UInt64(ProcessInfo.processInfo.systemUptime * 1e9),
-            pixels: out)
+        return VPhoneCameraFrame(pixelBuffer: out, timestampNS: ts)
     }
 }
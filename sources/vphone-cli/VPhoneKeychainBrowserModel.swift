@@ -15,6 +15,8 @@ class VPhoneKeychainBrowserModel {
     var sortOrder = [KeyPathComparator(\VPhoneKeychainItem.displayName)]
     var filterClass: String?
     var showDiagnostics = false
+    /// Change token from the last listing; refreshes fetch only deltas.
+    private var changeToken: [String: Any]?
 
     init(control: VPhoneControl) {
         self.control = control
@@ -87,15 +89,31 @@ class VPhoneKeychainBrowserModel {
         isLoading = true
         error = nil
         do {
-            let result = try await control.listKeychainItems()
-            items = result.items.enumerated().compactMap { VPhoneKeychainItem(index: $0.offset, entry: $0.element) }
-            diagnostics = result.diagnostics
+            let result = try await control.listKeychainItems(since: changeToken)
+            if result.isDelta {
+                if !result.isUnchanged {
+                    let changed = result.items.enumerated().compactMap {
+                        VPhoneKeychainItem(index: $0.offset, entry: $0.element)
+                    }
+                    let changedIDs = Set(changed.map(\.id))
+                    items = items.filter { item in
+                        !changedIDs.contains(item.id)
+                            && result.liveRowids[item.itemClass].map { $0.contains(item.rowid) } ?? true
+                    } + changed
+                    diagnostics = result.diagnostics
+                }
+            } else {
+                items = result.items.enumerated().compactMap { VPhoneKeychainItem(index: $0.offset, entry: $0.element) }
+                diagnostics = result.diagnostics
+            }
+            changeToken = result.token
             if items.isEmpty, !diagnostics.isEmpty {
                 print("[keychain] 0 items, diag: \(diagnostics)")
             }
         } catch {
             self.error = "\(error)"
             items = []
+            changeToken = nil
         }
         isLoading = false
     }
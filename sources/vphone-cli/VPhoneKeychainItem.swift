@@ -2,6 +2,8 @@ import Foundation
 
 struct VPhoneKeychainItem: Identifiable, Hashable {
     let id: String
+    /// Row in the guest's keychain table (`index` for sources without one).
+    let rowid: Int
     let itemClass: String
     let account: String
     let service: String
@@ -127,7 +129,7 @@ extension VPhoneKeychainItem {
             modified = nil
         }
 
-        let rowid = (entry["_rowid"] as? NSNumber)?.intValue ?? index
+        rowid = (entry["_rowid"] as? NSNumber)?.intValue ?? index
         id = "\(cls)-\(rowid)"
     }
 }
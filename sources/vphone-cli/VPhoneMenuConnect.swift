@@ -37,6 +37,11 @@ extension VPhoneMenuController {
         connectGuestVersionItem = guestVersion
         menu.addItem(guestVersion)
 
+        let stats = makeItem("Connection Stats", action: #selector(showConnectionStats))
+        stats.isEnabled = false
+        connectStatsItem = stats
+        menu.addItem(stats)
+
         menu.addItem(NSMenuItem.separator())
 
         let clipGet = makeItem("Get Clipboard", action: #selector(getClipboard))
@@ -82,6 +87,7 @@ extension VPhoneMenuController {
         connectDevModeStatusItem?.isEnabled = available
         connectPingItem?.isEnabled = available
         connectGuestVersionItem?.isEnabled = available
+        connectStatsItem?.isEnabled = available
     }
 
     @objc func openFiles() {
@@ -129,6 +135,14 @@ extension VPhoneMenuController {
         }
     }
 
+    @objc func showConnectionStats() {
+        Task {
+            let report = await control.statsReport()
+            print("[control] stats\n\(report)")
+            showAlert(title: "Connection Stats", message: report, style: .informational)
+        }
+    }
+
     func updateClipboardAvailability(available: Bool) {
         clipboardGetItem?.isEnabled = available
         clipboardSetItem?.isEnabled = available
@@ -96,4 +96,25 @@ extension VPhoneRemoteFile {
         permissions = entry["perm"] as? String ?? "---"
         modified = Date(timeIntervalSince1970: (entry["mtime"] as? Double) ?? 0)
     }
+
+    /// Parse one row of a columnar `file_list` page. `relativePath` may
+    /// contain subdirectories for recursive listings.
+    init?(root: String, relativePath: String, typeCode: UInt8, size: UInt64, mode: Int, mtime: Double) {
+        let type: FileType
+        switch typeCode {
+        case UInt8(ascii: "d"): type = .directory
+        case UInt8(ascii: "l"), UInt8(ascii: "L"): type = .symbolicLink
+        case UInt8(ascii: "f"): type = .file
+        default: return nil
+        }
+
+        let full = (root as NSString).appendingPathComponent(relativePath) as NSString
+        dir = full.deletingLastPathComponent
+        name = full.lastPathComponent
+        self.type = type
+        symlinkTargetsDirectory = typeCode == UInt8(ascii: "L")
+        self.size = size
+        permissions = String(mode, radix: 8)
+        modified = Date(timeIntervalSince1970: mtime)
+    }
 }
@@ -3,6 +3,8 @@ import ImageIO
 import AVFoundation
 import CoreVideo
 import ObjectiveC.runtime
+import ScreenCaptureKit
+import VideoToolbox
 import Virtualization
 
 // MARK: - Screen Recorder
@@ -37,25 +39,38 @@ class VPhoneScreenRecorder {
     private var writer: AVAssetWriter?
     private var videoInput: AVAssetWriterInput?
     private var adaptor: AVAssetWriterInputPixelBufferAdaptor?
+    private var sink: VPhoneRecordingSink?
+    private var stream: SCStream?
     private var timer: Timer?
-    private var frameCount: Int64 = 0
     private var outputURL: URL?
     private var graphicsDisplay: VZGraphicsDisplay?
     private var captureModeDescription = "private VZGraphicsDisplay screenshots"
     private var screenshotInFlight = false
     private var didLogCaptureFailure = false
+    private var recordingToken: UInt64 = 0
+
+    static let maxFrameRate: Int32 = 60
+    static let fallbackFrameRate = 30.0
 
     var isRecording: Bool {
         writer?.status == .writing
     }
 
+    /// Starts a recording of the VM display.
+    ///
+    /// Frames come from a ScreenCaptureKit stream on the VM window when it
+    /// is available: its IOSurface-backed buffers go straight into the
+    /// HEVC writer with their capture timestamps, so nothing is rasterized
+    /// on the CPU and idle periods cost nothing. Without Screen Recording
+    /// permission it falls back to polling `VZGraphicsDisplay` screenshots.
     func startRecording(view: NSView) throws {
         guard !isRecording else { return }
 
         let source = try resolveCaptureSource(for: view)
         let captureSize = source.graphicsDisplay.sizeInPixels
-        let width = max(Int(captureSize.width), 1)
-        let height = max(Int(captureSize.height), 1)
+        // HEVC wants even dimensions.
+        let width = max(Int(captureSize.width) & ~1, 2)
+        let height = max(Int(captureSize.height) & ~1, 2)
 
         let url = recordingOutputURL()
         outputURL = url
@@ -63,9 +78,15 @@ class VPhoneScreenRecorder {
         let writer = try AVAssetWriter(outputURL: url, fileType: .mov)
 
         let videoSettings: [String: Any] = [
-            AVVideoCodecKey: AVVideoCodecType.h264,
+            AVVideoCodecKey: AVVideoCodecType.hevc,
             AVVideoWidthKey: width,
             AVVideoHeightKey: height,
+            AVVideoCompressionPropertiesKey: [
+                AVVideoExpectedSourceFrameRateKey: Self.maxFrameRate,
+                AVVideoProfileLevelKey: kVTProfileLevel_HEVC_Main_AutoLevel as String,
+                kVTCompressionPropertyKey_RealTime as String: true,
+                AVVideoAllowFrameReorderingKey: false,
+            ],
         ]
         let input = AVAssetWriterInput(mediaType: .video, outputSettings: videoSettings)
         input.expectsMediaDataInRealTime = true
@@ -82,42 +103,55 @@ class VPhoneScreenRecorder {
 
         writer.add(input)
         writer.startWriting()
-        writer.startSession(atSourceTime: .zero)
 
         self.writer = writer
         videoInput = input
         self.adaptor = adaptor
+        sink = VPhoneRecordingSink(writer: writer, adaptor: adaptor)
         graphicsDisplay = source.graphicsDisplay
         captureModeDescription = source.description
-        frameCount = 0
         screenshotInFlight = false
         didLogCaptureFailure = false
-
-        timer = Timer.scheduledTimer(withTimeInterval: 1.0 / 30.0, repeats: true) {
-            [weak self] _ in
-            Task { @MainActor in
-                self?.captureFrame()
+        recordingToken &+= 1
+
+        let token = recordingToken
+        let window = view.window
+        let sourceRect = window.map { Self.sourceRect(of: view, in: $0) }
+        Task { @MainActor in
+            do {
+                guard let window, let sourceRect else { throw CaptureError.captureFailed }
+                try await self.startStreamCapture(
+                    window: window, sourceRect: sourceRect, width: width, height: height, token: token)
+                print("[record] capture source: ScreenCaptureKit window stream")
+            } catch {
+                guard self.recordingToken == token, self.isRecording else { return }
+                print("[record] ScreenCaptureKit unavailable (\(error)); using \(self.captureModeDescription)")
+                self.startScreenshotTimer()
             }
         }
 
-        print(
-            "[record] started - \(url.lastPathComponent) (\(width)x\(height), source: \(captureModeDescription))"
-        )
+        print("[record] started - \(url.lastPathComponent) (\(width)x\(height), hevc)")
     }
 
     func stopRecording() async -> URL? {
         guard let writer, writer.status == .writing else { return nil }
 
+        recordingToken &+= 1
         timer?.invalidate()
         timer = nil
+        if let stream {
+            try? await stream.stopCapture()
+            self.stream = nil
+        }
 
-        videoInput?.markAsFinished()
+        await sink?.finish()
         await writer.finishWriting()
 
         let url = outputURL
         self.writer = nil
         videoInput = nil
         adaptor = nil
+        sink = nil
         outputURL = nil
         graphicsDisplay = nil
         screenshotInFlight = false
@@ -129,6 +163,55 @@ class VPhoneScreenRecorder {
         return url
     }
 
+    // MARK: - ScreenCaptureKit
+
+    private func startStreamCapture(
+        window: NSWindow, sourceRect: CGRect, width: Int, height: Int, token: UInt64
+    ) async throws {
+        let content = try await SCShareableContent.excludingDesktopWindows(false, onScreenWindowsOnly: true)
+        guard let scWindow = content.windows.first(where: { $0.windowID == CGWindowID(window.windowNumber) })
+        else { throw CaptureError.captureFailed }
+
+        let config = SCStreamConfiguration()
+        config.width = width
+        config.height = height
+        config.sourceRect = sourceRect
+        // 420v is what the HEVC encoder consumes natively.
+        config.pixelFormat = kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange
+        config.minimumFrameInterval = CMTime(value: 1, timescale: Self.maxFrameRate)
+        config.queueDepth = 5
+        config.showsCursor = false
+
+        guard recordingToken == token, let sink else { throw CaptureError.captureFailed }
+        let stream = SCStream(
+            filter: SCContentFilter(desktopIndependentWindow: scWindow), configuration: config, delegate: sink)
+        try stream.addStreamOutput(sink, type: .screen, sampleHandlerQueue: sink.queue)
+        try await stream.startCapture()
+        guard recordingToken == token else {
+            try? await stream.stopCapture()
+            throw CaptureError.captureFailed
+        }
+        self.stream = stream
+    }
+
+    /// The VM view's rect in the window's top-left-origin point space,
+    /// which is what `SCStreamConfiguration.sourceRect` expects.
+    private static func sourceRect(of view: NSView, in window: NSWindow) -> CGRect {
+        let rect = view.convert(view.bounds, to: nil)
+        return CGRect(
+            x: rect.minX, y: window.frame.height - rect.maxY,
+            width: rect.width, height: rect.height)
+    }
+
+    private func startScreenshotTimer() {
+        timer = Timer.scheduledTimer(withTimeInterval: 1.0 / Self.fallbackFrameRate, repeats: true) {
+            [weak self] _ in
+            Task { @MainActor in
+                self?.captureFrame()
+            }
+        }
+    }
+
     func copyScreenshotToPasteboard(view: NSView) async throws {
         let cgImage = try await captureStillImage(from: view)
 
@@ -243,9 +326,7 @@ class VPhoneScreenRecorder {
         }
         CVPixelBufferUnlockBaseAddress(pb, [])
 
-        let time = CMTime(value: frameCount, timescale: 30)
-        adaptor.append(pb, withPresentationTime: time)
-        frameCount += 1
+        sink?.appendAsync(pb, at: CMClockGetTime(CMClockGetHostTimeClock()))
     }
 
     private func resolveCaptureSource(for view: NSView) throws -> CaptureSource {
@@ -324,3 +405,72 @@ class VPhoneScreenRecorder {
         FileManager.default.homeDirectoryForCurrentUser.appendingPathComponent("Desktop")
     }
 }
+
+// MARK: - Recording Sink
+
+/// Appends frames to the writer on its own serial queue, which is also the
+/// ScreenCaptureKit sample handler queue. Presentation times are the
+/// capture timestamps; the writer session starts at the first one, so the
+/// file plays back at the pace the display actually changed.
+final class VPhoneRecordingSink: NSObject, SCStreamOutput, SCStreamDelegate, @unchecked Sendable {
+    let queue = DispatchQueue(label: "com.vphone.record.sink", qos: .userInitiated)
+
+    private let writer: AVAssetWriter
+    private let adaptor: AVAssetWriterInputPixelBufferAdaptor
+    private var sessionStarted = false
+    private var lastTime = CMTime.invalid
+    private var finished = false
+
+    init(writer: AVAssetWriter, adaptor: AVAssetWriterInputPixelBufferAdaptor) {
+        self.writer = writer
+        self.adaptor = adaptor
+    }
+
+    func stream(_ stream: SCStream, didOutputSampleBuffer sampleBuffer: CMSampleBuffer, of type: SCStreamOutputType) {
+        guard type == .screen, sampleBuffer.isValid,
+              let attachments = CMSampleBufferGetSampleAttachmentsArray(sampleBuffer, createIfNecessary: false)
+              as? [[SCStreamFrameInfo: Any]],
+              let rawStatus = attachments.first?[.status] as? Int,
+              SCFrameStatus(rawValue: rawStatus) == .complete,
+              let pb = CMSampleBufferGetImageBuffer(sampleBuffer)
+        else { return }
+        append(pb, at: CMSampleBufferGetPresentationTimeStamp(sampleBuffer))
+    }
+
+    func stream(_ stream: SCStream, didStopWithError error: any Error) {
+        print("[record] capture stream stopped: \(error)")
+    }
+
+    func appendAsync(_ pb: CVPixelBuffer, at time: CMTime) {
+        nonisolated(unsafe) let pb = pb
+        queue.async { self.append(pb, at: time) }
+    }
+
+    /// Must run on `queue`.
+    private func append(_ pb: CVPixelBuffer, at time: CMTime) {
+        guard !finished, writer.status == .writing, time.isValid else { return }
+        if lastTime.isValid, time <= lastTime { return }
+        let input = adaptor.assetWriterInput
+        guard input.isReadyForMoreMediaData else { return }
+        if !sessionStarted {
+            writer.startSession(atSourceTime: time)
+            sessionStarted = true
+        }
+        if adaptor.append(pb, withPresentationTime: time) {
+            lastTime = time
+        }
+    }
+
+    func finish() async {
+        await withCheckedContinuation { (continuation: CheckedContinuation<Void, Never>) in
+            queue.async {
+                self.finished = true
+                if !self.sessionStarted {
+                    self.writer.startSession(atSourceTime: .zero)
+                }
+                self.adaptor.assetWriterInput.markAsFinished()
+                continuation.resume()
+            }
+        }
+    }
+}
@@ -194,6 +194,7 @@ class VPhoneVirtualMachineView: VZVirtualMachineView {
     /// Inject a tap at pixel coordinates (matching screenshot image dimensions).
     func injectTap(pixelX: Double, pixelY: Double, screenWidth: Int, screenHeight: Int) {
         let localPoint = pixelToLocal(pixelX: pixelX, pixelY: pixelY, screenWidth: screenWidth, screenHeight: screenHeight)
+        if sendGuestTouchBatch([(0, 0, localPoint), (0.08, 3, localPoint)]) { return }
         let windowPoint = convert(localPoint, to: nil)
 
         if let downEvent = synthesizeMouseEvent(type: .leftMouseDown, at: windowPoint) {
@@ -214,12 +215,22 @@ class VPhoneVirtualMachineView: VZVirtualMachineView {
     ) {
         let startLocal = pixelToLocal(pixelX: fromX, pixelY: fromY, screenWidth: screenWidth, screenHeight: screenHeight)
         let endLocal = pixelToLocal(pixelX: toX, pixelY: toY, screenWidth: screenWidth, screenHeight: screenHeight)
-        let startWindow = convert(startLocal, to: nil)
-        let endWindow = convert(endLocal, to: nil)
-
         let steps = max(10, durationMs / 16)
         let stepInterval = Double(durationMs) / Double(steps) / 1000.0
 
+        let moves: [(at: TimeInterval, phase: Int, point: NSPoint)] = (1...steps).map { i in
+            let t = Double(i) / Double(steps)
+            let pt = NSPoint(
+                x: startLocal.x + (endLocal.x - startLocal.x) * t,
+                y: startLocal.y + (endLocal.y - startLocal.y) * t
+            )
+            return (at: stepInterval * Double(i), phase: i < steps ? 1 : 3, point: pt)
+        }
+        if sendGuestTouchBatch([(0, 0, startLocal)] + moves) { return }
+
+        let startWindow = convert(startLocal, to: nil)
+        let endWindow = convert(endLocal, to: nil)
+
         if let downEvent = synthesizeMouseEvent(type: .leftMouseDown, at: startWindow) {
             mouseDown(with: downEvent)
         }
@@ -249,6 +260,25 @@ class VPhoneVirtualMachineView: VZVirtualMachineView {
         }
     }
 
+    /// Replay a scripted gesture guest-side as one timed `hid_batch`, so its
+    /// pacing no longer depends on main-queue timers. Returns false when
+    /// guest touch injection or batching is unavailable.
+    private func sendGuestTouchBatch(_ steps: [(at: TimeInterval, phase: Int, point: NSPoint)]) -> Bool {
+        guard let control, control.useGuestTouchInjection, control.supportsHIDBatch else { return false }
+        let events = steps.map { step in
+            let p = normalizeCoordinate(step.point)
+            return VPhoneControl.HIDBatchEvent.touch(at: step.at, phase: step.phase, x: Double(p.x), y: Double(p.y))
+        }
+        Task { @MainActor in
+            do {
+                try await control.sendHIDBatch(events)
+            } catch {
+                print("[vphone] hid_batch failed: \(error)")
+            }
+        }
+        return true
+    }
+
     // MARK: - Legacy Touch Injection (macOS 15)
 
     @discardableResult
@@ -259,6 +289,9 @@ class VPhoneVirtualMachineView: VZVirtualMachineView {
         // the 26.x kernel, so route touches through vphoned's guest-side HID
         // injection. 26.x bases fall through to the native VZ multitouch path.
         if let control, control.useGuestTouchInjection {
+            if phase == 0, let fps = window?.screen?.maximumFramesPerSecond, fps > 0 {
+                control.touchMoveInterval = 1.0 / Double(fps)
+            }
             control.sendTouch(phase: phase, x: Double(normalizedPoint.x), y: Double(normalizedPoint.y))
             return true
         }
@@ -261,6 +261,63 @@ struct ARM64InstTests {
     }
 }
 
+/// Fast-path decodes must agree with Capstone on mnemonic and branch target.
+struct ARM64DecoderTests {
+    let disasm = ARM64Disassembler()
+
+    private func word(_ data: Data?) -> UInt32 {
+        data!.withUnsafeBytes { $0.load(as: UInt32.self) }
+    }
+
+    @Test func matchesCapstone() throws {
+        let pc = 0x4000
+        let words: [UInt32] = [
+            ARM64.nopU32, ARM64.retU32, ARM64.retaaU32, ARM64.pacibspU32,
+            word(ARM64Encoder.encodeB(from: pc, to: pc - 0x100)),
+            word(ARM64Encoder.encodeBL(from: pc, to: pc + 0x2000)),
+            word(ARM64Encoder.encodeADRP(rd: 3, pc: UInt64(pc), target: 0x12_3000)),
+            word(ARM64Encoder.encodeAddImm12(rd: 3, rn: 3, imm12: 0x1A8)),
+            0x5400_0021, // b.ne #4
+            0x5400_0062, // b.hs #0xc
+            0xB4FF_FFE0, // cbz x0, #-4
+            0x3500_0020, // cbnz w0, #4
+            0x3628_0040, // tbz w0, #5, #8
+            0xF941_F001, // ldr x1, [x0, #0x3e0]
+            0x5280_02C0, // mov w0, #0x16
+            0xAA14_03E0, // mov x0, x20
+        ]
+
+        for w in words {
+            let decoded = try #require(ARM64Decoder.decode(w, at: pc))
+            let data = withUnsafeBytes(of: w.littleEndian) { Data($0) }
+            let insn = try #require(disasm.disassembleOne(data, at: UInt64(pc)))
+            #expect(decoded.mnemonic == insn.mnemonic)
+            if let target = decoded.branchTarget {
+                #expect(insn.operandString.hasSuffix(String(format: "#0x%x", target)))
+            }
+        }
+    }
+
+    @Test func unsupportedClassesFallBack() {
+        #expect(ARM64Decoder.decode(0xEB01_001F, at: 0) == nil) // cmp x0, x1
+        #expect(ARM64Decoder.decode(0x9100_03FD, at: 0) == nil) // mov x29, sp
+        #expect(ARM64Decoder.decode(0x5400_002F, at: 0) == nil) // b.nv
+    }
+
+    @Test func windowMatchesSingleDecode() {
+        var data = Data()
+        for w: UInt32 in [ARM64.pacibspU32, 0x3500_0020, 0xEB01_001F, ARM64.retU32] {
+            withUnsafeBytes(of: w.littleEndian) { data.append(contentsOf: $0) }
+        }
+        let window = ARM64Decoder.decodeWindow(in: data, from: 0, count: 8)
+        #expect(window.count == 4)
+        for (i, insn) in window.enumerated() {
+            #expect(insn == ARM64Decoder.decode(in: data, at: i * 4))
+        }
+        #expect(window[2] == nil)
+    }
+}
+
 struct BinaryBufferTests {
     @Test func readWriteU32() {
         let data = Data(repeating: 0, count: 16)
@@ -290,6 +347,24 @@ struct BinaryBufferTests {
         #expect(offsets.contains(20))
     }
 
+    @Test func batchFindAllTracksWrites() {
+        let data = Data("xxabcxxabcxxdefxxab".utf8)
+        let buf = BinaryBuffer(data)
+        let abc = Data("abc".utf8)
+        let def = Data("def".utf8)
+        let found = buf.findAll([abc, def])
+        #expect(found[abc] == [2, 7])
+        #expect(found[def] == [12])
+
+        // A direct mutation drops the cache; a write helper patches it.
+        buf.data.append(Data("c".utf8))
+        #expect(buf.findAll(abc) == [2, 7, 17])
+        buf.writeU32(at: 2, value: 0)
+        #expect(buf.findAll(abc) == [7, 17])
+        #expect(buf.findAll(abc, in: 8 ..< 20) == [17])
+        #expect(buf.findAll(def) == [12])
+    }
+
     @Test func readUnalignedValues() {
         let data = Data([0xFF, 0x78, 0x56, 0x34, 0x12, 0xF0, 0xDE, 0xBC, 0x9A])
         let buf = BinaryBuffer(data)
@@ -298,6 +373,124 @@ struct BinaryBufferTests {
     }
 }
 
+struct KernelCodeIndexTests {
+    /// 64 KiB of NOPs with BLs to 0x8000 every 0x400 bytes and ADRPs to
+    /// page 0x3000 every 0x1000 bytes.
+    func makeCode() throws -> Data {
+        var data = Data(repeating: 0, count: 0x10000)
+        for off in stride(from: 0, to: data.count, by: 4) {
+            data.replaceSubrange(off ..< off + 4, with: ARM64.nop)
+        }
+        for off in stride(from: 0x100, to: data.count, by: 0x400) {
+            try data.replaceSubrange(off ..< off + 4, with: #require(ARM64Encoder.encodeBL(from: off, to: 0x8000)))
+        }
+        for off in stride(from: 0x200, to: data.count, by: 0x1000) {
+            try data.replaceSubrange(off ..< off + 4, with: #require(ARM64Encoder.encodeADRP(rd: 0, pc: UInt64(off), target: 0x3000)))
+        }
+        return data
+    }
+
+    @Test func lookups() throws {
+        let data = try makeCode()
+        let index = KernelCodeIndex(data: data, codeRanges: [(0, data.count)])
+        #expect(index.bl[0x8000].map(Array.init) == Array(stride(from: 0x100, to: data.count, by: 0x400)))
+        #expect(index.adrp[0x3000].map(Array.init) == Array(stride(from: 0x200, to: data.count, by: 0x1000)))
+        #expect(index.bl[0x8004] == nil)
+        #expect(index.bl.count == 1)
+    }
+
+    @Test func shardCutsStayWordAlignedPerRange() {
+        // The first range's odd length leaves the running shard size off a
+        // word boundary when the second range starts.
+        let ranges = [0 ..< 0x20_0001, 0x30_0002 ..< 0x70_0002]
+        let total = ranges.reduce(0) { $0 + $1.count }
+        let shards = KernelCodeIndex.shard(ranges, total: total, cores: 3)
+        #expect(shards.count > 1)
+
+        let pieces = shards.flatMap { $0 }
+        for range in ranges {
+            let inside = pieces.filter { range.contains($0.lowerBound) }
+            #expect(inside.first?.lowerBound == range.lowerBound)
+            #expect(inside.last?.upperBound == range.upperBound)
+            for (lhs, rhs) in zip(inside, inside.dropFirst()) {
+                #expect(lhs.upperBound == rhs.lowerBound)
+            }
+            for piece in inside {
+                #expect((piece.lowerBound - range.lowerBound) % 4 == 0)
+            }
+        }
+    }
+
+    @Test func updateMatchesRebuild() throws {
+        var data = try makeCode()
+        let index = KernelCodeIndex(data: data, codeRanges: [(0, data.count)])
+
+        // NOP one BL and add a new BL to a different target.
+        let newBL = try #require(ARM64Encoder.encodeBL(from: 0x600, to: 0x9000))
+        let records = [
+            PatchRecord(patchID: "a", component: "kernelcache", fileOffset: 0x500,
+                        originalBytes: data[0x500 ..< 0x504], patchedBytes: ARM64.nop, description: "a"),
+            PatchRecord(patchID: "b", component: "kernelcache", fileOffset: 0x600,
+                        originalBytes: data[0x600 ..< 0x604], patchedBytes: newBL, description: "b"),
+        ]
+        for record in records {
+            data.replaceSubrange(record.fileOffset ..< record.fileOffset + 4, with: record.patchedBytes)
+        }
+
+        let updated = index.updated(applying: records, to: data)
+        let rebuilt = KernelCodeIndex(data: data, codeRanges: [(0, data.count)])
+        #expect(updated.bl.pairs.map(\.key) == rebuilt.bl.pairs.map(\.key))
+        #expect(updated.bl.pairs.map(\.offset) == rebuilt.bl.pairs.map(\.offset))
+        #expect(updated.bl[0x9000].map(Array.init) == [0x600])
+        #expect(updated.adrp.pairs.map(\.offset) == rebuilt.adrp.pairs.map(\.offset))
+    }
+
+    @Test func analysisCacheRoundTrip() throws {
+        let data = try makeCode()
+        let index = KernelCodeIndex(data: data, codeRanges: [(0, data.count)])
+        let dir = FileManager.default.temporaryDirectory.appendingPathComponent("kac-\(UUID().uuidString)")
+        defer { try? FileManager.default.removeItem(at: dir) }
+
+        let cache = KernelAnalysisCache(directory: dir)
+        let key = KernelAnalysisCache.key(for: data)
+        #expect(cache.load(key: key) == nil)
+        try cache.store(.init(index: index, panicOffset: 0x8000), key: key)
+
+        let entry = try #require(cache.load(key: key))
+        #expect(entry.panicOffset == 0x8000)
+        #expect(entry.index.matches(codeRanges: [(0, data.count)], byteCount: data.count))
+        #expect(entry.index.bl.pairs.map(\.offset) == index.bl.pairs.map(\.offset))
+        #expect(entry.index.adrp[0x3000].map(Array.init) == index.adrp[0x3000].map(Array.init))
+    }
+
+    @Test func analysisCacheRejectsCorruptFiles() throws {
+        let data = try makeCode()
+        let index = KernelCodeIndex(data: data, codeRanges: [(0, data.count)])
+        let dir = FileManager.default.temporaryDirectory.appendingPathComponent("kac-\(UUID().uuidString)")
+        defer { try? FileManager.default.removeItem(at: dir) }
+
+        let cache = KernelAnalysisCache(directory: dir)
+        let key = KernelAnalysisCache.key(for: data)
+        try cache.store(.init(index: index, panicOffset: nil), key: key)
+        let url = cache.fileURL(forKey: key)
+        let good = try Data(contentsOf: url)
+        #expect(cache.load(key: key) != nil)
+
+        // Last BL offset pointed past the kernel.
+        var outOfBounds = good
+        var huge = Int64(data.count).littleEndian
+        withUnsafeBytes(of: &huge) { outOfBounds.replaceSubrange(good.count - 8 ..< good.count, with: $0) }
+        try outOfBounds.write(to: url)
+        #expect(cache.load(key: key) == nil)
+
+        // Truncated mid-table, and trailing garbage.
+        try good.prefix(good.count - 4).write(to: url)
+        #expect(cache.load(key: key) == nil)
+        try (good + Data([0])).write(to: url)
+        #expect(cache.load(key: key) == nil)
+    }
+}
+
 final class BytePatchPatcher: Patcher {
     let component = "test"
     let verbose = false
@@ -357,6 +550,73 @@ struct FirmwarePipelineDataFlowTests {
     }
 }
 
+struct MappedFirmwareLoaderTests {
+    func makeDirectory() throws -> URL {
+        let dir = FileManager.default.temporaryDirectory.appendingPathComponent("mfl-\(UUID().uuidString)")
+        try FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+        return dir
+    }
+
+    @Test func rawSaveReplacesFileAndKeepsOldMapping() throws {
+        let dir = try makeDirectory()
+        defer { try? FileManager.default.removeItem(at: dir) }
+        let url = dir.appendingPathComponent("AVPBooter.bin")
+        let original = Data(repeating: 0x11, count: 3 * 0x4000)
+        try original.write(to: url)
+
+        let loader = FirmwarePipeline.MappedFirmwareLoader()
+        let loaded = try loader.load(from: url)
+        #expect(loaded == original)
+
+        var patched = loaded
+        patched[0x4001] = 0xAA
+        try loader.save(patched, to: url)
+
+        #expect(try Data(contentsOf: url) == patched)
+        #expect(loaded == original)
+        #expect(try FileManager.default.contentsOfDirectory(atPath: dir.path) == ["AVPBooter.bin"])
+    }
+
+    @Test func dirtyPageWriteHandlesSizeChange() throws {
+        let dir = try makeDirectory()
+        defer { try? FileManager.default.removeItem(at: dir) }
+        let url = dir.appendingPathComponent("raw.bin")
+        try Data(repeating: 0x22, count: 0x100).write(to: url)
+
+        let grown = Data(repeating: 0x33, count: 0x4100)
+        try IM4PHandler.writeDirtyPages(grown, to: url)
+        #expect(try Data(contentsOf: url) == grown)
+        #expect(try FileManager.default.contentsOfDirectory(atPath: dir.path) == ["raw.bin"])
+    }
+
+    @Test func checkpointStartsNewStage() {
+        let buf = BinaryBuffer(Data([0, 0, 0, 0]))
+        buf.writeBytes(at: 0, bytes: Data([0xAA]))
+        #expect(buf.original == Data([0, 0, 0, 0]))
+
+        buf.checkpoint()
+        #expect(buf.original == Data([0xAA, 0, 0, 0]))
+
+        let snap = buf.snapshot()
+        snap.writeBytes(at: 1, bytes: Data([0xBB]))
+        #expect(buf.data == Data([0xAA, 0, 0, 0]))
+        #expect(snap.original == buf.original)
+    }
+
+    @Test func adoptContinuesOnSharedBuffer() {
+        let shared = BinaryBuffer(Data([0, 0, 0, 0]))
+        shared.writeBytes(at: 2, bytes: Data([0xCC]))
+
+        let patcher = KernelPatcherBase(data: Data(count: 4), verbose: false)
+        patcher.adopt(buffer: shared)
+        #expect(patcher.buffer === shared)
+        #expect(patcher.buffer.original == Data([0, 0, 0xCC, 0]))
+
+        patcher.buffer.writeBytes(at: 0, bytes: Data([0xDD]))
+        #expect(shared.data == Data([0xDD, 0, 0xCC, 0]))
+    }
+}
+
 struct IBootPatcherIdempotencyTests {
     @Test func serialLabelsPatchTwoBannerRunsWhenLabelAbsent() {
         let banner = String(repeating: "=", count: 32)
@@ -476,3 +736,226 @@ struct FirmwarePipelineTests {
         #expect(found == target)
     }
 }
+
+struct FirmwarePipelineConcurrencyTests {
+    /// Six components on five files; the last two share a file, so their
+    /// lane must keep list order.
+    private func jobs(in dir: URL) throws -> [(FirmwarePipeline.ComponentDescriptor, URL)] {
+        try (0 ..< 6).map { i in
+            let file = dir.appendingPathComponent("component\(min(i, 4)).bin")
+            if !FileManager.default.fileExists(atPath: file.path) {
+                try Data(repeating: 0, count: 8).write(to: file)
+            }
+            let component = FirmwarePipeline.ComponentDescriptor(
+                name: "c\(i)",
+                inRestoreDir: false,
+                searchPatterns: [],
+                patcherFactories: [
+                    { data, _ in BytePatchPatcher(data: data, offset: i, byte: UInt8(0x10 + i), id: "c\(i).a") },
+                    { data, _ in BytePatchPatcher(data: data, offset: 7, byte: UInt8(0x80 + i), id: "c\(i).b") },
+                ]
+            )
+            return (component, file)
+        }
+    }
+
+    private func run(width: Int) throws -> (records: [[PatchRecord]], files: [String: Data]) {
+        let dir = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: dir) }
+
+        let pipeline = FirmwarePipeline(vmDirectory: dir, verbose: false)
+        let records = try pipeline.patchJobs(jobs(in: dir), width: width)
+        var files: [String: Data] = [:]
+        for name in try FileManager.default.contentsOfDirectory(atPath: dir.path) {
+            files[name] = try Data(contentsOf: dir.appendingPathComponent(name))
+        }
+        return (records, files)
+    }
+
+    @Test func concurrentMatchesSerial() throws {
+        let serial = try run(width: 1)
+        let concurrent = try run(width: 4)
+
+        #expect(concurrent.records == serial.records)
+        #expect(concurrent.files == serial.files)
+        #expect(serial.records.flatMap { $0 }.map(\.patchID).prefix(2) == ["c0.a", "c0.b"])
+        #expect(serial.files["component4.bin"] == Data([0, 0, 0, 0, 0x14, 0x15, 0, 0x85]))
+    }
+
+    @Test func crossFileComponentRunsAfterTheRest() throws {
+        let dir = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: dir) }
+
+        var plain = try jobs(in: dir).prefix(5)
+        let files = plain.map(\.1)
+        let manifestFile = dir.appendingPathComponent("manifest.bin")
+        try Data(repeating: 0, count: 8).write(to: manifestFile)
+        let seen = SeenFiles()
+        var manifest = FirmwarePipeline.ComponentDescriptor(
+            name: "Manifest",
+            inRestoreDir: false,
+            searchPatterns: [],
+            patcherFactories: [{ data, _ in
+                seen.contents = files.map { (try? Data(contentsOf: $0)) ?? Data() }
+                return BytePatchPatcher(data: data, offset: 0, byte: 0xEE, id: "manifest")
+            }]
+        )
+        manifest.readsOtherComponents = true
+        // Listed first, as if a lane could pick it up straight away.
+        plain.insert((manifest, manifestFile), at: plain.startIndex)
+
+        let pipeline = FirmwarePipeline(vmDirectory: dir, verbose: false)
+        let records = try pipeline.patchJobs(Array(plain), width: 4)
+
+        #expect(records.map { $0.map(\.patchID) }.first == ["manifest"])
+        #expect(seen.contents.count == files.count)
+        for (i, contents) in seen.contents.enumerated() {
+            #expect(try Data(contentsOf: files[i]) == contents)
+            #expect(contents.last == UInt8(0x80 + i))
+        }
+    }
+
+    private final class SeenFiles: @unchecked Sendable {
+        var contents: [Data] = []
+    }
+}
+
+struct PatchManifestReplayTests {
+    /// Raw loader whose save writes the file and then fails, like a crash
+    /// before the manifest is completed.
+    private struct InterruptedSaveLoader: FirmwarePipeline.FirmwareLoader {
+        struct Interrupted: Error {}
+
+        func load(from url: URL) throws -> Data {
+            try Data(contentsOf: url)
+        }
+
+        func save(_ data: Data, to url: URL) throws {
+            try data.write(to: url)
+            throw Interrupted()
+        }
+    }
+
+    private final class Counter: @unchecked Sendable {
+        var discoveries = 0
+    }
+
+    private func component(_ counter: Counter) -> FirmwarePipeline.ComponentDescriptor {
+        FirmwarePipeline.ComponentDescriptor(
+            name: "test",
+            inRestoreDir: false,
+            searchPatterns: [],
+            patcherFactories: [{ data, _ in
+                counter.discoveries += 1
+                return BytePatchPatcher(data: data, offset: 1, byte: 0xAA, id: "byte")
+            }]
+        )
+    }
+
+    private func run(
+        _ vmDir: URL, _ file: URL, _ counter: Counter, loader: (any FirmwarePipeline.FirmwareLoader)? = nil
+    ) throws -> [PatchRecord] {
+        let pipeline = FirmwarePipeline(vmDirectory: vmDir, verbose: false, loader: loader)
+        pipeline.openManifest()
+        return try pipeline.patchComponent(component(counter), at: file, patcherVerbose: false) { _ in }
+    }
+
+    private func fixture() throws -> (URL, URL) {
+        let vmDir = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: vmDir, withIntermediateDirectories: true)
+        let file = vmDir.appendingPathComponent("component.bin")
+        try Data([0x00, 0x00, 0x00, 0x00]).write(to: file)
+        return (vmDir, file)
+    }
+
+    @Test func patchedOutputIsSkipped() throws {
+        let (vmDir, file) = try fixture()
+        defer { try? FileManager.default.removeItem(at: vmDir) }
+        let counter = Counter()
+
+        let first = try run(vmDir, file, counter)
+        let second = try run(vmDir, file, counter)
+
+        #expect(counter.discoveries == 1)
+        #expect(second.map(\.patchID) == first.map(\.patchID))
+        #expect(try Data(contentsOf: file) == Data([0x00, 0xAA, 0x00, 0x00]))
+    }
+
+    @Test func unchangedInputReplaysRecords() throws {
+        let (vmDir, file) = try fixture()
+        defer { try? FileManager.default.removeItem(at: vmDir) }
+        let counter = Counter()
+
+        _ = try run(vmDir, file, counter)
+        try Data([0x00, 0x00, 0x00, 0x00]).write(to: file)
+        let replayed = try run(vmDir, file, counter)
+
+        #expect(counter.discoveries == 1)
+        #expect(replayed.map(\.patchID) == ["byte"])
+        #expect(try Data(contentsOf: file) == Data([0x00, 0xAA, 0x00, 0x00]))
+    }
+
+    @Test func interruptedSaveIsNotPatchedTwice() throws {
+        let (vmDir, file) = try fixture()
+        defer { try? FileManager.default.removeItem(at: vmDir) }
+        let counter = Counter()
+
+        #expect(throws: InterruptedSaveLoader.Interrupted.self) {
+            try run(vmDir, file, counter, loader: InterruptedSaveLoader())
+        }
+        let records = try run(vmDir, file, counter)
+
+        #expect(counter.discoveries == 1)
+        #expect(records.map(\.patchID) == ["byte"])
+        #expect(try Data(contentsOf: file) == Data([0x00, 0xAA, 0x00, 0x00]))
+    }
+}
+
+struct PatchProfilerTests {
+    @Test func reportAggregatesRuns() throws {
+        var runs: [[PatchProfiler.Sample]] = []
+        for _ in 0 ..< 3 {
+            let profiler = PatchProfiler()
+            let kernel = profiler.scope("kernelcache")
+            let patcher = kernel.nested("KernelJBPatcher")
+            kernel.measure("KernelJBPatcher") {
+                patcher.measure("patchKcall10") { _ = [UInt8](repeating: 0, count: 4096) }
+                patcher.measure("patchKcall10") {}
+            }
+            kernel.measure("save") {}
+            runs.append(profiler.samples)
+        }
+
+        let report = PatchProfiler.Report(runs: runs, metadata: ["variant": "jb"])
+        #expect(report.entries.map(\.name) == ["patchKcall10", "KernelJBPatcher", "save"])
+        let step = try #require(report.entries.first)
+        #expect(step.scope == "kernelcache/KernelJBPatcher")
+        #expect(step.runs == 3)
+        #expect(step.wallSecondsMin <= step.wallSecondsMedian)
+        #expect(step.wallSecondsMedian <= step.wallSecondsMax)
+
+        let decoded = try JSONDecoder().decode(PatchProfiler.Report.self, from: JSONEncoder().encode(report))
+        #expect(decoded.schema == PatchProfiler.Report.schemaVersion)
+        #expect(decoded.entries.count == 3)
+    }
+}
+
+struct KernelJBConcurrentDiscoveryTests {
+    private func record(_ offset: Int, _ size: Int = 4) -> PatchRecord {
+        PatchRecord(patchID: "p", component: "kernelcache", fileOffset: offset,
+                    originalBytes: Data(count: size), patchedBytes: Data(count: size), description: "p")
+    }
+
+    @Test func overlapAcrossSearches() throws {
+        #expect(KernelJBPatcher.firstOverlap([[record(0x100)], [record(0x104)], []]) == nil)
+        // Overlap inside one search is that search's own business.
+        #expect(KernelJBPatcher.firstOverlap([[record(0x100, 8), record(0x104)]]) == nil)
+
+        let hit = try #require(KernelJBPatcher.firstOverlap([[record(0x200)], [record(0x100, 0x10)], [record(0x108)]]))
+        #expect(hit.0 == 1)
+        #expect(hit.1 == 2)
+        #expect(hit.2 == 0x108)
+    }
+}
@@ -198,4 +198,20 @@ struct KernelcacheJBComparisonTests {
         let refPatches = try loadReference("kernelcache_jb")
         comparePatchRecords(swift: swiftPatches, reference: refPatches, component: "kernelcache_jb")
     }
+
+    @Test func concurrentDiscoveryMatchesSerial() throws {
+        let data = try loadRawPayload("kernelcache.bin")
+        let serial = KernelJBPatcher(data: data, verbose: false)
+        serial.discoveryConcurrency = 1
+        let concurrent = KernelJBPatcher(data: data, verbose: false)
+        concurrent.discoveryConcurrency = 4
+
+        let expected = try serial.findAll()
+        let actual = try concurrent.findAll()
+        #expect(actual.map(\.patchID) == expected.map(\.patchID))
+        #expect(actual.map(\.fileOffset) == expected.map(\.fileOffset))
+        #expect(actual.map(\.patchedBytes) == expected.map(\.patchedBytes))
+        #expect(actual.map(\.originalBytes) == expected.map(\.originalBytes))
+        #expect(concurrent.buffer.data == serial.buffer.data)
+    }
 }